@@ -0,0 +1,559 @@
+/***************************************************************************************************
+ * @file moog_bench.c
+ *
+ * @brief Moog modules micro benchmarks
+ *
+ * @licence MIT License
+ *
+ * Copyright (c) 2019 Jeremie Leclere
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy of this software and
+ * associated documentation files (the "Software"), to deal in the Software without restriction,
+ * including without limitation the rights to use, copy, modify, merge, publish, distribute,
+ * sublicense, and/or sell copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all copies or
+ * substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR IMPLIED, INCLUDING BUT
+ * NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND
+ * NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM,
+ * DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ **************************************************************************************************/
+
+#include <time.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <getopt.h>
+
+#include <log.h>
+#include <moog.h>
+#include <adsr.h>
+#include <wave_gen.h>
+#include <low_pass.h>
+#include <voice_pool.h>
+#include <render_bench.h>
+#include <quality_bench.h>
+#include <voices_bench.h>
+
+
+#define DFT_FS              (48000)             ///< Default sampling frequency (Hz)
+#define DFT_DURATION        (20)                ///< Default audio duration per measure (s)
+#define DFT_MAX_EXPONENT    (4)                 ///< Default largest rendered sequence (10^4 events)
+#define DFT_RENDER_OUTPUT   ("/dev/null")       ///< Default rendered WAV file
+#define DFT_TMP_DIR         ("/tmp")            ///< Default generated files directory
+#define BENCH_F0            (110.0)             ///< Oscillators frequency (Hz)
+#define BENCH_INTENSITY     (0.5)               ///< Oscillators / ADSR intensity
+#define BENCH_NOTE_LEN      (0.25)              ///< Note ON/OFF toggling period (s)
+
+#define NB_FRAME_SIZES      (4)
+static int frame_sizes[NB_FRAME_SIZES] = {
+    64,                 ///< Small real time block
+    256,                ///< Usual real time block
+    1024,               ///< Large real time block
+    7659                ///< Sixteenth note at 94 BPM, 48kHz (lilymoog default)
+};
+
+
+/* Benchmarked module descriptor */
+struct bench_ctx {
+    float fs;
+    int frame_size;
+    int block_size;
+    void *handle;
+    int32_t *in;
+    int32_t *out;
+    float *in_fl;
+    float *out_fl;
+    float *enveloppe;
+};
+
+
+struct bench {
+    const char *name;
+    int (*setup)(struct bench_ctx *ctx);
+    int (*process)(struct bench_ctx *ctx);
+    void (*teardown)(struct bench_ctx *ctx);
+    int (*toggle)(struct bench_ctx *ctx, int state);    ///< Note ON/OFF (NULL if irrelevant)
+};
+
+
+static double now(void)
+{
+    struct timespec ts;
+
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+
+    return ts.tv_sec + ts.tv_nsec * 1e-9;
+}
+
+
+/* Low pass filter */
+static int lpf_setup(struct bench_ctx *ctx)
+{
+    int i;
+    struct low_pass_params params;
+
+    params.Q    = 1.5;
+    params.gain = 1.0;
+    params.fc   = 1000.0;
+    params.fs   = ctx->fs;
+    ctx->handle = low_pass_create(&params);
+    if (!ctx->handle)
+        return -ENOMEM;
+
+    /* Full scale pseudo random input */
+    srand(0);
+    for (i = 0; i < ctx->frame_size; i++) {
+        ctx->in[i]    = (rand() % (1 << 23)) - (1 << 22);
+        ctx->in_fl[i] = ctx->in[i] / (float)(1 << 23);
+    }
+
+    return 0;
+}
+
+static int lpf_process(struct bench_ctx *ctx)
+{
+    return low_pass_process(ctx->handle, ctx->in, ctx->frame_size, ctx->out);
+}
+
+static int lpf_float_process(struct bench_ctx *ctx)
+{
+    return low_pass_process_float(ctx->handle, ctx->in_fl, ctx->frame_size, ctx->out_fl);
+}
+
+static void lpf_teardown(struct bench_ctx *ctx)
+{
+    low_pass_destroy((struct low_pass **)&ctx->handle);
+}
+
+
+/* Waveform generators */
+static int wave_setup(struct bench_ctx *ctx, enum wave_gen_mode mode)
+{
+    struct wave_gen_params params;
+
+    params.fs        = ctx->fs;
+    params.f0        = BENCH_F0;
+    params.intensity = BENCH_INTENSITY;
+    params.mode      = mode;
+    ctx->handle = wave_gen_create(&params);
+    if (!ctx->handle)
+        return -ENOMEM;
+
+    return 0;
+}
+
+static int saw_setup(struct bench_ctx *ctx)
+{
+    return wave_setup(ctx, WAVE_MODE_SAW);
+}
+
+static int sine_setup(struct bench_ctx *ctx)
+{
+    return wave_setup(ctx, WAVE_MODE_SINE);
+}
+
+static int square_setup(struct bench_ctx *ctx)
+{
+    return wave_setup(ctx, WAVE_MODE_SQUARE);
+}
+
+static int saw_bl_setup(struct bench_ctx *ctx)
+{
+    return wave_setup(ctx, WAVE_MODE_SAW_BL);
+}
+
+static int square_bl_setup(struct bench_ctx *ctx)
+{
+    return wave_setup(ctx, WAVE_MODE_SQUARE_BL);
+}
+
+static int wave_process(struct bench_ctx *ctx)
+{
+    return wave_gen_process(ctx->handle, ctx->frame_size, ctx->out);
+}
+
+static void wave_teardown(struct bench_ctx *ctx)
+{
+    wave_gen_destroy((struct wave_gen **)&ctx->handle);
+}
+
+
+/* ADSR */
+static int adsr_setup(struct bench_ctx *ctx)
+{
+    struct adsr_params params;
+
+    params.fs      = ctx->fs;
+    params.attack  = 20;
+    params.decay   = 5;
+    params.sustain = 0.9;
+    params.release = 15;
+    ctx->handle = adsr_create(&params);
+    if (!ctx->handle)
+        return -ENOMEM;
+
+    return 0;
+}
+
+static int adsr_bench_process(struct bench_ctx *ctx)
+{
+    return adsr_process(ctx->handle, ctx->frame_size, ctx->enveloppe);
+}
+
+static int adsr_bench_toggle(struct bench_ctx *ctx, int state)
+{
+    return adsr_toggle(ctx->handle, state, BENCH_INTENSITY);
+}
+
+static void adsr_teardown(struct bench_ctx *ctx)
+{
+    adsr_destroy((struct adsr **)&ctx->handle);
+}
+
+
+/* Full Moog chain */
+static int moog_setup_format(struct bench_ctx *ctx, enum moog_sample_format sample_format)
+{
+    struct moog_params params;
+
+    params.fs            = ctx->fs;
+    params.block_size    = ctx->block_size;
+    params.sample_format = sample_format;
+    params.fc            = 1000;
+    params.Q             = 1;
+    params.gain          = 1;
+    params.attack_time   = 20;
+    params.decay_time    = 5;
+    params.sustain       = 0.9;
+    params.release_time  = 15;
+    params.osc_mode      = WAVE_MODE_SAW;
+    params.coupling      = MOOG_OSC_COUPLING_FIFTH;
+    ctx->handle = moog_create(&params);
+    if (!ctx->handle)
+        return -ENOMEM;
+
+    moog_set_intensity(ctx->handle, BENCH_INTENSITY);
+    moog_set_frequency(ctx->handle, BENCH_F0);
+
+    return 0;
+}
+
+static int moog_setup(struct bench_ctx *ctx)
+{
+    return moog_setup_format(ctx, MOOG_SAMPLE_FORMAT_FIXED);
+}
+
+static int moog_float_setup(struct bench_ctx *ctx)
+{
+    return moog_setup_format(ctx, MOOG_SAMPLE_FORMAT_FLOAT);
+}
+
+static int moog_bench_process(struct bench_ctx *ctx)
+{
+    return moog_process(ctx->handle, NULL, 0, ctx->frame_size, ctx->out);
+}
+
+static int moog_float_process(struct bench_ctx *ctx)
+{
+    return moog_process_float(ctx->handle, NULL, 0, ctx->frame_size, ctx->out_fl);
+}
+
+static int moog_bench_toggle(struct bench_ctx *ctx, int state)
+{
+    return moog_toggle(ctx->handle, state);
+}
+
+static void moog_teardown(struct bench_ctx *ctx)
+{
+    moog_destroy((struct moog **)&ctx->handle);
+}
+
+
+#define NB_BENCHES      (10)
+static struct bench benches[NB_BENCHES] = {
+    {"low_pass",    lpf_setup,      lpf_process,        lpf_teardown,   NULL},
+    {"low_pass_fl", lpf_setup,      lpf_float_process,  lpf_teardown,   NULL},
+    {"saw_gen",     saw_setup,      wave_process,       wave_teardown,  NULL},
+    {"sine_gen",    sine_setup,     wave_process,       wave_teardown,  NULL},
+    {"square_gen",  square_setup,   wave_process,       wave_teardown,  NULL},
+    {"saw_bl_gen",  saw_bl_setup,   wave_process,       wave_teardown,  NULL},
+    {"square_bl_gen", square_bl_setup, wave_process,    wave_teardown,  NULL},
+    {"adsr",        adsr_setup,     adsr_bench_process, adsr_teardown,  adsr_bench_toggle},
+    {"moog",        moog_setup,     moog_bench_process, moog_teardown,  moog_bench_toggle},
+    {"moog_fl",     moog_float_setup, moog_float_process, moog_teardown, moog_bench_toggle},
+};
+
+
+static int run_bench(struct bench *bench, float fs, int frame_size, int block_size, float duration)
+{
+    int ret = 0;
+    int state = 0;
+    double start, elapsed;
+    long i, nb_calls, toggle_period;
+    struct bench_ctx ctx;
+
+    memset(&ctx, 0, sizeof(struct bench_ctx));
+    ctx.fs         = fs;
+    ctx.frame_size = frame_size;
+    ctx.block_size = block_size;
+    ctx.in         = (int32_t *)calloc(frame_size, sizeof(int32_t));
+    ctx.out        = (int32_t *)calloc(frame_size, sizeof(int32_t));
+    ctx.in_fl      = (float *)calloc(frame_size, sizeof(float));
+    ctx.out_fl     = (float *)calloc(frame_size, sizeof(float));
+    ctx.enveloppe  = (float *)calloc(frame_size, sizeof(float));
+    if ((!ctx.in) || (!ctx.out) || (!ctx.in_fl) || (!ctx.out_fl) || (!ctx.enveloppe)) {
+        ret = -ENOMEM;
+        goto exit;
+    }
+
+    ret = bench->setup(&ctx);
+    if (ret)
+        goto exit;
+
+    nb_calls      = (long)(duration * fs / frame_size) + 1;
+    toggle_period = (long)(BENCH_NOTE_LEN * fs / frame_size) + 1;
+
+    /* Warm up caches and branch predictors */
+    for (i = 0; i < toggle_period; i++)
+        bench->process(&ctx);
+
+    start = now();
+    for (i = 0; i < nb_calls; i++) {
+        /* Note transitions refused by the ADSR are silently ignored */
+        if ((bench->toggle) && (i % toggle_period == 0)) {
+            state = !state;
+            bench->toggle(&ctx, state);
+        }
+        bench->process(&ctx);
+    }
+    elapsed = now() - start;
+
+    printf("%-14s %8d %12.2f %14.0f %12.1f\n",
+           bench->name,
+           frame_size,
+           elapsed * 1e9 / (nb_calls * frame_size),
+           nb_calls * frame_size / elapsed,
+           nb_calls * frame_size / fs / elapsed);
+
+    bench->teardown(&ctx);
+
+exit:
+
+    if (ctx.in)
+        free(ctx.in);
+    if (ctx.out)
+        free(ctx.out);
+    if (ctx.in_fl)
+        free(ctx.in_fl);
+    if (ctx.out_fl)
+        free(ctx.out_fl);
+    if (ctx.enveloppe)
+        free(ctx.enveloppe);
+
+    return ret;
+}
+
+
+static void usage(const char *exec_name)
+{
+    LOGI("%s [-f FS] [-d DURATION] [-m MODULE] [-b BLOCK_SIZE]", exec_name);
+    LOGI("%s -r [-n MAX_EXPONENT] [-f FS] [-t TEMPO] [-o OUTPUT_FILE] [-T TMP_DIR]", exec_name);
+    LOGI("%s -q [-f FS] [-d DURATION]", exec_name);
+    LOGI("%s -v [-f FS] [-d DURATION] [-b BLOCK_SIZE]", exec_name);
+    LOGI("");
+    LOGI("    Moog modules micro benchmarks, end to end rendering benchmark (-r), waveform");
+    LOGI("    generators quality versus cost benchmark (-q), or polyphony benchmark (-v)");
+    LOGI("");
+    LOGI(" -f FS");
+    LOGI("    Sampling frequency, in Hz (default: %d for micro benchmarks, [44100, 48000,", DFT_FS);
+    LOGI("    96000, 192000] for rendering benchmark)");
+    LOGI("");
+    LOGI(" -d DURATION");
+    LOGI("    Audio duration processed per measure, in seconds (default: %d)", DFT_DURATION);
+    LOGI("");
+    LOGI(" -m MODULE");
+    LOGI("    Only run specified module benchmark, in ['low_pass', 'low_pass_fl', 'saw_gen',");
+    LOGI("    'sine_gen', 'square_gen', 'saw_bl_gen', 'square_bl_gen', 'adsr', 'moog', 'moog_fl']");
+    LOGI("    (default: all)");
+    LOGI("");
+    LOGI(" -b BLOCK_SIZE");
+    LOGI("    Moog internal processing block size, in samples (default: %d)", MOOG_DFT_BLOCK_SIZE);
+    LOGI("");
+    LOGI(" -r");
+    LOGI("    Render synthetic scripts of 10^3 to 10^MAX_EXPONENT events through the whole");
+    LOGI("    lilymoog pipeline, and report parse, render and write times and peak RSS.");
+    LOGI("");
+    LOGI(" -q");
+    LOGI("    Report harmonic to noise ratio (aliasing, pitch errors) and processing cost of saw");
+    LOGI("    and square generators, naive and band limited, at a few notes.");
+    LOGI("");
+    LOGI(" -v");
+    LOGI("    Report processing cost of voice pools of 1 to %d voices, playing chords that",
+         VOICE_POOL_MAX_VOICES);
+    LOGI("    fill every voice (overlapping release tails, voice stealing).");
+    LOGI("");
+    LOGI(" -n MAX_EXPONENT");
+    LOGI("    Largest rendered script, as a power of 10 events (default: %d, max: 7)",
+         DFT_MAX_EXPONENT);
+    LOGI("");
+    LOGI(" -t TEMPO");
+    LOGI("    Rendering tempo, in BPM (default: [60, 120, 300])");
+    LOGI("");
+    LOGI(" -o OUTPUT_FILE");
+    LOGI("    Rendered WAV file (default: '%s')", DFT_RENDER_OUTPUT);
+    LOGI("");
+    LOGI(" -T TMP_DIR");
+    LOGI("    Generated configuration and script files directory (default: '%s')", DFT_TMP_DIR);
+    LOGI("");
+}
+
+
+int main(int argc, char *argv[])
+{
+    int i, j, c;
+    float fs = 0;
+    int render = 0;
+    int quality = 0;
+    int voices = 0;
+    char *module = NULL;
+    int g_ret = EXIT_SUCCESS;
+    float duration = DFT_DURATION;
+    int block_size = MOOG_DFT_BLOCK_SIZE;
+    struct render_bench_params r_params;
+    struct quality_bench_params q_params;
+    struct voices_bench_params v_params;
+
+    r_params.max_exponent = DFT_MAX_EXPONENT;
+    r_params.tempo        = 0;
+    r_params.output       = DFT_RENDER_OUTPUT;
+    r_params.tmp_dir      = DFT_TMP_DIR;
+
+    while ((c = getopt(argc, argv, "hf:d:m:b:rqvn:t:o:T:")) != -1) {
+        switch (c) {
+        case 'h':
+            usage(argv[0]);
+            goto exit;
+        case 'f':
+            fs = atof(optarg);
+            if (fs <= 0) {
+                LOGE("Unexpected FS value (%f)", fs);
+                g_ret = -EINVAL;
+                goto exit;
+            }
+        break;
+        case 'd':
+            duration = atof(optarg);
+            if (duration <= 0) {
+                LOGE("Unexpected DURATION value (%f)", duration);
+                g_ret = -EINVAL;
+                goto exit;
+            }
+        break;
+        case 'm':
+            module = optarg;
+        break;
+        case 'b':
+            block_size = atoi(optarg);
+            if ((block_size < MOOG_MIN_BLOCK_SIZE) || (block_size > MOOG_MAX_BLOCK_SIZE)) {
+                LOGE("Unexpected BLOCK_SIZE value (%d)", block_size);
+                g_ret = -EINVAL;
+                goto exit;
+            }
+        break;
+        case 'r':
+            render = 1;
+        break;
+        case 'q':
+            quality = 1;
+        break;
+        case 'v':
+            voices = 1;
+        break;
+        case 'n':
+            r_params.max_exponent = atoi(optarg);
+            if ((r_params.max_exponent < 3) || (r_params.max_exponent > 7)) {
+                LOGE("Unexpected MAX_EXPONENT value (%d)", r_params.max_exponent);
+                g_ret = -EINVAL;
+                goto exit;
+            }
+        break;
+        case 't':
+            r_params.tempo = atof(optarg);
+            if (r_params.tempo <= 0) {
+                LOGE("Unexpected TEMPO value (%f)", r_params.tempo);
+                g_ret = -EINVAL;
+                goto exit;
+            }
+        break;
+        case 'o':
+            r_params.output = optarg;
+        break;
+        case 'T':
+            r_params.tmp_dir = optarg;
+        break;
+        case '?':
+            g_ret = EXIT_FAILURE;
+            usage(argv[0]);
+            goto exit;
+        }
+    }
+
+    if (render) {
+        r_params.fs = fs;
+        if (render_bench_run(&r_params)) {
+            LOGE("Rendering benchmark failure");
+            g_ret = EXIT_FAILURE;
+        }
+        goto exit;
+    }
+
+    if (fs == 0)
+        fs = DFT_FS;
+
+    if (quality) {
+        q_params.fs       = fs;
+        q_params.duration = duration;
+        if (quality_bench_run(&q_params)) {
+            LOGE("Quality benchmark failure");
+            g_ret = EXIT_FAILURE;
+        }
+        goto exit;
+    }
+
+    if (voices) {
+        v_params.fs         = fs;
+        v_params.duration   = duration;
+        v_params.block_size = block_size;
+        if (voices_bench_run(&v_params)) {
+            LOGE("Voices benchmark failure");
+            g_ret = EXIT_FAILURE;
+        }
+        goto exit;
+    }
+
+    printf("fs: %.0f Hz, %.1f s of audio per measure, Moog block size: %d\n\n",
+           fs, duration, block_size);
+    printf("%-14s %8s %12s %14s %12s\n",
+           "module", "frame", "ns/sample", "samples/s", "realtime x");
+
+    for (i = 0; i < NB_BENCHES; i++) {
+        if ((module) && (strcmp(module, benches[i].name) != 0))
+            continue;
+        for (j = 0; j < NB_FRAME_SIZES; j++) {
+            if (run_bench(&benches[i], fs, frame_sizes[j], block_size, duration)) {
+                LOGE("%s benchmark failure (frame size: %d)", benches[i].name, frame_sizes[j]);
+                g_ret = EXIT_FAILURE;
+                goto exit;
+            }
+        }
+    }
+
+exit:
+
+    return g_ret;
+}
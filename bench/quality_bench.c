@@ -0,0 +1,226 @@
+/***************************************************************************************************
+ * @file quality_bench.c
+ *
+ * @brief Waveform generators quality versus cost benchmark (sources)
+ *
+ * @licence MIT License
+ *
+ * Copyright (c) 2019 Jeremie Leclere
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy of this software and
+ * associated documentation files (the "Software"), to deal in the Software without restriction,
+ * including without limitation the rights to use, copy, modify, merge, publish, distribute,
+ * sublicense, and/or sell copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all copies or
+ * substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR IMPLIED, INCLUDING BUT
+ * NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND
+ * NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM,
+ * DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ **************************************************************************************************/
+
+#include <math.h>
+#include <time.h>
+#include <stdio.h>
+#include <stdlib.h>
+
+#include <log.h>
+#include <wave_gen.h>
+#include <quality_bench.h>
+
+
+#define FFT_SHIFT           (16)                ///< log2(analysed frames)
+#define FFT_LEN             (1 << FFT_SHIFT)    ///< Analysed frames
+#define LOBE_HALF_WIDTH     (6)                 ///< Window main lobe half width (bins)
+#define FRAME_SIZE          (256)               ///< Cost measure frame size
+#define INTENSITY           (0.5)               ///< Generators intensity
+
+#define NB_MODES            (4)
+static struct {
+    const char *name;
+    enum wave_gen_mode mode;
+} modes[NB_MODES] = {
+    {"saw",         WAVE_MODE_SAW},
+    {"saw_bl",      WAVE_MODE_SAW_BL},
+    {"square",      WAVE_MODE_SQUARE},
+    {"square_bl",   WAVE_MODE_SQUARE_BL},
+};
+
+#define NB_NOTES            (3)
+static float notes[NB_NOTES] = {
+    110.0,              ///< A2
+    880.0,              ///< A5
+    3520.0              ///< A7
+};
+
+
+static double now(void)
+{
+    struct timespec ts;
+
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+
+    return ts.tv_sec + ts.tv_nsec * 1e-9;
+}
+
+
+/* In place radix 2 complex FFT */
+static void fft(double *re, double *im)
+{
+    int i, j, k, len;
+    double wr, wi, cr, ci, tr, ti, tmp;
+
+    /* Bit reversal permutation */
+    for (i = 1, j = 0; i < FFT_LEN; i++) {
+        for (k = FFT_LEN >> 1; j & k; k >>= 1)
+            j ^= k;
+        j |= k;
+        if (i < j) {
+            tmp = re[i]; re[i] = re[j]; re[j] = tmp;
+            tmp = im[i]; im[i] = im[j]; im[j] = tmp;
+        }
+    }
+
+    for (len = 2; len <= FFT_LEN; len <<= 1) {
+        for (i = 0; i < FFT_LEN; i += len) {
+            for (k = 0; k < len / 2; k++) {
+                wr = cos(-2 * M_PI * k / len);
+                wi = sin(-2 * M_PI * k / len);
+                cr = re[i + k + len / 2];
+                ci = im[i + k + len / 2];
+                tr = cr * wr - ci * wi;
+                ti = cr * wi + ci * wr;
+                re[i + k + len / 2] = re[i + k] - tr;
+                im[i + k + len / 2] = im[i + k] - ti;
+                re[i + k] += tr;
+                im[i + k] += ti;
+            }
+        }
+    }
+}
+
+
+/* Harmonic to noise ratio (dB) of given generated frames
+ *
+ *  Frames are windowed (4 terms Blackman-Harris, side lobes below -92 dB): bins lying within the
+ * window main lobe around a harmonic of f0 are accounted as signal, others (but DC) as noise.
+ */
+static double harmonic_to_noise(const int32_t *frames, float fs, float f0, double *re, double *im)
+{
+    int i, h;
+    double w, center, power;
+    double signal = 0, noise = 0;
+
+    for (i = 0; i < FFT_LEN; i++) {
+        w = 0.35875
+          - 0.48829 * cos(2 * M_PI * i / FFT_LEN)
+          + 0.14128 * cos(4 * M_PI * i / FFT_LEN)
+          - 0.01168 * cos(6 * M_PI * i / FFT_LEN);
+        re[i] = w * frames[i];
+        im[i] = 0;
+    }
+
+    fft(re, im);
+
+    for (i = LOBE_HALF_WIDTH + 1; i <= FFT_LEN / 2; i++) {
+        power  = re[i] * re[i] + im[i] * im[i];
+        h      = (int)floor((double)i * fs / FFT_LEN / f0 + 0.5);
+        center = h * f0 * FFT_LEN / fs;
+        if ((h > 0) && (fabs(i - center) <= LOBE_HALF_WIDTH))
+            signal += power;
+        else
+            noise += power;
+    }
+
+    return 10 * log10(signal / noise);
+}
+
+
+/* Processing cost (ns/sample) of given generator */
+static double cost(struct wave_gen *gen, float fs, float duration, int32_t *frames)
+{
+    long i, nb_calls;
+    double start;
+
+    nb_calls = (long)(duration * fs / FRAME_SIZE) + 1;
+
+    start = now();
+    for (i = 0; i < nb_calls; i++)
+        wave_gen_process(gen, FRAME_SIZE, frames);
+
+    return (now() - start) * 1e9 / (nb_calls * FRAME_SIZE);
+}
+
+
+int quality_bench_run(const struct quality_bench_params *params)
+{
+    int i, j, ret = 0;
+    double hnr, ns_per_sample;
+    double *re = NULL, *im = NULL;
+    int32_t *frames = NULL;
+    struct wave_gen *gen = NULL;
+    struct wave_gen_params g_params;
+
+    if ((!params) || (params->fs <= 0) || (params->duration <= 0)) {
+        ret = -EINVAL;
+        goto exit;
+    }
+
+    re     = (double *)calloc(FFT_LEN, sizeof(double));
+    im     = (double *)calloc(FFT_LEN, sizeof(double));
+    frames = (int32_t *)calloc(FFT_LEN, sizeof(int32_t));
+    if ((!re) || (!im) || (!frames)) {
+        ret = -ENOMEM;
+        goto exit;
+    }
+
+    printf("fs: %.0f Hz, %d frames analysed, %.1f s of audio per cost measure\n\n",
+           params->fs, FFT_LEN, params->duration);
+    printf("%-12s %8s %10s %12s\n", "waveform", "f0", "HNR (dB)", "ns/sample");
+
+    for (i = 0; i < NB_MODES; i++) {
+        for (j = 0; j < NB_NOTES; j++) {
+
+            if (notes[j] >= params->fs / 2)
+                continue;
+
+            g_params.fs        = params->fs;
+            g_params.f0        = notes[j];
+            g_params.intensity = INTENSITY;
+            g_params.mode      = modes[i].mode;
+            gen = wave_gen_create(&g_params);
+            if (!gen) {
+                LOGE("%s generator creation failure", modes[i].name);
+                ret = -ENOMEM;
+                goto exit;
+            }
+
+            ret = wave_gen_process(gen, FFT_LEN, frames);
+            if (ret)
+                goto exit;
+
+            hnr           = harmonic_to_noise(frames, params->fs, notes[j], re, im);
+            ns_per_sample = cost(gen, params->fs, params->duration, frames);
+
+            printf("%-12s %8.0f %10.1f %12.2f\n", modes[i].name, notes[j], hnr, ns_per_sample);
+
+            wave_gen_destroy(&gen);
+        }
+    }
+
+exit:
+
+    wave_gen_destroy(&gen);
+    if (re)
+        free(re);
+    if (im)
+        free(im);
+    if (frames)
+        free(frames);
+
+    return ret;
+}
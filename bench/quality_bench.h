@@ -0,0 +1,57 @@
+/***************************************************************************************************
+ * @file quality_bench.h
+ *
+ * @brief Waveform generators quality versus cost benchmark (headers)
+ *
+ * @licence MIT License
+ *
+ * Copyright (c) 2019 Jeremie Leclere
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy of this software and
+ * associated documentation files (the "Software"), to deal in the Software without restriction,
+ * including without limitation the rights to use, copy, modify, merge, publish, distribute,
+ * sublicense, and/or sell copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all copies or
+ * substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR IMPLIED, INCLUDING BUT
+ * NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND
+ * NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM,
+ * DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ **************************************************************************************************/
+
+#ifndef _QUALITY_BENCH_H_
+#define _QUALITY_BENCH_H_
+
+
+#include <errno.h>
+
+
+/**
+ * @brief Quality benchmark parameters
+ */
+struct quality_bench_params {
+    float fs;                               ///< Sampling frequency (Hz)
+    float duration;                         ///< Audio duration processed per cost measure (s)
+};
+
+
+/**
+ * @brief Run waveform generators quality versus cost benchmark
+ *
+ *  Each saw and square generator (naive and band limited) is run at a few notes, and its
+ * harmonic to noise ratio is reported along with its processing cost. The ratio compares the
+ * power of expected harmonics (multiples of the note frequency) to the power of any other
+ * spectral component: aliasing, but also wrong pitch.
+ *
+ * @param[in] params    : Benchmark parameters
+ *
+ * @return 0 if successful, 0 > errno else
+ */
+int quality_bench_run(const struct quality_bench_params *params);
+
+
+#endif /* _QUALITY_BENCH_H_ */
@@ -0,0 +1,341 @@
+/***************************************************************************************************
+ * @file render_bench.c
+ *
+ * @brief End to end rendering scaling benchmark (sources)
+ *
+ * @licence MIT License
+ *
+ * Copyright (c) 2019 Jeremie Leclere
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy of this software and
+ * associated documentation files (the "Software"), to deal in the Software without restriction,
+ * including without limitation the rights to use, copy, modify, merge, publish, distribute,
+ * sublicense, and/or sell copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all copies or
+ * substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR IMPLIED, INCLUDING BUT
+ * NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND
+ * NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM,
+ * DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ **************************************************************************************************/
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+#include <sys/wait.h>
+
+#include <log.h>
+#include <stats.h>
+#include <sequencer.h>
+#include <cfg_parser.h>
+#include <seq_parser.h>
+#include <wav_writer.h>
+#include <render_bench.h>
+
+
+#define MIN_EXPONENT        (3)                 ///< Smallest sequence: 10^3 events
+#define EVENTS_PER_LINE     (16)
+#define MIN_RANK            (1)                 ///< Lowest generated octave
+#define MAX_RANK            (5)                 ///< Highest generated octave
+#define START_RANK          (2)                 ///< Sequencer default octave
+
+#define NB_FS               (4)
+static float fs_grid[NB_FS] = {44100, 48000, 96000, 192000};
+
+#define NB_TEMPOS           (3)
+static float tempo_grid[NB_TEMPOS] = {60, 120, 300};
+
+static const char *notes[] = {"a", "bb", "b", "c", "cd", "d", "eb", "e", "f", "fd", "g", "ab"};
+static const int lengths[] = {16, 8, 4};
+
+
+static float rand_range(float min, float max)
+{
+    return min + (max - min) * ((float)rand() / RAND_MAX);
+}
+
+
+/* Write a configuration file (default settings, with provided fs and tempo) */
+static int write_config(const char *filename, float fs, float tempo)
+{
+    FILE *fd;
+
+    fd = fopen(filename, "w");
+    if (!fd)
+        return -EINVAL;
+
+    fprintf(fd, "# lilymoog render benchmark configuration\n");
+    fprintf(fd, "tempo=%f\n", tempo);
+    fprintf(fd, "fs=%f\n", fs);
+    fprintf(fd, "lp_fc=1000\n");
+    fprintf(fd, "lp_Q=1\n");
+    fprintf(fd, "attack_time=20\n");
+    fprintf(fd, "decay_time=5\n");
+    fprintf(fd, "sustain=0.9\n");
+    fprintf(fd, "release_time=15\n");
+    fprintf(fd, "waveform=saw\n");
+    fprintf(fd, "coupling=fifth\n");
+    fprintf(fd, "intensity=0.3\n");
+
+    fclose(fd);
+
+    return 0;
+}
+
+
+/*
+ * Write a random script of nb_events events
+ *
+ *  Generated events always respect the sequencer constraints: octave kept in
+ * a sensible range, and filter updates never mixed with a sweep in a single
+ * event (sweeps are always over by the end of the note they're attached to).
+ */
+static int write_script(const char *filename, long nb_events)
+{
+    long i;
+    FILE *fd;
+    int rank = START_RANK;
+
+    fd = fopen(filename, "w");
+    if (!fd)
+        return -EINVAL;
+
+    srand(nb_events);
+
+    for (i = 0; i < nb_events; i++) {
+
+        /* Note or rest */
+        if (rand() % 8 == 0) {
+            fprintf(fd, "r");
+        } else {
+            fprintf(fd, "%s", notes[rand() % 12]);
+            if ((rand() % 4 == 0) && (rank < MAX_RANK)) {
+                fprintf(fd, "'");
+                rank++;
+            } else if ((rand() % 4 == 0) && (rank > MIN_RANK)) {
+                fprintf(fd, ",");
+                rank--;
+            }
+        }
+
+        /* Length update */
+        if (rand() % 4 == 0)
+            fprintf(fd, "%d", lengths[rand() % 3]);
+
+        /* Low pass filter section */
+        switch (rand() % 8) {
+        case 0:
+            fprintf(fd, "[fc:%.0f,q:%.1f]", rand_range(100, 5000), rand_range(0.5, 5));
+            break;
+        case 1:
+            fprintf(fd, "[fc:%.0f]", rand_range(100, 5000));
+            break;
+        case 2:
+            fprintf(fd, "[fcs:%.0f]", rand_range(50, 5000));
+            break;
+        default:
+            break;
+        }
+
+        /* Blank lines would be counted as events by the parser */
+        if (((i + 1) % EVENTS_PER_LINE == 0) || (i + 1 == nb_events))
+            fprintf(fd, "\n");
+        else
+            fprintf(fd, " ");
+    }
+
+    fclose(fd);
+
+    return 0;
+}
+
+
+/* Child process: parse, render and write, then report */
+static int render_child(const char *cfg_file, const char *seq_file, const char *output,
+                        long nb_events)
+{
+    int i, ret = 0;
+    struct cfg config;
+    struct stats stats;
+    struct seq sequence;
+    uint64_t timestamp;
+    double audio, parse, render, write;
+    struct wav_writer *wav = NULL;
+    struct sequencer *sequencer = NULL;
+    struct wav_writer_params wav_params;
+
+    sequence.events = NULL;
+
+    stats_init(&stats);
+    timestamp = stats_now();
+    ret = parse_cfg(cfg_file, &config);
+    if (ret)
+        goto exit;
+    ret = parse_sequence(seq_file, &sequence);
+    if (ret)
+        goto exit;
+    stats.elapsed[STATS_PARSE] += stats_now() - timestamp;
+
+    sequencer = sequencer_create(&config);
+    if (!sequencer) {
+        ret = -ENOMEM;
+        goto exit;
+    }
+
+    wav_params.fs          = config.m_params.fs;
+    wav_params.format      = (config.m_params.sample_format == MOOG_SAMPLE_FORMAT_FLOAT) ?
+                             WAV_WRITER_FORMAT_FLOAT : WAV_WRITER_FORMAT_PCM;
+    wav_params.bit_depth   = 32;
+    wav_params.nb_channels = 1;
+    wav_params.filename    = output;
+    wav = wav_writer_create(&wav_params);
+    if (!wav) {
+        ret = -EINVAL;
+        goto exit;
+    }
+
+    ret = sequencer_run(sequencer, &sequence, 0, 4, wav, &stats);
+    if (ret)
+        goto exit;
+
+    /* Header writing and file flushing belong to write time */
+    timestamp = stats_now();
+    wav_writer_destroy(&wav);
+    stats.elapsed[STATS_WRITE] += stats_now() - timestamp;
+
+    audio  = stats.nb_samples / stats.fs;
+    parse  = stats.elapsed[STATS_PARSE] * 1e-9;
+    write  = stats.elapsed[STATS_WRITE] * 1e-9;
+    render = 0;
+    for (i = STATS_ADSR; i <= STATS_SHIFT; i++)
+        render += stats.elapsed[i] * 1e-9;
+
+    printf("%10ld %8.0f %6.0f %10.1f %9.3f %9.3f %9.3f %10.1f %9.1f\n",
+           nb_events,
+           config.m_params.fs,
+           config.tempo,
+           audio,
+           parse,
+           render,
+           write,
+           audio / (parse + render + write),
+           stats_peak_rss() / 1024.0);
+    fflush(stdout);
+
+exit:
+
+    if (sequence.events)
+        free(sequence.events);
+
+    sequencer_destroy(&sequencer);
+    wav_writer_destroy(&wav);
+
+    return ret;
+}
+
+
+static int render_one(const struct render_bench_params *params, const char *cfg_file,
+                      const char *seq_file, long nb_events)
+{
+    pid_t pid;
+    int ret = 0, status;
+
+    fflush(stdout);
+
+    pid = fork();
+    if (pid < 0) {
+        ret = -errno;
+        goto exit;
+    }
+
+    if (pid == 0) {
+        ret = render_child(cfg_file, seq_file, params->output, nb_events);
+        fflush(stdout);
+        _exit(ret ? EXIT_FAILURE : EXIT_SUCCESS);
+    }
+
+    if ((waitpid(pid, &status, 0) < 0)
+    ||  (!WIFEXITED(status))
+    ||  (WEXITSTATUS(status) != 0))
+        ret = -EIO;
+
+exit:
+
+    return ret;
+}
+
+
+int render_bench_run(const struct render_bench_params *params)
+{
+    long nb_events;
+    char cfg_file[256];
+    char seq_file[256];
+    int nb_fs, nb_tempos;
+    int i, j, exponent, ret = 0;
+    float *fs_list, *tempo_list;
+
+    if ((!params)
+    ||  (!params->output)
+    ||  (!params->tmp_dir)
+    ||  (params->max_exponent < MIN_EXPONENT)) {
+        ret = -EINVAL;
+        goto exit;
+    }
+
+    /* User may restrict the grid to a single fs and/or tempo */
+    fs_list    = (params->fs > 0) ? (float *)&params->fs : fs_grid;
+    nb_fs      = (params->fs > 0) ? 1 : NB_FS;
+    tempo_list = (params->tempo > 0) ? (float *)&params->tempo : tempo_grid;
+    nb_tempos  = (params->tempo > 0) ? 1 : NB_TEMPOS;
+
+    snprintf(cfg_file, sizeof(cfg_file), "%s/lilymoog_bench_%d.cfg", params->tmp_dir, getpid());
+    snprintf(seq_file, sizeof(seq_file), "%s/lilymoog_bench_%d.txt", params->tmp_dir, getpid());
+
+    printf("%10s %8s %6s %10s %9s %9s %9s %10s %9s\n", "events", "fs", "tempo", "audio (s)",
+           "parse (s)", "render(s)", "write (s)", "realtime x", "RSS (MB)");
+
+    nb_events = 1;
+    for (exponent = 0; exponent < MIN_EXPONENT; exponent++)
+        nb_events *= 10;
+
+    for (exponent = MIN_EXPONENT; exponent <= params->max_exponent; exponent++) {
+
+        ret = write_script(seq_file, nb_events);
+        if (ret) {
+            LOGE("Failed to write script file '%s'", seq_file);
+            goto exit;
+        }
+
+        for (i = 0; i < nb_fs; i++) {
+            for (j = 0; j < nb_tempos; j++) {
+
+                ret = write_config(cfg_file, fs_list[i], tempo_list[j]);
+                if (ret) {
+                    LOGE("Failed to write configuration file '%s'", cfg_file);
+                    goto exit;
+                }
+
+                ret = render_one(params, cfg_file, seq_file, nb_events);
+                if (ret) {
+                    LOGE("Rendering failure (%ld events, fs: %.0f, tempo: %.0f)",
+                         nb_events, fs_list[i], tempo_list[j]);
+                    goto exit;
+                }
+            }
+        }
+
+        nb_events *= 10;
+    }
+
+exit:
+
+    unlink(cfg_file);
+    unlink(seq_file);
+
+    return ret;
+}
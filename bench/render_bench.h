@@ -0,0 +1,60 @@
+/***************************************************************************************************
+ * @file render_bench.h
+ *
+ * @brief End to end rendering scaling benchmark (header)
+ *
+ * @licence MIT License
+ *
+ * Copyright (c) 2019 Jeremie Leclere
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy of this software and
+ * associated documentation files (the "Software"), to deal in the Software without restriction,
+ * including without limitation the rights to use, copy, modify, merge, publish, distribute,
+ * sublicense, and/or sell copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all copies or
+ * substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR IMPLIED, INCLUDING BUT
+ * NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND
+ * NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM,
+ * DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ **************************************************************************************************/
+
+#ifndef _RENDER_BENCH_H_
+#define _RENDER_BENCH_H_
+
+
+#include <errno.h>
+
+
+/**
+ * @brief Rendering benchmark parameters
+ */
+struct render_bench_params {
+    int max_exponent;                       ///< Largest sequence size, as a power of 10 events
+    float fs;                               ///< Sampling frequency (Hz, 0 for the whole grid)
+    float tempo;                            ///< Tempo (BPM, 0 for the whole grid)
+    const char *output;                     ///< Rendered WAV file path
+    const char *tmp_dir;                    ///< Directory for generated config/script files
+};
+
+
+/**
+ * @brief Run end to end rendering benchmark
+ *
+ *  Synthetic scripts of 10^3 to 10^max_exponent events are generated, and
+ * rendered through the whole lilymoog pipeline (parsing, Moog processing, WAV
+ * writing) over a grid of sampling frequencies and tempos. Each rendering is
+ * run in its own process, so that its peak RSS can be reported.
+ *
+ * @param[in] params    : Benchmark parameters
+ *
+ * @return 0 if successful, 0 > errno else
+ */
+int render_bench_run(const struct render_bench_params *params);
+
+
+#endif /* _RENDER_BENCH_H_ */
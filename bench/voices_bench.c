@@ -0,0 +1,173 @@
+/***************************************************************************************************
+ * @file voices_bench.c
+ *
+ * @brief Polyphonic voice pool benchmark (sources)
+ *
+ * @licence MIT License
+ *
+ * Copyright (c) 2019 Jeremie Leclere
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy of this software and
+ * associated documentation files (the "Software"), to deal in the Software without restriction,
+ * including without limitation the rights to use, copy, modify, merge, publish, distribute,
+ * sublicense, and/or sell copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all copies or
+ * substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR IMPLIED, INCLUDING BUT
+ * NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND
+ * NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM,
+ * DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ **************************************************************************************************/
+
+#include <math.h>
+#include <time.h>
+#include <stdio.h>
+#include <stdlib.h>
+
+#include <log.h>
+#include <voice_pool.h>
+#include <voices_bench.h>
+
+
+#define FRAME_SIZE          (256)               ///< Processed frames per call
+#define NOTE_LEN            (0.25)              ///< Chords renewal period (s)
+#define BASE_F0             (55.0)              ///< Lowest chord note (Hz)
+#define INTENSITY           (0.5)               ///< Voices output intensity
+
+
+static double now(void)
+{
+    struct timespec ts;
+
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+
+    return ts.tv_sec + ts.tv_nsec * 1e-9;
+}
+
+
+/* Fill events with a chord of nb_notes notes (previous chord release first), semitones apart
+ * and wrapping around 4 octaves
+ */
+static int chord_events(struct moog_event *events, int nb_notes, int chord)
+{
+    int i;
+
+    events[0].offset    = 0;
+    events[0].type      = MOOG_EVENT_NOTE_OFF;
+    events[0].frequency = 0;
+
+    for (i = 0; i < nb_notes; i++) {
+        events[i + 1].offset    = 0;
+        events[i + 1].type      = MOOG_EVENT_NOTE_ON;
+        events[i + 1].frequency = BASE_F0 * powf(2, ((chord + i) % 48) / 12.0f);
+    }
+
+    return nb_notes + 1;
+}
+
+
+/* Processing time per output sample (s) of given number of voices */
+static int run_voices(const struct voices_bench_params *params, int nb_voices,
+                      struct moog_event *events, int32_t *frames, double *elapsed)
+{
+    int ret = 0;
+    int nb_events;
+    int chord = 0;
+    double start;
+    long i, nb_calls, chord_period;
+    struct voice_pool *pool = NULL;
+    struct voice_pool_params p_params;
+
+    p_params.m_params.fs            = params->fs;
+    p_params.m_params.block_size    = params->block_size;
+    p_params.m_params.sample_format = MOOG_SAMPLE_FORMAT_FIXED;
+    p_params.m_params.fc            = 1000;
+    p_params.m_params.Q             = 1;
+    p_params.m_params.gain          = 1;
+    p_params.m_params.attack_time   = 20;
+    p_params.m_params.decay_time    = 5;
+    p_params.m_params.sustain       = 0.9;
+    p_params.m_params.release_time  = 150;
+    p_params.m_params.osc_mode      = WAVE_MODE_SAW;
+    p_params.m_params.coupling      = MOOG_OSC_COUPLING_FIFTH;
+    p_params.nb_voices              = nb_voices;
+    p_params.steal                  = VOICE_POOL_STEAL_OLDEST;
+    p_params.intensity              = INTENSITY / nb_voices;
+
+    pool = voice_pool_create(&p_params);
+    if (!pool) {
+        ret = -ENOMEM;
+        goto exit;
+    }
+
+    nb_calls     = (long)(params->duration * params->fs / FRAME_SIZE) + 1;
+    chord_period = (long)(NOTE_LEN * params->fs / FRAME_SIZE) + 1;
+
+    start = now();
+    for (i = 0; i < nb_calls; i++) {
+        nb_events = 0;
+        if (i % chord_period == 0)
+            nb_events = chord_events(events, nb_voices, chord++);
+        ret = voice_pool_process(pool, events, nb_events, FRAME_SIZE, frames);
+        if (ret)
+            goto exit;
+    }
+    *elapsed = (now() - start) / (nb_calls * FRAME_SIZE);
+
+exit:
+
+    voice_pool_destroy(&pool);
+
+    return ret;
+}
+
+
+int voices_bench_run(const struct voices_bench_params *params)
+{
+    int ret = 0;
+    int nb_voices;
+    double elapsed;
+    int32_t *frames = NULL;
+    struct moog_event *events = NULL;
+
+    if ((!params) || (params->fs <= 0) || (params->duration <= 0)) {
+        ret = -EINVAL;
+        goto exit;
+    }
+
+    frames = (int32_t *)calloc(FRAME_SIZE, sizeof(int32_t));
+    events = (struct moog_event *)calloc(VOICE_POOL_MAX_VOICES + 1, sizeof(struct moog_event));
+    if ((!frames) || (!events)) {
+        ret = -ENOMEM;
+        goto exit;
+    }
+
+    printf("fs: %.0f Hz, %.1f s of audio per measure, Moog block size: %d\n\n",
+           params->fs, params->duration, params->block_size);
+    printf("%-8s %12s %18s %12s\n", "voices", "ns/sample", "ns/voice-sample", "realtime x");
+
+    for (nb_voices = 1; nb_voices <= VOICE_POOL_MAX_VOICES; nb_voices *= 2) {
+
+        ret = run_voices(params, nb_voices, events, frames, &elapsed);
+        if (ret) {
+            LOGE("%d voices benchmark failure", nb_voices);
+            goto exit;
+        }
+
+        printf("%-8d %12.2f %18.2f %12.1f\n", nb_voices, elapsed * 1e9,
+               elapsed * 1e9 / nb_voices, 1 / (elapsed * params->fs));
+    }
+
+exit:
+
+    if (frames)
+        free(frames);
+    if (events)
+        free(events);
+
+    return ret;
+}
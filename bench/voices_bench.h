@@ -0,0 +1,57 @@
+/***************************************************************************************************
+ * @file voices_bench.h
+ *
+ * @brief Polyphonic voice pool benchmark (headers)
+ *
+ * @licence MIT License
+ *
+ * Copyright (c) 2019 Jeremie Leclere
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy of this software and
+ * associated documentation files (the "Software"), to deal in the Software without restriction,
+ * including without limitation the rights to use, copy, modify, merge, publish, distribute,
+ * sublicense, and/or sell copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all copies or
+ * substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR IMPLIED, INCLUDING BUT
+ * NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND
+ * NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM,
+ * DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ **************************************************************************************************/
+
+#ifndef _VOICES_BENCH_H_
+#define _VOICES_BENCH_H_
+
+
+#include <errno.h>
+
+
+/**
+ * @brief Voice pool benchmark parameters
+ */
+struct voices_bench_params {
+    float fs;                               ///< Sampling frequency (Hz)
+    float duration;                         ///< Audio duration processed per measure (s)
+    int block_size;                         ///< Moog internal processing block size
+};
+
+
+/**
+ * @brief Run polyphonic voice pool benchmark
+ *
+ *  Voice pools of 1 to VOICE_POOL_MAX_VOICES voices are run on chords filling every voice,
+ * renewed on a regular basis: released voices overlap with new notes, and are stolen as soon
+ * as the pool is full. Processing cost is reported per output sample and per voice sample.
+ *
+ * @param[in] params    : Benchmark parameters
+ *
+ * @return 0 if successful, 0 > errno else
+ */
+int voices_bench_run(const struct voices_bench_params *params);
+
+
+#endif /* _VOICES_BENCH_H_ */
@@ -0,0 +1,408 @@
+/***************************************************************************************************
+ * @file regress.c
+ *
+ * @brief Golden output regression tests
+ *
+ * @licence MIT License
+ *
+ * Copyright (c) 2019 Jeremie Leclere
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy of this software and
+ * associated documentation files (the "Software"), to deal in the Software without restriction,
+ * including without limitation the rights to use, copy, modify, merge, publish, distribute,
+ * sublicense, and/or sell copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all copies or
+ * substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR IMPLIED, INCLUDING BUT
+ * NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND
+ * NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM,
+ * DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ **************************************************************************************************/
+
+#include <math.h>
+#include <errno.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <getopt.h>
+
+#include <log.h>
+#include <wav_reader.h>
+#include <snapshot_check.h>
+
+
+#define DFT_CASES_DIR       ("regress/cases")       ///< Default corpus directory
+#define DFT_OUTPUT_DIR      ("build/regress")       ///< Default rendered files directory
+#define DFT_BINARY          ("./lilymoog")          ///< Default tested binary
+#define CASES_LIST          ("cases.txt")           ///< Corpus description file
+#define COMPARE_CHUNK       (4096)                  ///< Number of frames per comparison step
+#define MAX_TRACKS          (4)                     ///< Maximal number of additional tracks
+#define SNAPSHOT_CASE       ("moog_snapshot")       ///< Built-in snapshot checks case name
+
+
+/*
+ * Regression case description
+ *
+ *  If neither a SNR nor a peak error tolerance is provided, rendered output is
+ * expected to be bit exact with the reference.
+ */
+struct regress_case {
+    char name[64];                          ///< Case name (<name>.cfg/.txt/.wav in corpus)
+    char reference[64];                     ///< Reference case name (<reference>.wav in corpus)
+    int prefill;                            ///< lilymoog PREFILL option
+    int postfill;                           ///< lilymoog POSTFILL option
+    int jobs;                               ///< lilymoog JOBS option (0 if unused)
+    double min_snr;                         ///< Minimal SNR (dB, 0 if bit exactness expected)
+    double max_peak;                        ///< Maximal peak error (full scale = 1, 0 if unused)
+    int nb_tracks;                          ///< Number of additional tracks
+    char tracks[MAX_TRACKS][64];            ///< Additional tracks (<track>.cfg/.txt in corpus)
+};
+
+
+/* Comparison results */
+struct regress_result {
+    int exact;                              ///< Bit exact output
+    double snr;                             ///< Signal to error ratio (dB)
+    double peak;                            ///< Peak absolute error (full scale = 1)
+};
+
+
+/*
+ * Parse a case description line, assumed to respect following syntax:
+ *
+ *      NAME [prefill=N] [postfill=N] [jobs=N] [snr=DB] [peak=ERROR] [ref=CASE]
+ *           [track=CASE ...]
+ */
+static int parse_case(char *line, struct regress_case *rcase)
+{
+    int ret = 0;
+    char *ctx = NULL;
+    char *token = NULL;
+
+    memset(rcase, 0, sizeof(struct regress_case));
+
+    token = strtok_r(line, " \t", &ctx);
+    if (!token) {
+        ret = -EINVAL;
+        goto exit;
+    }
+    strncpy(rcase->name, token, sizeof(rcase->name) - 1);
+    strncpy(rcase->reference, token, sizeof(rcase->reference) - 1);
+
+    while ((token = strtok_r(NULL, " \t", &ctx)) != NULL) {
+        if (strncmp(token, "prefill=", 8) == 0) {
+            rcase->prefill = atoi(token + 8);
+        } else if (strncmp(token, "postfill=", 9) == 0) {
+            rcase->postfill = atoi(token + 9);
+        } else if (strncmp(token, "jobs=", 5) == 0) {
+            rcase->jobs = atoi(token + 5);
+        } else if (strncmp(token, "snr=", 4) == 0) {
+            rcase->min_snr = atof(token + 4);
+        } else if (strncmp(token, "peak=", 5) == 0) {
+            rcase->max_peak = atof(token + 5);
+        } else if (strncmp(token, "ref=", 4) == 0) {
+            strncpy(rcase->reference, token + 4, sizeof(rcase->reference) - 1);
+        } else if ((strncmp(token, "track=", 6) == 0) && (rcase->nb_tracks < MAX_TRACKS)) {
+            strncpy(rcase->tracks[rcase->nb_tracks++], token + 6, sizeof(rcase->tracks[0]) - 1);
+        } else {
+            LOGE("%s: Unsupported case option '%s'", __func__, token);
+            ret = -EINVAL;
+            goto exit;
+        }
+    }
+
+exit:
+
+    return ret;
+}
+
+
+/* Compare rendered output with reference */
+static int compare(const char *reference, const char *output, struct regress_result *result)
+{
+    int i, nb, ret = 0;
+    double err, signal = 0, noise = 0;
+    double *ref_data = NULL, *out_data = NULL;
+    struct wav_reader *ref = NULL, *out = NULL;
+    struct wav_reader_info ref_info, out_info;
+
+    result->exact = 1;
+    result->snr   = INFINITY;
+    result->peak  = 0;
+
+    ref = wav_reader_create(reference);
+    if (!ref) {
+        LOGE("Failed to open reference '%s'", reference);
+        ret = -EINVAL;
+        goto exit;
+    }
+
+    out = wav_reader_create(output);
+    if (!out) {
+        LOGE("Failed to open output '%s'", output);
+        ret = -EINVAL;
+        goto exit;
+    }
+
+    wav_reader_get_info(ref, &ref_info);
+    wav_reader_get_info(out, &out_info);
+    if ((ref_info.fs != out_info.fs)
+    ||  (ref_info.nb_channels != out_info.nb_channels)
+    ||  (ref_info.nb_frames != out_info.nb_frames)) {
+        LOGE("Format mismatch: %d Hz, %d channel(s), %d frames expected "
+             "(%d Hz, %d channel(s), %d frames rendered)",
+             ref_info.fs, ref_info.nb_channels, ref_info.nb_frames,
+             out_info.fs, out_info.nb_channels, out_info.nb_frames);
+        ret = -EINVAL;
+        goto exit;
+    }
+
+    ref_data = (double *)calloc(COMPARE_CHUNK * ref_info.nb_channels, sizeof(double));
+    out_data = (double *)calloc(COMPARE_CHUNK * ref_info.nb_channels, sizeof(double));
+    if ((!ref_data) || (!out_data)) {
+        ret = -ENOMEM;
+        goto exit;
+    }
+
+    while ((nb = wav_reader_read(ref, ref_data, COMPARE_CHUNK)) > 0) {
+
+        if (wav_reader_read(out, out_data, nb) != nb) {
+            ret = -EIO;
+            goto exit;
+        }
+
+        for (i = 0; i < nb * ref_info.nb_channels; i++) {
+            /* Signed zeros count as different (floating point WAV files) */
+            err = out_data[i] - ref_data[i];
+            if ((err != 0) || (signbit(out_data[i]) != signbit(ref_data[i])))
+                result->exact = 0;
+            if (fabs(err) > result->peak)
+                result->peak = fabs(err);
+            signal += ref_data[i] * ref_data[i];
+            noise  += err * err;
+        }
+    }
+
+    if (nb < 0) {
+        ret = nb;
+        goto exit;
+    }
+
+    if (noise > 0)
+        result->snr = 10 * log10(signal / noise);
+
+exit:
+
+    if (ref_data)
+        free(ref_data);
+    if (out_data)
+        free(out_data);
+
+    wav_reader_destroy(&ref);
+    wav_reader_destroy(&out);
+
+    return ret;
+}
+
+
+/* Render a case, and either compare it to its reference or update the reference */
+static int run_case(const struct regress_case *rcase, const char *binary, const char *cases_dir,
+                    const char *output_dir, int update)
+{
+    int i, ret = 0;
+    size_t len;
+    char command[1024];
+    char output[512];
+    char reference[512];
+    struct regress_result result;
+
+    snprintf(reference, sizeof(reference), "%s/%s.wav", cases_dir, rcase->reference);
+    snprintf(output, sizeof(output), "%s/%s.wav", output_dir, rcase->name);
+
+    /* Cases compared to another case reference don't own any reference */
+    if ((update) && (strcmp(rcase->name, rcase->reference) != 0)) {
+        LOGI("[SKIP] %s: Uses '%s' reference", rcase->name, rcase->reference);
+        goto exit;
+    }
+
+    len = snprintf(command, sizeof(command), "%s -c %s/%s.cfg -s %s/%s.txt", binary, cases_dir,
+                   rcase->name, cases_dir, rcase->name);
+    for (i = 0; (i < rcase->nb_tracks) && (len < sizeof(command)); i++)
+        len += snprintf(command + len, sizeof(command) - len, " -c %s/%s.cfg -s %s/%s.txt",
+                        cases_dir, rcase->tracks[i], cases_dir, rcase->tracks[i]);
+    /* References are rendered by a single thread, jobs cases being checked against them */
+    if ((rcase->jobs) && (!update) && (len < sizeof(command)))
+        len += snprintf(command + len, sizeof(command) - len, " -j %d", rcase->jobs);
+    if (len < sizeof(command))
+        snprintf(command + len, sizeof(command) - len, " -o %s -p %d -P %d > /dev/null",
+                 update ? reference : output, rcase->prefill, rcase->postfill);
+
+    if (system(command)) {
+        LOGE("[FAIL] %s: Rendering failure ('%s')", rcase->name, command);
+        ret = -EIO;
+        goto exit;
+    }
+
+    if (update) {
+        LOGI("[UPDT] %s: Reference updated", rcase->name);
+        goto exit;
+    }
+
+    ret = compare(reference, output, &result);
+    if (ret) {
+        LOGE("[FAIL] %s: Comparison failure", rcase->name);
+        goto exit;
+    }
+
+    if (result.exact) {
+        LOGI("[PASS] %s: bit exact", rcase->name);
+    } else if (((rcase->min_snr > 0) || (rcase->max_peak > 0))
+           &&  (result.snr >= rcase->min_snr)
+           &&  ((rcase->max_peak <= 0) || (result.peak <= rcase->max_peak))) {
+        LOGI("[PASS] %s: SNR %.1f dB, peak error %.3g (tolerance: %.1f dB, %.3g)",
+             rcase->name, result.snr, result.peak, rcase->min_snr, rcase->max_peak);
+    } else {
+        LOGE("[FAIL] %s: SNR %.1f dB, peak error %.3g (tolerance: %.1f dB, %.3g)",
+             rcase->name, result.snr, result.peak, rcase->min_snr, rcase->max_peak);
+        ret = -EINVAL;
+    }
+
+exit:
+
+    return ret;
+}
+
+
+static void usage(const char *exec_name)
+{
+    LOGI("%s [-b BINARY] [-d CASES_DIR] [-o OUTPUT_DIR] [-c CASE] [-u]", exec_name);
+    LOGI("");
+    LOGI("    Render regression corpus, and compare outputs with stored references");
+    LOGI("");
+    LOGI(" -b BINARY");
+    LOGI("    Tested lilymoog binary (default: '%s')", DFT_BINARY);
+    LOGI("");
+    LOGI(" -d CASES_DIR");
+    LOGI("    Corpus directory, described by its '%s' file (default: '%s')",
+         CASES_LIST, DFT_CASES_DIR);
+    LOGI("");
+    LOGI(" -o OUTPUT_DIR");
+    LOGI("    Rendered files directory (default: '%s')", DFT_OUTPUT_DIR);
+    LOGI("");
+    LOGI(" -c CASE");
+    LOGI("    Only run specified case (default: all, '%s' being the built-in snapshot checks)",
+         SNAPSHOT_CASE);
+    LOGI("");
+    LOGI(" -u");
+    LOGI("    Update references instead of comparing");
+    LOGI("");
+}
+
+
+int main(int argc, char *argv[])
+{
+    char *c;
+    FILE *fd = NULL;
+    int opt, update = 0;
+    char list[512];
+    size_t line_size;
+    char *line = NULL;
+    char *only = NULL;
+    int g_ret = EXIT_SUCCESS;
+    int nb_cases = 0, nb_failures = 0;
+    struct regress_case rcase;
+    char *binary = DFT_BINARY;
+    char *cases_dir = DFT_CASES_DIR;
+    char *output_dir = DFT_OUTPUT_DIR;
+
+    while ((opt = getopt(argc, argv, "hb:d:o:c:u")) != -1) {
+        switch (opt) {
+        case 'h':
+            usage(argv[0]);
+            goto exit;
+        case 'b':
+            binary = optarg;
+        break;
+        case 'd':
+            cases_dir = optarg;
+        break;
+        case 'o':
+            output_dir = optarg;
+        break;
+        case 'c':
+            only = optarg;
+        break;
+        case 'u':
+            update = 1;
+        break;
+        case '?':
+            g_ret = EXIT_FAILURE;
+            usage(argv[0]);
+            goto exit;
+        }
+    }
+
+    snprintf(list, sizeof(list), "%s/%s", cases_dir, CASES_LIST);
+    fd = fopen(list, "r");
+    if (!fd) {
+        LOGE("Failed to open cases list '%s'", list);
+        g_ret = EXIT_FAILURE;
+        goto exit;
+    }
+
+    while (getline(&line, &line_size, fd) != -1) {
+
+        /* Remove \n character if any */
+        if ((c = strchr(line, '\n')) != NULL)
+            *c = '\0';
+
+        /* Skip comments and empty lines */
+        if ((line[0] == '#') || (line[0] == '\0'))
+            continue;
+
+        if (parse_case(line, &rcase)) {
+            g_ret = EXIT_FAILURE;
+            goto exit;
+        }
+
+        if ((only) && (strcmp(only, rcase.name) != 0))
+            continue;
+
+        nb_cases++;
+        if (run_case(&rcase, binary, cases_dir, output_dir, update))
+            nb_failures++;
+    }
+
+    /* Built-in case: snapshot / restore / clone round trips (no reference) */
+    if ((!update) && ((!only) || (strcmp(only, SNAPSHOT_CASE) == 0))) {
+        nb_cases++;
+        if (snapshot_check_run()) {
+            LOGE("[FAIL] %s: Snapshot checks failure", SNAPSHOT_CASE);
+            nb_failures++;
+        } else {
+            LOGI("[PASS] %s: restore and clone bit exact, corrupted snapshots rejected",
+                 SNAPSHOT_CASE);
+        }
+    }
+
+    if (nb_failures) {
+        LOGE("%d/%d case(s) failed", nb_failures, nb_cases);
+        g_ret = EXIT_FAILURE;
+    } else {
+        LOGI("%d case(s) passed", nb_cases);
+    }
+
+exit:
+
+    if (line)
+        free(line);
+
+    if (fd)
+        fclose(fd);
+
+    return g_ret;
+}
@@ -0,0 +1,294 @@
+/***************************************************************************************************
+ * @file snapshot_check.c
+ *
+ * @brief Moog snapshot, restore and clone regression checks
+ *
+ * @licence MIT License
+ *
+ * Copyright (c) 2019 Jeremie Leclere
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy of this software and
+ * associated documentation files (the "Software"), to deal in the Software without restriction,
+ * including without limitation the rights to use, copy, modify, merge, publish, distribute,
+ * sublicense, and/or sell copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all copies or
+ * substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR IMPLIED, INCLUDING BUT
+ * NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND
+ * NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM,
+ * DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ **************************************************************************************************/
+
+#include <errno.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include <log.h>
+#include <moog.h>
+#include <snapshot.h>
+#include <snapshot_check.h>
+
+
+#define CHECK_FS            (44100)                 ///< Sampling frequency
+#define CHECK_Q             (2)                     ///< Low pass filter quality factor
+#define CHECK_PREROLL       (3000)                  ///< Number of samples rendered before snapshot
+#define CHECK_LEN           (5000)                  ///< Number of samples rendered after snapshot
+
+/* Snapshot fields offsets (see moog_snapshot: header, then enveloppe snapshot) */
+#define OFFSET_FS           (8)                     ///< Sampling frequency
+#define OFFSET_Q            (12)                    ///< Filter quality factor
+#define OFFSET_FORMAT       (24)                    ///< Sample format
+#define OFFSET_INTENSITY    (28)                    ///< Output intensity
+#define OFFSET_ADSR_STATE   (56)                    ///< Enveloppe state
+
+
+/* Snapshot corruptions, each of them to be rejected by moog_restore */
+enum corruption {
+    CORRUPTION_TRUNCATED,                           ///< Last byte missing
+    CORRUPTION_FS,                                  ///< Other sampling frequency
+    CORRUPTION_Q,                                   ///< Other filter quality factor
+    CORRUPTION_FORMAT,                              ///< Other sample format
+    CORRUPTION_INTENSITY,                           ///< Out of range intensity
+    CORRUPTION_ADSR_STATE,                          ///< Out of range enveloppe state
+    CORRUPTION_NB
+};
+
+
+static const char *const corruption_names[CORRUPTION_NB] = {
+    "truncated blob",
+    "sampling frequency",
+    "quality factor",
+    "sample format",
+    "intensity",
+    "enveloppe state"
+};
+
+
+/* Events rendered before snapshot: note ON, and a sweep still on going at snapshot time */
+static const struct moog_event preroll_events[] = {
+    { .offset = 0,    .type = MOOG_EVENT_NOTE_ON,       .frequency = 110 },
+    { .offset = 1000, .type = MOOG_EVENT_FILTER_SWEEP,  .fc = 400, .nb_samples = 4000 },
+};
+
+
+/* Events rendered after snapshot: legato note, then note OFF */
+static const struct moog_event check_events[] = {
+    { .offset = 1500, .type = MOOG_EVENT_NOTE_ON,       .frequency = 146.83 },
+    { .offset = 3000, .type = MOOG_EVENT_NOTE_OFF },
+};
+
+
+/* Render samples on the instance signal path */
+static int render(struct moog *handle, enum moog_sample_format format,
+                  const struct moog_event *events, int nb_events, int nb_frames, void *output)
+{
+    if (format == MOOG_SAMPLE_FORMAT_FLOAT)
+        return moog_process_float(handle, events, nb_events, nb_frames, (float *)output);
+
+    return moog_process(handle, events, nb_events, nb_frames, (int32_t *)output);
+}
+
+
+/* Corrupt a snapshot, and return the size to be restored */
+static int corrupt(uint8_t *blob, int size, enum moog_sample_format format, enum corruption type)
+{
+    uint8_t *ptr;
+
+    switch (type) {
+    case CORRUPTION_TRUNCATED:
+        return size - 1;
+    case CORRUPTION_FS:
+        ptr = blob + OFFSET_FS;
+        snapshot_put_float(&ptr, CHECK_FS / 2);
+        break;
+    case CORRUPTION_Q:
+        ptr = blob + OFFSET_Q;
+        snapshot_put_float(&ptr, 2 * CHECK_Q);
+        break;
+    case CORRUPTION_FORMAT:
+        ptr = blob + OFFSET_FORMAT;
+        snapshot_put_i32(&ptr, (format == MOOG_SAMPLE_FORMAT_FLOAT) ? MOOG_SAMPLE_FORMAT_FIXED
+                                                                    : MOOG_SAMPLE_FORMAT_FLOAT);
+        break;
+    case CORRUPTION_INTENSITY:
+        ptr = blob + OFFSET_INTENSITY;
+        snapshot_put_float(&ptr, 2);
+        break;
+    case CORRUPTION_ADSR_STATE:
+    default:
+        ptr = blob + OFFSET_ADSR_STATE;
+        snapshot_put_i32(&ptr, 42);
+        break;
+    }
+
+    return size;
+}
+
+
+/* Run checks on a signal path */
+static int check_format(enum moog_sample_format format, const char *name)
+{
+    int i, size, ret = 0;
+    struct moog_params params;
+    struct moog *ref = NULL, *restored = NULL, *clone = NULL;
+    uint8_t *blob = NULL, *corrupted = NULL, *before = NULL, *after = NULL;
+    uint8_t *outputs[3] = { NULL, NULL, NULL };
+    int nb_events = sizeof(check_events) / sizeof(check_events[0]);
+
+    memset(&params, 0, sizeof(struct moog_params));
+    params.fs            = CHECK_FS;
+    params.block_size    = MOOG_DFT_BLOCK_SIZE;
+    params.sample_format = format;
+    params.fc            = 2000;
+    params.Q             = CHECK_Q;
+    params.gain          = 1;
+    params.attack_time   = 20;
+    params.decay_time    = 40;
+    params.sustain       = 0.7;
+    params.release_time  = 100;
+    params.osc_mode      = WAVE_MODE_SAW_BL;
+    params.coupling      = MOOG_OSC_COUPLING_FIFTH;
+
+    for (i = 0; i < 3; i++) {
+        outputs[i] = (uint8_t *)malloc(CHECK_LEN * sizeof(int32_t));
+        if (!outputs[i]) {
+            ret = -ENOMEM;
+            goto exit;
+        }
+    }
+
+    /* Reference instance, snapshot taken in the middle of a sweep */
+    ref = moog_create(&params);
+    if ((!ref)
+    ||  (moog_set_intensity(ref, 0.5))) {
+        ret = -EINVAL;
+        goto exit;
+    }
+
+    ret = render(ref, format, preroll_events, sizeof(preroll_events) / sizeof(preroll_events[0]),
+                 CHECK_PREROLL, outputs[0]);
+    if (ret)
+        goto exit;
+
+    size = moog_snapshot(ref, NULL, 0);
+    if (size < 0) {
+        ret = size;
+        goto exit;
+    }
+
+    blob      = (uint8_t *)malloc(size);
+    corrupted = (uint8_t *)malloc(size);
+    before    = (uint8_t *)malloc(size);
+    after     = (uint8_t *)malloc(size);
+    if ((!blob) || (!corrupted) || (!before) || (!after)) {
+        ret = -ENOMEM;
+        goto exit;
+    }
+
+    if (moog_snapshot(ref, blob, size) != size) {
+        LOGE("%s: Failed to take snapshot", name);
+        ret = -EINVAL;
+        goto exit;
+    }
+
+    /* Restored instance and clone */
+    restored = moog_create(&params);
+    if ((!restored)
+    ||  (moog_restore(restored, blob, size) != size)) {
+        LOGE("%s: Failed to restore snapshot", name);
+        ret = -EINVAL;
+        goto exit;
+    }
+
+    clone = moog_clone(ref);
+    if (!clone) {
+        LOGE("%s: Failed to clone instance", name);
+        ret = -EINVAL;
+        goto exit;
+    }
+
+    /* Every instance goes on rendering the very same samples */
+    ret = render(ref, format, check_events, nb_events, CHECK_LEN, outputs[0]);
+    if (!ret)
+        ret = render(restored, format, check_events, nb_events, CHECK_LEN, outputs[1]);
+    if (!ret)
+        ret = render(clone, format, check_events, nb_events, CHECK_LEN, outputs[2]);
+    if (ret)
+        goto exit;
+
+    if (memcmp(outputs[0], outputs[1], CHECK_LEN * sizeof(int32_t))) {
+        LOGE("%s: Restored instance output differs", name);
+        ret = -EINVAL;
+        goto exit;
+    }
+
+    if (memcmp(outputs[0], outputs[2], CHECK_LEN * sizeof(int32_t))) {
+        LOGE("%s: Cloned instance output differs", name);
+        ret = -EINVAL;
+        goto exit;
+    }
+
+    /* Corrupted snapshots are rejected, target state being left untouched */
+    if (moog_snapshot(restored, before, size) != size) {
+        ret = -EINVAL;
+        goto exit;
+    }
+
+    for (i = 0; i < CORRUPTION_NB; i++) {
+        memcpy(corrupted, blob, size);
+        if (moog_restore(restored, corrupted, corrupt(corrupted, size, format, i)) >= 0) {
+            LOGE("%s: Snapshot with corrupted %s restored", name, corruption_names[i]);
+            ret = -EINVAL;
+            goto exit;
+        }
+
+        if ((moog_snapshot(restored, after, size) != size)
+        ||  (memcmp(before, after, size))) {
+            LOGE("%s: Snapshot with corrupted %s altered target state", name,
+                 corruption_names[i]);
+            ret = -EINVAL;
+            goto exit;
+        }
+    }
+
+exit:
+
+    for (i = 0; i < 3; i++) {
+        if (outputs[i])
+            free(outputs[i]);
+    }
+    if (blob)
+        free(blob);
+    if (corrupted)
+        free(corrupted);
+    if (before)
+        free(before);
+    if (after)
+        free(after);
+
+    moog_destroy(&ref);
+    moog_destroy(&restored);
+    moog_destroy(&clone);
+
+    return ret;
+}
+
+
+int snapshot_check_run(void)
+{
+    int ret;
+
+    ret = check_format(MOOG_SAMPLE_FORMAT_FIXED, "fixed point");
+    if (ret)
+        goto exit;
+
+    ret = check_format(MOOG_SAMPLE_FORMAT_FLOAT, "floating point");
+
+exit:
+
+    return ret;
+}
@@ -0,0 +1,46 @@
+/***************************************************************************************************
+ * @file snapshot_check.h
+ *
+ * @brief Moog snapshot, restore and clone regression checks (header)
+ *
+ * @licence MIT License
+ *
+ * Copyright (c) 2019 Jeremie Leclere
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy of this software and
+ * associated documentation files (the "Software"), to deal in the Software without restriction,
+ * including without limitation the rights to use, copy, modify, merge, publish, distribute,
+ * sublicense, and/or sell copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all copies or
+ * substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR IMPLIED, INCLUDING BUT
+ * NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND
+ * NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM,
+ * DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ **************************************************************************************************/
+
+#ifndef _SNAPSHOT_CHECK_H_
+#define _SNAPSHOT_CHECK_H_
+
+
+#include <errno.h>
+
+
+/**
+ * @brief Run moog snapshot regression checks, on both signal paths
+ *
+ *  An instance renders a few thousand samples, and its snapshot is restored into a new instance,
+ * next to a clone of it (moog_clone). All three instances must then render the very same
+ * samples. Corrupted snapshots (truncated, incompatible header, out of range field) must be
+ * rejected, leaving the target instance untouched.
+ *
+ * @return 0 if successful, 0 > errno else
+ */
+int snapshot_check_run(void);
+
+
+#endif /* _SNAPSHOT_CHECK_H_ */
@@ -0,0 +1,146 @@
+/***************************************************************************************************
+ * @file cache.c
+ *
+ * @brief Process wide shared data cache (sources)
+ *
+ * @licence MIT License
+ *
+ * Copyright (c) 2019 Jeremie Leclere
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy of this software and
+ * associated documentation files (the "Software"), to deal in the Software without restriction,
+ * including without limitation the rights to use, copy, modify, merge, publish, distribute,
+ * sublicense, and/or sell copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all copies or
+ * substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR IMPLIED, INCLUDING BUT
+ * NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND
+ * NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM,
+ * DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ **************************************************************************************************/
+
+#include <string.h>
+#include <stdlib.h>
+#include <pthread.h>
+
+#include <cache.h>
+
+
+/* Cache entry (linked list: a handful of entries per process is expected) */
+struct cache_entry {
+    void *data;                                     ///< Shared data
+    void *key;                                      ///< Data key (own copy)
+    size_t key_size;                                ///< Key size
+    int refcount;                                   ///< Number of users
+    cache_build_t build;                            ///< Data constructor
+    cache_free_t destroy;                           ///< Data destructor
+    struct cache_entry *next;                       ///< Next entry
+};
+
+
+static struct cache_entry *entries = NULL;
+static pthread_mutex_t lock = PTHREAD_MUTEX_INITIALIZER;
+
+
+void *cache_acquire(const void *key, size_t key_size, cache_build_t build, cache_free_t destroy)
+{
+    void *data = NULL;
+    struct cache_entry *entry;
+
+    if ((!key) || (!key_size) || (!build) || (!destroy))
+        return NULL;
+
+    pthread_mutex_lock(&lock);
+
+    /* Cache hit */
+    for (entry = entries; entry; entry = entry->next) {
+        if ((entry->build == build)
+        &&  (entry->key_size == key_size)
+        &&  (memcmp(entry->key, key, key_size) == 0)) {
+            entry->refcount++;
+            data = entry->data;
+            goto exit;
+        }
+    }
+
+    /* Cache miss: Build data (under lock, so that concurrent users don't build it twice) */
+    entry = (struct cache_entry *)calloc(1, sizeof(struct cache_entry));
+    if (!entry)
+        goto exit;
+
+    entry->key = malloc(key_size);
+    if (!entry->key)
+        goto failure;
+    memcpy(entry->key, key, key_size);
+
+    entry->data = build(key);
+    if (!entry->data)
+        goto failure;
+
+    entry->key_size = key_size;
+    entry->refcount = 1;
+    entry->build    = build;
+    entry->destroy  = destroy;
+    entry->next     = entries;
+    entries         = entry;
+
+    data = entry->data;
+
+exit:
+
+    pthread_mutex_unlock(&lock);
+
+    return data;
+
+failure:
+
+    if (entry->key)
+        free(entry->key);
+    free(entry);
+
+    pthread_mutex_unlock(&lock);
+
+    return NULL;
+}
+
+
+int cache_release(const void *data)
+{
+    int ret = 0;
+    struct cache_entry *entry, **prev;
+
+    if (!data)
+        return 0;
+
+    pthread_mutex_lock(&lock);
+
+    for (prev = &entries; *prev; prev = &(*prev)->next) {
+        if ((*prev)->data == data)
+            break;
+    }
+
+    entry = *prev;
+    if (!entry) {
+        ret = -EINVAL;
+        goto exit;
+    }
+
+    /* Last user: Free data and entry */
+    entry->refcount--;
+    if (entry->refcount == 0) {
+        *prev = entry->next;
+        entry->destroy(entry->data);
+        free(entry->key);
+        free(entry);
+    }
+
+exit:
+
+    pthread_mutex_unlock(&lock);
+
+    return ret;
+}
@@ -0,0 +1,74 @@
+/***************************************************************************************************
+ * @file cache.h
+ *
+ * @brief Process wide shared data cache (headers)
+ *
+ * @licence MIT License
+ *
+ * Copyright (c) 2019 Jeremie Leclere
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy of this software and
+ * associated documentation files (the "Software"), to deal in the Software without restriction,
+ * including without limitation the rights to use, copy, modify, merge, publish, distribute,
+ * sublicense, and/or sell copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all copies or
+ * substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR IMPLIED, INCLUDING BUT
+ * NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND
+ * NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM,
+ * DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ **************************************************************************************************/
+
+#ifndef _CACHE_H_
+#define _CACHE_H_
+
+
+#include <errno.h>
+#include <stddef.h>
+
+
+/**
+ * @brief Cached data constructor: builds data from its key (NULL if failed)
+ */
+typedef void *(*cache_build_t)(const void *key);
+
+
+/**
+ * @brief Cached data destructor
+ */
+typedef void (*cache_free_t)(void *data);
+
+
+/**
+ * @brief Acquire shared data matching a key, building it if not cached yet
+ *
+ *  Cached data are meant to be immutable (precomputed tables, ...), and shared by any number of
+ * users (engine instances, threads): Entries are reference counted, and freed on their last
+ * release. Keys are compared bytewise (padding bytes included: zero them), along with the build
+ * function, so that different data types never collide.
+ *
+ * @param[in] key       : Data key
+ * @param[in] key_size  : Key size (bytes)
+ * @param[in] build     : Data constructor, called on cache miss
+ * @param[in] destroy   : Data destructor, called on last release
+ *
+ * @return Shared data if successful, NULL else
+ */
+void *cache_acquire(const void *key, size_t key_size, cache_build_t build, cache_free_t destroy);
+
+
+/**
+ * @brief Release shared data acquired from cache
+ *
+ * @param[in] data      : Shared data (NULL is silently ignored)
+ *
+ * @return 0 if successful, 0 > errno else
+ */
+int cache_release(const void *data);
+
+
+#endif /* _CACHE_H_ */
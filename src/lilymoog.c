@@ -29,21 +29,22 @@
 #include <getopt.h>
 
 #include <log.h>
-#include <moog.h>
-#include <notes.h>
+#include <stats.h>
+#include <splitter.h>
+#include <sequencer.h>
+#include <multitrack.h>
 #include <wav_writer.h>
 #include <cfg_parser.h>
 #include <seq_parser.h>
 
 
 #define DFT_OUTPUT_FILE     ("output.wav")          ///< Default output file
-#define DFT_RANK            (2)
-#define DFT_LENGTH          (4)
 
 
 static void usage(const char *exec_name)
 {
-    LOGI("%s -c CONFIG -s SCRIPT [-o OUTPUT_FILE] [-p PREFILL] [-P POSTFILL]", exec_name);
+    LOGI("%s -c CONFIG -s SCRIPT [-c CONFIG -s SCRIPT ...] [-o OUTPUT_FILE] [-p PREFILL] "
+         "[-P POSTFILL] [-j JOBS] [--stats]", exec_name);
     LOGI("");
     LOGI("    Moog sequence generator using provided script and configuration");
     LOGI("");
@@ -55,6 +56,11 @@ static void usage(const char *exec_name)
     LOGI("    Sequence to be generated, written in lilypond like syntax. Please refer to README.md");
     LOGI("    for more details about syntax.");
     LOGI("");
+    LOGI("    Up to %d tracks can be provided as several CONFIG / SCRIPT pairs (n-th CONFIG goes",
+         MULTITRACK_MAX_TRACKS);
+    LOGI("    with n-th SCRIPT): tracks are rendered in parallel, and mixed to a single output");
+    LOGI("    file according to their track_gain and track_pan settings.");
+    LOGI("");
     LOGI(" -o OUTPUT_FILE");
     LOGI("    Output WAV filename (default: 'output.wav')");
     LOGI("");
@@ -70,39 +76,80 @@ static void usage(const char *exec_name)
     LOGI("    sixteenth notes. The equivalent duration of silence will be inserted at the");
     LOGI("    end of generated output file.");
     LOGI("");
+    LOGI(" -j, --jobs JOBS");
+    LOGI("    Number of threads rendering a single track (default: 1). The sequence is split");
+    LOGI("    where every voice is silent (and regularly within long passages on the fixed");
+    LOGI("    point signal path), and segments are rendered in parallel: output is the very");
+    LOGI("    same whatever the number of threads. Not available with several tracks, or a");
+    LOGI("    track gain or pan (mix bus).");
+    LOGI("");
+    LOGI(" --stats");
+    LOGI("    Print processing statistics at exit: time spent in each processing stage,");
+    LOGI("    generated audio duration, realtime factor and peak RSS. With -j or several");
+    LOGI("    tracks, worker threads CPU time is reported apart, with the share of samples");
+    LOGI("    they rendered.");
+    LOGI("");
 }
 
 
+static struct option long_options[] = {
+    {"jobs",    required_argument, NULL, 'j'},
+    {"stats",   no_argument,    NULL,   'S'},
+    {NULL,      0,              NULL,   0}
+};
+
+
 int main(int argc, char *argv[])
 {
-    float frequency;
-    int rank, length;
-    struct cfg config;
-    float Q, fc, gain;
-    struct seq sequence;
-    int i, j, k, c, ret;
+    int c, t, ret;
+    struct stats stats;
+    int nb_channels = 1;
+    int stats_enabled = 0;
+    uint64_t timestamp = 0;
+    struct stats *p_stats = NULL;
     int g_ret = EXIT_SUCCESS;
-    struct moog *moog = NULL;
-    int32_t *output_frame = NULL;
     struct wav_writer *wav = NULL;
+    struct splitter *splitter = NULL;
+    struct sequencer *sequencer = NULL;
+    struct multitrack *multitrack = NULL;
     struct wav_writer_params wav_params;
+    struct multitrack_params mt_params;
+    struct splitter_params sp_params;
+    struct cfg config[MULTITRACK_MAX_TRACKS];
+    struct seq sequence[MULTITRACK_MAX_TRACKS];
 
-    char *script_file = NULL;
+    int nb_scripts = 0;
+    int nb_configurations = 0;
     int nb_prefill_frames = 0;
     int nb_postfill_frames = 0;
-    char *configuration_file = NULL;
+    int nb_jobs = 1;
     char *output_file = DFT_OUTPUT_FILE;
+    char *script_file[MULTITRACK_MAX_TRACKS];
+    char *configuration_file[MULTITRACK_MAX_TRACKS];
+
+    for (t = 0; t < MULTITRACK_MAX_TRACKS; t++)
+        sequence[t].events = NULL;
 
-    while ((c = getopt(argc, argv, "hc:s:o:p:P:")) != -1) {
+    while ((c = getopt_long(argc, argv, "hc:s:o:p:P:j:", long_options, NULL)) != -1) {
         switch (c) {
         case 'h':
             usage(argv[0]);
             goto exit;
         case 'c':
-            configuration_file = optarg;
+            if (nb_configurations == MULTITRACK_MAX_TRACKS) {
+                LOGE("Too many tracks (%d at most)", MULTITRACK_MAX_TRACKS);
+                g_ret = -EINVAL;
+                goto exit;
+            }
+            configuration_file[nb_configurations++] = optarg;
         break;
         case 's':
-            script_file = optarg;
+            if (nb_scripts == MULTITRACK_MAX_TRACKS) {
+                LOGE("Too many tracks (%d at most)", MULTITRACK_MAX_TRACKS);
+                g_ret = -EINVAL;
+                goto exit;
+            }
+            script_file[nb_scripts++] = optarg;
         break;
         case 'o':
             output_file = optarg;
@@ -125,6 +172,18 @@ int main(int argc, char *argv[])
                 goto exit;
             }
         break;
+        case 'j':
+            nb_jobs = atoi(optarg);
+            if ((nb_jobs < 1) || (nb_jobs > SPLITTER_MAX_THREADS)) {
+                LOGE("Unexpected JOBS value (%d, in [1, %d])", nb_jobs, SPLITTER_MAX_THREADS);
+                usage(argv[0]);
+                g_ret = -EINVAL;
+                goto exit;
+            }
+        break;
+        case 'S':
+            stats_enabled = 1;
+        break;
         case '?':
             g_ret = EXIT_FAILURE;
             usage(argv[0]);
@@ -133,185 +192,152 @@ int main(int argc, char *argv[])
     }
 
     /* Check mandatory arguments */
-    if (!configuration_file) {
+    if (!nb_configurations) {
         LOGE("Missing configuration file");
         usage(argv[0]);
         g_ret = -EINVAL;
         goto exit;
     }
 
-    if (!script_file) {
+    if (!nb_scripts) {
         LOGE("Missing script file");
         usage(argv[0]);
         g_ret = -EINVAL;
         goto exit;
     }
 
-    /* Parse user configuration */
-    ret = parse_cfg(configuration_file, &config);
-    if (ret) {
-        LOGE("Configuration parsing failure");
-        g_ret = EXIT_FAILURE;
+    if (nb_configurations != nb_scripts) {
+        LOGE("Configuration files and script files must come in pairs (%d vs %d provided)",
+             nb_configurations, nb_scripts);
+        usage(argv[0]);
+        g_ret = -EINVAL;
         goto exit;
     }
 
-    /* Parse user sequence */
-    ret = parse_sequence(script_file, &sequence);
-    if (ret) {
-        LOGE("Sequence parsing failure");
-        g_ret = EXIT_FAILURE;
-        goto exit;
+    if (stats_enabled) {
+        stats_init(&stats);
+        p_stats = &stats;
     }
 
+    STATS_START(p_stats, timestamp);
+    for (t = 0; t < nb_configurations; t++) {
 
-    /* Output frame */
-    output_frame = (int32_t *)calloc(config.m_params.frame_size, sizeof(int32_t));
-    if (!output_frame) {
-        LOGE("Output buffer allocation failure");
-        g_ret = EXIT_FAILURE;
-        goto exit;
-    }
+        /* Parse user configuration */
+        ret = parse_cfg(configuration_file[t], &config[t]);
+        if (ret) {
+            LOGE("Configuration parsing failure (%s)", configuration_file[t]);
+            g_ret = EXIT_FAILURE;
+            goto exit;
+        }
 
-    /* Moog init */
-    moog = moog_create(&config.m_params);
-    if (!moog) {
-        LOGE("Failed to initialize Moog module !");
-        g_ret = EXIT_FAILURE;
-        goto exit;
+        /* Parse user sequence */
+        ret = parse_sequence(script_file[t], &sequence[t]);
+        if (ret) {
+            LOGE("Sequence parsing failure (%s)", script_file[t]);
+            g_ret = EXIT_FAILURE;
+            goto exit;
+        }
     }
+    STATS_STOP(p_stats, STATS_PARSE, timestamp);
 
-    /* WAV writer */
-    wav_params.fs          = config.m_params.fs;
-    wav_params.bit_depth   = 32;
-    wav_params.nb_channels = 1;
-    wav_params.filename    = output_file;
-    wav = wav_writer_create(&wav_params);
-    if (!wav) {
-        LOGE("Failed to create WAV writer !");
-        g_ret = EXIT_FAILURE;
-        goto exit;
-    }
 
-    /* Set output intensity */
-    moog_set_intensity(moog, config.intensity);
-
-    /* Pre-fill with silence */
-    moog_toggle(moog, 0);
-    for (i = 0; i < nb_prefill_frames; i++) {
-        moog_process(moog, output_frame);
-        /* QS8.23 to QS.31 */
-        for (j = 0; j < config.m_params.frame_size; j++)
-            output_frame[j] = output_frame[j] << 8;
-        wav_writer_write(wav, output_frame, config.m_params.frame_size);
-    }
+    /* A single track goes through the mix bus only if it has to be scaled or panned */
+    if ((nb_configurations > 1)
+    ||  (config[0].track_gain != 0)
+    ||  (config[0].track_pan != 0)) {
 
-    /* Main loop */
-    rank = DFT_RANK;
-    length = DFT_LENGTH;
-    for (i = 0; i < sequence.nb_events; i++) {
-
-        /* Silence / note update */
-        if (strcmp(sequence.events[i].note, "R") == 0) {
-            ret = moog_toggle(moog, 0);
-            if (ret)
-                LOGE("Failed to toggle Moog OFF");
-        } else {
-            rank += sequence.events[i].rank_update;
-            ret = get_note(rank, sequence.events[i].note, &frequency);
-            if (ret) {
-                LOGE("Failed to get note frequency !");
-                g_ret = EXIT_FAILURE;
-                goto exit;
-            }
-            ret = moog_toggle(moog, 1);
-            if (ret) {
-                LOGE("Failed to toggle Moog ON !");
-                g_ret = EXIT_FAILURE;
-                goto exit;
-            }
-            ret = moog_set_frequency(moog, frequency);
-            if (ret) {
-                LOGE("Failed to set Moog frequency ! Please consider reducing the attack and/or release time");
-                g_ret = EXIT_FAILURE;
-                goto exit;
-            }
+        /* Parallel rendering only splits a single track along time */
+        if (nb_jobs > 1) {
+            LOGE("Parallel rendering (-j) is only available for a single, unscaled and unpanned "
+                 "track");
+            g_ret = -EINVAL;
+            goto exit;
         }
 
-        /* Length update */
-        if (sequence.events[i].len_update != 0)
-            length = sequence.events[i].len_update;
-
-        /* Low pass cutoff frequency sweep */
-        if (sequence.events[i].fc_sweep != 0) {
-            ret = moog_filter_start_fc_sweep(moog, sequence.events[i].fc_sweep, length);
-            if (ret) {
-                LOGE("Failed to start fc sweep !");
-                g_ret = -EINVAL;
-                goto exit;
-            }
+        /* Multi-track init */
+        mt_params.nb_tracks = nb_configurations;
+        for (t = 0; t < nb_configurations; t++) {
+            mt_params.tracks[t].config   = &config[t];
+            mt_params.tracks[t].sequence = &sequence[t];
         }
+        multitrack = multitrack_create(&mt_params);
+        if (!multitrack) {
+            LOGE("Failed to initialize tracks !");
+            g_ret = EXIT_FAILURE;
+            goto exit;
+        }
+        multitrack_get_nb_channels(multitrack, &nb_channels);
 
-        /* Low pass filter parameters update */
-        if ((sequence.events[i].q_update != LP_NO_UPDATE_VALUE)
-        ||  (sequence.events[i].fc_update != LP_NO_UPDATE_VALUE)
-        ||  (sequence.events[i].gain_update != LP_NO_UPDATE_VALUE)) {
-
-            /* Get current filter parameters */
-            ret = moog_filter_get_parameters(moog, &fc, &Q, &gain);
-            if (ret) {
-                LOGE("Failed to retrieve Moog parameters !");
-                g_ret = EXIT_FAILURE;
-                goto exit;
-            }
+    } else if (nb_jobs > 1) {
 
-            /* Update specified parameters */
-            if (sequence.events[i].q_update != LP_NO_UPDATE_VALUE)
-                Q = sequence.events[i].q_update;
-            if (sequence.events[i].fc_update != LP_NO_UPDATE_VALUE)
-                fc = sequence.events[i].fc_update;
-            if (sequence.events[i].gain_update != LP_NO_UPDATE_VALUE)
-                fc = sequence.events[i].gain_update;
-
-            /* Apply new parameters set */
-            ret = moog_filter_set_parameters(moog, fc, Q, gain);
-            if (ret) {
-                LOGE("Failed to update Moog filter parameters !");
-                g_ret = EXIT_FAILURE;
-                goto exit;
-            }
+        /* Parallel rendering init */
+        sp_params.config     = &config[0];
+        sp_params.sequence   = &sequence[0];
+        sp_params.nb_threads = nb_jobs;
+        splitter = splitter_create(&sp_params);
+        if (!splitter) {
+            LOGE("Failed to initialize parallel rendering !");
+            g_ret = EXIT_FAILURE;
+            goto exit;
         }
 
-        /* Output generation */
-        for (j = 0; j < length; j++) {
-            moog_process(moog, output_frame);
-            /* QS8.23 to QS.31 */
-            for (k = 0; k < config.m_params.frame_size; k++)
-                output_frame[k] = output_frame[k] << 8;
-            wav_writer_write(wav, output_frame, config.m_params.frame_size);
+    } else {
+
+        /* Sequencer init */
+        sequencer = sequencer_create(&config[0]);
+        if (!sequencer) {
+            LOGE("Failed to initialize sequencer !");
+            g_ret = EXIT_FAILURE;
+            goto exit;
         }
+    }
 
+    /* WAV writer */
+    wav_params.fs          = config[0].m_params.fs;
+    wav_params.format      = (config[0].m_params.sample_format == MOOG_SAMPLE_FORMAT_FLOAT) ?
+                             WAV_WRITER_FORMAT_FLOAT : WAV_WRITER_FORMAT_PCM;
+    wav_params.bit_depth   = 32;
+    wav_params.nb_channels = nb_channels;
+    wav_params.filename    = output_file;
+    wav = wav_writer_create(&wav_params);
+    if (!wav) {
+        LOGE("Failed to create WAV writer !");
+        g_ret = EXIT_FAILURE;
+        goto exit;
     }
 
-    /* Post-fill with silence */
-    moog_toggle(moog, 0);
-    for (i = 0; i < nb_postfill_frames; i++) {
-        moog_process(moog, output_frame);
-        /* QS8.23 to QS.31 */
-        for (j = 0; j < config.m_params.frame_size; j++)
-            output_frame[j] = output_frame[j] << 8;
-        wav_writer_write(wav, output_frame, config.m_params.frame_size);
+    /* Sequence rendering */
+    if (multitrack)
+        ret = multitrack_run(multitrack, nb_prefill_frames, nb_postfill_frames, wav, p_stats);
+    else if (splitter)
+        ret = splitter_run(splitter, nb_prefill_frames, nb_postfill_frames, wav, p_stats);
+    else
+        ret = sequencer_run(sequencer, &sequence[0], nb_prefill_frames, nb_postfill_frames, wav,
+                            p_stats);
+    if (ret) {
+        LOGE("Sequence rendering failure");
+        g_ret = EXIT_FAILURE;
+        goto exit;
     }
 
 exit:
 
-    if (sequence.events)
-        free(sequence.events);
+    for (t = 0; t < MULTITRACK_MAX_TRACKS; t++) {
+        if (sequence[t].events)
+            free(sequence[t].events);
+    }
 
-    if (output_frame)
-        free(output_frame);
+    multitrack_destroy(&multitrack);
+    splitter_destroy(&splitter);
+    sequencer_destroy(&sequencer);
 
-    moog_destroy(&moog);
+    /* Header writing and file flushing belong to write stage */
+    STATS_START(p_stats, timestamp);
     wav_writer_destroy(&wav);
+    STATS_STOP(p_stats, STATS_WRITE, timestamp);
+
+    if (p_stats)
+        stats_report(p_stats);
 
     return g_ret;
 }
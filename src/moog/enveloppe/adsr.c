@@ -23,9 +23,14 @@
  * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
  **************************************************************************************************/
 
+#include <string.h>
 #include <stdlib.h>
 
 #include <adsr.h>
+#include <snapshot.h>
+
+
+#define MIN(x, y)       (((x) < (y)) ? (x) : (y))
 
 
 /* Internal ADSR states */
@@ -43,87 +48,84 @@ struct adsr {
     float sustain;                      ///< Sustain factor (in [0, 1], applied to intensity)
     float intensity;                    ///< User defined intensity
 
-    /* Decay slope */
-    int decay_len;
-    float *decay_table;
-
-    /* Attack slope */
+    /* Slopes lengths (samples) */
     int attack_len;
-    float *attack_table;
-
-    /* Release slope */
+    int decay_len;
     int release_len;
-    float *release_table;
 
     /* State description */
-    int index;
-    float state_factor;
+    int index;                          ///< Current slope index
     enum adsr_state state;
 };
 
 
-static void adsr_state_update(struct adsr *handle)
+/* Snapshot: settings (checked against the restoring enveloppe ones), intensity, index and state */
+#define SNAPSHOT_SIZE   (7 * SNAPSHOT_32)
+
+
+/* Current slope linear segment: factor = start + index * step, index in [0, len[
+ *
+ *  Returns segment length, or 0 if current state is not a slope (idle and sustain states).
+ */
+static int adsr_get_segment(const struct adsr *handle, float *start, float *step)
 {
     switch (handle->state) {
 
-    case ADSR_IDLE:
-        /* No on going note, just chill ... */
-        break;
-
     case ADSR_ATTACK:
+        /* Raise from 0 to 1 */
+        *start = 0.0;
+        *step  = 1.0 / handle->attack_len;
+        return handle->attack_len;
 
-        handle->index++;
-        if (handle->index < handle->attack_len) {
-
-            /* Keep following attack slope */
-            handle->state_factor = handle->attack_table[handle->index];
+    case ADSR_DECAY:
+        /* Fall from 1 to sustain factor */
+        *start = 1.0;
+        *step  = - (1 - handle->sustain) / handle->decay_len;
+        return handle->decay_len;
 
-        } else {
+    case ADSR_RELEASE:
+        /* Fall from sustain factor to 0 */
+        *start = handle->sustain;
+        *step  = - handle->sustain / handle->release_len;
+        return handle->release_len;
 
-            /* Switch to decay slope */
-            handle->state        = ADSR_DECAY;
-            handle->index        = 0;
-            handle->state_factor = handle->decay_table[handle->index];
-        }
-        break;
+    case ADSR_IDLE:
+    case ADSR_SUSTAIN:
+    default:
+        return 0;
+    }
+}
 
-    case ADSR_DECAY:
 
-        handle->index++;
-        if (handle->index < handle->decay_len) {
+/* Slope value at given index, shared by enveloppe rendering and level readings so that they
+ * round the very same way (retriggers resume from the rendered level): Evaluation order is kept
+ * as written, floating point contractions (FMA) being disabled at build time (see Makefile).
+ */
+static inline float adsr_slope_value(const struct adsr *handle, float start, float step, int index)
+{
+    return handle->intensity * (start + index * step);
+}
 
-            /* Keep following decay slope */
-            handle->state_factor = handle->decay_table[handle->index];
 
-        } else {
+/* Switch to next state at the end of a slope */
+static void adsr_next_state(struct adsr *handle)
+{
+    handle->index = 0;
 
-            /* Switch to sustain mode */
-            handle->state        = ADSR_SUSTAIN;
-            handle->index        = 0;
-            handle->state_factor = handle->sustain;
-        }
+    switch (handle->state) {
+    case ADSR_ATTACK:
+        handle->state = ADSR_DECAY;
         break;
-
-    case ADSR_SUSTAIN:
-        /* Someone has a finger stuck on the keyboard, just wait and don't break the groove ! */
+    case ADSR_DECAY:
+        handle->state = ADSR_SUSTAIN;
         break;
-
     case ADSR_RELEASE:
-
-        handle->index++;
-        if (handle->index < handle->release_len) {
-
-            /* Keep following release slope */
-            handle->state_factor = handle->release_table[handle->index];
-
-        } else {
-
-            /* Switch to idle mode */
-            handle->state        = ADSR_IDLE;
-            handle->index        = 0;
-            handle->intensity    = 0.0;
-            handle->state_factor = 0.0;
-        }
+        handle->state     = ADSR_IDLE;
+        handle->intensity = 0.0;
+        break;
+    case ADSR_IDLE:
+    case ADSR_SUSTAIN:
+    default:
         break;
     }
 }
@@ -131,7 +133,6 @@ static void adsr_state_update(struct adsr *handle)
 
 struct adsr *adsr_create(struct adsr_params *params)
 {
-    int i;
     struct adsr *handle = NULL;
 
     if ((!params)
@@ -147,37 +148,21 @@ struct adsr *adsr_create(struct adsr_params *params)
     if (!handle)
         goto failure;
 
-    handle->index        = 0;
-    handle->state        = ADSR_IDLE;
-    handle->sustain      = params->sustain;
-    handle->intensity    = 0.0;
-    handle->state_factor = 0.0;
-
-    handle->attack_len   = (int)(params->attack * params->fs / 1000);
-    handle->attack_table = (float *)calloc(handle->attack_len, sizeof(float));
-    if (!handle->attack_table)
-        goto failure;
-    for (i = 0; i < handle->attack_len; i++)
-        handle->attack_table[i] = (float)i / handle->attack_len;
-
-
-    handle->decay_len    = (int)(params->decay * params->fs / 1000);
-    handle->decay_table = (float *)calloc(handle->decay_len, sizeof(float));
-    if (!handle->decay_table)
-        goto failure;
-    for (i = 0; i < handle->decay_len; i++)
-        handle->decay_table[i] = handle->sustain + (1 - handle->sustain)
-                                 * (handle->decay_len - i) / handle->decay_len;
-
-    handle->release_len  = (int)(params->release * params->fs / 1000);
-    handle->release_table = (float *)calloc(handle->release_len, sizeof(float));
-    if (!handle->release_table)
-        goto failure;
-    for (i = 0; i < handle->release_len; i++)
-        handle->release_table[i] = handle->sustain
-                                   * (handle->release_len - i) / handle->release_len;
-
-    handle->state = ADSR_IDLE;
+    handle->index     = 0;
+    handle->state     = ADSR_IDLE;
+    handle->sustain   = params->sustain;
+    handle->intensity = 0.0;
+
+    /* Slopes last one sample at least */
+    handle->attack_len  = (int)(params->attack * params->fs / 1000);
+    handle->decay_len   = (int)(params->decay * params->fs / 1000);
+    handle->release_len = (int)(params->release * params->fs / 1000);
+    if (handle->attack_len < 1)
+        handle->attack_len = 1;
+    if (handle->decay_len < 1)
+        handle->decay_len = 1;
+    if (handle->release_len < 1)
+        handle->release_len = 1;
 
     return handle;
 
@@ -194,15 +179,6 @@ void adsr_destroy(struct adsr **handle)
     if ((!handle) || (!(*handle)))
         goto exit;
 
-    if ((*handle)->attack_table)
-        free((*handle)->attack_table);
-
-    if ((*handle)->decay_table)
-        free((*handle)->decay_table);
-
-    if ((*handle)->release_table)
-        free((*handle)->release_table);
-
     free(*handle);
     *handle = NULL;
 
@@ -212,6 +188,55 @@ exit:
 }
 
 
+int adsr_get_level(struct adsr *handle, float *level)
+{
+    int ret = 0;
+    float start, step;
+
+    if ((!handle)
+    ||  (!level)) {
+        ret = -EINVAL;
+        goto exit;
+    }
+
+    if (adsr_get_segment(handle, &start, &step))
+        *level = adsr_slope_value(handle, start, step, handle->index);
+    else if (handle->state == ADSR_SUSTAIN)
+        *level = handle->intensity * handle->sustain;
+    else
+        *level = 0;
+
+exit:
+
+    return ret;
+}
+
+
+int adsr_retrigger(struct adsr *handle, float intensity)
+{
+    int index, ret = 0;
+    float level;
+
+    if ((!handle)
+    ||  (intensity < 0)
+    ||  (intensity > 1)) {
+        ret = -EINVAL;
+        goto exit;
+    }
+
+    /* Attack slope resumes from current level, avoiding any discontinuity */
+    adsr_get_level(handle, &level);
+    index = (intensity > 0) ? (int)(level / intensity * handle->attack_len) : 0;
+    handle->intensity = intensity;
+    handle->state     = ADSR_ATTACK;
+    handle->index     = MIN(index, handle->attack_len - 1);
+
+exit:
+
+    return ret;
+}
+
+
 int adsr_toggle(struct adsr *handle, int state, float intensity)
 {
     int ret = 0;
@@ -226,18 +251,23 @@ int adsr_toggle(struct adsr *handle, int state, float intensity)
 
     if (state == 1) {
 
-        /* Avoid note switch during transitions (shall be fixed ...) */
-        if ((handle->state != ADSR_IDLE)
-        &&  (handle->state != ADSR_SUSTAIN)) {
-            ret = -EAGAIN;
-        } else {
-            if (handle->state == ADSR_IDLE) {
-                handle->intensity    = intensity;
-                handle->state        = ADSR_ATTACK;
-                handle->index        = 0;
-                handle->state_factor = 0.0;
-            }
-            /* No else: If we're in sustain mode, just stay like this */
+        switch (handle->state) {
+        case ADSR_IDLE:
+            handle->intensity = intensity;
+            handle->state     = ADSR_ATTACK;
+            handle->index     = 0;
+            break;
+        case ADSR_DECAY:
+        case ADSR_RELEASE:
+            ret = adsr_retrigger(handle, intensity);
+            break;
+        case ADSR_ATTACK:
+        case ADSR_SUSTAIN:
+        default:
+            /* Note already on going: just stay like this (legato), unless intensity changes */
+            if (intensity != handle->intensity)
+                ret = adsr_retrigger(handle, intensity);
+            break;
         }
 
     } else {
@@ -248,12 +278,11 @@ int adsr_toggle(struct adsr *handle, int state, float intensity)
             ret = 0;
         } else {
             /* Switch to release mode, whatever current state.
-             * In case we're in attack or decay state, that will generate a state_factor
-             * discontinuity ... To be reworked, somewhere, sometime.
+             * In case we're in attack or decay state, that will generate a discontinuity
+             * (release slope starts from sustain factor) ... To be reworked, somewhere, sometime.
              */
-            handle->state        = ADSR_RELEASE;
-            handle->index        = 0;
-            handle->state_factor = handle->sustain;
+            handle->state = ADSR_RELEASE;
+            handle->index = 0;
         }
     }
 
@@ -265,7 +294,8 @@ exit:
 
 int adsr_process(struct adsr *handle, int nb_frames, float *enveloppe)
 {
-    int i, ret = 0;
+    int i, n, len, ret = 0;
+    float start, step, value;
 
     if ((!handle)
     || (!enveloppe)) {
@@ -273,14 +303,201 @@ int adsr_process(struct adsr *handle, int nb_frames, float *enveloppe)
         goto exit;
     }
 
-    for (i = 0; i < nb_frames; i++) {
+    /* Fill enveloppe by spans of constant or linear segments, up to state changes */
+    while (nb_frames > 0) {
+
+        len = adsr_get_segment(handle, &start, &step);
 
-        enveloppe[i] = handle->intensity * handle->state_factor;
+        if (!len) {
 
-        adsr_state_update(handle);
+            /* Idle or sustain: constant value up to next toggle */
+            n     = nb_frames;
+            value = (handle->state == ADSR_SUSTAIN) ? handle->intensity * handle->sustain : 0;
+            if (value == 0) {
+                memset(enveloppe, 0, n * sizeof(float));
+            } else {
+                for (i = 0; i < n; i++)
+                    enveloppe[i] = value;
+            }
+
+        } else {
+
+            /* Slope: linear ramp up to its end */
+            n = MIN(nb_frames, len - handle->index);
+            for (i = 0; i < n; i++)
+                enveloppe[i] = adsr_slope_value(handle, start, step, handle->index + i);
+
+            handle->index += n;
+            if (handle->index == len)
+                adsr_next_state(handle);
+        }
+
+        enveloppe += n;
+        nb_frames -= n;
     }
 
 exit:
 
     return ret;
 }
+
+
+int adsr_skip(struct adsr *handle, int nb_frames)
+{
+    int n, len, ret = 0;
+    float start, step;
+
+    if ((!handle) || (nb_frames < 0)) {
+        ret = -EINVAL;
+        goto exit;
+    }
+
+    /* Same state machine as adsr_process, without computing the enveloppe */
+    while (nb_frames > 0) {
+
+        len = adsr_get_segment(handle, &start, &step);
+        if (!len)
+            break;
+
+        n = MIN(nb_frames, len - handle->index);
+        handle->index += n;
+        if (handle->index == len)
+            adsr_next_state(handle);
+
+        nb_frames -= n;
+    }
+
+exit:
+
+    return ret;
+}
+
+
+int adsr_is_idle(struct adsr *handle)
+{
+    return (handle) && (handle->state == ADSR_IDLE);
+}
+
+
+/* Read a snapshot into a copy of the enveloppe: Settings must be the enveloppe ones, and the
+ * position must lie within the current slope (none outside of slopes)
+ *
+ *  Returns the snapshot size, -EINVAL if it does not fit.
+ */
+static int adsr_read_snapshot(const struct adsr *handle, const void *blob, int size,
+                              struct adsr *state)
+{
+    float step, start;
+    int len, ret = SNAPSHOT_SIZE;
+    const uint8_t *ptr = (const uint8_t *)blob;
+
+    if ((!blob)
+    ||  (size < SNAPSHOT_SIZE)) {
+        ret = -EINVAL;
+        goto exit;
+    }
+
+    memcpy(state, handle, sizeof(struct adsr));
+
+    if ((snapshot_get_float(&ptr) != handle->sustain)
+    ||  (snapshot_get_i32(&ptr) != handle->attack_len)
+    ||  (snapshot_get_i32(&ptr) != handle->decay_len)
+    ||  (snapshot_get_i32(&ptr) != handle->release_len)) {
+        ret = -EINVAL;
+        goto exit;
+    }
+
+    state->intensity = snapshot_get_float(&ptr);
+    state->index     = snapshot_get_i32(&ptr);
+    state->state     = (enum adsr_state)snapshot_get_i32(&ptr);
+
+    if ((state->state < ADSR_IDLE)
+    ||  (state->state > ADSR_RELEASE)
+    ||  (!(state->intensity >= 0))
+    ||  (!(state->intensity <= 1))) {
+        ret = -EINVAL;
+        goto exit;
+    }
+
+    len = adsr_get_segment(state, &start, &step);
+    if ((state->index < 0)
+    ||  ((len > 0) && (state->index >= len))
+    ||  ((len == 0) && (state->index != 0)))
+        ret = -EINVAL;
+
+exit:
+
+    return ret;
+}
+
+
+int adsr_snapshot(struct adsr *handle, void *blob, int size)
+{
+    int ret = SNAPSHOT_SIZE;
+    uint8_t *ptr = (uint8_t *)blob;
+
+    if (!handle) {
+        ret = -EINVAL;
+        goto exit;
+    }
+
+    if (!blob)
+        goto exit;
+
+    if (size < SNAPSHOT_SIZE) {
+        ret = -ENOSPC;
+        goto exit;
+    }
+
+    snapshot_put_float(&ptr, handle->sustain);
+    snapshot_put_i32(&ptr, handle->attack_len);
+    snapshot_put_i32(&ptr, handle->decay_len);
+    snapshot_put_i32(&ptr, handle->release_len);
+    snapshot_put_float(&ptr, handle->intensity);
+    snapshot_put_i32(&ptr, handle->index);
+    snapshot_put_i32(&ptr, handle->state);
+
+exit:
+
+    return ret;
+}
+
+
+int adsr_restore(struct adsr *handle, const void *blob, int size)
+{
+    int ret = 0;
+    struct adsr state;
+
+    if (!handle) {
+        ret = -EINVAL;
+        goto exit;
+    }
+
+    ret = adsr_read_snapshot(handle, blob, size, &state);
+    if (ret < 0)
+        goto exit;
+
+    memcpy(handle, &state, sizeof(struct adsr));
+
+exit:
+
+    return ret;
+}
+
+
+int adsr_check_snapshot(struct adsr *handle, const void *blob, int size)
+{
+    int ret = 0;
+    struct adsr state;
+
+    if (!handle) {
+        ret = -EINVAL;
+        goto exit;
+    }
+
+    ret = adsr_read_snapshot(handle, blob, size, &state);
+
+exit:
+
+    return ret;
+}
@@ -68,9 +68,24 @@ struct adsr *adsr_create(struct adsr_params *params);
 void adsr_destroy(struct adsr **handle);
 
 
+/**
+ * @brief Get current enveloppe level
+ *
+ * @param[in]  handle       : Module handle
+ * @param[out] level        : Current enveloppe value (intensity scaled)
+ *
+ * @return 0 if successful, 0 > errno else
+ */
+int adsr_get_level(struct adsr *handle, float *level);
+
+
 /**
  * @brief Toggle note (ON/OFF)
  *
+ *  A note ON during decay or release slopes retriggers the attack slope from the current level,
+ * while a note ON during attack or sustain keeps the enveloppe untouched (legato), unless the
+ * note intensity differs from the current one (see adsr_retrigger).
+ *
  * @param[in] handle    : Module handle
  * @param[in] state     : ON (1), OFF (0)
  * @param[in] intensity : Note intensity (only used if state == ON)
@@ -80,6 +95,18 @@ void adsr_destroy(struct adsr **handle);
 int adsr_toggle(struct adsr *handle, int state, float intensity);
 
 
+/**
+ * @brief Start a new note whatever the current state: the attack slope is retriggered from the
+ *        current level, up to the new note intensity
+ *
+ * @param[in] handle    : Module handle
+ * @param[in] intensity : Note intensity
+ *
+ * @return 0 if successful, 0 > errno else
+ */
+int adsr_retrigger(struct adsr *handle, float intensity);
+
+
 /**
  * @brief Proceed to enveloppe computation
  *
@@ -92,4 +119,67 @@ int adsr_toggle(struct adsr *handle, int state, float intensity);
 int adsr_process(struct adsr *handle, int nb_frames, float *enveloppe);
 
 
+/**
+ * @brief Move enveloppe forward as if nb_frames samples were computed
+ *
+ * @param[in]  handle       : Module handle
+ * @param[in]  nb_frames    : Numer of samples
+ *
+ * @return 0 if successful, 0 > errno else
+ */
+int adsr_skip(struct adsr *handle, int nb_frames);
+
+
+/**
+ * @brief Check whether enveloppe is idle (no note on going: null enveloppe up to next toggle)
+ *
+ * @param[in] handle    : Module handle
+ *
+ * @return 1 if idle, 0 else
+ */
+int adsr_is_idle(struct adsr *handle);
+
+
+/**
+ * @brief Save enveloppe state (settings, current slope and position) to a position independent
+ *        blob
+ *
+ * @param[in]  handle       : Module handle
+ * @param[out] blob         : State snapshot (NULL to only get its size)
+ * @param[in]  size         : Blob size (bytes)
+ *
+ * @return Snapshot size (bytes) if successful, 0 > errno else
+ */
+int adsr_snapshot(struct adsr *handle, void *blob, int size);
+
+
+/**
+ * @brief Restore enveloppe state (current slope and position) from a snapshot (see
+ *        adsr_snapshot), taken with the same settings
+ *
+ *  Snapshots taken with other settings, or positioned out of their slope, are rejected (enveloppe
+ * being left untouched).
+ *
+ * @param[in] handle        : Module handle
+ * @param[in] blob          : State snapshot
+ * @param[in] size          : Blob size (bytes)
+ *
+ * @return Number of read bytes if successful, 0 > errno else
+ */
+int adsr_restore(struct adsr *handle, const void *blob, int size);
+
+
+/**
+ * @brief Check whether a snapshot would be restored (see adsr_restore), leaving the enveloppe
+ *        untouched
+ *
+ * @param[in] handle        : Module handle
+ * @param[in] blob          : State snapshot
+ * @param[in] size          : Blob size (bytes)
+ *
+ * @return Number of bytes adsr_restore would read if successful, 0 > errno else
+ */
+int adsr_check_snapshot(struct adsr *handle, const void *blob, int size);
+
+
 #endif /* _ADSR_H_ */
@@ -23,25 +23,137 @@
  * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
  **************************************************************************************************/
 
+#include <math.h>
+#include <string.h>
 #include <stdlib.h>
 
 #include <saw_gen.h>
+#include <snapshot.h>
+
+/* Runtime dispatched SIMD kernels (x86 only) */
+#if defined(__x86_64__) && defined(__GNUC__)
+#include <immintrin.h>
+#define SAW_GEN_SIMD
+#endif
 
 #define QS823_MAX           ((1 << 23) - 1)         ///< QS8.23 scale factor
 
+/* Phase accumulator: Q.32 fraction of cycle (wraps around on overflow) */
+#define PHASE_SCALE         (4294967296.0)          ///< 2^32
+#define PHASE_INC(f0, fs)   ((uint32_t)llround((double)(f0) / (fs) * PHASE_SCALE))
+
+/* Rendering kernel prototype: frames [start, nb_frames[ */
+typedef void (*saw_gen_kernel)(uint32_t phase, uint32_t phase_inc, float scale, int start,
+                               int nb_frames, int32_t *out);
+
 
 struct saw_gen {
     float f0;                                       ///< Waveform frequency
     float fs;                                       ///< Sampling frequency
-    float phase;                                    ///< Initial waveform phase
     float intensity;                                ///< Waveform intensity
-    int32_t step;                                   ///< Decreasing step value
+    uint32_t phase;                                 ///< Current phase
+    uint32_t phase_inc;                             ///< Phase increment
     int32_t i_max;                                  ///< Maximum intensity value
-    int32_t i_min;                                  ///< Minimum intensity value
-    int32_t i_current;                              ///< Current waveform value
+    float scale;                                    ///< Centered phase to output scale factor
+    saw_gen_kernel kernel;                          ///< Rendering kernel
 };
 
 
+/* Snapshot: sampling frequency (checked), frequency, intensity and phase, other fields being
+ * derived from them
+ */
+#define SNAPSHOT_SIZE       (4 * SNAPSHOT_32)
+
+
+/* Rendering kernel, portable version
+ *
+ *  Phase is centered ([-2^31, 2^31[ signed value), and scaled to a [i_max, -i_max] descending
+ * ramp: Every frame only depends on its index.
+ */
+static void saw_gen_render_scalar(uint32_t phase, uint32_t phase_inc, float scale, int start,
+                                  int nb_frames, int32_t *out)
+{
+    int i;
+
+    for (i = start; i < nb_frames; i++)
+        out[i] = (int32_t)((float)(int32_t)(phase + (uint32_t)i * phase_inc + 0x80000000u)
+                           * scale);
+}
+
+
+#if defined(SAW_GEN_SIMD)
+
+/* Rendering kernel, SSE2 version (4 frames per iteration) */
+static void saw_gen_render_sse2(uint32_t phase, uint32_t phase_inc, float scale, int start,
+                                int nb_frames, int32_t *out)
+{
+    int i;
+    __m128i p;
+    uint32_t p0 = phase + (uint32_t)start * phase_inc + 0x80000000u;
+    const __m128i step = _mm_set1_epi32((int32_t)(4 * phase_inc));
+    const __m128  s    = _mm_set1_ps(scale);
+
+    p = _mm_setr_epi32((int32_t)p0, (int32_t)(p0 + phase_inc), (int32_t)(p0 + 2 * phase_inc),
+                       (int32_t)(p0 + 3 * phase_inc));
+
+    for (i = start; i + 4 <= nb_frames; i += 4) {
+        _mm_storeu_si128((__m128i *)&out[i], _mm_cvttps_epi32(_mm_mul_ps(_mm_cvtepi32_ps(p), s)));
+        p = _mm_add_epi32(p, step);
+    }
+
+    saw_gen_render_scalar(phase, phase_inc, scale, i, nb_frames, out);
+}
+
+
+/* Rendering kernel, AVX2 version (8 frames per iteration) */
+__attribute__((target("avx2")))
+static void saw_gen_render_avx2(uint32_t phase, uint32_t phase_inc, float scale, int start,
+                                int nb_frames, int32_t *out)
+{
+    int i;
+    __m256i p;
+    uint32_t p0 = phase + (uint32_t)start * phase_inc + 0x80000000u;
+    const __m256i step = _mm256_set1_epi32((int32_t)(8 * phase_inc));
+    const __m256  s    = _mm256_set1_ps(scale);
+
+    p = _mm256_mullo_epi32(_mm256_setr_epi32(0, 1, 2, 3, 4, 5, 6, 7),
+                           _mm256_set1_epi32((int32_t)phase_inc));
+    p = _mm256_add_epi32(p, _mm256_set1_epi32((int32_t)p0));
+
+    for (i = start; i + 8 <= nb_frames; i += 8) {
+        _mm256_storeu_si256((__m256i *)&out[i],
+                            _mm256_cvttps_epi32(_mm256_mul_ps(_mm256_cvtepi32_ps(p), s)));
+        p = _mm256_add_epi32(p, step);
+    }
+
+    saw_gen_render_scalar(phase, phase_inc, scale, i, nb_frames, out);
+}
+
+#endif /* SAW_GEN_SIMD */
+
+
+/* Select best kernel supported by running CPU */
+static saw_gen_kernel saw_gen_select_kernel(void)
+{
+#if defined(SAW_GEN_SIMD)
+    __builtin_cpu_init();
+    if (__builtin_cpu_supports("avx2"))
+        return saw_gen_render_avx2;
+    return saw_gen_render_sse2;
+#else
+    return saw_gen_render_scalar;
+#endif
+}
+
+
+/* Update amplitude dependent parameters */
+static void saw_gen_set_scale(struct saw_gen *handle)
+{
+    handle->i_max = (int32_t)(handle->intensity * QS823_MAX);
+    handle->scale = - (float)handle->i_max / 2147483648.0f;
+}
+
+
 struct saw_gen *saw_gen_create(struct saw_gen_params *params)
 {
     struct saw_gen *handle = NULL;
@@ -61,10 +173,10 @@ struct saw_gen *saw_gen_create(struct saw_gen_params *params)
     handle->f0        = params->f0;
     handle->fs        = params->fs;
     handle->intensity = params->intensity;
-    handle->i_max     = (int32_t)(handle->intensity * QS823_MAX);
-    handle->i_min     = - (int32_t)(handle->intensity * QS823_MAX);
-    handle->step      = (int32_t)((2 * handle->i_max) * (handle->f0 / handle->fs));
-    handle->i_current = handle->i_max;
+    handle->phase     = 0;
+    handle->phase_inc = PHASE_INC(handle->f0, handle->fs);
+    handle->kernel    = saw_gen_select_kernel();
+    saw_gen_set_scale(handle);
 
     return handle;
 
@@ -121,9 +233,9 @@ int saw_gen_set_frequency(struct saw_gen *handle, float f0)
 
     /* Update saw generation parameters */
     handle->f0        = f0;
-    handle->step      = (int32_t)((2 * handle->i_max) * (handle->f0 / handle->fs));
+    handle->phase_inc = PHASE_INC(handle->f0, handle->fs);
 
-    /* No need to change current value: we just keep following at a diffrent rate */
+    /* No need to change current phase: we just keep following at a diffrent rate */
 
 exit:
 
@@ -162,11 +274,26 @@ int saw_gen_set_intensity(struct saw_gen *handle, float intensity)
 
     /* Update saw generation parameters */
     handle->intensity = intensity;
-    handle->i_max     = (int32_t)(handle->intensity * QS823_MAX);
-    handle->i_min     = - (int32_t)(handle->intensity * QS823_MAX);
-    handle->step      = (int32_t)((2 * handle->i_max) * (handle->f0 / handle->fs));
+    saw_gen_set_scale(handle);
 
-    /* No need to change current value: we just keep following at a diffrent rate */
+    /* No need to change current phase: we just keep following at a diffrent scale */
+
+exit:
+
+    return ret;
+}
+
+
+int saw_gen_skip(struct saw_gen *handle, int nb_frames)
+{
+    int ret = 0;
+
+    if ((!handle) || (nb_frames < 0)) {
+        ret = -EINVAL;
+        goto exit;
+    }
+
+    handle->phase += (uint32_t)nb_frames * handle->phase_inc;
 
 exit:
 
@@ -176,24 +303,130 @@ exit:
 
 int saw_gen_process(struct saw_gen *handle, int nb_frames, int32_t *out)
 {
-    int i, ret = 0;
-    int32_t underflow;
+    int ret = 0;
 
     if ((!handle) || (!out)) {
         ret = -EINVAL;
         goto exit;
     }
 
-    for (i = 0; i < nb_frames; i++) {
+    handle->kernel(handle->phase, handle->phase_inc, handle->scale, 0, nb_frames, out);
+    handle->phase += (uint32_t)nb_frames * handle->phase_inc;
+
+exit:
+
+    return ret;
+}
+
+
+/* Read a snapshot into a copy of the generator, checking it fits
+ *
+ *  Returns the snapshot size, -EINVAL if it does not fit.
+ */
+static int saw_gen_read_snapshot(const struct saw_gen *handle, const void *blob, int size,
+                                 struct saw_gen *state)
+{
+    int ret = SNAPSHOT_SIZE;
+    const uint8_t *ptr = (const uint8_t *)blob;
+
+    if ((!blob)
+    ||  (size < SNAPSHOT_SIZE)) {
+        ret = -EINVAL;
+        goto exit;
+    }
+
+    memcpy(state, handle, sizeof(struct saw_gen));
+
+    if (snapshot_get_float(&ptr) != handle->fs) {
+        ret = -EINVAL;
+        goto exit;
+    }
+
+    state->f0        = snapshot_get_float(&ptr);
+    state->intensity = snapshot_get_float(&ptr);
+    state->phase     = snapshot_get_u32(&ptr);
+
+    if ((!(state->f0 >= 0))
+    ||  (!(state->f0 <= state->fs))
+    ||  (!(state->intensity >= 0))
+    ||  (!(state->intensity <= 1))) {
+        ret = -EINVAL;
+        goto exit;
+    }
+
+    /* Derived fields */
+    state->phase_inc = PHASE_INC(state->f0, state->fs);
+    saw_gen_set_scale(state);
+
+exit:
+
+    return ret;
+}
+
+
+int saw_gen_snapshot(struct saw_gen *handle, void *blob, int size)
+{
+    int ret = SNAPSHOT_SIZE;
+    uint8_t *ptr = (uint8_t *)blob;
+
+    if (!handle) {
+        ret = -EINVAL;
+        goto exit;
+    }
+
+    if (!blob)
+        goto exit;
 
-        out[i] = handle->i_current;
-        handle->i_current -= handle->step;
-        if (handle->i_current < handle->i_min) {
-            underflow = handle->i_current - handle->i_min;
-            handle->i_current = handle->i_max - underflow;
-        }
+    if (size < SNAPSHOT_SIZE) {
+        ret = -ENOSPC;
+        goto exit;
     }
 
+    snapshot_put_float(&ptr, handle->fs);
+    snapshot_put_float(&ptr, handle->f0);
+    snapshot_put_float(&ptr, handle->intensity);
+    snapshot_put_u32(&ptr, handle->phase);
+
+exit:
+
+    return ret;
+}
+
+
+int saw_gen_restore(struct saw_gen *handle, const void *blob, int size)
+{
+    int ret = 0;
+    struct saw_gen state;
+
+    if (!handle) {
+        ret = -EINVAL;
+        goto exit;
+    }
+
+    ret = saw_gen_read_snapshot(handle, blob, size, &state);
+    if (ret < 0)
+        goto exit;
+
+    memcpy(handle, &state, sizeof(struct saw_gen));
+
+exit:
+
+    return ret;
+}
+
+
+int saw_gen_check_snapshot(struct saw_gen *handle, const void *blob, int size)
+{
+    int ret = 0;
+    struct saw_gen state;
+
+    if (!handle) {
+        ret = -EINVAL;
+        goto exit;
+    }
+
+    ret = saw_gen_read_snapshot(handle, blob, size, &state);
+
 exit:
 
     return ret;
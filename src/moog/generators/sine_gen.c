@@ -28,14 +28,26 @@
 #include <stdlib.h>
 
 #include <sine_gen.h>
+#include <snapshot.h>
 
 
-#define ABS(x)                      (((x) > 0) ? (x) : -(x))
 #define MIN(x,y)                    (((x) < (y)) ? (x) : (y))
-#define SIGN(x)                     (((x) >= 0) ? 1 : -1)
 #define QS823_MAX                   ((1 << 23) - 1)                 ///< QS8.23 scale factor
 #define INTENSITY_TRANSITION_LEN    (1000)
 #define FREQUENCY_TRANSITION_LEN    (256)
+#define FREQUENCY_TRANSITION_SHIFT  (8)                             ///< log2(transition length)
+
+/* Phase accumulator: Q.32 fraction of cycle (wraps around on overflow) */
+#define PHASE_SCALE                 (4294967296.0)                  ///< 2^32
+#define PHASE_INC(f0, fs)           ((uint32_t)llround((double)(f0) / (fs) * PHASE_SCALE))
+
+/* sin(pi.t) Taylor series coefficients, t in [-0.5, 0.5] (error < 6e-8) */
+#define SIN_C1                      ( 3.14159265358979f)
+#define SIN_C3                      (-5.16771278004997f)
+#define SIN_C5                      ( 2.55016403987734f)
+#define SIN_C7                      (-0.59926452932079f)
+#define SIN_C9                      ( 0.08214588661112f)
+#define SIN_C11                     (-0.00737043094571f)
 
 
 struct sine_gen {
@@ -43,30 +55,113 @@ struct sine_gen {
     /* General parameters */
     float fs;
     float f0;
-    float phase;
-    uint64_t index;
+    uint32_t phase;
+    uint32_t phase_inc;
     float intensity;
 
     /* Amplitude transition descriptors */
+    float new_intensity;
     float intensity_delta;
     int intensity_transition;
     int intensity_transition_index;
 
-    /* Trackers for frequency transition */
-    int ascending;
-    int prev_sign;
-    int sign_change;
-    int32_t prev_out;
-
-    /* Frequency transition descriptors */
+    /* Frequency transition descriptors: Phase increment linearly moves from start_inc to
+     * start_inc + delta_inc, phase being continuous (closed form from transition start)
+     */
     float new_f0;
+    uint32_t start_phase;
+    uint32_t start_inc;
+    int64_t delta_inc;
     int frequency_transition;
-    int frequency_transition_start;
     int frequency_transition_index;
-    float frequency_transition_phase[FREQUENCY_TRANSITION_LEN];
 };
 
 
+/* Snapshot: sampling frequency (checked), frequency, phase and transitions (phase increment
+ * being derived from frequency)
+ */
+#define SNAPSHOT_SIZE               (13 * SNAPSHOT_32 + SNAPSHOT_64)
+
+
+/* sin(2.pi.phase), phase being a Q.32 fraction of cycle */
+static inline float sine_gen_sin(uint32_t phase)
+{
+    float t, t2;
+
+    /* Phase as a [-1, 1[ half cycle fraction, folded to [-0.5, 0.5] as sin(pi.t) = sin(pi.(1-t)) */
+    t  = (int32_t)phase * (1.0f / 2147483648.0f);
+    t  = copysignf(0.5f - fabsf(0.5f - fabsf(t)), t);
+    t2 = t * t;
+
+    return t * (SIN_C1 + t2 * (SIN_C3 + t2 * (SIN_C5 + t2 * (SIN_C7 + t2 * (SIN_C9
+                                                                       + t2 * SIN_C11)))));
+}
+
+
+/* Render sine frames from given phase, intensity ramping by intensity_step on every frame
+ *
+ *  Every frame only depends on its index: the loop is branch free, and vectorized by the compiler.
+ */
+static void sine_gen_render(uint32_t phase, uint32_t phase_inc, float intensity,
+                            float intensity_step, int nb_frames, int32_t *out)
+{
+    int i;
+
+    for (i = 0; i < nb_frames; i++)
+        out[i] = (int32_t)(QS823_MAX * (intensity + (i + 1) * intensity_step)
+                           * sine_gen_sin(phase + (uint32_t)i * phase_inc));
+}
+
+
+/* Move amplitude transition forward */
+static void sine_gen_intensity_advance(struct sine_gen *handle, int nb_frames)
+{
+    if (!handle->intensity_transition)
+        return;
+
+    handle->intensity_transition_index += nb_frames;
+    if (handle->intensity_transition_index == INTENSITY_TRANSITION_LEN) {
+        handle->intensity                  = handle->new_intensity;
+        handle->intensity_transition       = 0;
+        handle->intensity_delta            = 0;
+        handle->intensity_transition_index = 0;
+    } else {
+        handle->intensity += nb_frames * handle->intensity_delta;
+    }
+}
+
+
+/* Phase increment after given number of frequency transition frames */
+static uint32_t sine_gen_transition_inc(const struct sine_gen *handle, int k)
+{
+    return handle->start_inc + (uint32_t)((handle->delta_inc * k) >> FREQUENCY_TRANSITION_SHIFT);
+}
+
+
+/* Phase after given number of frequency transition frames
+ *
+ *  k-th frame phase increment being start_inc + delta_inc.(k + 1) / LEN, phase after k frames is
+ * start_phase + k.start_inc + delta_inc.k.(k + 1) / (2.LEN): Modulo 2^32 sums are exact.
+ */
+static uint32_t sine_gen_transition_phase(const struct sine_gen *handle, int k)
+{
+    return handle->start_phase + (uint32_t)k * handle->start_inc
+         + (uint32_t)((handle->delta_inc * k * (k + 1) / 2) >> FREQUENCY_TRANSITION_SHIFT);
+}
+
+
+/* Render frequency transition frames, from given transition index */
+static void sine_gen_render_transition(const struct sine_gen *handle, int index, int nb_frames,
+                                       int32_t *out)
+{
+    int i;
+
+    for (i = 0; i < nb_frames; i++)
+        out[i] = (int32_t)(QS823_MAX * (handle->intensity + (i + 1) * handle->intensity_delta)
+                           * sine_gen_sin(sine_gen_transition_phase(handle, index + i)));
+}
+
+
 struct sine_gen *sine_gen_create(struct sine_gen_params *params)
 {
     struct sine_gen *handle = NULL;
@@ -86,7 +181,8 @@ struct sine_gen *sine_gen_create(struct sine_gen_params *params)
     handle->f0        = params->f0;
     handle->fs        = params->fs;
     handle->intensity = params->intensity;
-    handle->index     = 0;
+    handle->phase     = 0;
+    handle->phase_inc = PHASE_INC(handle->f0, handle->fs);
 
     return handle;
 
@@ -131,8 +227,8 @@ exit:
 
 int sine_gen_set_frequency(struct sine_gen *handle, float f0)
 {
-    int i, ret = 0;
-    float f, delta;
+    int ret = 0;
+    uint32_t phase_inc;
 
     if ((!handle)
     ||  (f0 < 0)
@@ -142,25 +238,21 @@ int sine_gen_set_frequency(struct sine_gen *handle, float f0)
     }
 
     if (handle->f0 == 0) {
-        handle->f0 = f0;
+        handle->f0        = f0;
+        handle->phase_inc = PHASE_INC(f0, handle->fs);
         goto exit;
     }
 
-    if (handle->frequency_transition) {
-        ret = -EAGAIN;
-        goto exit;
-    }
-
-    delta = (f0 - handle->f0) / FREQUENCY_TRANSITION_LEN;
-    handle->frequency_transition_phase[0] = handle->f0;
-    for (i = 1; i < FREQUENCY_TRANSITION_LEN; i++) {
-        f = handle->f0 + i*delta;
-        handle->frequency_transition_phase[i] = handle->frequency_transition_phase[i - 1] + f;
-    }
+    /* Start from current phase and increment, which might be those of an ongoing transition */
+    phase_inc = handle->phase_inc;
+    if (handle->frequency_transition)
+        phase_inc = sine_gen_transition_inc(handle, handle->frequency_transition_index);
 
     handle->new_f0                     = f0;
+    handle->start_phase                = handle->phase;
+    handle->start_inc                  = phase_inc;
+    handle->delta_inc                  = (int64_t)PHASE_INC(f0, handle->fs) - phase_inc;
     handle->frequency_transition       = 1;
-    handle->frequency_transition_start = 0;
     handle->frequency_transition_index = 0;
 
 exit:
@@ -198,6 +290,7 @@ int sine_gen_set_intensity(struct sine_gen *handle, float intensity)
         goto exit;
     }
 
+    handle->new_intensity              = intensity;
     handle->intensity_transition       = 1;
     handle->intensity_delta            = (intensity - handle->intensity) / INTENSITY_TRANSITION_LEN;
     handle->intensity_transition_index = 0;
@@ -208,124 +301,229 @@ exit:
 }
 
 
+/* Move generation forward by nb_frames, rendering them unless out is NULL */
+static void sine_gen_run(struct sine_gen *handle, int nb_frames, int32_t *out)
+{
+    int n;
+
+    while (nb_frames > 0) {
+
+        /* Process up to next transition end, if any */
+        n = nb_frames;
+        if (handle->intensity_transition)
+            n = MIN(n, INTENSITY_TRANSITION_LEN - handle->intensity_transition_index);
+
+        if (handle->frequency_transition) {
+
+            n = MIN(n, FREQUENCY_TRANSITION_LEN - handle->frequency_transition_index);
+
+            if (out)
+                sine_gen_render_transition(handle, handle->frequency_transition_index, n, out);
+
+            handle->frequency_transition_index += n;
+            handle->phase = sine_gen_transition_phase(handle, handle->frequency_transition_index);
+
+            /* Handle end of frequency transition */
+            if (handle->frequency_transition_index == FREQUENCY_TRANSITION_LEN) {
+                handle->f0                         = handle->new_f0;
+                handle->phase_inc                  = PHASE_INC(handle->f0, handle->fs);
+                handle->new_f0                     = 0;
+                handle->frequency_transition       = 0;
+                handle->frequency_transition_index = 0;
+            }
+
+        } else {
+
+            if (out)
+                sine_gen_render(handle->phase, handle->phase_inc, handle->intensity,
+                                handle->intensity_delta, n, out);
+
+            handle->phase += (uint32_t)n * handle->phase_inc;
+        }
+
+        sine_gen_intensity_advance(handle, n);
+
+        if (out)
+            out   += n;
+        nb_frames -= n;
+    }
+}
+
+
+int sine_gen_skip(struct sine_gen *handle, int nb_frames)
+{
+    int ret = 0;
+
+    if ((!handle) || (nb_frames < 0)) {
+        ret = -EINVAL;
+        goto exit;
+    }
+
+    sine_gen_run(handle, nb_frames, NULL);
+
+exit:
+
+    return ret;
+}
+
+
 int sine_gen_process(struct sine_gen *handle, int nb_frames, int32_t *out)
 {
-    float phase;
-    int period, index = 0;
-    int i, j, sign, ret = 0;
-    int32_t delta, delta_min = QS823_MAX;
-    int32_t tmp, prev_tmp, local_ascending = 0;
+    int ret = 0;
 
     if ((!handle) || (!out)) {
         ret = -EINVAL;
         goto exit;
     }
 
-    for (i = 0; i < nb_frames; i++) {
+    sine_gen_run(handle, nb_frames, out);
 
-        /* Handle amplitude transition */
-        if (handle->intensity_transition) {
-            handle->intensity += handle->intensity_delta;
-            handle->intensity_transition_index++;
-            if (handle->intensity_transition_index == INTENSITY_TRANSITION_LEN) {
-                handle->intensity_transition       = 0;
-                handle->intensity_delta            = 0;
-                handle->intensity_transition_index = 0;
-            }
-        }
+exit:
 
-        /* Handle frequency transition */
-        if (handle->frequency_transition) {
+    return ret;
+}
 
-            /* Wait for an ascending sign change to start */
-            if ((!handle->frequency_transition_start)
-            &&  (handle->sign_change)
-            &&  (handle->ascending))
-                handle->frequency_transition_start = 1;
-
-            if (handle->frequency_transition_start) {
-
-                /* Proceed to frequency transition */
-                phase = handle->frequency_transition_phase[handle->frequency_transition_index];
-                handle->frequency_transition_index++;
-
-                /* Handle end of frequency transition */
-                if (handle->frequency_transition_index == FREQUENCY_TRANSITION_LEN) {
-
-                    /* Reset descriptors */
-                    handle->f0                         = handle->new_f0;
-                    handle->new_f0                     = 0;
-                    handle->frequency_transition       = 0;
-                    handle->frequency_transition_index = 0;
-                    handle->frequency_transition_start = 0;
-                    memset(handle->frequency_transition_phase,
-                           0,
-                           FREQUENCY_TRANSITION_LEN * sizeof(float));
-
-                    /* Search for best new index */
-                    period = handle->fs / handle->f0;
-                    for (j = 0; j < period; j++) {
-
-                        /* Compute output for current index */
-                        tmp = (int32_t)(QS823_MAX * handle->intensity
-                                        * sin(2 * M_PI * j * handle->f0 / handle->fs));
-
-                        /* Sine ascending status */
-                        if (j == 0)
-                            prev_tmp = tmp;
-                        else {
-                            if (tmp > prev_tmp)
-                                local_ascending = 1;
-                            else
-                                local_ascending = 0;
-                            prev_tmp = tmp;
-                        }
-
-                        /* Check for minimal delta between last output and computed value, only
-                         * if we're in the expected sine phase (else we might find an non relevant
-                         * minimal delta that will ruin that search)
-                         */
-                        if (((handle->ascending) && (local_ascending))
-                        ||  ((!handle->ascending) && (!local_ascending))) {
-                            delta = ABS(tmp - handle->prev_out);
-                            if (delta < delta_min) {
-                                delta_min = delta;
-                                /* Store best candidate index */
-                                index = j;
-                            }
-                        }
-                    }
-                    handle->index = index + 1;
-                }
-
-            } else {
-                phase = handle->index * handle->f0;
-                handle->index++;
-            }
 
-        } else {
-            phase = handle->index * handle->f0;
-            handle->index++;
-        }
+/* Check a transition state: index within the transition if on going, null else */
+static int sine_gen_check_transition(int transition, int index, int len)
+{
+    if (!transition)
+        return index == 0;
 
-        out[i] = (int32_t)(QS823_MAX * handle->intensity * sin(2 * M_PI * phase / handle->fs));
+    return (transition == 1) && (index >= 0) && (index < len);
+}
 
-        /* Update trackers */
-        sign = SIGN(out[i]);
-        if (sign != handle->prev_sign) {
-            handle->prev_sign   = sign;
-            handle->sign_change = 1;
-        } else {
-            handle->sign_change = 0;
-        }
-        if (out[i] > handle->prev_out)
-            handle->ascending = 1;
-        else
-            handle->ascending = 0;
 
-        handle->prev_out = out[i];
+/* Read a snapshot into a copy of the generator, checking it fits: Transitions must be in progress
+ * (or not started at all)
+ *
+ *  Returns the snapshot size, -EINVAL if it does not fit.
+ */
+static int sine_gen_read_snapshot(const struct sine_gen *handle, const void *blob, int size,
+                                  struct sine_gen *state)
+{
+    int ret = SNAPSHOT_SIZE;
+    const uint8_t *ptr = (const uint8_t *)blob;
+
+    if ((!blob)
+    ||  (size < SNAPSHOT_SIZE)) {
+        ret = -EINVAL;
+        goto exit;
+    }
+
+    memcpy(state, handle, sizeof(struct sine_gen));
+
+    if (snapshot_get_float(&ptr) != handle->fs) {
+        ret = -EINVAL;
+        goto exit;
+    }
+
+    state->f0                         = snapshot_get_float(&ptr);
+    state->phase                      = snapshot_get_u32(&ptr);
+    state->intensity                  = snapshot_get_float(&ptr);
+    state->new_intensity              = snapshot_get_float(&ptr);
+    state->intensity_delta            = snapshot_get_float(&ptr);
+    state->intensity_transition       = snapshot_get_i32(&ptr);
+    state->intensity_transition_index = snapshot_get_i32(&ptr);
+    state->new_f0                     = snapshot_get_float(&ptr);
+    state->start_phase                = snapshot_get_u32(&ptr);
+    state->start_inc                  = snapshot_get_u32(&ptr);
+    state->delta_inc                  = snapshot_get_i64(&ptr);
+    state->frequency_transition       = snapshot_get_i32(&ptr);
+    state->frequency_transition_index = snapshot_get_i32(&ptr);
+
+    if ((!(state->f0 >= 0))
+    ||  (!(state->f0 < state->fs/2))
+    ||  (!sine_gen_check_transition(state->intensity_transition,
+                                    state->intensity_transition_index, INTENSITY_TRANSITION_LEN))
+    ||  (!sine_gen_check_transition(state->frequency_transition,
+                                    state->frequency_transition_index, FREQUENCY_TRANSITION_LEN))) {
+        ret = -EINVAL;
+        goto exit;
+    }
+
+    /* Derived fields */
+    state->phase_inc = PHASE_INC(state->f0, state->fs);
+
+exit:
+
+    return ret;
+}
+
+
+int sine_gen_snapshot(struct sine_gen *handle, void *blob, int size)
+{
+    int ret = SNAPSHOT_SIZE;
+    uint8_t *ptr = (uint8_t *)blob;
+
+    if (!handle) {
+        ret = -EINVAL;
+        goto exit;
+    }
+
+    if (!blob)
+        goto exit;
+
+    if (size < SNAPSHOT_SIZE) {
+        ret = -ENOSPC;
+        goto exit;
+    }
+
+    snapshot_put_float(&ptr, handle->fs);
+    snapshot_put_float(&ptr, handle->f0);
+    snapshot_put_u32(&ptr, handle->phase);
+    snapshot_put_float(&ptr, handle->intensity);
+    snapshot_put_float(&ptr, handle->new_intensity);
+    snapshot_put_float(&ptr, handle->intensity_delta);
+    snapshot_put_i32(&ptr, handle->intensity_transition);
+    snapshot_put_i32(&ptr, handle->intensity_transition_index);
+    snapshot_put_float(&ptr, handle->new_f0);
+    snapshot_put_u32(&ptr, handle->start_phase);
+    snapshot_put_u32(&ptr, handle->start_inc);
+    snapshot_put_i64(&ptr, handle->delta_inc);
+    snapshot_put_i32(&ptr, handle->frequency_transition);
+    snapshot_put_i32(&ptr, handle->frequency_transition_index);
+
+exit:
+
+    return ret;
+}
+
+
+int sine_gen_restore(struct sine_gen *handle, const void *blob, int size)
+{
+    int ret = 0;
+    struct sine_gen state;
+
+    if (!handle) {
+        ret = -EINVAL;
+        goto exit;
     }
 
+    ret = sine_gen_read_snapshot(handle, blob, size, &state);
+    if (ret < 0)
+        goto exit;
+
+    memcpy(handle, &state, sizeof(struct sine_gen));
+
+exit:
+
+    return ret;
+}
+
+
+int sine_gen_check_snapshot(struct sine_gen *handle, const void *blob, int size)
+{
+    int ret = 0;
+    struct sine_gen state;
+
+    if (!handle) {
+        ret = -EINVAL;
+        goto exit;
+    }
+
+    ret = sine_gen_read_snapshot(handle, blob, size, &state);
+
 exit:
 
     return ret;
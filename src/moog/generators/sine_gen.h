@@ -122,4 +122,55 @@ int sine_gen_set_intensity(struct sine_gen *handle, float intensity);
 int sine_gen_process(struct sine_gen *handle, int nb_frames, int32_t *out);
 
 
+/**
+ * @brief Move waveform generation forward without rendering frames: the generator state is
+ *        the same as if nb_frames frames were processed
+ *
+ * @param[in] handle    : Module handle
+ * @param[in] nb_frames : Number of skipped frames
+ *
+ * @return 0 if successful, 0 > errno else
+ */
+int sine_gen_skip(struct sine_gen *handle, int nb_frames);
+
+
+/**
+ * @brief Save generator state (phase, frequency and intensity, with their transitions) to a
+ *        position independent blob
+ *
+ * @param[in]  handle       : Module handle
+ * @param[out] blob         : State snapshot (NULL to only get its size)
+ * @param[in]  size         : Blob size (bytes)
+ *
+ * @return Snapshot size (bytes) if successful, 0 > errno else
+ */
+int sine_gen_snapshot(struct sine_gen *handle, void *blob, int size);
+
+
+/**
+ * @brief Restore generator state (phase, frequency and intensity, with their transitions) from a
+ *        snapshot (see sine_gen_snapshot), taken at the same sampling frequency
+ *
+ * @param[in] handle        : Module handle
+ * @param[in] blob          : State snapshot
+ * @param[in] size          : Blob size (bytes)
+ *
+ * @return Number of read bytes if successful, 0 > errno else
+ */
+int sine_gen_restore(struct sine_gen *handle, const void *blob, int size);
+
+
+/**
+ * @brief Check whether a snapshot would be restored (see sine_gen_restore), leaving the generator
+ *        untouched
+ *
+ * @param[in] handle        : Module handle
+ * @param[in] blob          : State snapshot
+ * @param[in] size          : Blob size (bytes)
+ *
+ * @return Number of bytes sine_gen_restore would read if successful, 0 > errno else
+ */
+int sine_gen_check_snapshot(struct sine_gen *handle, const void *blob, int size);
+
+
 #endif /* _SINE_GEN_H_ */
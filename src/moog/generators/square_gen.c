@@ -23,25 +23,138 @@
  * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
  **************************************************************************************************/
 
+#include <math.h>
+#include <string.h>
 #include <stdlib.h>
 
 #include <square_gen.h>
+#include <snapshot.h>
+
+/* Runtime dispatched SIMD kernels (x86 only) */
+#if defined(__x86_64__) && defined(__GNUC__)
+#include <immintrin.h>
+#define SQUARE_GEN_SIMD
+#endif
 
 #define QS823_MAX           ((1 << 23) - 1)         ///< QS8.23 scale factor
 
+/* Phase accumulator: Q.32 fraction of cycle (wraps around on overflow), the upper half cycle
+ * being the "up" state
+ */
+#define PHASE_SCALE         (4294967296.0)          ///< 2^32
+#define PHASE_INC(f0, fs)   ((uint32_t)llround((double)(f0) / (fs) * PHASE_SCALE))
+#define HALF_CYCLE          (0x80000000u)           ///< Half cycle phase mask
+
+/* Rendering kernel prototype: frames [start, nb_frames[ */
+typedef void (*square_gen_kernel)(uint32_t phase, uint32_t phase_inc, int32_t i_up,
+                                  int32_t i_down, int start, int nb_frames, int32_t *out);
+
 
 struct square_gen {
     float f0;                                       ///< Waveform frequency
     float fs;                                       ///< Sampling frequency
     float intensity;                                ///< Waveform intensity
-    int index;                                      ///< Current index
+    uint32_t phase;                                 ///< Current phase
+    uint32_t phase_inc;                             ///< Phase increment
     int32_t i_up;                                   ///< Square up value
     int32_t i_down;                                 ///< Square down value
-    int32_t i_current;                              ///< Current value
-    int32_t half_period;                            ///< Half square signal period
+    square_gen_kernel kernel;                       ///< Rendering kernel
 };
 
 
+/* Snapshot: sampling frequency (checked), frequency, intensity and phase, other fields being
+ * derived from them
+ */
+#define SNAPSHOT_SIZE       (4 * SNAPSHOT_32)
+
+
+/* Rendering kernel, portable version: Every frame only depends on its index */
+static void square_gen_render_scalar(uint32_t phase, uint32_t phase_inc, int32_t i_up,
+                                     int32_t i_down, int start, int nb_frames, int32_t *out)
+{
+    int i;
+
+    for (i = start; i < nb_frames; i++)
+        out[i] = ((phase + (uint32_t)i * phase_inc) & HALF_CYCLE) ? i_down : i_up;
+}
+
+
+#if defined(SQUARE_GEN_SIMD)
+
+/* Rendering kernel, SSE2 version (4 frames per iteration)
+ *
+ *  Phase sign bit is spread over the whole lane (arithmetic shift), and used to select either
+ * the up or down value.
+ */
+static void square_gen_render_sse2(uint32_t phase, uint32_t phase_inc, int32_t i_up,
+                                   int32_t i_down, int start, int nb_frames, int32_t *out)
+{
+    int i;
+    __m128i p, mask;
+    uint32_t p0 = phase + (uint32_t)start * phase_inc;
+    const __m128i step = _mm_set1_epi32((int32_t)(4 * phase_inc));
+    const __m128i up   = _mm_set1_epi32(i_up);
+    const __m128i down = _mm_set1_epi32(i_down);
+
+    p = _mm_setr_epi32((int32_t)p0, (int32_t)(p0 + phase_inc), (int32_t)(p0 + 2 * phase_inc),
+                       (int32_t)(p0 + 3 * phase_inc));
+
+    for (i = start; i + 4 <= nb_frames; i += 4) {
+        mask = _mm_srai_epi32(p, 31);
+        _mm_storeu_si128((__m128i *)&out[i],
+                         _mm_or_si128(_mm_and_si128(mask, down), _mm_andnot_si128(mask, up)));
+        p = _mm_add_epi32(p, step);
+    }
+
+    square_gen_render_scalar(phase, phase_inc, i_up, i_down, i, nb_frames, out);
+}
+
+
+/* Rendering kernel, AVX2 version (8 frames per iteration) */
+__attribute__((target("avx2")))
+static void square_gen_render_avx2(uint32_t phase, uint32_t phase_inc, int32_t i_up,
+                                   int32_t i_down, int start, int nb_frames, int32_t *out)
+{
+    int i;
+    __m256i p;
+    uint32_t p0 = phase + (uint32_t)start * phase_inc;
+    const __m256i step = _mm256_set1_epi32((int32_t)(8 * phase_inc));
+    const __m256i up   = _mm256_set1_epi32(i_up);
+    const __m256i down = _mm256_set1_epi32(i_down);
+
+    p = _mm256_mullo_epi32(_mm256_setr_epi32(0, 1, 2, 3, 4, 5, 6, 7),
+                           _mm256_set1_epi32((int32_t)phase_inc));
+    p = _mm256_add_epi32(p, _mm256_set1_epi32((int32_t)p0));
+
+    for (i = start; i + 8 <= nb_frames; i += 8) {
+        /* Select down value for lanes whose phase sign bit is set */
+        _mm256_storeu_si256((__m256i *)&out[i],
+                            _mm256_castps_si256(_mm256_blendv_ps(_mm256_castsi256_ps(up),
+                                                                 _mm256_castsi256_ps(down),
+                                                                 _mm256_castsi256_ps(p))));
+        p = _mm256_add_epi32(p, step);
+    }
+
+    square_gen_render_scalar(phase, phase_inc, i_up, i_down, i, nb_frames, out);
+}
+
+#endif /* SQUARE_GEN_SIMD */
+
+
+/* Select best kernel supported by running CPU */
+static square_gen_kernel square_gen_select_kernel(void)
+{
+#if defined(SQUARE_GEN_SIMD)
+    __builtin_cpu_init();
+    if (__builtin_cpu_supports("avx2"))
+        return square_gen_render_avx2;
+    return square_gen_render_sse2;
+#else
+    return square_gen_render_scalar;
+#endif
+}
+
+
 struct square_gen *square_gen_create(struct square_gen_params *params)
 {
     struct square_gen *handle = NULL;
@@ -63,8 +176,9 @@ struct square_gen *square_gen_create(struct square_gen_params *params)
     handle->intensity   = params->intensity;
     handle->i_up        = (int32_t)(handle->intensity * QS823_MAX);
     handle->i_down      = - (int32_t)(handle->intensity * QS823_MAX);
-    handle->half_period = (int32_t)(handle->fs / (2 * handle->f0));
-    handle->i_current   = handle->i_up;
+    handle->phase       = 0;
+    handle->phase_inc   = PHASE_INC(handle->f0, handle->fs);
+    handle->kernel      = square_gen_select_kernel();
 
     return handle;
 
@@ -121,10 +235,10 @@ int square_gen_set_frequency(struct square_gen *handle, float f0)
 
     /* Update square generation parameters */
     handle->f0          = f0;
-    handle->half_period = (int32_t)(handle->fs / (2 * handle->f0));
+    handle->phase_inc   = PHASE_INC(handle->f0, handle->fs);
 
-    /* Current value update: Just reset index, and stay on the same state */
-    handle->index       = 0;
+    /* Current value update: Restart current half cycle, and stay on the same state */
+    handle->phase      &= HALF_CYCLE;
 
 exit:
 
@@ -153,7 +267,6 @@ exit:
 int square_gen_set_intensity(struct square_gen *handle, float intensity)
 {
     int ret = 0;
-    int up_or_down;
 
     if ((!handle)
     ||  (intensity < 0)
@@ -162,15 +275,27 @@ int square_gen_set_intensity(struct square_gen *handle, float intensity)
         goto exit;
     }
 
-    up_or_down = (handle->i_current == handle->i_up) ? 1 : -1;
-
-    /* Update square generation parameters */
+    /* Update square generation parameters (current state is kept, phase being left untouched) */
     handle->intensity   = intensity;
     handle->i_up        = (int32_t)(handle->intensity * QS823_MAX);
     handle->i_down      = - (int32_t)(handle->intensity * QS823_MAX);
 
-    /* Current value update: Just update scale */
-    handle->i_current = (up_or_down == 1) ? handle->i_up : handle->i_down;
+exit:
+
+    return ret;
+}
+
+
+int square_gen_skip(struct square_gen *handle, int nb_frames)
+{
+    int ret = 0;
+
+    if ((!handle) || (nb_frames < 0)) {
+        ret = -EINVAL;
+        goto exit;
+    }
+
+    handle->phase += (uint32_t)nb_frames * handle->phase_inc;
 
 exit:
 
@@ -180,25 +305,132 @@ exit:
 
 int square_gen_process(struct square_gen *handle, int nb_frames, int32_t *out)
 {
-    int i, ret = 0;
+    int ret = 0;
 
     if ((!handle) || (!out)) {
         ret = -EINVAL;
         goto exit;
     }
 
-    for (i = 0; i < nb_frames; i++) {
-        out[i] = handle->i_current;
-        handle->index++;
-        if (handle->index == handle->half_period) {
-            handle->index = 0;
-            if (handle->i_current == handle->i_up)
-                handle->i_current = handle->i_down;
-            else
-                handle->i_current = handle->i_up;
-        }
+    handle->kernel(handle->phase, handle->phase_inc, handle->i_up, handle->i_down, 0, nb_frames,
+                   out);
+    handle->phase += (uint32_t)nb_frames * handle->phase_inc;
+
+exit:
+
+    return ret;
+}
+
+
+/* Read a snapshot into a copy of the generator, checking it fits
+ *
+ *  Returns the snapshot size, -EINVAL if it does not fit.
+ */
+static int square_gen_read_snapshot(const struct square_gen *handle, const void *blob, int size,
+                                    struct square_gen *state)
+{
+    int ret = SNAPSHOT_SIZE;
+    const uint8_t *ptr = (const uint8_t *)blob;
+
+    if ((!blob)
+    ||  (size < SNAPSHOT_SIZE)) {
+        ret = -EINVAL;
+        goto exit;
+    }
+
+    memcpy(state, handle, sizeof(struct square_gen));
+
+    if (snapshot_get_float(&ptr) != handle->fs) {
+        ret = -EINVAL;
+        goto exit;
+    }
+
+    state->f0        = snapshot_get_float(&ptr);
+    state->intensity = snapshot_get_float(&ptr);
+    state->phase     = snapshot_get_u32(&ptr);
+
+    if ((!(state->f0 >= 0))
+    ||  (!(state->f0 < state->fs/2))
+    ||  (!(state->intensity >= 0))
+    ||  (!(state->intensity <= 1))) {
+        ret = -EINVAL;
+        goto exit;
+    }
+
+    /* Derived fields */
+    state->i_up      = (int32_t)(state->intensity * QS823_MAX);
+    state->i_down    = - (int32_t)(state->intensity * QS823_MAX);
+    state->phase_inc = PHASE_INC(state->f0, state->fs);
+
+exit:
+
+    return ret;
+}
+
+
+int square_gen_snapshot(struct square_gen *handle, void *blob, int size)
+{
+    int ret = SNAPSHOT_SIZE;
+    uint8_t *ptr = (uint8_t *)blob;
+
+    if (!handle) {
+        ret = -EINVAL;
+        goto exit;
+    }
+
+    if (!blob)
+        goto exit;
+
+    if (size < SNAPSHOT_SIZE) {
+        ret = -ENOSPC;
+        goto exit;
+    }
+
+    snapshot_put_float(&ptr, handle->fs);
+    snapshot_put_float(&ptr, handle->f0);
+    snapshot_put_float(&ptr, handle->intensity);
+    snapshot_put_u32(&ptr, handle->phase);
+
+exit:
+
+    return ret;
+}
+
+
+int square_gen_restore(struct square_gen *handle, const void *blob, int size)
+{
+    int ret = 0;
+    struct square_gen state;
+
+    if (!handle) {
+        ret = -EINVAL;
+        goto exit;
+    }
+
+    ret = square_gen_read_snapshot(handle, blob, size, &state);
+    if (ret < 0)
+        goto exit;
+
+    memcpy(handle, &state, sizeof(struct square_gen));
+
+exit:
+
+    return ret;
+}
+
+
+int square_gen_check_snapshot(struct square_gen *handle, const void *blob, int size)
+{
+    int ret = 0;
+    struct square_gen state;
+
+    if (!handle) {
+        ret = -EINVAL;
+        goto exit;
     }
 
+    ret = square_gen_read_snapshot(handle, blob, size, &state);
+
 exit:
 
     return ret;
@@ -28,7 +28,9 @@
 #include <saw_gen.h>
 #include <sine_gen.h>
 #include <wave_gen.h>
+#include <snapshot.h>
 #include <square_gen.h>
+#include <wavetable_gen.h>
 
 
 struct wave_gen {
@@ -38,12 +40,19 @@ struct wave_gen {
 };
 
 
+/* Snapshot header (waveform type, current frequency), followed by the specific waveform
+ * generator snapshot
+ */
+#define HEADER_SIZE     (2 * SNAPSHOT_32)
+
+
 struct wave_gen *wave_gen_create(struct wave_gen_params *params)
 {
     struct wave_gen *handle = NULL;
     struct saw_gen_params saw_params;
     struct sine_gen_params sine_params;
     struct square_gen_params square_params;
+    struct wavetable_gen_params wavetable_params;
 
     if (!params)
         goto failure;
@@ -73,6 +82,15 @@ struct wave_gen *wave_gen_create(struct wave_gen_params *params)
         square_params.intensity = params->intensity;
         handle->gen = (void *)square_gen_create(&square_params);
         break;
+    case WAVE_MODE_SAW_BL:
+    case WAVE_MODE_SQUARE_BL:
+        wavetable_params.f0        = params->f0;
+        wavetable_params.fs        = params->fs;
+        wavetable_params.intensity = params->intensity;
+        wavetable_params.waveform  = (handle->mode == WAVE_MODE_SAW_BL) ?
+                                     WAVETABLE_WAVEFORM_SAW : WAVETABLE_WAVEFORM_SQUARE;
+        handle->gen = (void *)wavetable_gen_create(&wavetable_params);
+        break;
     default:
         goto failure;
     }
@@ -102,6 +120,10 @@ void wave_gen_destroy(struct wave_gen **handle)
     case WAVE_MODE_SINE:
         sine_gen_destroy((struct sine_gen **)&(*handle)->gen);
         break;
+    case WAVE_MODE_SAW_BL:
+    case WAVE_MODE_SQUARE_BL:
+        wavetable_gen_destroy((struct wavetable_gen **)&(*handle)->gen);
+        break;
     case WAVE_MODE_SQUARE:
     default:
         square_gen_destroy((struct square_gen **)&(*handle)->gen);
@@ -134,6 +156,10 @@ int wave_gen_get_frequency(struct wave_gen *handle, float *f0)
     case WAVE_MODE_SINE:
         ret = sine_gen_get_frequency((struct sine_gen *)handle->gen, f0);
         break;
+    case WAVE_MODE_SAW_BL:
+    case WAVE_MODE_SQUARE_BL:
+        ret = wavetable_gen_get_frequency((struct wavetable_gen *)handle->gen, f0);
+        break;
     case WAVE_MODE_SQUARE:
     default:
         ret = square_gen_get_frequency((struct square_gen *)handle->gen, f0);
@@ -165,6 +191,10 @@ int wave_gen_set_frequency(struct wave_gen *handle, float f0)
     case WAVE_MODE_SINE:
         ret = sine_gen_set_frequency((struct sine_gen *)handle->gen, f0);
         break;
+    case WAVE_MODE_SAW_BL:
+    case WAVE_MODE_SQUARE_BL:
+        ret = wavetable_gen_set_frequency((struct wavetable_gen *)handle->gen, f0);
+        break;
     case WAVE_MODE_SQUARE:
         ret = square_gen_set_frequency((struct square_gen *)handle->gen, f0);
     default:
@@ -196,6 +226,10 @@ int wave_gen_get_intensity(struct wave_gen *handle, float *intensity)
     case WAVE_MODE_SINE:
         ret = sine_gen_get_intensity((struct sine_gen *)handle->gen, intensity);
         break;
+    case WAVE_MODE_SAW_BL:
+    case WAVE_MODE_SQUARE_BL:
+        ret = wavetable_gen_get_intensity((struct wavetable_gen *)handle->gen, intensity);
+        break;
     case WAVE_MODE_SQUARE:
     default:
         ret = square_gen_get_intensity((struct square_gen *)handle->gen, intensity);
@@ -224,6 +258,10 @@ int wave_gen_set_intensity(struct wave_gen *handle, float intensity)
     case WAVE_MODE_SINE:
         ret = sine_gen_set_intensity((struct sine_gen *)handle->gen, intensity);
         break;
+    case WAVE_MODE_SAW_BL:
+    case WAVE_MODE_SQUARE_BL:
+        ret = wavetable_gen_set_intensity((struct wavetable_gen *)handle->gen, intensity);
+        break;
     case WAVE_MODE_SQUARE:
     default:
         ret = square_gen_set_intensity((struct square_gen *)handle->gen, intensity);
@@ -236,6 +274,15 @@ exit:
 }
 
 
+void *wave_gen_get_generator(struct wave_gen *handle)
+{
+    if (!handle)
+        return NULL;
+
+    return handle->gen;
+}
+
+
 int wave_gen_process(struct wave_gen *handle, int nb_frames, int32_t *out)
 {
     int ret = 0;
@@ -252,6 +299,10 @@ int wave_gen_process(struct wave_gen *handle, int nb_frames, int32_t *out)
     case WAVE_MODE_SINE:
         ret = sine_gen_process((struct sine_gen *)handle->gen, nb_frames, out);
         break;
+    case WAVE_MODE_SAW_BL:
+    case WAVE_MODE_SQUARE_BL:
+        ret = wavetable_gen_process((struct wavetable_gen *)handle->gen, nb_frames, out);
+        break;
     case WAVE_MODE_SQUARE:
     default:
         ret = square_gen_process((struct square_gen *)handle->gen, nb_frames, out);
@@ -262,3 +313,155 @@ exit:
 
     return ret;
 }
+
+
+int wave_gen_skip(struct wave_gen *handle, int nb_frames)
+{
+    int ret = 0;
+
+    if (!handle) {
+        ret = -EINVAL;
+        goto exit;
+    }
+
+    switch (handle->mode) {
+    case WAVE_MODE_SAW:
+        ret = saw_gen_skip((struct saw_gen *)handle->gen, nb_frames);
+        break;
+    case WAVE_MODE_SINE:
+        ret = sine_gen_skip((struct sine_gen *)handle->gen, nb_frames);
+        break;
+    case WAVE_MODE_SAW_BL:
+    case WAVE_MODE_SQUARE_BL:
+        ret = wavetable_gen_skip((struct wavetable_gen *)handle->gen, nb_frames);
+        break;
+    case WAVE_MODE_SQUARE:
+    default:
+        ret = square_gen_skip((struct square_gen *)handle->gen, nb_frames);
+        break;
+    }
+
+exit:
+
+    return ret;
+}
+
+
+int wave_gen_snapshot(struct wave_gen *handle, void *blob, int size)
+{
+    int ret = 0;
+    uint8_t *ptr = (uint8_t *)blob;
+
+    if (!handle) {
+        ret = -EINVAL;
+        goto exit;
+    }
+
+    if (blob) {
+        if (size < HEADER_SIZE) {
+            ret = -ENOSPC;
+            goto exit;
+        }
+
+        snapshot_put_i32(&ptr, handle->mode);
+        snapshot_put_float(&ptr, handle->frequency);
+        size -= HEADER_SIZE;
+    }
+
+    switch (handle->mode) {
+    case WAVE_MODE_SAW:
+        ret = saw_gen_snapshot((struct saw_gen *)handle->gen, ptr, size);
+        break;
+    case WAVE_MODE_SINE:
+        ret = sine_gen_snapshot((struct sine_gen *)handle->gen, ptr, size);
+        break;
+    case WAVE_MODE_SAW_BL:
+    case WAVE_MODE_SQUARE_BL:
+        ret = wavetable_gen_snapshot((struct wavetable_gen *)handle->gen, ptr, size);
+        break;
+    case WAVE_MODE_SQUARE:
+    default:
+        ret = square_gen_snapshot((struct square_gen *)handle->gen, ptr, size);
+        break;
+    }
+
+    if (ret >= 0)
+        ret += HEADER_SIZE;
+
+exit:
+
+    return ret;
+}
+
+
+/* Check a snapshot, and restore it as well if restore is set */
+static int wave_gen_read_snapshot(struct wave_gen *handle, const void *blob, int size, int restore)
+{
+    int ret = 0;
+    float frequency;
+    const uint8_t *ptr = (const uint8_t *)blob;
+
+    if ((!handle)
+    ||  (!blob)
+    ||  (size < HEADER_SIZE)) {
+        ret = -EINVAL;
+        goto exit;
+    }
+
+    if (snapshot_get_i32(&ptr) != (int32_t)handle->mode) {
+        ret = -EINVAL;
+        goto exit;
+    }
+
+    frequency = snapshot_get_float(&ptr);
+    if (!(frequency >= 0)) {
+        ret = -EINVAL;
+        goto exit;
+    }
+    size -= HEADER_SIZE;
+
+    switch (handle->mode) {
+    case WAVE_MODE_SAW:
+        ret = restore ? saw_gen_restore((struct saw_gen *)handle->gen, ptr, size)
+                      : saw_gen_check_snapshot((struct saw_gen *)handle->gen, ptr, size);
+        break;
+    case WAVE_MODE_SINE:
+        ret = restore ? sine_gen_restore((struct sine_gen *)handle->gen, ptr, size)
+                      : sine_gen_check_snapshot((struct sine_gen *)handle->gen, ptr, size);
+        break;
+    case WAVE_MODE_SAW_BL:
+    case WAVE_MODE_SQUARE_BL:
+        ret = restore ? wavetable_gen_restore((struct wavetable_gen *)handle->gen, ptr, size)
+                      : wavetable_gen_check_snapshot((struct wavetable_gen *)handle->gen, ptr,
+                                                     size);
+        break;
+    case WAVE_MODE_SQUARE:
+    default:
+        ret = restore ? square_gen_restore((struct square_gen *)handle->gen, ptr, size)
+                      : square_gen_check_snapshot((struct square_gen *)handle->gen, ptr, size);
+        break;
+    }
+
+    if (ret < 0)
+        goto exit;
+
+    if (restore)
+        handle->frequency = frequency;
+    ret += HEADER_SIZE;
+
+exit:
+
+    return ret;
+}
+
+
+int wave_gen_restore(struct wave_gen *handle, const void *blob, int size)
+{
+    return wave_gen_read_snapshot(handle, blob, size, 1);
+}
+
+
+int wave_gen_check_snapshot(struct wave_gen *handle, const void *blob, int size)
+{
+    return wave_gen_read_snapshot(handle, blob, size, 0);
+}
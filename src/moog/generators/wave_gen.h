@@ -42,7 +42,9 @@ struct wave_gen;
 enum wave_gen_mode {
 	WAVE_MODE_SINE,
 	WAVE_MODE_SAW,
-	WAVE_MODE_SQUARE
+	WAVE_MODE_SQUARE,
+	WAVE_MODE_SAW_BL,               ///< Band limited saw (wavetable)
+	WAVE_MODE_SQUARE_BL             ///< Band limited square (wavetable)
 };
 
 /**
@@ -120,6 +122,17 @@ int wave_gen_get_intensity(struct wave_gen *handle, float *intensity);
 int wave_gen_set_intensity(struct wave_gen *handle, float intensity);
 
 
+/**
+ * @brief Get specific waveform generator handle, for callers dispatching on waveform type once
+ *
+ * @param[in] handle    : Module handle
+ *
+ * @return Generator handle (struct saw_gen, sine_gen, square_gen or wavetable_gen, depending on
+ *         waveform type) if successful, NULL else
+ */
+void *wave_gen_get_generator(struct wave_gen *handle);
+
+
 /**
  * @brief Proceed to waveform generation
  *
@@ -132,4 +145,55 @@ int wave_gen_set_intensity(struct wave_gen *handle, float intensity);
 int wave_gen_process(struct wave_gen *handle, int nb_frames, int32_t *out);
 
 
+/**
+ * @brief Move waveform generation forward without rendering frames: the generator state is
+ *        the same as if nb_frames frames were processed
+ *
+ * @param[in] handle    : Module handle
+ * @param[in] nb_frames : Number of skipped frames
+ *
+ * @return 0 if successful, 0 > errno else
+ */
+int wave_gen_skip(struct wave_gen *handle, int nb_frames);
+
+
+/**
+ * @brief Save waveform generation state (type, and specific generator state) to a position
+ *        independent blob
+ *
+ * @param[in]  handle       : Module handle
+ * @param[out] blob         : State snapshot (NULL to only get its size)
+ * @param[in]  size         : Blob size (bytes)
+ *
+ * @return Snapshot size (bytes) if successful, 0 > errno else
+ */
+int wave_gen_snapshot(struct wave_gen *handle, void *blob, int size);
+
+
+/**
+ * @brief Restore waveform generation state from a snapshot (see wave_gen_snapshot), taken with
+ *        the same waveform type and sampling frequency
+ *
+ * @param[in] handle        : Module handle
+ * @param[in] blob          : State snapshot
+ * @param[in] size          : Blob size (bytes)
+ *
+ * @return Number of read bytes if successful, 0 > errno else
+ */
+int wave_gen_restore(struct wave_gen *handle, const void *blob, int size);
+
+
+/**
+ * @brief Check whether a snapshot would be restored (see wave_gen_restore), leaving the generator
+ *        untouched
+ *
+ * @param[in] handle        : Module handle
+ * @param[in] blob          : State snapshot
+ * @param[in] size          : Blob size (bytes)
+ *
+ * @return Number of bytes wave_gen_restore would read if successful, 0 > errno else
+ */
+int wave_gen_check_snapshot(struct wave_gen *handle, const void *blob, int size);
+
+
 #endif /* _SINE_GEN_H_ */
@@ -0,0 +1,488 @@
+/***************************************************************************************************
+ * @file wavetable_gen.c
+ *
+ * @brief Band limited wavetable waveform generation module (sources)
+ *
+ * @licence MIT License
+ *
+ * Copyright (c) 2019 Jeremie Leclere
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy of this software and
+ * associated documentation files (the "Software"), to deal in the Software without restriction,
+ * including without limitation the rights to use, copy, modify, merge, publish, distribute,
+ * sublicense, and/or sell copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all copies or
+ * substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR IMPLIED, INCLUDING BUT
+ * NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND
+ * NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM,
+ * DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ **************************************************************************************************/
+
+#include <math.h>
+#include <string.h>
+#include <stdlib.h>
+#include <pthread.h>
+
+#include <wavetable_gen.h>
+#include <snapshot.h>
+
+/* Runtime dispatched SIMD rendering kernel (x86 only) */
+#if defined(__x86_64__) && defined(__GNUC__)
+#include <immintrin.h>
+#define WAVETABLE_SIMD
+#endif
+
+
+#define QS823_MAX           ((1 << 23) - 1)         ///< QS8.23 scale factor
+
+/* Tables: One single cycle table per octave (mipmap level), level l (>= 1) being played for
+ * phase increments in [2^-(l+1), 2^-l[ (cycle fraction per sample), and holding 2^(l-1)
+ * harmonics: the highest one always lies below Nyquist frequency.
+ */
+#define NB_WAVEFORMS        (2)                     ///< Number of band limited waveforms
+#define NB_LEVELS           (11)                    ///< Number of levels (up to 1024 harmonics)
+#define TABLE_SHIFT         (12)                    ///< log2(table length)
+#define TABLE_LEN           (1 << TABLE_SHIFT)      ///< Table length (samples)
+
+/* Phase accumulator: Q.32 fraction of cycle, upper bits indexing tables */
+#define PHASE_SCALE         (4294967296.0)          ///< 2^32
+#define FRAC_SHIFT          (32 - TABLE_SHIFT)      ///< Interpolation fraction bits
+#define FRAC_MASK           ((1 << FRAC_SHIFT) - 1) ///< Interpolation fraction mask
+
+/* Rendering kernel prototype: frames [start, nb_frames[ */
+typedef void (*wavetable_gen_kernel)(const float *table, uint32_t phase, uint32_t phase_inc,
+                                     float gain, int start, int nb_frames, int32_t *out);
+
+
+struct wavetable_gen {
+    float f0;                                       ///< Waveform frequency
+    float fs;                                       ///< Sampling frequency
+    float intensity;                                ///< Waveform intensity
+    float gain;                                     ///< Table to QS8.23 scale factor
+    uint32_t phase;                                 ///< Current phase
+    uint32_t phase_inc;                             ///< Phase increment
+    const float *table;                             ///< Current level table
+    enum wavetable_gen_waveform waveform;           ///< Waveform type
+};
+
+
+/* Snapshot: sampling frequency and waveform (checked), frequency, intensity and phase, other
+ * fields being derived from them
+ */
+#define SNAPSHOT_SIZE       (5 * SNAPSHOT_32)
+
+
+/* Process wide tables (one guard sample per table for interpolation), and rendering kernel */
+static float tables[NB_WAVEFORMS][NB_LEVELS][TABLE_LEN + 1];
+static wavetable_gen_kernel render_kernel;
+static pthread_once_t init_once = PTHREAD_ONCE_INIT;
+
+
+/* Rendering kernel, portable version
+ *
+ *  Interpolation uses separate multiplications and additions, just as the AVX2 kernel lanes do,
+ * so that both kernels are bit exact: Floating point contractions, which would fuse them (FMA)
+ * and round differently, are disabled at build time (-ffp-contract=off, see Makefile).
+ */
+static void wavetable_gen_render_scalar(const float *table, uint32_t phase, uint32_t phase_inc,
+                                        float gain, int start, int nb_frames, int32_t *out)
+{
+    int i;
+    uint32_t p, index;
+    float frac, a, b;
+
+    for (i = start; i < nb_frames; i++) {
+        p     = phase + (uint32_t)i * phase_inc;
+        index = p >> FRAC_SHIFT;
+        frac  = (float)(int32_t)(p & FRAC_MASK) * (1.0f / (1 << FRAC_SHIFT));
+        a     = table[index];
+        b     = table[index + 1];
+        out[i] = (int32_t)((a + (b - a) * frac) * gain);
+    }
+}
+
+
+#if defined(WAVETABLE_SIMD)
+
+/* Rendering kernel, AVX2 version (8 frames per iteration, table values being gathered) */
+__attribute__((target("avx2")))
+static void wavetable_gen_render_avx2(const float *table, uint32_t phase, uint32_t phase_inc,
+                                      float gain, int start, int nb_frames, int32_t *out)
+{
+    int i;
+    __m256i p, index;
+    __m256 frac, a, b, s;
+    const __m256i step = _mm256_set1_epi32((int32_t)(8 * phase_inc));
+    const __m256i mask = _mm256_set1_epi32(FRAC_MASK);
+    const __m256  unit = _mm256_set1_ps(1.0f / (1 << FRAC_SHIFT));
+    const __m256  g    = _mm256_set1_ps(gain);
+
+    p = _mm256_mullo_epi32(_mm256_setr_epi32(0, 1, 2, 3, 4, 5, 6, 7),
+                           _mm256_set1_epi32((int32_t)phase_inc));
+    p = _mm256_add_epi32(p, _mm256_set1_epi32((int32_t)(phase + (uint32_t)start * phase_inc)));
+
+    for (i = start; i + 8 <= nb_frames; i += 8) {
+        index = _mm256_srli_epi32(p, FRAC_SHIFT);
+        frac  = _mm256_mul_ps(_mm256_cvtepi32_ps(_mm256_and_si256(p, mask)), unit);
+        a     = _mm256_i32gather_ps(table, index, 4);
+        b     = _mm256_i32gather_ps(table + 1, index, 4);
+        s     = _mm256_add_ps(a, _mm256_mul_ps(_mm256_sub_ps(b, a), frac));
+        _mm256_storeu_si256((__m256i *)&out[i], _mm256_cvttps_epi32(_mm256_mul_ps(s, g)));
+        p     = _mm256_add_epi32(p, step);
+    }
+
+    wavetable_gen_render_scalar(table, phase, phase_inc, gain, i, nb_frames, out);
+}
+
+#endif /* WAVETABLE_SIMD */
+
+
+/* Compute process wide tables, and select best kernel supported by running CPU
+ *
+ *  Levels being nested (each one holds the previous level harmonics), harmonics are accumulated
+ * level after level, sines being read from a table: no trigonometric call per harmonic sample.
+ */
+static void wavetable_gen_init(void)
+{
+    int l, h, n, h_max;
+    static double sine[TABLE_LEN];
+    static double saw[TABLE_LEN];
+    static double square[TABLE_LEN];
+
+    for (n = 0; n < TABLE_LEN; n++)
+        sine[n] = sin(2 * M_PI * n / TABLE_LEN);
+
+    h = 1;
+    for (l = 0; l < NB_LEVELS; l++) {
+
+        /* Descending saw: (2/pi).sum(sin(2.pi.h.x)/h),
+         * square: (4/pi).sum(sin(2.pi.h.x)/h), h odd
+         */
+        h_max = 1 << l;
+        for (; h <= h_max; h++) {
+            for (n = 0; n < TABLE_LEN; n++) {
+                saw[n] += 2 / M_PI * sine[(h * n) % TABLE_LEN] / h;
+                if (h % 2)
+                    square[n] += 4 / M_PI * sine[(h * n) % TABLE_LEN] / h;
+            }
+        }
+
+        for (n = 0; n < TABLE_LEN; n++) {
+            tables[WAVETABLE_WAVEFORM_SAW][l][n]    = (float)saw[n];
+            tables[WAVETABLE_WAVEFORM_SQUARE][l][n] = (float)square[n];
+        }
+        tables[WAVETABLE_WAVEFORM_SAW][l][TABLE_LEN]    = (float)saw[0];
+        tables[WAVETABLE_WAVEFORM_SQUARE][l][TABLE_LEN] = (float)square[0];
+    }
+
+    render_kernel = wavetable_gen_render_scalar;
+#if defined(WAVETABLE_SIMD)
+    __builtin_cpu_init();
+    if (__builtin_cpu_supports("avx2"))
+        render_kernel = wavetable_gen_render_avx2;
+#endif
+}
+
+
+/* Set phase increment, and select matching table */
+static void wavetable_gen_set_phase_inc(struct wavetable_gen *handle)
+{
+    int level = NB_LEVELS;
+
+    handle->phase_inc = (uint32_t)llround((double)handle->f0 / handle->fs * PHASE_SCALE);
+
+    /* Level from phase increment most significant bit (lowest frequencies: highest level) */
+    if (handle->phase_inc)
+        level = __builtin_clz(handle->phase_inc);
+    if (level > NB_LEVELS)
+        level = NB_LEVELS;
+
+    handle->table = tables[handle->waveform][level - 1];
+}
+
+
+struct wavetable_gen *wavetable_gen_create(struct wavetable_gen_params *params)
+{
+    struct wavetable_gen *handle = NULL;
+
+    if ((!params)
+    ||  (params->fs < 0)
+    ||  (params->f0 < 0)
+    ||  (params->f0 >= params->fs/2)
+    ||  (params->intensity < 0)
+    ||  (params->intensity > 1)
+    ||  ((params->waveform != WAVETABLE_WAVEFORM_SAW)
+    &&   (params->waveform != WAVETABLE_WAVEFORM_SQUARE)))
+        goto failure;
+
+    if (pthread_once(&init_once, wavetable_gen_init))
+        goto failure;
+
+    handle = (struct wavetable_gen *)calloc(1, sizeof(struct wavetable_gen));
+    if (!handle)
+        goto failure;
+
+    handle->f0        = params->f0;
+    handle->fs        = params->fs;
+    handle->intensity = params->intensity;
+    handle->gain      = handle->intensity * QS823_MAX;
+    handle->waveform  = params->waveform;
+    handle->phase     = 0;
+    wavetable_gen_set_phase_inc(handle);
+
+    return handle;
+
+failure:
+
+    wavetable_gen_destroy(&handle);
+
+    return NULL;
+}
+
+
+void wavetable_gen_destroy(struct wavetable_gen **handle)
+{
+    if ((!handle) || (!(*handle)))
+        goto exit;
+
+    free(*handle);
+    *handle = NULL;
+
+exit:
+
+    return;
+}
+
+
+int wavetable_gen_get_frequency(struct wavetable_gen *handle, float *f0)
+{
+    int ret = 0;
+
+    if ((!handle)
+    ||  (!f0)) {
+        ret = -EINVAL;
+        goto exit;
+    }
+
+    *f0 = handle->f0;
+
+exit:
+
+    return ret;
+}
+
+
+int wavetable_gen_set_frequency(struct wavetable_gen *handle, float f0)
+{
+    int ret = 0;
+
+    if ((!handle)
+    ||  (f0 < 0)
+    ||  (f0 >= handle->fs/2)) {
+        ret = -EINVAL;
+        goto exit;
+    }
+
+    /* Phase is left untouched: the waveform just keeps going at a different rate */
+    handle->f0 = f0;
+    wavetable_gen_set_phase_inc(handle);
+
+exit:
+
+    return ret;
+}
+
+
+int wavetable_gen_get_intensity(struct wavetable_gen *handle, float *intensity)
+{
+    int ret = 0;
+
+    if ((!handle)
+    ||  (!intensity)) {
+        ret = -EINVAL;
+        goto exit;
+    }
+
+    *intensity = handle->intensity;
+
+exit:
+
+    return ret;
+}
+
+
+int wavetable_gen_set_intensity(struct wavetable_gen *handle, float intensity)
+{
+    int ret = 0;
+
+    if ((!handle)
+    ||  (intensity < 0)
+    ||  (intensity > 1)) {
+        ret = -EINVAL;
+        goto exit;
+    }
+
+    handle->intensity = intensity;
+    handle->gain      = handle->intensity * QS823_MAX;
+
+exit:
+
+    return ret;
+}
+
+
+int wavetable_gen_skip(struct wavetable_gen *handle, int nb_frames)
+{
+    int ret = 0;
+
+    if ((!handle) || (nb_frames < 0)) {
+        ret = -EINVAL;
+        goto exit;
+    }
+
+    handle->phase += (uint32_t)nb_frames * handle->phase_inc;
+
+exit:
+
+    return ret;
+}
+
+
+int wavetable_gen_process(struct wavetable_gen *handle, int nb_frames, int32_t *out)
+{
+    int ret = 0;
+
+    if ((!handle) || (!out)) {
+        ret = -EINVAL;
+        goto exit;
+    }
+
+    render_kernel(handle->table, handle->phase, handle->phase_inc, handle->gain, 0, nb_frames,
+                  out);
+    handle->phase += (uint32_t)nb_frames * handle->phase_inc;
+
+exit:
+
+    return ret;
+}
+
+
+/* Read a snapshot into a copy of the generator, checking it fits
+ *
+ *  Returns the snapshot size, -EINVAL if it does not fit.
+ */
+static int wavetable_gen_read_snapshot(const struct wavetable_gen *handle, const void *blob,
+                                       int size, struct wavetable_gen *state)
+{
+    int ret = SNAPSHOT_SIZE;
+    const uint8_t *ptr = (const uint8_t *)blob;
+
+    if ((!blob)
+    ||  (size < SNAPSHOT_SIZE)) {
+        ret = -EINVAL;
+        goto exit;
+    }
+
+    memcpy(state, handle, sizeof(struct wavetable_gen));
+
+    if ((snapshot_get_float(&ptr) != handle->fs)
+    ||  (snapshot_get_i32(&ptr) != (int32_t)handle->waveform)) {
+        ret = -EINVAL;
+        goto exit;
+    }
+
+    state->f0        = snapshot_get_float(&ptr);
+    state->intensity = snapshot_get_float(&ptr);
+    state->phase     = snapshot_get_u32(&ptr);
+
+    if ((!(state->f0 >= 0))
+    ||  (!(state->f0 < state->fs/2))
+    ||  (!(state->intensity >= 0))
+    ||  (!(state->intensity <= 1))) {
+        ret = -EINVAL;
+        goto exit;
+    }
+
+    /* Derived fields */
+    state->gain = state->intensity * QS823_MAX;
+    wavetable_gen_set_phase_inc(state);
+
+exit:
+
+    return ret;
+}
+
+
+int wavetable_gen_snapshot(struct wavetable_gen *handle, void *blob, int size)
+{
+    int ret = SNAPSHOT_SIZE;
+    uint8_t *ptr = (uint8_t *)blob;
+
+    if (!handle) {
+        ret = -EINVAL;
+        goto exit;
+    }
+
+    if (!blob)
+        goto exit;
+
+    if (size < SNAPSHOT_SIZE) {
+        ret = -ENOSPC;
+        goto exit;
+    }
+
+    snapshot_put_float(&ptr, handle->fs);
+    snapshot_put_i32(&ptr, handle->waveform);
+    snapshot_put_float(&ptr, handle->f0);
+    snapshot_put_float(&ptr, handle->intensity);
+    snapshot_put_u32(&ptr, handle->phase);
+
+exit:
+
+    return ret;
+}
+
+
+int wavetable_gen_restore(struct wavetable_gen *handle, const void *blob, int size)
+{
+    int ret = 0;
+    struct wavetable_gen state;
+
+    if (!handle) {
+        ret = -EINVAL;
+        goto exit;
+    }
+
+    ret = wavetable_gen_read_snapshot(handle, blob, size, &state);
+    if (ret < 0)
+        goto exit;
+
+    memcpy(handle, &state, sizeof(struct wavetable_gen));
+
+exit:
+
+    return ret;
+}
+
+
+int wavetable_gen_check_snapshot(struct wavetable_gen *handle, const void *blob, int size)
+{
+    int ret = 0;
+    struct wavetable_gen state;
+
+    if (!handle) {
+        ret = -EINVAL;
+        goto exit;
+    }
+
+    ret = wavetable_gen_read_snapshot(handle, blob, size, &state);
+
+exit:
+
+    return ret;
+}
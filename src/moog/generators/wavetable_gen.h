@@ -0,0 +1,189 @@
+/***************************************************************************************************
+ * @file wavetable_gen.h
+ *
+ * @brief Band limited wavetable waveform generation module (headers)
+ *
+ * @licence MIT License
+ *
+ * Copyright (c) 2019 Jeremie Leclere
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy of this software and
+ * associated documentation files (the "Software"), to deal in the Software without restriction,
+ * including without limitation the rights to use, copy, modify, merge, publish, distribute,
+ * sublicense, and/or sell copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all copies or
+ * substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR IMPLIED, INCLUDING BUT
+ * NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND
+ * NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM,
+ * DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ **************************************************************************************************/
+
+#ifndef _WAVETABLE_GEN_H_
+#define _WAVETABLE_GEN_H_
+
+#include <errno.h>
+#include <stdint.h>
+
+
+/**
+ * @brief Opaque module handle
+ */
+struct wavetable_gen;
+
+
+/**
+ * @brief Available band limited waveforms
+ */
+enum wavetable_gen_waveform {
+    WAVETABLE_WAVEFORM_SAW,
+    WAVETABLE_WAVEFORM_SQUARE
+};
+
+
+/**
+ * @brief Initialization parameters
+ */
+struct wavetable_gen_params {
+    float fs;                                   ///< Sampling frequency (Hz, > 0)
+    float f0;                                   ///< Waveform frequency (Hz, [0,fs/2[)
+    float intensity;                            ///< Waveform intensity ([0,1])
+    enum wavetable_gen_waveform waveform;       ///< Waveform type
+};
+
+
+/**
+ * @brief Initialize band limited waveform generator module
+ *
+ *  Waveforms are played back from single cycle tables, one per octave, only holding harmonics
+ * below Nyquist frequency for the octave notes. Tables are computed once per process on first
+ * module creation, and shared (read only) by all module instances.
+ *
+ * @param[in] params    : Initialization parameters
+ *
+ * @return Module handle if successful, NULL else
+ */
+struct wavetable_gen *wavetable_gen_create(struct wavetable_gen_params *params);
+
+
+/**
+ * @brief Release module ressources
+ *
+ * @param[in] handle    : Module handle
+ *
+ * @return None
+ */
+void wavetable_gen_destroy(struct wavetable_gen **handle);
+
+
+/**
+ * @brief Get current waveform frequency
+ *
+ * @param[in]  handle   : Module handle
+ * @param[out] f0       : Current frequency (Hz)
+ *
+ * @return 0 if successful, 0 > errno else
+ */
+int wavetable_gen_get_frequency(struct wavetable_gen *handle, float *f0);
+
+
+/**
+ * @brief Update waveform frequency (phase continuous)
+ *
+ * @param[in] handle    : Module handle
+ * @param[in] f0        : New frequency (Hz, [0,fs/2[)
+ *
+ * @return 0 if successful, 0 > errno else
+ */
+int wavetable_gen_set_frequency(struct wavetable_gen *handle, float f0);
+
+
+/**
+ * @brief Get current waveform intensity
+ *
+ * @param[in]  handle       : Module handle
+ * @param[out] intensity    : Current intensity
+ *
+ * @return 0 if successful, 0 > errno else
+ */
+int wavetable_gen_get_intensity(struct wavetable_gen *handle, float *intensity);
+
+
+/**
+ * @brief Update waveform intensity
+ *
+ * @param[in] handle    : Module handle
+ * @param[in] intensity : New intensity ([0,1])
+ *
+ * @return 0 if successful, 0 > errno else
+ */
+int wavetable_gen_set_intensity(struct wavetable_gen *handle, float intensity);
+
+
+/**
+ * @brief Proceed to waveform generation
+ *
+ * @param[in]  handle       : Module handle
+ * @param[in]  nb_frames    : Number of output frames
+ * @param[out] out          : Output QS8.23 frames
+ *
+ * @return 0 if successful, 0 > errno else
+ */
+int wavetable_gen_process(struct wavetable_gen *handle, int nb_frames, int32_t *out);
+
+
+/**
+ * @brief Move waveform generation forward without rendering frames: the generator state is
+ *        the same as if nb_frames frames were processed
+ *
+ * @param[in] handle    : Module handle
+ * @param[in] nb_frames : Number of skipped frames
+ *
+ * @return 0 if successful, 0 > errno else
+ */
+int wavetable_gen_skip(struct wavetable_gen *handle, int nb_frames);
+
+
+/**
+ * @brief Save generator state (phase, frequency and intensity) to a position independent blob
+ *
+ * @param[in]  handle       : Module handle
+ * @param[out] blob         : State snapshot (NULL to only get its size)
+ * @param[in]  size         : Blob size (bytes)
+ *
+ * @return Snapshot size (bytes) if successful, 0 > errno else
+ */
+int wavetable_gen_snapshot(struct wavetable_gen *handle, void *blob, int size);
+
+
+/**
+ * @brief Restore generator state (phase, frequency and intensity) from a snapshot (see
+ *        wavetable_gen_snapshot), taken at the same sampling frequency, with the same waveform
+ *
+ * @param[in] handle        : Module handle
+ * @param[in] blob          : State snapshot
+ * @param[in] size          : Blob size (bytes)
+ *
+ * @return Number of read bytes if successful, 0 > errno else
+ */
+int wavetable_gen_restore(struct wavetable_gen *handle, const void *blob, int size);
+
+
+/**
+ * @brief Check whether a snapshot would be restored (see wavetable_gen_restore), leaving the
+ *        generator untouched
+ *
+ * @param[in] handle        : Module handle
+ * @param[in] blob          : State snapshot
+ * @param[in] size          : Blob size (bytes)
+ *
+ * @return Number of bytes wavetable_gen_restore would read if successful, 0 > errno else
+ */
+int wavetable_gen_check_snapshot(struct wavetable_gen *handle, const void *blob, int size);
+
+
+#endif /* _WAVETABLE_GEN_H_ */
@@ -29,50 +29,72 @@
 #include <stdlib.h>
 
 #include <low_pass.h>
+#include <snapshot.h>
+
+#if defined(__SSE__)
+#include <xmmintrin.h>
+#endif
+
+/* Runtime dispatched SIMD feed-forward kernels (x86 only) */
+#if defined(__x86_64__) && defined(__GNUC__)
+#include <immintrin.h>
+#define LOW_PASS_SIMD
+#endif
 
 
 /* Double to QS8.23 conversion macros */
 #define BQ_DOUBLE_2_QS328(val)  (int32_t)((val)*(1 << (28)) + (((val) > 0)? 0.5: -0.5))
 
-/* Transition table: Q.16 values representing a [0,1[ linear table */
-#define TABLE_LEN       (256)
-#define TABLE_SCALE     (16)
-
-static uint16_t transition_table[TABLE_LEN] = {
-        0,   256,   512,   768,  1024,  1280,  1536,  1792,
-     2048,  2304,  2560,  2816,  3072,  3328,  3584,  3840,
-     4096,  4352,  4608,  4864,  5120,  5376,  5632,  5888,
-     6144,  6400,  6656,  6912,  7168,  7424,  7680,  7936,
-     8192,  8448,  8704,  8960,  9216,  9472,  9728,  9984,
-    10240, 10496, 10752, 11008, 11264, 11520, 11776, 12032,
-    12288, 12544, 12800, 13056, 13312, 13568, 13824, 14080,
-    14336, 14592, 14848, 15104, 15360, 15616, 15872, 16128,
-    16384, 16640, 16896, 17152, 17408, 17664, 17920, 18176,
-    18432, 18688, 18944, 19200, 19456, 19712, 19968, 20224,
-    20480, 20736, 20992, 21248, 21504, 21760, 22016, 22272,
-    22528, 22784, 23040, 23296, 23552, 23808, 24064, 24320,
-    24576, 24832, 25088, 25344, 25600, 25856, 26112, 26368,
-    26624, 26880, 27136, 27392, 27648, 27904, 28160, 28416,
-    28672, 28928, 29184, 29440, 29696, 29952, 30208, 30464,
-    30720, 30976, 31232, 31488, 31744, 32000, 32256, 32512,
-    32768, 33024, 33280, 33536, 33792, 34048, 34304, 34560,
-    34816, 35072, 35328, 35584, 35840, 36096, 36352, 36608,
-    36864, 37120, 37376, 37632, 37888, 38144, 38400, 38656,
-    38912, 39168, 39424, 39680, 39936, 40192, 40448, 40704,
-    40960, 41216, 41472, 41728, 41984, 42240, 42496, 42752,
-    43008, 43264, 43520, 43776, 44032, 44288, 44544, 44800,
-    45056, 45312, 45568, 45824, 46080, 46336, 46592, 46848,
-    47104, 47360, 47616, 47872, 48128, 48384, 48640, 48896,
-    49152, 49408, 49664, 49920, 50176, 50432, 50688, 50944,
-    51200, 51456, 51712, 51968, 52224, 52480, 52736, 52992,
-    53248, 53504, 53760, 54016, 54272, 54528, 54784, 55040,
-    55296, 55552, 55808, 56064, 56320, 56576, 56832, 57088,
-    57344, 57600, 57856, 58112, 58368, 58624, 58880, 59136,
-    59392, 59648, 59904, 60160, 60416, 60672, 60928, 61184,
-    61440, 61696, 61952, 62208, 62464, 62720, 62976, 63232,
-    63488, 63744, 64000, 64256, 64512, 64768, 65024, 65280
+/* Flush denormals to zero (FTZ) and treat denormal inputs as zero (DAZ) on x86: the biquad
+ * recursion decays towards denormal values during silences, which are dramatically slow to
+ * process on most x86 CPUs.
+ */
+#if defined(__SSE__)
+#define FLUSH_DENORMALS_ENTER(csr)  do {                                                \
+                                        (csr) = _mm_getcsr();                           \
+                                        _mm_setcsr((csr) | 0x8040);                     \
+                                    } while (0)
+#define FLUSH_DENORMALS_EXIT(csr)   _mm_setcsr(csr)
+#else
+#define FLUSH_DENORMALS_ENTER(csr)  ((void)(csr))
+#define FLUSH_DENORMALS_EXIT(csr)   ((void)(csr))
+#endif
+
+/* Number of feed-forward terms computed at once */
+#define FF_CHUNK        (64)
+
+/* Cutoff frequency to coefficients table: log spaced entries from TABLE_FC_MIN up to
+ * TABLE_FC_MAX.fs, coefficients being linearly interpolated between entries.
+ */
+#define TABLE_FC_MIN            (10.0)                  ///< Lowest table cutoff frequency (Hz)
+#define TABLE_FC_MAX            (0.49)                  ///< Highest cutoff frequency (.fs)
+#define TABLE_STEPS_PER_OCTAVE  (64)                    ///< Table resolution
+
+#define MIN(x, y)       (((x) < (y)) ? (x) : (y))
+
+/* Coefficients transitions: Coefficients move to their new values by steps, each step being
+ * applied to a whole control block (coefficients are constant within a block)
+ */
+#define TRANSITION_LEN  (256)                           ///< Transition duration (samples)
+#define CTRL_BLOCK      (16)                            ///< Control block size (samples)
+#define NB_STEPS        (TRANSITION_LEN / CTRL_BLOCK)   ///< Number of steps per transition
+#define RAMP_SCALE      (16)                            ///< Ramp table values scale (Q.16)
+
+/* Transition ramp: Q.16 progress towards new coefficients for each control block.
+ *
+ *  Values sample the historical per sample progression (every sample used to move coefficients
+ * by i/256 of their remaining distance to target, i being the transition sample index) in the
+ * middle of each control block: Coefficients reach their target after 5 blocks.
+ */
+static const uint32_t ramp_table[NB_STEPS] = {
+     6854, 43997, 62909, 65438, 65536, 65536, 65536, 65536,
+    65536, 65536, 65536, 65536, 65536, 65536, 65536, 65536
 };
 
+/* Fixed point coefficient at given ramp value */
+#define RAMP(start, end, ramp)  ((start) + (int32_t)((((int64_t)(end) - (start)) * (ramp))     \
+                                                     >> RAMP_SCALE))
+
 
 /* Biquad normalized coefficients (floating point) */
 struct low_pass_coeffs {
@@ -94,25 +116,167 @@ struct low_pass_fp_coeffs {
 };
 
 
+/* Biquad normalized coefficients (single precision floating point) */
+struct low_pass_fl_coeffs {
+    float b0;                                           ///< Same as above, used by the floating
+    float b1;                                           ///< point path
+    float b2;                                           ///<
+    float a1;                                           ///<
+    float a2;                                           ///<
+};
+
+
+/* Feed-forward kernel: ff[i] = b0.x[i] + b1.x[i-1] + b2.x[i-2], for i in [start, nb_frames[
+ * (x[-1] and x[-2] are never read: start is expected to be >= 2)
+ */
+typedef void (*low_pass_ff_kernel)(const struct low_pass_fp_coeffs *coeffs, const int32_t *x,
+                                   int start, int nb_frames, int64_t *ff);
+
+
+/* Bank kernels: frames [offset, offset + nb_frames[ of handles [start, nb_handles[, all handles
+ * sharing the same coefficients
+ */
+typedef void (*low_pass_bank_kernel)(struct low_pass *const *handles, int start, int nb_handles,
+                                     const int32_t *const *in, int offset, int nb_frames,
+                                     int32_t *const *out);
+typedef void (*low_pass_bank_kernel_float)(struct low_pass *const *handles, int start,
+                                           int nb_handles, const float *const *in, int offset,
+                                           int nb_frames, float *const *out);
+
+
 /* Low pass structure */
 struct low_pass {
     int32_t x1;
     int32_t x2;
     int32_t y1;
     int32_t y2;
+    float x1_fl;
+    float x2_fl;
+    float y1_fl;
+    float y2_fl;
     float sweep_fc;
     int sweep_flag;
     int sweep_index;
     int sweep_length;
     float sweep_step;
-    int table_index;
+    int transition_index;
     int update_flag;
     struct low_pass_fp_coeffs coeffs;
     struct low_pass_params parameters;
     struct low_pass_fp_coeffs new_coeffs;
+    struct low_pass_fl_coeffs coeffs_fl;
+    struct low_pass_fl_coeffs new_coeffs_fl;
+    struct low_pass_fp_coeffs start_coeffs;
+    struct low_pass_fl_coeffs start_coeffs_fl;
+    low_pass_ff_kernel ff_kernel;
+    low_pass_bank_kernel bank_kernel;
+    low_pass_bank_kernel_float bank_kernel_fl;
+    const struct low_pass_table *table;
+};
+
+
+/* Cutoff frequency to coefficients table */
+struct low_pass_table {
+    float fs;                                           ///< Sampling frequency
+    float Q;                                            ///< Quality factor
+    int nb_entries;                                     ///< Number of table entries
+    double *fc;                                         ///< Entries cutoff frequencies
+    double *inv_width;                                  ///< Inverse of distances between entries
+    struct low_pass_coeffs *coeffs;                     ///< Entries coefficients
 };
 
 
+/* Snapshot: sampling frequency and coefficients table key (fs and Q, null if none), both checked
+ * as coefficients computed from a table differ from designed ones, then parameters, biquad
+ * states, sweep and transition, and the three coefficients sets of both signal paths
+ */
+#define SNAPSHOT_SIZE   (51 * SNAPSHOT_32)
+
+
+/* Feed-forward kernel, portable version */
+static void low_pass_ff_scalar(const struct low_pass_fp_coeffs *coeffs, const int32_t *x,
+                               int start, int nb_frames, int64_t *ff)
+{
+    int i;
+
+    for (i = start; i < nb_frames; i++)
+        ff[i] = (int64_t)coeffs->b0 * x[i]
+              + (int64_t)coeffs->b1 * x[i - 1]
+              + (int64_t)coeffs->b2 * x[i - 2];
+}
+
+
+#if defined(LOW_PASS_SIMD)
+
+/* Feed-forward kernel, SSE4.1 version (2 samples per iteration)
+ *
+ *  Samples are sign extended to 64 bits lanes, and multiplied by pmuldq (32x32 -> 64 bits
+ * signed multiply of each lane low half): Products and sums are exact, just as the scalar ones.
+ */
+__attribute__((target("sse4.1")))
+static void low_pass_ff_sse41(const struct low_pass_fp_coeffs *coeffs, const int32_t *x,
+                              int start, int nb_frames, int64_t *ff)
+{
+    int i;
+    __m128i x0, x1, x2, acc;
+    __m128i b0 = _mm_set1_epi64x(coeffs->b0);
+    __m128i b1 = _mm_set1_epi64x(coeffs->b1);
+    __m128i b2 = _mm_set1_epi64x(coeffs->b2);
+
+    for (i = start; i + 2 <= nb_frames; i += 2) {
+        x0  = _mm_cvtepi32_epi64(_mm_loadl_epi64((const __m128i *)&x[i]));
+        x1  = _mm_cvtepi32_epi64(_mm_loadl_epi64((const __m128i *)&x[i - 1]));
+        x2  = _mm_cvtepi32_epi64(_mm_loadl_epi64((const __m128i *)&x[i - 2]));
+        acc = _mm_add_epi64(_mm_mul_epi32(x0, b0), _mm_mul_epi32(x1, b1));
+        acc = _mm_add_epi64(acc, _mm_mul_epi32(x2, b2));
+        _mm_storeu_si128((__m128i *)&ff[i], acc);
+    }
+
+    low_pass_ff_scalar(coeffs, x, i, nb_frames, ff);
+}
+
+
+/* Feed-forward kernel, AVX2 version (4 samples per iteration) */
+__attribute__((target("avx2")))
+static void low_pass_ff_avx2(const struct low_pass_fp_coeffs *coeffs, const int32_t *x,
+                             int start, int nb_frames, int64_t *ff)
+{
+    int i;
+    __m256i x0, x1, x2, acc;
+    __m256i b0 = _mm256_set1_epi64x(coeffs->b0);
+    __m256i b1 = _mm256_set1_epi64x(coeffs->b1);
+    __m256i b2 = _mm256_set1_epi64x(coeffs->b2);
+
+    for (i = start; i + 4 <= nb_frames; i += 4) {
+        x0  = _mm256_cvtepi32_epi64(_mm_loadu_si128((const __m128i *)&x[i]));
+        x1  = _mm256_cvtepi32_epi64(_mm_loadu_si128((const __m128i *)&x[i - 1]));
+        x2  = _mm256_cvtepi32_epi64(_mm_loadu_si128((const __m128i *)&x[i - 2]));
+        acc = _mm256_add_epi64(_mm256_mul_epi32(x0, b0), _mm256_mul_epi32(x1, b1));
+        acc = _mm256_add_epi64(acc, _mm256_mul_epi32(x2, b2));
+        _mm256_storeu_si256((__m256i *)&ff[i], acc);
+    }
+
+    low_pass_ff_scalar(coeffs, x, i, nb_frames, ff);
+}
+
+#endif /* LOW_PASS_SIMD */
+
+
+/* Select best feed-forward kernel supported by running CPU */
+static low_pass_ff_kernel low_pass_select_ff_kernel(void)
+{
+#if defined(LOW_PASS_SIMD)
+    __builtin_cpu_init();
+    if (__builtin_cpu_supports("avx2"))
+        return low_pass_ff_avx2;
+    if (__builtin_cpu_supports("sse4.1"))
+        return low_pass_ff_sse41;
+#endif
+
+    return low_pass_ff_scalar;
+}
+
+
 /* Compute filter coefficients from user parameters */
 static int low_pass_design(const struct low_pass_params *params, struct low_pass_coeffs *coeffs)
 {
@@ -150,9 +314,73 @@ exit:
 }
 
 
-/* Fill current/upcoming fixed point coefficients structure */
+/* Interpolate coefficients from table, if parameters are covered by it */
+static int low_pass_table_lookup(const struct low_pass_table *table,
+                                 const struct low_pass_params *params,
+                                 struct low_pass_coeffs *coeffs)
+{
+    int low, high, mid, ret = 0;
+    double t;
+    const struct low_pass_coeffs *c0, *c1;
+
+    if ((!table)
+    ||  (params->fs != table->fs)
+    ||  (params->Q != table->Q)
+    ||  (params->fc < table->fc[0])
+    ||  (params->fc >= table->fc[table->nb_entries - 1])) {
+        ret = -EINVAL;
+        goto exit;
+    }
+
+    /* Search for surrounding entries */
+    low  = 0;
+    high = table->nb_entries - 1;
+    while (high - low > 1) {
+        mid = (low + high) / 2;
+        if (params->fc < table->fc[mid])
+            high = mid;
+        else
+            low = mid;
+    }
+
+    t  = (params->fc - table->fc[low]) * table->inv_width[low];
+    c0 = &table->coeffs[low];
+    c1 = &table->coeffs[low + 1];
+
+    coeffs->b0 = c0->b0 + (c1->b0 - c0->b0) * t;
+    coeffs->b1 = c0->b1 + (c1->b1 - c0->b1) * t;
+    coeffs->b2 = c0->b2 + (c1->b2 - c0->b2) * t;
+    coeffs->a1 = c0->a1 + (c1->a1 - c0->a1) * t;
+    coeffs->a2 = c0->a2 + (c1->a2 - c0->a2) * t;
+
+exit:
+
+    return ret;
+}
+
+
+/* Compute filter coefficients, from table if possible */
+static int low_pass_compute(struct low_pass *handle, const struct low_pass_params *params,
+                            struct low_pass_coeffs *coeffs)
+{
+    if (!low_pass_table_lookup(handle->table, params, coeffs))
+        return 0;
+
+    return low_pass_design(params, coeffs);
+}
+
+
+/* Fill current/upcoming fixed & floating point coefficients structures */
 static void low_pass_feed(struct low_pass *handle, const struct low_pass_coeffs *coeffs, int update)
 {
+    struct low_pass_fl_coeffs *coeffs_fl = update ? &handle->new_coeffs_fl : &handle->coeffs_fl;
+
+    coeffs_fl->b0 = (float)coeffs->b0;
+    coeffs_fl->b1 = (float)coeffs->b1;
+    coeffs_fl->b2 = (float)coeffs->b2;
+    coeffs_fl->a1 = (float)coeffs->a1;
+    coeffs_fl->a2 = (float)coeffs->a2;
+
     if (update) {
 
         handle->new_coeffs.b0 = BQ_DOUBLE_2_QS328(coeffs->b0);
@@ -173,6 +401,17 @@ static void low_pass_feed(struct low_pass *handle, const struct low_pass_coeffs
 }
 
 
+/* Start a transition from current coefficients to upcoming ones */
+static void low_pass_start_transition(struct low_pass *handle)
+{
+    memcpy(&handle->start_coeffs, &handle->coeffs, sizeof(struct low_pass_fp_coeffs));
+    memcpy(&handle->start_coeffs_fl, &handle->coeffs_fl, sizeof(struct low_pass_fl_coeffs));
+
+    handle->transition_index = 0;
+    handle->update_flag      = 1;
+}
+
+
 /* Sweep coefficients update */
 int low_pass_sweep_update(struct low_pass *handle)
 {
@@ -193,15 +432,13 @@ int low_pass_sweep_update(struct low_pass *handle)
     }
 
     /* Convert user parameters to internal coefficients */
-    ret = low_pass_design(&new_params, &new_coeffs);
+    ret = low_pass_compute(handle, &new_params, &new_coeffs);
     if (ret)
         goto exit;
 
     /* Update biquad upcoming coefficients */
     low_pass_feed(handle, &new_coeffs, 1);
-
-    handle->table_index  = 0;
-    handle->update_flag  = 1;
+    low_pass_start_transition(handle);
 
     /* Save new parameters */
     memcpy(&handle->parameters, &new_params, sizeof(struct low_pass_params));
@@ -212,37 +449,553 @@ exit:
 }
 
 
-/* Filter coefficients linear progression to target values */
-static void low_pass_update_coeffs(struct low_pass *handle)
+/* Set current control block coefficients, and return the number of samples up to next step */
+static int low_pass_ramp_coeffs(struct low_pass *handle)
 {
-    int32_t delta;
-    uint16_t scale;
+    int step = handle->transition_index / CTRL_BLOCK;
+    uint32_t ramp = ramp_table[step];
+    float scale = ramp * (1.0f / (1 << RAMP_SCALE));
+
+    handle->coeffs.b0 = RAMP(handle->start_coeffs.b0, handle->new_coeffs.b0, ramp);
+    handle->coeffs.b1 = RAMP(handle->start_coeffs.b1, handle->new_coeffs.b1, ramp);
+    handle->coeffs.b2 = RAMP(handle->start_coeffs.b2, handle->new_coeffs.b2, ramp);
+    handle->coeffs.a1 = RAMP(handle->start_coeffs.a1, handle->new_coeffs.a1, ramp);
+    handle->coeffs.a2 = RAMP(handle->start_coeffs.a2, handle->new_coeffs.a2, ramp);
+
+    handle->coeffs_fl.b0 = handle->start_coeffs_fl.b0
+                         + (handle->new_coeffs_fl.b0 - handle->start_coeffs_fl.b0) * scale;
+    handle->coeffs_fl.b1 = handle->start_coeffs_fl.b1
+                         + (handle->new_coeffs_fl.b1 - handle->start_coeffs_fl.b1) * scale;
+    handle->coeffs_fl.b2 = handle->start_coeffs_fl.b2
+                         + (handle->new_coeffs_fl.b2 - handle->start_coeffs_fl.b2) * scale;
+    handle->coeffs_fl.a1 = handle->start_coeffs_fl.a1
+                         + (handle->new_coeffs_fl.a1 - handle->start_coeffs_fl.a1) * scale;
+    handle->coeffs_fl.a2 = handle->start_coeffs_fl.a2
+                         + (handle->new_coeffs_fl.a2 - handle->start_coeffs_fl.a2) * scale;
+
+    /* Target reached: Coefficients won't change until transition end */
+    if (ramp == (1 << RAMP_SCALE))
+        return TRANSITION_LEN - handle->transition_index;
+
+    return CTRL_BLOCK - handle->transition_index % CTRL_BLOCK;
+}
 
-    /* Update filter coefficients (simple linear interpolation) */
-    scale = transition_table[handle->table_index];
-    delta = handle->new_coeffs.b0 - handle->coeffs.b0;
-    handle->coeffs.b0 += (int32_t)(((int64_t)delta * scale) >> TABLE_SCALE);
-    delta = handle->new_coeffs.b1 - handle->coeffs.b1;
-    handle->coeffs.b1 += (int32_t)(((int64_t)delta * scale) >> TABLE_SCALE);
-    delta = handle->new_coeffs.b2 - handle->coeffs.b2;
-    handle->coeffs.b2 += (int32_t)(((int64_t)delta * scale) >> TABLE_SCALE);
-    delta = handle->new_coeffs.a1 - handle->coeffs.a1;
-    handle->coeffs.a1 += (int32_t)(((int64_t)delta * scale) >> TABLE_SCALE);
-    delta = handle->new_coeffs.a2 - handle->coeffs.a2;
-    handle->coeffs.a2 += (int32_t)(((int64_t)delta * scale) >> TABLE_SCALE);
 
-    /* Update transition descriptors */
-    handle->table_index++;
-    if (handle->table_index == TABLE_LEN) {
+/* Move transition forward, and handle transition end */
+static void low_pass_transition_advance(struct low_pass *handle, int nb_frames)
+{
+    handle->transition_index += nb_frames;
+    if (handle->transition_index == TRANSITION_LEN) {
         /* Current transition is over */
         memcpy(&handle->coeffs, &handle->new_coeffs, sizeof(struct low_pass_fp_coeffs));
+        memcpy(&handle->coeffs_fl, &handle->new_coeffs_fl, sizeof(struct low_pass_fl_coeffs));
         handle->update_flag = 0;
 
         /* Update sweep state */
         if (handle->sweep_flag)
             low_pass_sweep_update(handle);
+    }
+}
+
+
+/* Filter samples with constant coefficients
+ *
+ *  The feed-forward part of a whole chunk is computed at once (SIMD), then the recursive part.
+ * Integer sums being exact, the output is bit exact with a per sample computation.
+ */
+static void low_pass_process_steady(struct low_pass *handle, const int32_t *input, int nb_frames,
+                                    int32_t *output)
+{
+    int i, n;
+    int64_t acc, a1, a2;
+    int32_t x1, x2, y1, y2;
+    int64_t ff[FF_CHUNK];
+
+    a1 = handle->coeffs.a1;
+    a2 = handle->coeffs.a2;
+    x1 = handle->x1;
+    x2 = handle->x2;
+    y1 = handle->y1;
+    y2 = handle->y2;
+
+    while (nb_frames) {
+
+        n = MIN(nb_frames, FF_CHUNK);
+
+        ff[0] = (int64_t)handle->coeffs.b0 * input[0]
+              + (int64_t)handle->coeffs.b1 * x1
+              + (int64_t)handle->coeffs.b2 * x2;
+        if (n > 1)
+            ff[1] = (int64_t)handle->coeffs.b0 * input[1]
+                  + (int64_t)handle->coeffs.b1 * input[0]
+                  + (int64_t)handle->coeffs.b2 * x1;
+        handle->ff_kernel(&handle->coeffs, input, 2, n, ff);
+
+        for (i = 0; i < n; i++) {
+            /* Keep y[n-1] term last: it is the only one on the recursion critical path */
+            acc  = ff[i] - a2 * y2;
+            acc -= a1 * y1;
+
+            if (acc < 0)
+                acc += (1 << 28) - 1;
+            y2 = y1;
+            y1 = output[i] = (int32_t)(acc >> 28);
+        }
+
+        /* Update input states */
+        x2 = (n > 1) ? input[n - 2] : x1;
+        x1 = input[n - 1];
+
+        output    += n;
+        input     += n;
+        nb_frames -= n;
+    }
+
+    handle->x1 = x1;
+    handle->x2 = x2;
+    handle->y1 = y1;
+    handle->y2 = y2;
+}
+
+
+/* Filter samples with constant coefficients (floating point path) */
+static void low_pass_process_steady_float(struct low_pass *handle, const float *in,
+                                          int nb_frames, float *out)
+{
+    int i;
+    float x, y, x1, x2, y1, y2;
+    struct low_pass_fl_coeffs c;
+
+    /* Keep states and coefficients in registers: Terms are separate multiplications, summed
+     * left to right, just as bank kernels lanes do (floating point contractions into FMA, which
+     * round differently, are disabled at build time, see Makefile): Output is then the same
+     * whichever kernel filters an instance.
+     */
+    x1 = handle->x1_fl;
+    x2 = handle->x2_fl;
+    y1 = handle->y1_fl;
+    y2 = handle->y2_fl;
+    c  = handle->coeffs_fl;
+
+    for (i = 0; i < nb_frames; i++) {
+
+        x = in[i];
+        y = c.b0 * x + c.b1 * x1 + c.b2 * x2 - c.a2 * y2 - c.a1 * y1;
+
+        /* Update states */
+        x2 = x1;
+        x1 = x;
+        y2 = y1;
+        y1 = out[i] = y;
+    }
+
+    handle->x1_fl = x1;
+    handle->x2_fl = x2;
+    handle->y1_fl = y1;
+    handle->y2_fl = y2;
+}
+
+
+/* Bank kernel, portable version: Handles are filtered one after the other */
+static void low_pass_bank_scalar(struct low_pass *const *handles, int start, int nb_handles,
+                                 const int32_t *const *in, int offset, int nb_frames,
+                                 int32_t *const *out)
+{
+    int k;
+
+    for (k = start; k < nb_handles; k++)
+        low_pass_process_steady(handles[k], in[k] + offset, nb_frames, out[k] + offset);
+}
+
+
+/* Bank kernel, portable version (floating point path) */
+static void low_pass_bank_float_scalar(struct low_pass *const *handles, int start,
+                                       int nb_handles, const float *const *in, int offset,
+                                       int nb_frames, float *const *out)
+{
+    int k;
+
+    for (k = start; k < nb_handles; k++)
+        low_pass_process_steady_float(handles[k], in[k] + offset, nb_frames, out[k] + offset);
+}
+
+
+#if defined(LOW_PASS_SIMD)
+
+/* Bank kernel, AVX2 version (4 handles per vector)
+ *
+ *  Each 64 bits lane runs the recursion of a handle, products being computed by vpmuldq (low
+ * halves signed multiply): only lanes low halves are meaningful. Rounding matches the scalar
+ * version (towards zero), and y[n] low half is taken from a logical shift, AVX2 lacking the 64
+ * bits arithmetic one.
+ */
+__attribute__((target("avx2")))
+static void low_pass_bank_avx2(struct low_pass *const *handles, int start, int nb_handles,
+                               const int32_t *const *in, int offset, int nb_frames,
+                               int32_t *const *out)
+{
+    int i, k;
+    struct low_pass *const *h;
+    const struct low_pass_fp_coeffs *c = &handles[0]->coeffs;
+    __m256i x, x1, x2, y, y1, y2, acc;
+    const __m256i b0   = _mm256_set1_epi64x(c->b0);
+    const __m256i b1   = _mm256_set1_epi64x(c->b1);
+    const __m256i b2   = _mm256_set1_epi64x(c->b2);
+    const __m256i a1   = _mm256_set1_epi64x(c->a1);
+    const __m256i a2   = _mm256_set1_epi64x(c->a2);
+    const __m256i bias = _mm256_set1_epi64x((1 << 28) - 1);
+    const __m256i zero = _mm256_setzero_si256();
+
+    for (k = start; k + 4 <= nb_handles; k += 4) {
+
+        h  = &handles[k];
+        x1 = _mm256_setr_epi64x(h[0]->x1, h[1]->x1, h[2]->x1, h[3]->x1);
+        x2 = _mm256_setr_epi64x(h[0]->x2, h[1]->x2, h[2]->x2, h[3]->x2);
+        y1 = _mm256_setr_epi64x(h[0]->y1, h[1]->y1, h[2]->y1, h[3]->y1);
+        y2 = _mm256_setr_epi64x(h[0]->y2, h[1]->y2, h[2]->y2, h[3]->y2);
+
+        for (i = offset; i < offset + nb_frames; i++) {
+
+            x   = _mm256_setr_epi64x(in[k][i], in[k + 1][i], in[k + 2][i], in[k + 3][i]);
+            acc = _mm256_add_epi64(_mm256_mul_epi32(b0, x), _mm256_mul_epi32(b1, x1));
+            acc = _mm256_add_epi64(acc, _mm256_mul_epi32(b2, x2));
+            acc = _mm256_sub_epi64(acc, _mm256_mul_epi32(a2, y2));
+            acc = _mm256_sub_epi64(acc, _mm256_mul_epi32(a1, y1));
+            acc = _mm256_add_epi64(acc, _mm256_and_si256(_mm256_cmpgt_epi64(zero, acc), bias));
+            y   = _mm256_srli_epi64(acc, 28);
+
+            out[k][i]     = _mm256_extract_epi32(y, 0);
+            out[k + 1][i] = _mm256_extract_epi32(y, 2);
+            out[k + 2][i] = _mm256_extract_epi32(y, 4);
+            out[k + 3][i] = _mm256_extract_epi32(y, 6);
+
+            x2 = x1;
+            x1 = x;
+            y2 = y1;
+            y1 = y;
+        }
+
+        h[0]->x1 = _mm256_extract_epi32(x1, 0);
+        h[1]->x1 = _mm256_extract_epi32(x1, 2);
+        h[2]->x1 = _mm256_extract_epi32(x1, 4);
+        h[3]->x1 = _mm256_extract_epi32(x1, 6);
+        h[0]->x2 = _mm256_extract_epi32(x2, 0);
+        h[1]->x2 = _mm256_extract_epi32(x2, 2);
+        h[2]->x2 = _mm256_extract_epi32(x2, 4);
+        h[3]->x2 = _mm256_extract_epi32(x2, 6);
+        h[0]->y1 = _mm256_extract_epi32(y1, 0);
+        h[1]->y1 = _mm256_extract_epi32(y1, 2);
+        h[2]->y1 = _mm256_extract_epi32(y1, 4);
+        h[3]->y1 = _mm256_extract_epi32(y1, 6);
+        h[0]->y2 = _mm256_extract_epi32(y2, 0);
+        h[1]->y2 = _mm256_extract_epi32(y2, 2);
+        h[2]->y2 = _mm256_extract_epi32(y2, 4);
+        h[3]->y2 = _mm256_extract_epi32(y2, 6);
+    }
+
+    low_pass_bank_scalar(handles, k, nb_handles, in, offset, nb_frames, out);
+}
+
 
+/* Bank kernel, AVX-512 version (8 handles per vector) */
+__attribute__((target("avx512f")))
+static void low_pass_bank_avx512(struct low_pass *const *handles, int start, int nb_handles,
+                                 const int32_t *const *in, int offset, int nb_frames,
+                                 int32_t *const *out)
+{
+    int i, j, k;
+    int32_t state[4][8], y32[8];
+    struct low_pass *const *h;
+    const struct low_pass_fp_coeffs *c = &handles[0]->coeffs;
+    __m512i x, x1, x2, y, y1, y2, acc;
+    const __m512i b0   = _mm512_set1_epi64(c->b0);
+    const __m512i b1   = _mm512_set1_epi64(c->b1);
+    const __m512i b2   = _mm512_set1_epi64(c->b2);
+    const __m512i a1   = _mm512_set1_epi64(c->a1);
+    const __m512i a2   = _mm512_set1_epi64(c->a2);
+    const __m512i bias = _mm512_set1_epi64((1 << 28) - 1);
+    const __m512i zero = _mm512_setzero_si512();
+
+    for (k = start; k + 8 <= nb_handles; k += 8) {
+
+        h = &handles[k];
+        for (j = 0; j < 8; j++) {
+            state[0][j] = h[j]->x1;
+            state[1][j] = h[j]->x2;
+            state[2][j] = h[j]->y1;
+            state[3][j] = h[j]->y2;
+        }
+        x1 = _mm512_cvtepi32_epi64(_mm256_loadu_si256((const __m256i *)state[0]));
+        x2 = _mm512_cvtepi32_epi64(_mm256_loadu_si256((const __m256i *)state[1]));
+        y1 = _mm512_cvtepi32_epi64(_mm256_loadu_si256((const __m256i *)state[2]));
+        y2 = _mm512_cvtepi32_epi64(_mm256_loadu_si256((const __m256i *)state[3]));
+
+        for (i = offset; i < offset + nb_frames; i++) {
+
+            x   = _mm512_setr_epi64(in[k][i], in[k + 1][i], in[k + 2][i], in[k + 3][i],
+                                    in[k + 4][i], in[k + 5][i], in[k + 6][i], in[k + 7][i]);
+            acc = _mm512_add_epi64(_mm512_mul_epi32(b0, x), _mm512_mul_epi32(b1, x1));
+            acc = _mm512_add_epi64(acc, _mm512_mul_epi32(b2, x2));
+            acc = _mm512_sub_epi64(acc, _mm512_mul_epi32(a2, y2));
+            acc = _mm512_sub_epi64(acc, _mm512_mul_epi32(a1, y1));
+            acc = _mm512_mask_add_epi64(acc, _mm512_cmplt_epi64_mask(acc, zero), acc, bias);
+            y   = _mm512_srai_epi64(acc, 28);
+
+            _mm256_storeu_si256((__m256i *)y32, _mm512_cvtepi64_epi32(y));
+            for (j = 0; j < 8; j++)
+                out[k + j][i] = y32[j];
+
+            x2 = x1;
+            x1 = x;
+            y2 = y1;
+            y1 = y;
+        }
+
+        _mm256_storeu_si256((__m256i *)state[0], _mm512_cvtepi64_epi32(x1));
+        _mm256_storeu_si256((__m256i *)state[1], _mm512_cvtepi64_epi32(x2));
+        _mm256_storeu_si256((__m256i *)state[2], _mm512_cvtepi64_epi32(y1));
+        _mm256_storeu_si256((__m256i *)state[3], _mm512_cvtepi64_epi32(y2));
+        for (j = 0; j < 8; j++) {
+            h[j]->x1 = state[0][j];
+            h[j]->x2 = state[1][j];
+            h[j]->y1 = state[2][j];
+            h[j]->y2 = state[3][j];
+        }
+    }
+
+    low_pass_bank_avx2(handles, k, nb_handles, in, offset, nb_frames, out);
+}
+
+
+/* Bank kernel, SSE version (floating point path, 4 handles per vector)
+ *
+ *  Terms are summed in the scalar version order (no fused multiply-add, the scalar version being
+ * built without contractions either), so that every lane output matches the scalar one.
+ */
+static void low_pass_bank_float_sse(struct low_pass *const *handles, int start, int nb_handles,
+                                    const float *const *in, int offset, int nb_frames,
+                                    float *const *out)
+{
+    int i, j, k;
+    float y32[4];
+    struct low_pass *const *h;
+    const struct low_pass_fl_coeffs *c = &handles[0]->coeffs_fl;
+    __m128 x, x1, x2, y, y1, y2;
+    const __m128 b0 = _mm_set1_ps(c->b0);
+    const __m128 b1 = _mm_set1_ps(c->b1);
+    const __m128 b2 = _mm_set1_ps(c->b2);
+    const __m128 a1 = _mm_set1_ps(c->a1);
+    const __m128 a2 = _mm_set1_ps(c->a2);
+
+    for (k = start; k + 4 <= nb_handles; k += 4) {
+
+        h  = &handles[k];
+        x1 = _mm_setr_ps(h[0]->x1_fl, h[1]->x1_fl, h[2]->x1_fl, h[3]->x1_fl);
+        x2 = _mm_setr_ps(h[0]->x2_fl, h[1]->x2_fl, h[2]->x2_fl, h[3]->x2_fl);
+        y1 = _mm_setr_ps(h[0]->y1_fl, h[1]->y1_fl, h[2]->y1_fl, h[3]->y1_fl);
+        y2 = _mm_setr_ps(h[0]->y2_fl, h[1]->y2_fl, h[2]->y2_fl, h[3]->y2_fl);
+
+        for (i = offset; i < offset + nb_frames; i++) {
+
+            x = _mm_setr_ps(in[k][i], in[k + 1][i], in[k + 2][i], in[k + 3][i]);
+            y = _mm_add_ps(_mm_mul_ps(b0, x), _mm_mul_ps(b1, x1));
+            y = _mm_add_ps(y, _mm_mul_ps(b2, x2));
+            y = _mm_sub_ps(y, _mm_mul_ps(a2, y2));
+            y = _mm_sub_ps(y, _mm_mul_ps(a1, y1));
+
+            _mm_storeu_ps(y32, y);
+            for (j = 0; j < 4; j++)
+                out[k + j][i] = y32[j];
+
+            x2 = x1;
+            x1 = x;
+            y2 = y1;
+            y1 = y;
+        }
+
+        for (j = 0; j < 4; j++) {
+            h[j]->x1_fl = x1[j];
+            h[j]->x2_fl = x2[j];
+            h[j]->y1_fl = y1[j];
+            h[j]->y2_fl = y2[j];
+        }
     }
+
+    low_pass_bank_float_scalar(handles, k, nb_handles, in, offset, nb_frames, out);
+}
+
+
+/* Bank kernel, AVX version (floating point path, 8 handles per vector) */
+__attribute__((target("avx")))
+static void low_pass_bank_float_avx(struct low_pass *const *handles, int start, int nb_handles,
+                                    const float *const *in, int offset, int nb_frames,
+                                    float *const *out)
+{
+    int i, j, k;
+    float y32[8];
+    struct low_pass *const *h;
+    const struct low_pass_fl_coeffs *c = &handles[0]->coeffs_fl;
+    __m256 x, x1, x2, y, y1, y2;
+    const __m256 b0 = _mm256_set1_ps(c->b0);
+    const __m256 b1 = _mm256_set1_ps(c->b1);
+    const __m256 b2 = _mm256_set1_ps(c->b2);
+    const __m256 a1 = _mm256_set1_ps(c->a1);
+    const __m256 a2 = _mm256_set1_ps(c->a2);
+
+    for (k = start; k + 8 <= nb_handles; k += 8) {
+
+        h  = &handles[k];
+        x1 = _mm256_setr_ps(h[0]->x1_fl, h[1]->x1_fl, h[2]->x1_fl, h[3]->x1_fl,
+                            h[4]->x1_fl, h[5]->x1_fl, h[6]->x1_fl, h[7]->x1_fl);
+        x2 = _mm256_setr_ps(h[0]->x2_fl, h[1]->x2_fl, h[2]->x2_fl, h[3]->x2_fl,
+                            h[4]->x2_fl, h[5]->x2_fl, h[6]->x2_fl, h[7]->x2_fl);
+        y1 = _mm256_setr_ps(h[0]->y1_fl, h[1]->y1_fl, h[2]->y1_fl, h[3]->y1_fl,
+                            h[4]->y1_fl, h[5]->y1_fl, h[6]->y1_fl, h[7]->y1_fl);
+        y2 = _mm256_setr_ps(h[0]->y2_fl, h[1]->y2_fl, h[2]->y2_fl, h[3]->y2_fl,
+                            h[4]->y2_fl, h[5]->y2_fl, h[6]->y2_fl, h[7]->y2_fl);
+
+        for (i = offset; i < offset + nb_frames; i++) {
+
+            x = _mm256_setr_ps(in[k][i], in[k + 1][i], in[k + 2][i], in[k + 3][i],
+                               in[k + 4][i], in[k + 5][i], in[k + 6][i], in[k + 7][i]);
+            y = _mm256_add_ps(_mm256_mul_ps(b0, x), _mm256_mul_ps(b1, x1));
+            y = _mm256_add_ps(y, _mm256_mul_ps(b2, x2));
+            y = _mm256_sub_ps(y, _mm256_mul_ps(a2, y2));
+            y = _mm256_sub_ps(y, _mm256_mul_ps(a1, y1));
+
+            _mm256_storeu_ps(y32, y);
+            for (j = 0; j < 8; j++)
+                out[k + j][i] = y32[j];
+
+            x2 = x1;
+            x1 = x;
+            y2 = y1;
+            y1 = y;
+        }
+
+        for (j = 0; j < 8; j++) {
+            h[j]->x1_fl = x1[j];
+            h[j]->x2_fl = x2[j];
+            h[j]->y1_fl = y1[j];
+            h[j]->y2_fl = y2[j];
+        }
+    }
+
+    low_pass_bank_float_sse(handles, k, nb_handles, in, offset, nb_frames, out);
+}
+
+
+/* Bank kernel, AVX-512 version (floating point path, 16 handles per vector) */
+__attribute__((target("avx512f")))
+static void low_pass_bank_float_avx512(struct low_pass *const *handles, int start,
+                                       int nb_handles, const float *const *in, int offset,
+                                       int nb_frames, float *const *out)
+{
+    int i, j, k;
+    float x32[16], y32[16];
+    struct low_pass *const *h;
+    const struct low_pass_fl_coeffs *c = &handles[0]->coeffs_fl;
+    __m512 x, x1, x2, y, y1, y2;
+    const __m512 b0 = _mm512_set1_ps(c->b0);
+    const __m512 b1 = _mm512_set1_ps(c->b1);
+    const __m512 b2 = _mm512_set1_ps(c->b2);
+    const __m512 a1 = _mm512_set1_ps(c->a1);
+    const __m512 a2 = _mm512_set1_ps(c->a2);
+
+    for (k = start; k + 16 <= nb_handles; k += 16) {
+
+        h = &handles[k];
+        for (j = 0; j < 16; j++)
+            x32[j] = h[j]->x1_fl;
+        x1 = _mm512_loadu_ps(x32);
+        for (j = 0; j < 16; j++)
+            x32[j] = h[j]->x2_fl;
+        x2 = _mm512_loadu_ps(x32);
+        for (j = 0; j < 16; j++)
+            x32[j] = h[j]->y1_fl;
+        y1 = _mm512_loadu_ps(x32);
+        for (j = 0; j < 16; j++)
+            x32[j] = h[j]->y2_fl;
+        y2 = _mm512_loadu_ps(x32);
+
+        for (i = offset; i < offset + nb_frames; i++) {
+
+            for (j = 0; j < 16; j++)
+                x32[j] = in[k + j][i];
+            x = _mm512_loadu_ps(x32);
+            y = _mm512_add_ps(_mm512_mul_ps(b0, x), _mm512_mul_ps(b1, x1));
+            y = _mm512_add_ps(y, _mm512_mul_ps(b2, x2));
+            y = _mm512_sub_ps(y, _mm512_mul_ps(a2, y2));
+            y = _mm512_sub_ps(y, _mm512_mul_ps(a1, y1));
+
+            _mm512_storeu_ps(y32, y);
+            for (j = 0; j < 16; j++)
+                out[k + j][i] = y32[j];
+
+            x2 = x1;
+            x1 = x;
+            y2 = y1;
+            y1 = y;
+        }
+
+        for (j = 0; j < 16; j++) {
+            h[j]->x1_fl = x1[j];
+            h[j]->x2_fl = x2[j];
+            h[j]->y1_fl = y1[j];
+            h[j]->y2_fl = y2[j];
+        }
+    }
+
+    low_pass_bank_float_avx(handles, k, nb_handles, in, offset, nb_frames, out);
+}
+
+#endif /* LOW_PASS_SIMD */
+
+
+/* Select best bank kernels supported by running CPU */
+static void low_pass_select_bank_kernels(struct low_pass *handle)
+{
+#if defined(LOW_PASS_SIMD)
+    __builtin_cpu_init();
+    if (__builtin_cpu_supports("avx512f")) {
+        handle->bank_kernel    = low_pass_bank_avx512;
+        handle->bank_kernel_fl = low_pass_bank_float_avx512;
+    } else if (__builtin_cpu_supports("avx2")) {
+        handle->bank_kernel    = low_pass_bank_avx2;
+        handle->bank_kernel_fl = low_pass_bank_float_avx;
+    } else {
+        handle->bank_kernel    = low_pass_bank_scalar;
+        handle->bank_kernel_fl = __builtin_cpu_supports("avx") ? low_pass_bank_float_avx
+                                                                : low_pass_bank_float_sse;
+    }
+#else
+    handle->bank_kernel    = low_pass_bank_scalar;
+    handle->bank_kernel_fl = low_pass_bank_float_scalar;
+#endif
+}
+
+
+/* Check whether two filters share the very same coefficients, now and on upcoming transitions
+ * and sweeps (bank processing)
+ */
+static int low_pass_same_coeffs(const struct low_pass *a, const struct low_pass *b)
+{
+    return (a->table == b->table)
+        && (a->update_flag == b->update_flag)
+        && (a->transition_index == b->transition_index)
+        && (a->sweep_flag == b->sweep_flag)
+        && (a->sweep_index == b->sweep_index)
+        && (a->sweep_length == b->sweep_length)
+        && (a->sweep_fc == b->sweep_fc)
+        && (a->sweep_step == b->sweep_step)
+        && (!memcmp(&a->parameters, &b->parameters, sizeof(struct low_pass_params)))
+        && (!memcmp(&a->coeffs, &b->coeffs, sizeof(struct low_pass_fp_coeffs)))
+        && (!memcmp(&a->new_coeffs, &b->new_coeffs, sizeof(struct low_pass_fp_coeffs)))
+        && (!memcmp(&a->start_coeffs, &b->start_coeffs, sizeof(struct low_pass_fp_coeffs)))
+        && (!memcmp(&a->coeffs_fl, &b->coeffs_fl, sizeof(struct low_pass_fl_coeffs)))
+        && (!memcmp(&a->new_coeffs_fl, &b->new_coeffs_fl, sizeof(struct low_pass_fl_coeffs)))
+        && (!memcmp(&a->start_coeffs_fl, &b->start_coeffs_fl,
+                    sizeof(struct low_pass_fl_coeffs)));
 }
 
 
@@ -265,6 +1018,9 @@ struct low_pass *low_pass_create(const struct low_pass_params *params)
 
     memcpy(&handle->parameters, params, sizeof(struct low_pass_params));
 
+    handle->ff_kernel = low_pass_select_ff_kernel();
+    low_pass_select_bank_kernels(handle);
+
     return handle;
 
 failure:
@@ -306,15 +1062,13 @@ int low_pass_update(struct low_pass *handle, const struct low_pass_params *new_p
     }
 
     /* Convert user parameters to internal coefficients */
-    ret = low_pass_design(new_params, &new_coeffs);
+    ret = low_pass_compute(handle, new_params, &new_coeffs);
     if (ret)
         goto exit;
 
-    handle->table_index  = 0;
-    handle->update_flag  = 1;
-
     /* update biquad upcoming coefficients */
     low_pass_feed(handle, &new_coeffs, 1);
+    low_pass_start_transition(handle);
 
     memcpy(&handle->parameters, new_params, sizeof(struct low_pass_params));
 
@@ -324,6 +1078,23 @@ exit:
 }
 
 
+int low_pass_set_table(struct low_pass *handle, const struct low_pass_table *table)
+{
+    int ret = 0;
+
+    if (!handle) {
+        ret = -EINVAL;
+        goto exit;
+    }
+
+    handle->table = table;
+
+exit:
+
+    return ret;
+}
+
+
 int low_pass_get_parameters(struct low_pass *handle, struct low_pass_params *params)
 {
     int ret = 0;
@@ -362,7 +1133,7 @@ int low_pass_start_fc_sweep(struct low_pass *handle, float new_fc, int nb_sample
     handle->sweep_fc     = new_fc;
     handle->sweep_flag   = 1;
     handle->sweep_index  = 0;
-    handle->sweep_length = nb_samples / TABLE_LEN;
+    handle->sweep_length = nb_samples / TRANSITION_LEN;
     handle->sweep_step   = (new_fc - handle->parameters.fc) / handle->sweep_length;
 
     low_pass_sweep_update(handle);
@@ -373,43 +1144,518 @@ exit:
 }
 
 
+struct low_pass_table *low_pass_table_create(float fs, float Q)
+{
+    int i;
+    double fc_max;
+    struct low_pass_params params;
+    struct low_pass_table *table = NULL;
+
+    if ((fs <= 2 * TABLE_FC_MIN / TABLE_FC_MAX)
+    ||  (Q <= 0))
+        goto failure;
+
+    table = (struct low_pass_table *)calloc(1, sizeof(struct low_pass_table));
+    if (!table)
+        goto failure;
+
+    fc_max            = TABLE_FC_MAX * fs;
+    table->fs         = fs;
+    table->Q          = Q;
+    table->nb_entries = (int)ceil(log2(fc_max / TABLE_FC_MIN) * TABLE_STEPS_PER_OCTAVE) + 1;
+
+    table->fc        = (double *)calloc(table->nb_entries, sizeof(double));
+    table->inv_width = (double *)calloc(table->nb_entries, sizeof(double));
+    table->coeffs    = (struct low_pass_coeffs *)calloc(table->nb_entries,
+                                                        sizeof(struct low_pass_coeffs));
+    if ((!table->fc) || (!table->inv_width) || (!table->coeffs))
+        goto failure;
+
+    params.fs   = fs;
+    params.Q    = Q;
+    params.gain = 0;
+
+    for (i = 0; i < table->nb_entries; i++) {
+
+        /* Last entry is clipped to highest supported cutoff frequency */
+        table->fc[i] = TABLE_FC_MIN * pow(2, (double)i / TABLE_STEPS_PER_OCTAVE);
+        if (i == table->nb_entries - 1)
+            table->fc[i] = fc_max;
+
+        params.fc = table->fc[i];
+        if (low_pass_design(&params, &table->coeffs[i]))
+            goto failure;
+
+        if (i > 0)
+            table->inv_width[i - 1] = 1.0 / (table->fc[i] - table->fc[i - 1]);
+    }
+
+    return table;
+
+failure:
+
+    low_pass_table_destroy(&table);
+
+    return NULL;
+}
+
+
+void low_pass_table_destroy(struct low_pass_table **table)
+{
+    if ((!table) || (!(*table)))
+        goto exit;
+
+    if ((*table)->fc)
+        free((*table)->fc);
+    if ((*table)->inv_width)
+        free((*table)->inv_width);
+    if ((*table)->coeffs)
+        free((*table)->coeffs);
+
+    free(*table);
+    *table = NULL;
+
+exit:
+
+    return;
+}
+
+
 int low_pass_process(struct low_pass *handle, const int32_t *in, int nb_frames, int32_t *out)
 {
-    int ret = 0;
-    int64_t acc;
-    int32_t *output = out;
-    const int32_t *input = in;
+    int n, ret = 0;
 
     if ((!handle) || (!in) || (!out) || (nb_frames <= 0)) {
         ret = -EINVAL;
         goto exit;
     }
 
-    while (nb_frames--) {
+    while (nb_frames) {
 
-        /* Handle transition if any */
+        /* Handle transition if any: Process up to next control block */
+        n = nb_frames;
         if (handle->update_flag)
-            low_pass_update_coeffs(handle);
+            n = MIN(n, low_pass_ramp_coeffs(handle));
 
-        acc = (int64_t)handle->coeffs.b0 * (*input)
-            + (int64_t)handle->coeffs.b1 * handle->x1
-            + (int64_t)handle->coeffs.b2 * handle->x2
-            - (int64_t)handle->coeffs.a1 * handle->y1
-            - (int64_t)handle->coeffs.a2 * handle->y2;
+        low_pass_process_steady(handle, in, n, out);
 
-        /* Update states */
-        handle->x2 = handle->x1;
-        handle->x1 = *input;
-        handle->y2 = handle->y1;
+        if (handle->update_flag)
+            low_pass_transition_advance(handle, n);
+
+        in        += n;
+        out       += n;
+        nb_frames -= n;
+    }
+
+exit:
+
+    return ret;
+}
+
+
+int low_pass_process_float(struct low_pass *handle, const float *in, int nb_frames, float *out)
+{
+    int n, ret = 0;
+    unsigned int csr;
+
+    if ((!handle) || (!in) || (!out) || (nb_frames <= 0)) {
+        ret = -EINVAL;
+        goto exit;
+    }
+
+    FLUSH_DENORMALS_ENTER(csr);
+
+    while (nb_frames) {
+
+        /* Handle transition if any: Process up to next control block */
+        n = nb_frames;
+        if (handle->update_flag)
+            n = MIN(n, low_pass_ramp_coeffs(handle));
+
+        low_pass_process_steady_float(handle, in, n, out);
+
+        if (handle->update_flag)
+            low_pass_transition_advance(handle, n);
+
+        in        += n;
+        out       += n;
+        nb_frames -= n;
+    }
+
+    FLUSH_DENORMALS_EXIT(csr);
+
+exit:
+
+    return ret;
+}
+
+
+/* Filter several signals at once, on either signal path (in/out or in_fl/out_fl) */
+static int low_pass_bank_render(struct low_pass *const *handles, int nb_handles,
+                                const int32_t *const *in, const float *const *in_fl,
+                                int nb_frames, int32_t *const *out, float *const *out_fl)
+{
+    int k, n, done = 0, ret = 0;
+    struct low_pass *lead;
+
+    if ((!handles) || (nb_handles <= 0) || (nb_frames <= 0)) {
+        ret = -EINVAL;
+        goto exit;
+    }
+
+    for (k = 0; k < nb_handles; k++) {
+        if ((!handles[k])
+        ||  ((in) && ((!in[k]) || (!out[k])))
+        ||  ((in_fl) && ((!in_fl[k]) || (!out_fl[k])))) {
+            ret = -EINVAL;
+            goto exit;
+        }
+    }
+
+    /* Filters not sharing their coefficients can't run in parallel lanes */
+    lead = handles[0];
+    for (k = 1; k < nb_handles; k++) {
+        if (!low_pass_same_coeffs(lead, handles[k]))
+            break;
+    }
+
+    if (k < nb_handles) {
+        for (k = 0; k < nb_handles; k++) {
+            if (in)
+                ret = low_pass_process(handles[k], in[k], nb_frames, out[k]);
+            else
+                ret = low_pass_process_float(handles[k], in_fl[k], nb_frames, out_fl[k]);
+            if (ret)
+                goto exit;
+        }
+        goto exit;
+    }
 
-        if (acc < 0)
-            acc += (1 << 28) - 1;
-        *output = handle->y1 = (int32_t)(acc >> 28);
+    while (done < nb_frames) {
 
-        output++;
-        input++;
+        /* Handle transition if any: Process up to next control block (the same for every
+         * filter, as well as coefficients)
+         */
+        n = nb_frames - done;
+        if (lead->update_flag) {
+            for (k = 0; k < nb_handles; k++)
+                n = MIN(n, low_pass_ramp_coeffs(handles[k]));
+        }
+
+        if (in)
+            lead->bank_kernel(handles, 0, nb_handles, in, done, n, out);
+        else
+            lead->bank_kernel_fl(handles, 0, nb_handles, in_fl, done, n, out_fl);
+
+        if (lead->update_flag) {
+            for (k = 0; k < nb_handles; k++)
+                low_pass_transition_advance(handles[k], n);
+        }
+
+        done += n;
+    }
+
+exit:
+
+    return ret;
+}
+
+
+int low_pass_process_bank(struct low_pass *const *handles, int nb_handles,
+                          const int32_t *const *in, int nb_frames, int32_t *const *out)
+{
+    int ret = 0;
+
+    if ((!in) || (!out)) {
+        ret = -EINVAL;
+        goto exit;
     }
 
+    ret = low_pass_bank_render(handles, nb_handles, in, NULL, nb_frames, out, NULL);
+
+exit:
+
+    return ret;
+}
+
+
+int low_pass_process_bank_float(struct low_pass *const *handles, int nb_handles,
+                                const float *const *in, int nb_frames, float *const *out)
+{
+    int ret = 0;
+    unsigned int csr;
+
+    if ((!in) || (!out)) {
+        ret = -EINVAL;
+        goto exit;
+    }
+
+    FLUSH_DENORMALS_ENTER(csr);
+    ret = low_pass_bank_render(handles, nb_handles, NULL, in, nb_frames, NULL, out);
+    FLUSH_DENORMALS_EXIT(csr);
+
+exit:
+
+    return ret;
+}
+
+
+int low_pass_skip(struct low_pass *handle, int nb_frames)
+{
+    int n, ret = 0;
+
+    if ((!handle) || (nb_frames < 0)) {
+        ret = -EINVAL;
+        goto exit;
+    }
+
+    /* Same control blocks as low_pass_process: coefficients follow their exact trajectory */
+    while (nb_frames) {
+        n = nb_frames;
+        if (handle->update_flag)
+            n = MIN(n, low_pass_ramp_coeffs(handle));
+
+        if (handle->update_flag)
+            low_pass_transition_advance(handle, n);
+
+        nb_frames -= n;
+    }
+
+    handle->x1    = 0;
+    handle->x2    = 0;
+    handle->y1    = 0;
+    handle->y2    = 0;
+    handle->x1_fl = 0;
+    handle->x2_fl = 0;
+    handle->y1_fl = 0;
+    handle->y2_fl = 0;
+
+exit:
+
+    return ret;
+}
+
+
+int low_pass_is_idle(struct low_pass *handle)
+{
+    if (!handle)
+        return 0;
+
+    return (!handle->update_flag)
+        && (!handle->sweep_flag)
+        && (!handle->x1) && (!handle->x2) && (!handle->y1) && (!handle->y2)
+        && (handle->x1_fl == 0) && (handle->x2_fl == 0)
+        && (handle->y1_fl == 0) && (handle->y2_fl == 0);
+}
+
+
+/* Serialize fixed point coefficients */
+static void low_pass_put_coeffs(uint8_t **ptr, const struct low_pass_fp_coeffs *coeffs)
+{
+    snapshot_put_i32(ptr, coeffs->b0);
+    snapshot_put_i32(ptr, coeffs->b1);
+    snapshot_put_i32(ptr, coeffs->b2);
+    snapshot_put_i32(ptr, coeffs->a1);
+    snapshot_put_i32(ptr, coeffs->a2);
+}
+
+
+/* Serialize floating point coefficients */
+static void low_pass_put_coeffs_fl(uint8_t **ptr, const struct low_pass_fl_coeffs *coeffs)
+{
+    snapshot_put_float(ptr, coeffs->b0);
+    snapshot_put_float(ptr, coeffs->b1);
+    snapshot_put_float(ptr, coeffs->b2);
+    snapshot_put_float(ptr, coeffs->a1);
+    snapshot_put_float(ptr, coeffs->a2);
+}
+
+
+/* Deserialize fixed point coefficients */
+static void low_pass_get_coeffs(const uint8_t **ptr, struct low_pass_fp_coeffs *coeffs)
+{
+    coeffs->b0 = snapshot_get_i32(ptr);
+    coeffs->b1 = snapshot_get_i32(ptr);
+    coeffs->b2 = snapshot_get_i32(ptr);
+    coeffs->a1 = snapshot_get_i32(ptr);
+    coeffs->a2 = snapshot_get_i32(ptr);
+}
+
+
+/* Deserialize floating point coefficients */
+static void low_pass_get_coeffs_fl(const uint8_t **ptr, struct low_pass_fl_coeffs *coeffs)
+{
+    coeffs->b0 = snapshot_get_float(ptr);
+    coeffs->b1 = snapshot_get_float(ptr);
+    coeffs->b2 = snapshot_get_float(ptr);
+    coeffs->a1 = snapshot_get_float(ptr);
+    coeffs->a2 = snapshot_get_float(ptr);
+}
+
+
+/* Read a snapshot into a copy of the filter, checking it fits: same sampling frequency and
+ * coefficients table, transitions and sweeps in progress (or not started at all)
+ *
+ *  Returns the snapshot size, -EINVAL if it does not fit.
+ */
+static int low_pass_read_snapshot(const struct low_pass *handle, const void *blob, int size,
+                                  struct low_pass *state)
+{
+    int ret = SNAPSHOT_SIZE;
+    const uint8_t *ptr = (const uint8_t *)blob;
+
+    if ((!blob)
+    ||  (size < SNAPSHOT_SIZE)) {
+        ret = -EINVAL;
+        goto exit;
+    }
+
+    memcpy(state, handle, sizeof(struct low_pass));
+
+    if ((snapshot_get_float(&ptr) != handle->parameters.fs)
+    ||  (snapshot_get_float(&ptr) != (handle->table ? handle->table->fs : 0))
+    ||  (snapshot_get_float(&ptr) != (handle->table ? handle->table->Q : 0))) {
+        ret = -EINVAL;
+        goto exit;
+    }
+
+    state->parameters.Q    = snapshot_get_float(&ptr);
+    state->parameters.gain = snapshot_get_float(&ptr);
+    state->parameters.fc   = snapshot_get_float(&ptr);
+
+    state->x1    = snapshot_get_i32(&ptr);
+    state->x2    = snapshot_get_i32(&ptr);
+    state->y1    = snapshot_get_i32(&ptr);
+    state->y2    = snapshot_get_i32(&ptr);
+    state->x1_fl = snapshot_get_float(&ptr);
+    state->x2_fl = snapshot_get_float(&ptr);
+    state->y1_fl = snapshot_get_float(&ptr);
+    state->y2_fl = snapshot_get_float(&ptr);
+
+    state->sweep_fc         = snapshot_get_float(&ptr);
+    state->sweep_flag       = snapshot_get_i32(&ptr);
+    state->sweep_index      = snapshot_get_i32(&ptr);
+    state->sweep_length     = snapshot_get_i32(&ptr);
+    state->sweep_step       = snapshot_get_float(&ptr);
+    state->transition_index = snapshot_get_i32(&ptr);
+    state->update_flag      = snapshot_get_i32(&ptr);
+
+    low_pass_get_coeffs(&ptr, &state->coeffs);
+    low_pass_get_coeffs(&ptr, &state->new_coeffs);
+    low_pass_get_coeffs(&ptr, &state->start_coeffs);
+    low_pass_get_coeffs_fl(&ptr, &state->coeffs_fl);
+    low_pass_get_coeffs_fl(&ptr, &state->new_coeffs_fl);
+    low_pass_get_coeffs_fl(&ptr, &state->start_coeffs_fl);
+
+    /* Transition steps and sweep updates are indexed on the way */
+    if ((!(state->parameters.Q > 0))
+    ||  (!(state->parameters.fc > 0))
+    ||  (!(state->parameters.fc < state->parameters.fs/2))
+    ||  ((state->sweep_flag != 0) && (state->sweep_flag != 1))
+    ||  ((state->sweep_flag) && ((state->sweep_index < 0)
+                             ||  (state->sweep_index >= state->sweep_length)))
+    ||  ((state->update_flag != 0) && (state->update_flag != 1))
+    ||  (state->transition_index < 0)
+    ||  (state->transition_index > TRANSITION_LEN)
+    ||  ((state->update_flag) && (state->transition_index == TRANSITION_LEN)))
+        ret = -EINVAL;
+
+exit:
+
+    return ret;
+}
+
+
+int low_pass_snapshot(struct low_pass *handle, void *blob, int size)
+{
+    int ret = SNAPSHOT_SIZE;
+    uint8_t *ptr = (uint8_t *)blob;
+
+    if (!handle) {
+        ret = -EINVAL;
+        goto exit;
+    }
+
+    if (!blob)
+        goto exit;
+
+    if (size < SNAPSHOT_SIZE) {
+        ret = -ENOSPC;
+        goto exit;
+    }
+
+    snapshot_put_float(&ptr, handle->parameters.fs);
+    snapshot_put_float(&ptr, handle->table ? handle->table->fs : 0);
+    snapshot_put_float(&ptr, handle->table ? handle->table->Q : 0);
+
+    snapshot_put_float(&ptr, handle->parameters.Q);
+    snapshot_put_float(&ptr, handle->parameters.gain);
+    snapshot_put_float(&ptr, handle->parameters.fc);
+
+    snapshot_put_i32(&ptr, handle->x1);
+    snapshot_put_i32(&ptr, handle->x2);
+    snapshot_put_i32(&ptr, handle->y1);
+    snapshot_put_i32(&ptr, handle->y2);
+    snapshot_put_float(&ptr, handle->x1_fl);
+    snapshot_put_float(&ptr, handle->x2_fl);
+    snapshot_put_float(&ptr, handle->y1_fl);
+    snapshot_put_float(&ptr, handle->y2_fl);
+
+    snapshot_put_float(&ptr, handle->sweep_fc);
+    snapshot_put_i32(&ptr, handle->sweep_flag);
+    snapshot_put_i32(&ptr, handle->sweep_index);
+    snapshot_put_i32(&ptr, handle->sweep_length);
+    snapshot_put_float(&ptr, handle->sweep_step);
+    snapshot_put_i32(&ptr, handle->transition_index);
+    snapshot_put_i32(&ptr, handle->update_flag);
+
+    low_pass_put_coeffs(&ptr, &handle->coeffs);
+    low_pass_put_coeffs(&ptr, &handle->new_coeffs);
+    low_pass_put_coeffs(&ptr, &handle->start_coeffs);
+    low_pass_put_coeffs_fl(&ptr, &handle->coeffs_fl);
+    low_pass_put_coeffs_fl(&ptr, &handle->new_coeffs_fl);
+    low_pass_put_coeffs_fl(&ptr, &handle->start_coeffs_fl);
+
+exit:
+
+    return ret;
+}
+
+
+int low_pass_restore(struct low_pass *handle, const void *blob, int size)
+{
+    int ret = 0;
+    struct low_pass state;
+
+    if (!handle) {
+        ret = -EINVAL;
+        goto exit;
+    }
+
+    ret = low_pass_read_snapshot(handle, blob, size, &state);
+    if (ret < 0)
+        goto exit;
+
+    memcpy(handle, &state, sizeof(struct low_pass));
+
+exit:
+
+    return ret;
+}
+
+
+int low_pass_check_snapshot(struct low_pass *handle, const void *blob, int size)
+{
+    int ret = 0;
+    struct low_pass state;
+
+    if (!handle) {
+        ret = -EINVAL;
+        goto exit;
+    }
+
+    ret = low_pass_read_snapshot(handle, blob, size, &state);
+
 exit:
 
     return ret;
@@ -37,6 +37,16 @@
 struct low_pass;
 
 
+/**
+ * @brief Opaque cutoff frequency to coefficients table handle
+ *
+ *  Tables hold precomputed coefficients for a given (fs, Q) couple, saving trigonometric
+ * computations on cutoff frequency updates (sweeps). A table is read only once created, and can
+ * be shared by any number of filters.
+ */
+struct low_pass_table;
+
+
 /**
  * @brief Initialization parameters
  */
@@ -79,6 +89,20 @@ void low_pass_destroy(struct low_pass **handle);
 int low_pass_update(struct low_pass *handle, const struct low_pass_params *new_params);
 
 
+/**
+ * @brief Use a cutoff frequency to coefficients table for upcoming parameters updates
+ *
+ *  Table is used for parameters matching its (fs, Q) couple and covered cutoff frequencies, others
+ * being computed as usual. Table is not owned by the filter, and must outlive it.
+ *
+ * @param[in] handle        : Module handle
+ * @param[in] table         : Table handle (NULL to stop using a table)
+ *
+ * @return 0 if successful, 0 > errno else
+ */
+int low_pass_set_table(struct low_pass *handle, const struct low_pass_table *table);
+
+
 /**
  * @brief Get filter parameters
  *
@@ -115,4 +139,142 @@ int low_pass_start_fc_sweep(struct low_pass *handle, float new_fc, int nb_sample
 int low_pass_process(struct low_pass *handle, const int32_t *in, int nb_frames, int32_t *out);
 
 
+/**
+ * @brief Proceed to low pass filtering (floating point path)
+ *
+ *  Both paths share filter parameters, transitions and sweeps, but have their own states:
+ * a given filter instance is expected to be processed with a single path.
+ *
+ * @param[in]  handle       : Module handle
+ * @param[in]  in           : Input samples (full scale: [-1, 1[)
+ * @param[in]  nb_frames    : Number of frames
+ * @param[out] out          : Output samples (full scale: [-1, 1[)
+ *
+ * @return 0 if successful, 0 > errno else
+ */
+int low_pass_process_float(struct low_pass *handle, const float *in, int nb_frames, float *out);
+
+
+/**
+ * @brief Proceed to low pass filtering of several signals at once, one per filter instance
+ *
+ *  Instances sharing the very same coefficients (same parameters, updates and sweeps, as voices
+ * of a polyphonic synthesizer) are processed in parallel SIMD lanes: the biquad recursion is
+ * vectorized across instances instead of across time. Instances not sharing their coefficients
+ * are processed one after the other.
+ *  Output is bit exact with low_pass_process applied to every instance.
+ *
+ * @param[in]  handles      : Module handles
+ * @param[in]  nb_handles   : Number of handles
+ * @param[in]  in           : Input QS8.23 samples (one buffer per handle)
+ * @param[in]  nb_frames    : Number of frames
+ * @param[out] out          : Output QS8.23 samples (one buffer per handle)
+ *
+ * @return 0 if successful, 0 > errno else
+ */
+int low_pass_process_bank(struct low_pass *const *handles, int nb_handles,
+                          const int32_t *const *in, int nb_frames, int32_t *const *out);
+
+
+/**
+ * @brief Proceed to low pass filtering of several signals at once (floating point path)
+ *
+ *  Same as low_pass_process_bank, output being identical to low_pass_process_float applied to
+ * every instance, but for rounding differences if the compiler fuses its multiply-adds.
+ *
+ * @param[in]  handles      : Module handles
+ * @param[in]  nb_handles   : Number of handles
+ * @param[in]  in           : Input samples (one buffer per handle, full scale: [-1, 1[)
+ * @param[in]  nb_frames    : Number of frames
+ * @param[out] out          : Output samples (one buffer per handle, full scale: [-1, 1[)
+ *
+ * @return 0 if successful, 0 > errno else
+ */
+int low_pass_process_bank_float(struct low_pass *const *handles, int nb_handles,
+                                const float *const *in, int nb_frames, float *const *out);
+
+
+/**
+ * @brief Check whether filter is at rest: null states (both paths), and no transition or sweep
+ *        on going. A null input then gives a null output, and leaves the filter untouched.
+ *
+ * @param[in] handle        : Module handle
+ *
+ * @return 1 if at rest, 0 else
+ */
+int low_pass_is_idle(struct low_pass *handle);
+
+
+/**
+ * @brief Move filter forward as if nb_frames samples were processed, its state having decayed
+ *        to rest: coefficients transitions and sweeps move forward, and states are reset.
+ *
+ * @param[in] handle        : Module handle
+ * @param[in] nb_frames     : Number of skipped samples
+ *
+ * @return 0 if successful, 0 > errno else
+ */
+int low_pass_skip(struct low_pass *handle, int nb_frames);
+
+
+/**
+ * @brief Cutoff frequency to coefficients table creation
+ *
+ * @param[in] fs            : Sampling frequency (Hz)
+ * @param[in] Q             : Quality factor (> 0)
+ *
+ * @return Valid table handle if successful, NULL else
+ */
+struct low_pass_table *low_pass_table_create(float fs, float Q);
+
+
+/**
+ * @brief Release table ressources
+ *
+ * @param[in] table         : Table handle
+ *
+ * @return None
+ */
+void low_pass_table_destroy(struct low_pass_table **table);
+
+
+/**
+ * @brief Save filter state (parameters, coefficients with their transitions and sweeps, and
+ *        biquad states) to a position independent blob
+ *
+ * @param[in]  handle       : Module handle
+ * @param[out] blob         : State snapshot (NULL to only get its size)
+ * @param[in]  size         : Blob size (bytes)
+ *
+ * @return Snapshot size (bytes) if successful, 0 > errno else
+ */
+int low_pass_snapshot(struct low_pass *handle, void *blob, int size);
+
+
+/**
+ * @brief Restore filter state from a snapshot (see low_pass_snapshot), taken at the same sampling
+ *        frequency, with an equivalent coefficients table (same fs and Q, or none)
+ *
+ * @param[in] handle        : Module handle
+ * @param[in] blob          : State snapshot
+ * @param[in] size          : Blob size (bytes)
+ *
+ * @return Number of read bytes if successful, 0 > errno else
+ */
+int low_pass_restore(struct low_pass *handle, const void *blob, int size);
+
+
+/**
+ * @brief Check whether a snapshot would be restored (see low_pass_restore), leaving the filter
+ *        untouched
+ *
+ * @param[in] handle        : Module handle
+ * @param[in] blob          : State snapshot
+ * @param[in] size          : Blob size (bytes)
+ *
+ * @return Number of bytes low_pass_restore would read if successful, 0 > errno else
+ */
+int low_pass_check_snapshot(struct low_pass *handle, const void *blob, int size);
+
+
 #endif /* _LOW_PASS_H_ */
@@ -25,24 +25,48 @@
 
 #include <math.h>
 #include <stdio.h>
+#include <string.h>
 #include <stdlib.h>
 
 #include <moog.h>
+#include <cache.h>
 #include <adsr.h>
+#include <saw_gen.h>
+#include <sine_gen.h>
 #include <wave_gen.h>
 #include <low_pass.h>
+#include <snapshot.h>
+#include <square_gen.h>
+#include <wavetable_gen.h>
 
 
 #define QS823_MIN       (-(1 << 23))
 #define QS823_MAX       ((1 << 23) - 1)
+#define QS823_TO_FLOAT  (1.0f / (1 << 23))
 
 #define MAX(x, y) ((x) > (y) ? (x) : (y))
 #define MIN(x, y) ((x) < (y) ? (x) : (y))
 
+/* Forces template functions inlining, even when not optimizing */
+#define ALWAYS_INLINE   inline __attribute__((always_inline))
+
+#define SNAPSHOT_MAGIC  (0x474f4f4du)   ///< Snapshot tag ("MOOG")
+
+
+/* Block processing kernels, specialized per waveform and coupling (nb_frames <= block_size) */
+typedef void (*moog_block_kernel)(struct moog *handle, int nb_frames, int32_t *output);
+typedef void (*moog_block_kernel_float)(struct moog *handle, int nb_frames, float *output);
+
+/* Block source kernels: low pass filter input only, left in osc1_output (fixed point path) or
+ * adsr_output (floating point path)
+ */
+typedef void (*moog_source_kernel)(struct moog *handle, int nb_frames);
+
 
 struct moog {
 
     float fs;
+    struct moog_params params;          ///< Creation parameters (clones)
 
     /* ADSR */
     struct adsr *adsr;
@@ -50,20 +74,276 @@ struct moog {
 
     /* Low pass filter */
     struct low_pass *lpf;
+    struct low_pass_table *lpf_table;
 
     /* Internal oscillators */
     float coupling_scale;
     struct wave_gen *osc1;
     struct wave_gen *osc2;
+    void *gen1;
+    void *gen2;
     enum moog_osc_coupling coupling;
 
-    /* Internal buffers */
-    int frame_size;
+    /* Block processing kernels (chosen at creation) */
+    moog_block_kernel process_block;
+    moog_block_kernel_float process_block_float;
+    moog_source_kernel process_source;
+    moog_source_kernel process_source_float;
+
+    /* Internal buffers (one processing block) */
+    int block_size;
     int32_t *osc1_output;
     int32_t *osc2_output;
-    int32_t *sum_output;
-    int32_t *adsr_output;
     float   *adsr_scale;
+    float   *adsr_output;
+    enum moog_sample_format sample_format;
+
+    /* Processing statistics (NULL if disabled) */
+    struct stats *stats;
+};
+
+
+/* Snapshot header, followed by enveloppe, filter and oscillators snapshots (every field being
+ * serialized on its own, see snapshot.h)
+ */
+struct moog_snapshot_header {
+    uint32_t magic;                     ///< Snapshot tag (SNAPSHOT_MAGIC)
+    int32_t size;                       ///< Whole snapshot size (bytes)
+    float fs;                           ///< Sampling frequency
+    float Q;                            ///< Filter coefficients table quality factor
+    int32_t osc_mode;                   ///< Waveform type
+    int32_t coupling;                   ///< Oscillators coupling mode
+    int32_t sample_format;              ///< Signal path sample format
+    float intensity;                    ///< Current intensity
+};
+
+#define HEADER_SIZE     (8 * SNAPSHOT_32)
+
+
+/* Low pass coefficient table cache key (zeroed before use: compared bytewise) */
+struct moog_lpf_table_key {
+    float fs;
+    float Q;
+};
+
+
+/* Low pass coefficient table cache constructor */
+static void *moog_lpf_table_build(const void *key)
+{
+    const struct moog_lpf_table_key *k = (const struct moog_lpf_table_key *)key;
+
+    return (void *)low_pass_table_create(k->fs, k->Q);
+}
+
+
+/* Low pass coefficient table cache destructor */
+static void moog_lpf_table_free(void *data)
+{
+    struct low_pass_table *table = (struct low_pass_table *)data;
+
+    low_pass_table_destroy(&table);
+}
+
+
+/* Oscillator output: waveform being constant in specialized kernels, the switch is resolved at
+ * compile time, and generator code is inlined along with the kernel (link time optimization)
+ */
+static ALWAYS_INLINE void moog_osc_process(enum wave_gen_mode mode, void *gen, int nb_frames,
+                                           int32_t *out)
+{
+    switch (mode) {
+    case WAVE_MODE_SAW:
+        saw_gen_process((struct saw_gen *)gen, nb_frames, out);
+        break;
+    case WAVE_MODE_SINE:
+        sine_gen_process((struct sine_gen *)gen, nb_frames, out);
+        break;
+    case WAVE_MODE_SQUARE:
+        square_gen_process((struct square_gen *)gen, nb_frames, out);
+        break;
+    case WAVE_MODE_SAW_BL:
+    case WAVE_MODE_SQUARE_BL:
+        wavetable_gen_process((struct wavetable_gen *)gen, nb_frames, out);
+        break;
+    }
+}
+
+
+/* Compute low pass filter input of a single block (nb_frames <= block_size) in osc1_output,
+ * template specialized per waveform and coupling (see MOOG_BLOCK_KERNELS)
+ */
+static ALWAYS_INLINE void moog_source_block_tmpl(struct moog *handle, int nb_frames,
+                                                 enum wave_gen_mode mode, int coupled)
+{
+    int i;
+    int64_t tmp_sum;
+    uint64_t timestamp = 0;
+    float *scale = handle->adsr_scale;
+    int32_t *osc1 = handle->osc1_output;
+    int32_t *osc2 = handle->osc2_output;
+
+    /* Compute ADSR enveloppe */
+    STATS_START(handle->stats, timestamp);
+    adsr_process(handle->adsr, nb_frames, scale);
+    STATS_STOP(handle->stats, STATS_ADSR, timestamp);
+
+    /* Internal oscillators output */
+    STATS_START(handle->stats, timestamp);
+    moog_osc_process(mode, handle->gen1, nb_frames, osc1);
+    STATS_STOP(handle->stats, STATS_OSC1, timestamp);
+
+    if (coupled) {
+        STATS_START(handle->stats, timestamp);
+        moog_osc_process(mode, handle->gen2, nb_frames, osc2);
+        STATS_STOP(handle->stats, STATS_OSC2, timestamp);
+
+        /* Sum oscillators outputs with saturation, and apply ADSR enveloppe (in place) */
+        STATS_START(handle->stats, timestamp);
+        for (i = 0; i < nb_frames; i++) {
+            tmp_sum = (int64_t)osc1[i] + osc2[i];
+            osc1[i] = (int32_t)(scale[i] * (int32_t)(MAX(MIN(tmp_sum, QS823_MAX), QS823_MIN)));
+        }
+        STATS_STOP(handle->stats, STATS_ENVELOPPE, timestamp);
+
+    } else {
+
+        /* Apply ADSR enveloppe on single oscillator output (in place) */
+        STATS_START(handle->stats, timestamp);
+        for (i = 0; i < nb_frames; i++)
+            osc1[i] = (int32_t)(scale[i] * osc1[i]);
+        STATS_STOP(handle->stats, STATS_ENVELOPPE, timestamp);
+    }
+}
+
+
+/* Process a single block (nb_frames <= block_size), template specialized per waveform and
+ * coupling
+ */
+static ALWAYS_INLINE void moog_process_block_tmpl(struct moog *handle, int nb_frames,
+                                                  int32_t *output, enum wave_gen_mode mode,
+                                                  int coupled)
+{
+    uint64_t timestamp = 0;
+
+    moog_source_block_tmpl(handle, nb_frames, mode, coupled);
+
+    /* Low pass filter */
+    STATS_START(handle->stats, timestamp);
+    low_pass_process(handle->lpf, handle->osc1_output, nb_frames, output);
+    STATS_STOP(handle->stats, STATS_LOW_PASS, timestamp);
+}
+
+
+/* Compute low pass filter input of a single block (nb_frames <= block_size) in adsr_output,
+ * floating point signal path template
+ */
+static ALWAYS_INLINE void moog_source_block_float_tmpl(struct moog *handle, int nb_frames,
+                                                       enum wave_gen_mode mode, int coupled)
+{
+    int i;
+    int64_t tmp_sum;
+    uint64_t timestamp = 0;
+    float *scale = handle->adsr_scale;
+    float *adsr_output = handle->adsr_output;
+    int32_t *osc1 = handle->osc1_output;
+    int32_t *osc2 = handle->osc2_output;
+
+    /* Compute ADSR enveloppe */
+    STATS_START(handle->stats, timestamp);
+    adsr_process(handle->adsr, nb_frames, scale);
+    STATS_STOP(handle->stats, STATS_ADSR, timestamp);
+
+    /* Internal oscillators output (integer waveforms, converted along with enveloppe) */
+    STATS_START(handle->stats, timestamp);
+    moog_osc_process(mode, handle->gen1, nb_frames, osc1);
+    STATS_STOP(handle->stats, STATS_OSC1, timestamp);
+
+    if (coupled) {
+        STATS_START(handle->stats, timestamp);
+        moog_osc_process(mode, handle->gen2, nb_frames, osc2);
+        STATS_STOP(handle->stats, STATS_OSC2, timestamp);
+
+        /* Sum oscillators outputs with saturation, and apply ADSR enveloppe */
+        STATS_START(handle->stats, timestamp);
+        for (i = 0; i < nb_frames; i++) {
+            tmp_sum = (int64_t)osc1[i] + osc2[i];
+            adsr_output[i] = scale[i] * QS823_TO_FLOAT
+                             * (float)(MAX(MIN(tmp_sum, QS823_MAX), QS823_MIN));
+        }
+        STATS_STOP(handle->stats, STATS_ENVELOPPE, timestamp);
+
+    } else {
+
+        /* Apply ADSR enveloppe on single oscillator output */
+        STATS_START(handle->stats, timestamp);
+        for (i = 0; i < nb_frames; i++)
+            adsr_output[i] = scale[i] * QS823_TO_FLOAT * (float)osc1[i];
+        STATS_STOP(handle->stats, STATS_ENVELOPPE, timestamp);
+    }
+}
+
+
+/* Process a single block (nb_frames <= block_size), floating point signal path template */
+static ALWAYS_INLINE void moog_process_block_float_tmpl(struct moog *handle, int nb_frames,
+                                                        float *output, enum wave_gen_mode mode,
+                                                        int coupled)
+{
+    uint64_t timestamp = 0;
+
+    moog_source_block_float_tmpl(handle, nb_frames, mode, coupled);
+
+    /* Low pass filter */
+    STATS_START(handle->stats, timestamp);
+    low_pass_process_float(handle->lpf, handle->adsr_output, nb_frames, output);
+    STATS_STOP(handle->stats, STATS_LOW_PASS, timestamp);
+}
+
+
+/* Specialized block processing and source kernels (both signal paths) for a waveform and
+ * coupling
+ */
+#define MOOG_BLOCK_KERNELS(name, mode, coupled)                                                   \
+static void moog_process_block_##name(struct moog *handle, int nb_frames, int32_t *output)       \
+{                                                                                                 \
+    moog_process_block_tmpl(handle, nb_frames, output, mode, coupled);                            \
+}                                                                                                 \
+static void moog_process_block_float_##name(struct moog *handle, int nb_frames, float *output)   \
+{                                                                                                 \
+    moog_process_block_float_tmpl(handle, nb_frames, output, mode, coupled);                      \
+}                                                                                                 \
+static void moog_source_block_##name(struct moog *handle, int nb_frames)                         \
+{                                                                                                 \
+    moog_source_block_tmpl(handle, nb_frames, mode, coupled);                                     \
+}                                                                                                 \
+static void moog_source_block_float_##name(struct moog *handle, int nb_frames)                   \
+{                                                                                                 \
+    moog_source_block_float_tmpl(handle, nb_frames, mode, coupled);                               \
+}
+
+MOOG_BLOCK_KERNELS(sine,                WAVE_MODE_SINE,         0)
+MOOG_BLOCK_KERNELS(sine_coupled,        WAVE_MODE_SINE,         1)
+MOOG_BLOCK_KERNELS(saw,                 WAVE_MODE_SAW,          0)
+MOOG_BLOCK_KERNELS(saw_coupled,         WAVE_MODE_SAW,          1)
+MOOG_BLOCK_KERNELS(square,              WAVE_MODE_SQUARE,       0)
+MOOG_BLOCK_KERNELS(square_coupled,      WAVE_MODE_SQUARE,       1)
+MOOG_BLOCK_KERNELS(wavetable,           WAVE_MODE_SAW_BL,       0)
+MOOG_BLOCK_KERNELS(wavetable_coupled,   WAVE_MODE_SAW_BL,       1)
+
+#define MOOG_KERNELS(name)  { moog_process_block_##name, moog_process_block_float_##name,     \
+                              moog_source_block_##name, moog_source_block_float_##name }
+
+/* Block processing kernels, per waveform type and coupling (none or any interval) */
+static const struct {
+    moog_block_kernel fixed;                        ///< QS8.23 signal path
+    moog_block_kernel_float fl;                     ///< Floating point signal path
+    moog_source_kernel source;                      ///< QS8.23 signal path (filter input)
+    moog_source_kernel source_fl;                   ///< Floating point signal path (filter input)
+} moog_block_kernels[][2] = {
+    [WAVE_MODE_SINE]      = { MOOG_KERNELS(sine),      MOOG_KERNELS(sine_coupled) },
+    [WAVE_MODE_SAW]       = { MOOG_KERNELS(saw),       MOOG_KERNELS(saw_coupled) },
+    [WAVE_MODE_SQUARE]    = { MOOG_KERNELS(square),    MOOG_KERNELS(square_coupled) },
+    [WAVE_MODE_SAW_BL]    = { MOOG_KERNELS(wavetable), MOOG_KERNELS(wavetable_coupled) },
+    [WAVE_MODE_SQUARE_BL] = { MOOG_KERNELS(wavetable), MOOG_KERNELS(wavetable_coupled) },
 };
 
 
@@ -72,9 +352,15 @@ struct moog *moog_create(struct moog_params *params)
     struct moog *handle = NULL;
     struct adsr_params adsr_params;
     struct low_pass_params lpf_params;
+    struct moog_lpf_table_key lpf_key;
+    int coupled;
     struct wave_gen_params osc_params;
 
-    if (!params)
+    if ((!params)
+    ||  (params->block_size < MOOG_MIN_BLOCK_SIZE)
+    ||  (params->block_size > MOOG_MAX_BLOCK_SIZE)
+    ||  ((params->sample_format != MOOG_SAMPLE_FORMAT_FIXED)
+    &&   (params->sample_format != MOOG_SAMPLE_FORMAT_FLOAT)))
         goto failure;
 
     handle = (struct moog *)calloc(1, sizeof(struct moog));
@@ -82,6 +368,7 @@ struct moog *moog_create(struct moog_params *params)
         goto failure;
 
     handle->fs = params->fs;
+    memcpy(&handle->params, params, sizeof(struct moog_params));
 
     /* ADSR */
     adsr_params.fs      = params->fs;
@@ -131,6 +418,15 @@ struct moog *moog_create(struct moog_params *params)
         goto failure;
     }
 
+    /* Waveform and coupling specific processing (oscillators type being checked on creation) */
+    handle->gen1 = wave_gen_get_generator(handle->osc1);
+    handle->gen2 = wave_gen_get_generator(handle->osc2);
+    coupled = (handle->coupling != MOOG_OSC_COUPLING_NONE);
+    handle->process_block        = moog_block_kernels[params->osc_mode][coupled].fixed;
+    handle->process_block_float  = moog_block_kernels[params->osc_mode][coupled].fl;
+    handle->process_source       = moog_block_kernels[params->osc_mode][coupled].source;
+    handle->process_source_float = moog_block_kernels[params->osc_mode][coupled].source_fl;
+
     /* Low pass filter */
     lpf_params.Q    = params->Q;
     lpf_params.gain = params->gain;
@@ -140,30 +436,42 @@ struct moog *moog_create(struct moog_params *params)
     if (!handle->lpf)
         goto failure;
 
+    /* Cutoff frequency updates (sweeps) use precomputed coefficients, shared by all instances
+     * running at the same sampling frequency and Q
+     */
+    memset(&lpf_key, 0, sizeof(lpf_key));
+    lpf_key.fs = lpf_params.fs;
+    lpf_key.Q  = lpf_params.Q;
+    handle->lpf_table = (struct low_pass_table *)cache_acquire(&lpf_key, sizeof(lpf_key),
+                                                               moog_lpf_table_build,
+                                                               moog_lpf_table_free);
+    if ((!handle->lpf_table)
+    ||  (low_pass_set_table(handle->lpf, handle->lpf_table)))
+        goto failure;
+
     /* Internal buffers */
-    handle->frame_size = params->frame_size;
-    handle->osc1_output = (int32_t *)calloc(handle->frame_size, sizeof(int32_t));
+    handle->block_size = params->block_size;
+    handle->osc1_output = (int32_t *)calloc(handle->block_size, sizeof(int32_t));
     if (!handle->osc1_output)
         goto failure;
 
     if (handle->coupling != MOOG_OSC_COUPLING_NONE) {
-        handle->osc2_output = (int32_t *)calloc(handle->frame_size, sizeof(int32_t));
+        handle->osc2_output = (int32_t *)calloc(handle->block_size, sizeof(int32_t));
         if (!handle->osc2_output)
             goto failure;
-
-        handle->sum_output = (int32_t *)calloc(handle->frame_size, sizeof(int32_t));
-        if (!handle->sum_output)
-            goto failure;
     }
 
-    handle->adsr_output = (int32_t *)calloc(handle->frame_size, sizeof(int32_t));
-    if (!handle->adsr_output)
-        goto failure;
-
-    handle->adsr_scale = (float *)calloc(handle->frame_size, sizeof(float));
+    handle->adsr_scale = (float *)calloc(handle->block_size, sizeof(float));
     if (!handle->adsr_scale)
         goto failure;
 
+    handle->sample_format = params->sample_format;
+    if (handle->sample_format == MOOG_SAMPLE_FORMAT_FLOAT) {
+        handle->adsr_output = (float *)calloc(handle->block_size, sizeof(float));
+        if (!handle->adsr_output)
+            goto failure;
+    }
+
     return handle;
 
 failure:
@@ -180,6 +488,7 @@ void moog_destroy(struct moog **handle)
 
     adsr_destroy(&(*handle)->adsr);
     low_pass_destroy(&(*handle)->lpf);
+    cache_release((*handle)->lpf_table);
     wave_gen_destroy(&(*handle)->osc1);
     wave_gen_destroy(&(*handle)->osc2);
 
@@ -187,12 +496,10 @@ void moog_destroy(struct moog **handle)
         free((*handle)->osc1_output);
     if ((*handle)->osc2_output)
         free((*handle)->osc2_output);
-    if ((*handle)->sum_output)
-        free((*handle)->sum_output);
-    if ((*handle)->adsr_output)
-        free((*handle)->adsr_output);
     if ((*handle)->adsr_scale)
         free((*handle)->adsr_scale);
+    if ((*handle)->adsr_output)
+        free((*handle)->adsr_output);
 
     free(*handle);
     *handle = NULL;
@@ -207,10 +514,7 @@ int moog_toggle(struct moog *handle, int state)
 {
     int ret = 0;
 
-    /* Full args check to avoid partial submodules update
-     * The only remaining failure possibility lies in ADSR internal state
-     * compatibility, which will be the first update attempt.
-     */
+    /* Full args check to avoid partial submodules update */
     if ((!handle)
     ||  ((state != 0) && (state != 1))) {
         ret = -EINVAL;
@@ -228,6 +532,23 @@ exit:
 }
 
 
+int moog_retrigger(struct moog *handle)
+{
+    int ret = 0;
+
+    if (!handle) {
+        ret = -EINVAL;
+        goto exit;
+    }
+
+    ret = adsr_retrigger(handle->adsr, handle->intensity);
+
+exit:
+
+    return ret;
+}
+
+
 int moog_set_intensity(struct moog *handle, float intensity)
 {
     int ret = 0;
@@ -268,6 +589,23 @@ exit:
 }
 
 
+int moog_get_level(struct moog *handle, float *level)
+{
+    int ret = 0;
+
+    if (!handle) {
+        ret = -EINVAL;
+        goto exit;
+    }
+
+    ret = adsr_get_level(handle->adsr, level);
+
+exit:
+
+    return ret;
+}
+
+
 int moog_set_frequency(struct moog *handle, float frequency)
 {
     int ret = 0;
@@ -355,7 +693,7 @@ exit:
 }
 
 
-int moog_filter_start_fc_sweep(struct moog *handle, float new_fc, int nb_frames)
+int moog_filter_start_fc_sweep(struct moog *handle, float new_fc, int nb_samples)
 {
     int ret = 0;
 
@@ -364,7 +702,7 @@ int moog_filter_start_fc_sweep(struct moog *handle, float new_fc, int nb_frames)
         goto exit;
     }
 
-    ret = low_pass_start_fc_sweep(handle->lpf, new_fc, nb_frames * handle->frame_size);
+    ret = low_pass_start_fc_sweep(handle->lpf, new_fc, nb_samples);
 
 exit:
 
@@ -372,10 +710,136 @@ exit:
 }
 
 
-int moog_process(struct moog *handle, int32_t *output)
+int moog_set_stats(struct moog *handle, struct stats *stats)
 {
-    int i, ret = 0;
-    int64_t tmp_sum;
+    int ret = 0;
+
+    if (!handle) {
+        ret = -EINVAL;
+        goto exit;
+    }
+
+    handle->stats = stats;
+
+exit:
+
+    return ret;
+}
+
+
+int moog_apply_event(struct moog *handle, const struct moog_event *event)
+{
+    int ret = 0;
+    float fc, Q, gain;
+
+    if ((!handle)
+    ||  (!event)) {
+        ret = -EINVAL;
+        goto exit;
+    }
+
+    switch (event->type) {
+    case MOOG_EVENT_NOTE_ON:
+        ret = moog_toggle(handle, 1);
+        if (ret)
+            goto exit;
+        ret = moog_set_frequency(handle, event->frequency);
+        break;
+    case MOOG_EVENT_NOTE_OFF:
+        ret = moog_toggle(handle, 0);
+        break;
+    case MOOG_EVENT_FILTER_UPDATE:
+        /* Only update specified parameters */
+        ret = moog_filter_get_parameters(handle, &fc, &Q, &gain);
+        if (ret)
+            goto exit;
+        if (event->mask & MOOG_FILTER_FC)
+            fc = event->fc;
+        if (event->mask & MOOG_FILTER_Q)
+            Q = event->Q;
+        if (event->mask & MOOG_FILTER_GAIN)
+            gain = event->gain;
+        ret = moog_filter_set_parameters(handle, fc, Q, gain);
+        break;
+    case MOOG_EVENT_FILTER_SWEEP:
+        ret = moog_filter_start_fc_sweep(handle, event->fc, event->nb_samples);
+        break;
+    default:
+        ret = -EINVAL;
+        break;
+    }
+
+exit:
+
+    return ret;
+}
+
+
+/* Render samples with timed events, on either signal path (output or output_fl) */
+static int moog_render(struct moog *handle, const struct moog_event *events, int nb_events,
+                       int nb_frames, int32_t *output, float *output_fl)
+{
+    int i, next, nb, done = 0, ret = 0;
+
+    if ((!handle)
+    ||  ((!output) && (!output_fl))
+    ||  (nb_frames < 0)
+    ||  (nb_events < 0)
+    ||  ((nb_events > 0) && (!events))) {
+        ret = -EINVAL;
+        goto exit;
+    }
+
+    /* Every module keeps its state from one sample to the next: Processing samples
+     * block after block gives the very same output as processing them at once.
+     */
+    for (i = 0; i <= nb_events; i++) {
+
+        /* Process samples up to next event */
+        next = (i < nb_events) ? events[i].offset : nb_frames;
+        if ((next < done) || (next > nb_frames)) {
+            ret = -EINVAL;
+            goto exit;
+        }
+
+        /* Idle fast path: null output up to next event */
+        if ((done < next) && (moog_is_silent(handle))) {
+            ret = moog_skip(handle, next - done);
+            if (ret)
+                goto exit;
+            if (output)
+                memset(output + done, 0, (next - done) * sizeof(int32_t));
+            else
+                memset(output_fl + done, 0, (next - done) * sizeof(float));
+            done = next;
+        }
+
+        while (done < next) {
+            nb = MIN(handle->block_size, next - done);
+            if (output)
+                handle->process_block(handle, nb, output + done);
+            else
+                handle->process_block_float(handle, nb, output_fl + done);
+            done += nb;
+        }
+
+        if (i < nb_events) {
+            ret = moog_apply_event(handle, &events[i]);
+            if (ret)
+                goto exit;
+        }
+    }
+
+exit:
+
+    return ret;
+}
+
+
+int moog_process(struct moog *handle, const struct moog_event *events, int nb_events,
+                 int nb_frames, int32_t *output)
+{
+    int ret = 0;
 
     if ((!handle)
     ||  (!output)) {
@@ -383,36 +847,446 @@ int moog_process(struct moog *handle, int32_t *output)
         goto exit;
     }
 
-    /* Compute ADSR enveloppe */
-    adsr_process(handle->adsr, handle->frame_size, handle->adsr_scale);
+    ret = moog_render(handle, events, nb_events, nb_frames, output, NULL);
 
-    /* Internal oscillators output */
-    wave_gen_process(handle->osc1, handle->frame_size, handle->osc1_output);
+exit:
 
-    if (handle->coupling != MOOG_OSC_COUPLING_NONE) {
-        wave_gen_process(handle->osc2, handle->frame_size, handle->osc2_output);
+    return ret;
+}
+
+
+int moog_process_float(struct moog *handle, const struct moog_event *events, int nb_events,
+                       int nb_frames, float *output)
+{
+    int ret = 0;
 
-        /* Sum oscillators outputs with saturation */
-        for (i = 0; i < handle->frame_size; i++) {
-            tmp_sum = (int64_t)handle->osc1_output[i] + handle->osc2_output[i];
-            handle->sum_output[i] = (int32_t)(MAX(MIN(tmp_sum, QS823_MAX), QS823_MIN));
+    if ((!handle)
+    ||  (!output)
+    ||  (handle->sample_format != MOOG_SAMPLE_FORMAT_FLOAT)) {
+        ret = -EINVAL;
+        goto exit;
+    }
+
+    ret = moog_render(handle, events, nb_events, nb_frames, NULL, output);
+
+exit:
+
+    return ret;
+}
+
+
+/* Render several instances at once, on either signal path (outputs or outputs_fl)
+ *
+ *  Filter inputs of every instance are computed block after block, then filtered together.
+ */
+static int moog_render_bank(struct moog *const *handles, int nb_handles, int nb_frames,
+                            int32_t *const *outputs, float *const *outputs_fl)
+{
+    int k, nb, done = 0, ret = 0;
+    uint64_t timestamp = 0;
+    struct low_pass *lpf[MOOG_BANK_MAX_INSTANCES];
+    const int32_t *in[MOOG_BANK_MAX_INSTANCES];
+    const float *in_fl[MOOG_BANK_MAX_INSTANCES];
+    int32_t *out[MOOG_BANK_MAX_INSTANCES];
+    float *out_fl[MOOG_BANK_MAX_INSTANCES];
+
+    if ((!handles)
+    ||  (nb_handles < 1)
+    ||  (nb_handles > MOOG_BANK_MAX_INSTANCES)
+    ||  (nb_frames < 0)) {
+        ret = -EINVAL;
+        goto exit;
+    }
+
+    for (k = 0; k < nb_handles; k++) {
+        if ((!handles[k])
+        ||  (handles[k]->block_size != handles[0]->block_size)
+        ||  ((outputs) && (!outputs[k]))
+        ||  ((outputs_fl) && ((!outputs_fl[k])
+        ||                    (handles[k]->sample_format != MOOG_SAMPLE_FORMAT_FLOAT)))) {
+            ret = -EINVAL;
+            goto exit;
         }
+        lpf[k]   = handles[k]->lpf;
+        in[k]    = handles[k]->osc1_output;
+        in_fl[k] = handles[k]->adsr_output;
+    }
 
-        /* Apply ADSR enveloppe on summed oscillators outputs */
-        for (i = 0; i < handle->frame_size; i++)
-            handle->adsr_output[i] = (int32_t)(handle->adsr_scale[i] * handle->sum_output[i]);
+    while (done < nb_frames) {
 
-    } else {
+        nb = MIN(handles[0]->block_size, nb_frames - done);
 
-        /* Apply ADSR enveloppe on single oscillator output */
-        for (i = 0; i < handle->frame_size; i++)
-            handle->adsr_output[i] = (int32_t)(handle->adsr_scale[i] * handle->osc1_output[i]);
+        for (k = 0; k < nb_handles; k++) {
+            if (outputs) {
+                handles[k]->process_source(handles[k], nb);
+                out[k] = outputs[k] + done;
+            } else {
+                handles[k]->process_source_float(handles[k], nb);
+                out_fl[k] = outputs_fl[k] + done;
+            }
+        }
+
+        /* Low pass filters */
+        STATS_START(handles[0]->stats, timestamp);
+        if (outputs)
+            ret = low_pass_process_bank(lpf, nb_handles, in, nb, out);
+        else
+            ret = low_pass_process_bank_float(lpf, nb_handles, in_fl, nb, out_fl);
+        STATS_STOP(handles[0]->stats, STATS_LOW_PASS, timestamp);
+        if (ret)
+            goto exit;
+
+        done += nb;
     }
 
-    /* Low pass filter */
-    low_pass_process(handle->lpf, handle->adsr_output, handle->frame_size, output);
+exit:
+
+    return ret;
+}
+
+
+int moog_process_bank(struct moog *const *handles, int nb_handles, int nb_frames,
+                      int32_t *const *outputs)
+{
+    int ret = 0;
+
+    if (!outputs) {
+        ret = -EINVAL;
+        goto exit;
+    }
+
+    ret = moog_render_bank(handles, nb_handles, nb_frames, outputs, NULL);
+
+exit:
+
+    return ret;
+}
+
+
+int moog_process_bank_float(struct moog *const *handles, int nb_handles, int nb_frames,
+                            float *const *outputs)
+{
+    int ret = 0;
+
+    if (!outputs) {
+        ret = -EINVAL;
+        goto exit;
+    }
+
+    ret = moog_render_bank(handles, nb_handles, nb_frames, NULL, outputs);
+
+exit:
+
+    return ret;
+}
+
+
+int moog_is_silent(struct moog *handle)
+{
+    if (!handle)
+        return 0;
+
+    return (adsr_is_idle(handle->adsr)) && (low_pass_is_idle(handle->lpf));
+}
+
+
+int moog_fast_forward(struct moog *handle, int nb_frames)
+{
+    int ret = 0;
+
+    if ((!handle) || (nb_frames < 0)) {
+        ret = -EINVAL;
+        goto exit;
+    }
+
+    /* Every submodule control state follows its exact trajectory, the signal path only being
+     * left out
+     */
+    ret = adsr_skip(handle->adsr, nb_frames);
+    ret |= low_pass_skip(handle->lpf, nb_frames);
+    ret |= wave_gen_skip(handle->osc1, nb_frames);
+    if (handle->coupling != MOOG_OSC_COUPLING_NONE)
+        ret |= wave_gen_skip(handle->osc2, nb_frames);
+
+exit:
+
+    return ret;
+}
+
+
+int moog_skip(struct moog *handle, int nb_frames)
+{
+    int ret = 0;
+
+    if ((!handle) || (nb_frames < 0)) {
+        ret = -EINVAL;
+        goto exit;
+    }
+
+    if (!moog_is_silent(handle)) {
+        ret = -EAGAIN;
+        goto exit;
+    }
+
+    /* Enveloppe and filter are left untouched by null samples: only oscillators move forward,
+     * so that following notes start with the very same phase
+     */
+    ret = wave_gen_skip(handle->osc1, nb_frames);
+    if (handle->coupling != MOOG_OSC_COUPLING_NONE)
+        ret |= wave_gen_skip(handle->osc2, nb_frames);
+
+exit:
+
+    return ret;
+}
+
+
+/* Whole snapshot size: header followed by every submodule snapshot */
+static int moog_snapshot_size(struct moog *handle)
+{
+    int n, ret = HEADER_SIZE;
+
+    n = adsr_snapshot(handle->adsr, NULL, 0);
+    if (n < 0)
+        return n;
+    ret += n;
+
+    n = low_pass_snapshot(handle->lpf, NULL, 0);
+    if (n < 0)
+        return n;
+    ret += n;
+
+    n = wave_gen_snapshot(handle->osc1, NULL, 0);
+    if (n < 0)
+        return n;
+    ret += n;
+
+    if (handle->coupling != MOOG_OSC_COUPLING_NONE) {
+        n = wave_gen_snapshot(handle->osc2, NULL, 0);
+        if (n < 0)
+            return n;
+        ret += n;
+    }
+
+    return ret;
+}
+
+
+int moog_snapshot(struct moog *handle, void *blob, int size)
+{
+    int n, ret = 0;
+    uint8_t *ptr = (uint8_t *)blob;
+
+    if (!handle) {
+        ret = -EINVAL;
+        goto exit;
+    }
+
+    ret = moog_snapshot_size(handle);
+    if ((ret < 0) || (!blob))
+        goto exit;
+
+    if (size < ret) {
+        ret = -ENOSPC;
+        goto exit;
+    }
+
+    snapshot_put_u32(&ptr, SNAPSHOT_MAGIC);
+    snapshot_put_i32(&ptr, ret);
+    snapshot_put_float(&ptr, handle->fs);
+    snapshot_put_float(&ptr, handle->params.Q);
+    snapshot_put_i32(&ptr, handle->params.osc_mode);
+    snapshot_put_i32(&ptr, handle->coupling);
+    snapshot_put_i32(&ptr, handle->sample_format);
+    snapshot_put_float(&ptr, handle->intensity);
+    size -= HEADER_SIZE;
+
+    n = adsr_snapshot(handle->adsr, ptr, size);
+    if (n < 0)
+        goto failure;
+    ptr  += n;
+    size -= n;
+
+    n = low_pass_snapshot(handle->lpf, ptr, size);
+    if (n < 0)
+        goto failure;
+    ptr  += n;
+    size -= n;
+
+    n = wave_gen_snapshot(handle->osc1, ptr, size);
+    if (n < 0)
+        goto failure;
+    ptr  += n;
+    size -= n;
+
+    if (handle->coupling != MOOG_OSC_COUPLING_NONE) {
+        n = wave_gen_snapshot(handle->osc2, ptr, size);
+        if (n < 0)
+            goto failure;
+    }
+
+exit:
+
+    return ret;
+
+failure:
+
+    return n;
+}
+
+
+/* Check every submodule snapshot, and restore them as well if restore is set
+ *
+ *  Returns the number of read bytes, 0 > errno else.
+ */
+static int moog_read_submodules(struct moog *handle, const uint8_t *ptr, int size, int restore)
+{
+    int n, ret = 0;
+
+    n = restore ? adsr_restore(handle->adsr, ptr, size)
+                : adsr_check_snapshot(handle->adsr, ptr, size);
+    if (n < 0)
+        goto failure;
+    ptr  += n;
+    size -= n;
+    ret  += n;
+
+    n = restore ? low_pass_restore(handle->lpf, ptr, size)
+                : low_pass_check_snapshot(handle->lpf, ptr, size);
+    if (n < 0)
+        goto failure;
+    ptr  += n;
+    size -= n;
+    ret  += n;
+
+    n = restore ? wave_gen_restore(handle->osc1, ptr, size)
+                : wave_gen_check_snapshot(handle->osc1, ptr, size);
+    if (n < 0)
+        goto failure;
+    ptr  += n;
+    size -= n;
+    ret  += n;
+
+    if (handle->coupling != MOOG_OSC_COUPLING_NONE) {
+        n = restore ? wave_gen_restore(handle->osc2, ptr, size)
+                    : wave_gen_check_snapshot(handle->osc2, ptr, size);
+        if (n < 0)
+            goto failure;
+        ret += n;
+    }
+
+    return ret;
+
+failure:
+
+    return n;
+}
+
+
+/* Check a whole snapshot, and restore it as well if restore is set (all or nothing) */
+static int moog_read_snapshot(struct moog *handle, const void *blob, int size, int restore)
+{
+    int ret = 0;
+    const uint8_t *ptr = (const uint8_t *)blob;
+    struct moog_snapshot_header header;
+
+    if ((!handle)
+    ||  (!blob)
+    ||  (size < HEADER_SIZE)) {
+        ret = -EINVAL;
+        goto exit;
+    }
+
+    /* Header: snapshot taken by a compatible instance */
+    header.magic         = snapshot_get_u32(&ptr);
+    header.size          = snapshot_get_i32(&ptr);
+    header.fs            = snapshot_get_float(&ptr);
+    header.Q             = snapshot_get_float(&ptr);
+    header.osc_mode      = snapshot_get_i32(&ptr);
+    header.coupling      = snapshot_get_i32(&ptr);
+    header.sample_format = snapshot_get_i32(&ptr);
+    header.intensity     = snapshot_get_float(&ptr);
+    if ((header.magic != SNAPSHOT_MAGIC)
+    ||  (header.size > size)
+    ||  (header.size != moog_snapshot_size(handle))
+    ||  (header.fs != handle->fs)
+    ||  (header.Q != handle->params.Q)
+    ||  (header.osc_mode != (int32_t)handle->params.osc_mode)
+    ||  (header.coupling != (int32_t)handle->coupling)
+    ||  (header.sample_format != (int32_t)handle->sample_format)
+    ||  (!(header.intensity >= 0))
+    ||  (!(header.intensity <= 1))) {
+        ret = -EINVAL;
+        goto exit;
+    }
+
+    size = header.size - HEADER_SIZE;
+
+    /* Every submodule snapshot is checked before any is restored */
+    ret = moog_read_submodules(handle, ptr, size, 0);
+    if (ret < 0)
+        goto exit;
+
+    if (restore) {
+        ret = moog_read_submodules(handle, ptr, size, 1);
+        if (ret < 0)
+            goto exit;
+
+        handle->intensity = header.intensity;
+    }
+
+    ret = header.size;
 
 exit:
 
     return ret;
 }
+
+
+int moog_restore(struct moog *handle, const void *blob, int size)
+{
+    return moog_read_snapshot(handle, blob, size, 1);
+}
+
+
+int moog_check_snapshot(struct moog *handle, const void *blob, int size)
+{
+    return moog_read_snapshot(handle, blob, size, 0);
+}
+
+
+struct moog *moog_clone(struct moog *handle)
+{
+    int size;
+    void *blob = NULL;
+    struct moog *clone = NULL;
+
+    if (!handle)
+        goto failure;
+
+    clone = moog_create(&handle->params);
+    if (!clone)
+        goto failure;
+
+    size = moog_snapshot(handle, NULL, 0);
+    if (size < 0)
+        goto failure;
+
+    blob = malloc(size);
+    if ((!blob)
+    ||  (moog_snapshot(handle, blob, size) < 0)
+    ||  (moog_restore(clone, blob, size) < 0))
+        goto failure;
+
+    free(blob);
+
+    return clone;
+
+failure:
+
+    if (blob)
+        free(blob);
+    moog_destroy(&clone);
+
+    return NULL;
+}
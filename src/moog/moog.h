@@ -33,6 +33,29 @@
 /* Forward waveform types enum declaration */
 #include <wave_gen.h>
 
+/* Processing statistics */
+#include <stats.h>
+
+
+/**
+ * @brief Internal processing block size bounds (number of samples)
+ *
+ *  Frames are internally processed by blocks of that size, so that the
+ * intermediate buffers working set is independent from the frame size.
+ */
+#define MOOG_MIN_BLOCK_SIZE     (16)            ///< Minimal block size
+#define MOOG_MAX_BLOCK_SIZE     (4096)          ///< Maximal block size
+#define MOOG_DFT_BLOCK_SIZE     (256)           ///< Default block size (fits in L1 cache)
+
+
+/**
+ * @brief Maximal number of instances processed at once by moog_process_bank
+ *
+ *  Matches the widest SIMD lanes count of low pass filter bank processing (16 single precision
+ * lanes with AVX-512).
+ */
+#define MOOG_BANK_MAX_INSTANCES (16)
+
 
 /**
  * @brief Opaque module handle
@@ -55,6 +78,50 @@ enum moog_osc_coupling {
     MOOG_OSC_COUPLING_OCTAVE                    ///< Let's double that frequency !
 };
 
+/**
+ * @brief Signal path sample format
+ */
+enum moog_sample_format {
+    MOOG_SAMPLE_FORMAT_FIXED,                   ///< QS8.23 fixed point (moog_process)
+    MOOG_SAMPLE_FORMAT_FLOAT                    ///< Single precision floating point
+                                                ///< (moog_process_float)
+};
+
+
+/**
+ * @brief Timed event types
+ */
+enum moog_event_type {
+    MOOG_EVENT_NOTE_ON,                         ///< Note ON (uses frequency)
+    MOOG_EVENT_NOTE_OFF,                        ///< Note OFF
+    MOOG_EVENT_FILTER_UPDATE,                   ///< Low pass filter update (uses fc, Q, gain, mask)
+    MOOG_EVENT_FILTER_SWEEP                     ///< Low pass fc sweep (uses fc, nb_samples)
+};
+
+
+/**
+ * @brief Low pass filter parameters updated by a MOOG_EVENT_FILTER_UPDATE event
+ */
+#define MOOG_FILTER_FC          (1 << 0)        ///< Update cutoff frequency
+#define MOOG_FILTER_Q           (1 << 1)        ///< Update quality factor
+#define MOOG_FILTER_GAIN        (1 << 2)        ///< Update gain
+
+
+/**
+ * @brief Timed event, applied at a given sample of a processed block
+ */
+struct moog_event {
+    int offset;                                 ///< Sample offset in processed block
+    enum moog_event_type type;                  ///< Event type
+    float frequency;                            ///< Note frequency (Hz)
+    float fc;                                   ///< New (or sweep target) cutoff frequency (Hz)
+    float Q;                                    ///< New quality factor
+    float gain;                                 ///< New gain (dB)
+    int mask;                                   ///< Updated filter parameters (MOOG_FILTER_*)
+    int nb_samples;                             ///< Sweep duration (number of samples)
+};
+
+
 /**
  * @brief Initialization parameters
  */
@@ -62,7 +129,9 @@ struct moog_params {
 
     /* General parameters */
     float fs;                                   ///< Sampling frequency
-    int frame_size;                             ///< Numer of samples per frame
+    int block_size;                             ///< Numer of samples per processing block
+                                                ///< ([MOOG_MIN_BLOCK_SIZE, MOOG_MAX_BLOCK_SIZE])
+    enum moog_sample_format sample_format;      ///< Signal path sample format
 
     /* Low pass filter parameters */
     float fc;                                   ///< Cutoff frequency (Hz, [0,fs/2[)
@@ -104,6 +173,9 @@ void moog_destroy(struct moog **handle);
 /**
  * @brief Toggle Moog module (ON/OFF)
  *
+ *  Toggling ON an already playing module keeps the enveloppe continuous: the attack slope is
+ * retriggered from the current level if needed (see adsr_toggle).
+ *
  * @param[in] handle        : Module handle
  * @param[in] state         : ON (1), OFF (0)
  *
@@ -112,6 +184,18 @@ void moog_destroy(struct moog **handle);
 int moog_toggle(struct moog *handle, int state);
 
 
+/**
+ * @brief Retrigger the enveloppe whatever its state (unlike moog_toggle, which plays legato
+ *        over a held note): the attack slope restarts from the current level, up to the current
+ *        intensity. Used to start a new note on a still playing (stolen) module.
+ *
+ * @param[in] handle        : Module handle
+ *
+ * @return 0 if successful, 0 > errno else
+ */
+int moog_retrigger(struct moog *handle);
+
+
 /**
  * @brief Set output intensity
  *
@@ -134,6 +218,17 @@ int moog_set_intensity(struct moog *handle, float intensity);
 int moog_get_intensity(struct moog *handle, float *intensity);
 
 
+/**
+ * @brief Get current enveloppe level
+ *
+ * @param[in]  handle       : Module handle
+ * @param[out] level        : Current enveloppe level (in [0,1], intensity scaled)
+ *
+ * @return 0 if successful, 0 > errno else
+ */
+int moog_get_level(struct moog *handle, float *level);
+
+
 /**
  * @brief Set low oscillator output frequency
  *
@@ -187,22 +282,212 @@ int moog_filter_set_parameters(struct moog *handle, float new_fc, float new_Q, f
  *
  * @param[in] handle        : Module handle
  * @param[in] new_fc        : Target new cutoff frequency
- * @param[in] nb_frames     : Number of frames to reach new cutoff frequency
+ * @param[in] nb_samples    : Number of samples to reach new cutoff frequency
+ *
+ * @return 0 if successful, 0 > errno else
+ */
+int moog_filter_start_fc_sweep(struct moog *handle, float new_fc, int nb_samples);
+
+
+/**
+ * @brief Enable/disable per stage processing time measures
+ *
+ * @param[in] handle        : Module handle
+ * @param[in] stats         : Statistics structure to be updated (NULL to disable)
+ *
+ * @return 0 if successful, 0 > errno else
+ */
+int moog_set_stats(struct moog *handle, struct stats *stats);
+
+
+/**
+ * @brief Apply an event right away (event offset is ignored)
+ *
+ * @param[in] handle        : Module handle
+ * @param[in] event         : Event to be applied
  *
  * @return 0 if successful, 0 > errno else
  */
-int moog_filter_start_fc_sweep(struct moog *handle, float new_fc, int nb_frames);
+int moog_apply_event(struct moog *handle, const struct moog_event *event);
 
 
 /**
  * @brief Proceed to moog bass generation
  *
+ *  Each event is applied right before processing the sample located at its offset, so
+ * that notes and filter updates land on their exact sample whatever the block length.
+ *
  * @param[in]  handle       : Module handle
+ * @param[in]  events       : Timed events, sorted by offset in [0, nb_frames] (can be NULL
+ *                            if nb_events is 0)
+ * @param[in]  nb_events    : Number of events
+ * @param[in]  nb_frames    : Number of samples to be generated
  * @param[out] output       : Output QS8.23 signal
  *
  * @return 0 if successful, 0 > errno
  */
-int moog_process(struct moog *handle, int32_t *output);
+int moog_process(struct moog *handle, const struct moog_event *events, int nb_events,
+                 int nb_frames, int32_t *output);
+
+
+/**
+ * @brief Proceed to moog bass generation (floating point signal path)
+ *
+ *  Same as moog_process, with enveloppe application and low pass filtering computed in
+ * single precision floating point. Only available if the module has been initialized with
+ * the MOOG_SAMPLE_FORMAT_FLOAT sample format.
+ *
+ * @param[in]  handle       : Module handle
+ * @param[in]  events       : Timed events, sorted by offset in [0, nb_frames] (can be NULL
+ *                            if nb_events is 0)
+ * @param[in]  nb_events    : Number of events
+ * @param[in]  nb_frames    : Number of samples to be generated
+ * @param[out] output       : Output signal (full scale: [-1, 1[)
+ *
+ * @return 0 if successful, 0 > errno
+ */
+int moog_process_float(struct moog *handle, const struct moog_event *events, int nb_events,
+                       int nb_frames, float *output);
+
+
+/**
+ * @brief Proceed to moog bass generation of several instances at once (no event)
+ *
+ *  Instances sharing their low pass filter coefficients (same parameters, and same filter
+ * events at the same time, such as polyphonic voices) have their filters run in parallel SIMD
+ * lanes (see low_pass_process_bank). Output is bit exact with moog_process applied to every
+ * instance (floating point contractions being disabled at build time, see Makefile), but for
+ * the silent fast path, which is never taken here.
+ *
+ * @param[in]  handles      : Module handles (same block size)
+ * @param[in]  nb_handles   : Number of handles ([1, MOOG_BANK_MAX_INSTANCES])
+ * @param[in]  nb_frames    : Number of samples to be generated
+ * @param[out] outputs      : Output QS8.23 signals (one per handle)
+ *
+ * @return 0 if successful, 0 > errno
+ */
+int moog_process_bank(struct moog *const *handles, int nb_handles, int nb_frames,
+                      int32_t *const *outputs);
+
+
+/**
+ * @brief Proceed to moog bass generation of several instances at once (floating point signal
+ *        path)
+ *
+ *  Same as moog_process_bank, every instance using the MOOG_SAMPLE_FORMAT_FLOAT sample format.
+ *
+ * @param[in]  handles      : Module handles (same block size)
+ * @param[in]  nb_handles   : Number of handles ([1, MOOG_BANK_MAX_INSTANCES])
+ * @param[in]  nb_frames    : Number of samples to be generated
+ * @param[out] outputs      : Output signals (one per handle, full scale: [-1, 1[)
+ *
+ * @return 0 if successful, 0 > errno
+ */
+int moog_process_bank_float(struct moog *const *handles, int nb_handles, int nb_frames,
+                            float *const *outputs);
+
+
+/**
+ * @brief Check whether output is silent up to next event
+ *
+ *  Output is silent once no note is on going (idle enveloppe), and the low pass filter has
+ * decayed to a null state, with no transition or sweep on going.
+ *
+ * @param[in] handle        : Module handle
+ *
+ * @return 1 if silent, 0 else
+ */
+int moog_is_silent(struct moog *handle);
+
+
+/**
+ * @brief Skip silent samples: internal state moves forward as if nb_frames null samples were
+ *        processed, without running the signal path
+ *
+ * @param[in] handle        : Module handle
+ * @param[in] nb_frames     : Number of skipped samples
+ *
+ * @return 0 if successful, -EAGAIN if output is not silent (see moog_is_silent), 0 > errno else
+ */
+int moog_skip(struct moog *handle, int nb_frames);
+
+
+/**
+ * @brief Move internal state forward as if nb_frames samples were processed, without running the
+ *        signal path
+ *
+ *  Oscillators, enveloppe and filter coefficients follow their exact trajectory, whatever the
+ * output: only the filter state is unknown, and assumed to have decayed to rest. Once the
+ * output would have been silent anyway (see moog_is_silent), the state is then the very same as
+ * after moog_process.
+ *
+ * @param[in] handle        : Module handle
+ * @param[in] nb_frames     : Number of skipped samples
+ *
+ * @return 0 if successful, 0 > errno else
+ */
+int moog_fast_forward(struct moog *handle, int nb_frames);
+
+
+/**
+ * @brief Save the whole moog state (enveloppe, filter with its on going transitions and sweeps,
+ *        oscillators and intensity) to a compact, position independent blob
+ *
+ *  Snapshots only depend on the rendering history, not on the instance they are taken from:
+ * they may be restored by any instance created with the same sampling frequency, filter Q,
+ * waveform, coupling, sample format and enveloppe settings, in the same process or not (fields
+ * are serialized one by one, little endian, whatever the host structures layout and byte order).
+ * Rendering is then bit exact as long as the block size is the same too (floating point rounding
+ * may differ otherwise).
+ *
+ * @param[in]  handle       : Module handle
+ * @param[out] blob         : State snapshot (NULL to only get its size)
+ * @param[in]  size         : Blob size (bytes)
+ *
+ * @return Snapshot size (bytes) if successful, -ENOSPC if blob is too small, 0 > errno else
+ */
+int moog_snapshot(struct moog *handle, void *blob, int size);
+
+
+/**
+ * @brief Restore the whole moog state from a snapshot (see moog_snapshot): rendering then goes
+ *        on exactly as it would have from the snapshot point
+ *
+ *  Restoration is all or nothing: every submodule snapshot is checked before any is restored.
+ *
+ * @param[in] handle        : Module handle
+ * @param[in] blob          : State snapshot
+ * @param[in] size          : Blob size (bytes)
+ *
+ * @return Number of read bytes if successful, -EINVAL if the snapshot is not compatible with
+ *         this instance (state being left untouched), 0 > errno else
+ */
+int moog_restore(struct moog *handle, const void *blob, int size);
+
+
+/**
+ * @brief Check whether a snapshot would be restored (see moog_restore), leaving the moog
+ *        untouched
+ *
+ * @param[in] handle        : Module handle
+ * @param[in] blob          : State snapshot
+ * @param[in] size          : Blob size (bytes)
+ *
+ * @return Number of bytes moog_restore would read if successful, -EINVAL if the snapshot is not
+ *         compatible with this instance, 0 > errno else
+ */
+int moog_check_snapshot(struct moog *handle, const void *blob, int size);
+
+
+/**
+ * @brief Create a new instance in the very same state as an existing one (same creation
+ *        parameters, snapshot restored). Statistics are not shared (see moog_set_stats).
+ *
+ * @param[in] handle        : Module handle
+ *
+ * @return Valid module handle if successful, NULL else
+ */
+struct moog *moog_clone(struct moog *handle);
 
 
 #endif /* _MOOG_H_ */
@@ -0,0 +1,146 @@
+/***************************************************************************************************
+ * @file snapshot.h
+ *
+ * @brief State snapshots serialization helpers (header only)
+ *
+ * @licence MIT License
+ *
+ * Copyright (c) 2019 Jeremie Leclere
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy of this software and
+ * associated documentation files (the "Software"), to deal in the Software without restriction,
+ * including without limitation the rights to use, copy, modify, merge, publish, distribute,
+ * sublicense, and/or sell copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all copies or
+ * substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR IMPLIED, INCLUDING BUT
+ * NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND
+ * NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM,
+ * DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ **************************************************************************************************/
+
+#ifndef _SNAPSHOT_H_
+#define _SNAPSHOT_H_
+
+
+#include <stdint.h>
+#include <string.h>
+
+
+/**
+ * @brief Serialized fields sizes (bytes)
+ *
+ *  Snapshots are written field by field, little endian, so that they depend neither on structures
+ * layout and padding, nor on host byte order. Floating point fields are IEEE 754 binary32.
+ */
+#define SNAPSHOT_32     (4)
+#define SNAPSHOT_64     (8)
+
+
+/**
+ * @brief Write a 32 bits field, and move write pointer forward
+ */
+static inline void snapshot_put_u32(uint8_t **ptr, uint32_t value)
+{
+    int i;
+
+    for (i = 0; i < SNAPSHOT_32; i++)
+        (*ptr)[i] = (uint8_t)(value >> (8 * i));
+    *ptr += SNAPSHOT_32;
+}
+
+
+/**
+ * @brief Write a 64 bits field, and move write pointer forward
+ */
+static inline void snapshot_put_u64(uint8_t **ptr, uint64_t value)
+{
+    int i;
+
+    for (i = 0; i < SNAPSHOT_64; i++)
+        (*ptr)[i] = (uint8_t)(value >> (8 * i));
+    *ptr += SNAPSHOT_64;
+}
+
+
+static inline void snapshot_put_i32(uint8_t **ptr, int32_t value)
+{
+    snapshot_put_u32(ptr, (uint32_t)value);
+}
+
+
+static inline void snapshot_put_i64(uint8_t **ptr, int64_t value)
+{
+    snapshot_put_u64(ptr, (uint64_t)value);
+}
+
+
+static inline void snapshot_put_float(uint8_t **ptr, float value)
+{
+    uint32_t bits;
+
+    memcpy(&bits, &value, sizeof(bits));
+    snapshot_put_u32(ptr, bits);
+}
+
+
+/**
+ * @brief Read a 32 bits field, and move read pointer forward
+ */
+static inline uint32_t snapshot_get_u32(const uint8_t **ptr)
+{
+    int i;
+    uint32_t value = 0;
+
+    for (i = 0; i < SNAPSHOT_32; i++)
+        value |= (uint32_t)(*ptr)[i] << (8 * i);
+    *ptr += SNAPSHOT_32;
+
+    return value;
+}
+
+
+/**
+ * @brief Read a 64 bits field, and move read pointer forward
+ */
+static inline uint64_t snapshot_get_u64(const uint8_t **ptr)
+{
+    int i;
+    uint64_t value = 0;
+
+    for (i = 0; i < SNAPSHOT_64; i++)
+        value |= (uint64_t)(*ptr)[i] << (8 * i);
+    *ptr += SNAPSHOT_64;
+
+    return value;
+}
+
+
+static inline int32_t snapshot_get_i32(const uint8_t **ptr)
+{
+    return (int32_t)snapshot_get_u32(ptr);
+}
+
+
+static inline int64_t snapshot_get_i64(const uint8_t **ptr)
+{
+    return (int64_t)snapshot_get_u64(ptr);
+}
+
+
+static inline float snapshot_get_float(const uint8_t **ptr)
+{
+    float value;
+    uint32_t bits = snapshot_get_u32(ptr);
+
+    memcpy(&value, &bits, sizeof(value));
+
+    return value;
+}
+
+
+#endif /* _SNAPSHOT_H_ */
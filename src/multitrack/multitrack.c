@@ -0,0 +1,740 @@
+/***************************************************************************************************
+ * @file multitrack.c
+ *
+ * @brief Multi-track rendering module (sources)
+ *
+ * @licence MIT License
+ *
+ * Copyright (c) 2019 Jeremie Leclere
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy of this software and
+ * associated documentation files (the "Software"), to deal in the Software without restriction,
+ * including without limitation the rights to use, copy, modify, merge, publish, distribute,
+ * sublicense, and/or sell copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all copies or
+ * substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR IMPLIED, INCLUDING BUT
+ * NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND
+ * NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM,
+ * DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ **************************************************************************************************/
+
+#include <math.h>
+#include <stdlib.h>
+#include <string.h>
+#include <pthread.h>
+
+#include <log.h>
+#include <multitrack.h>
+#include <sequencer.h>
+
+/* Runtime dispatched SIMD kernels (x86 only) */
+#if defined(__x86_64__) && defined(__GNUC__)
+#include <immintrin.h>
+#define MULTITRACK_SIMD
+#endif
+
+#define PERIOD_SIZE         (8192)                  ///< Number of samples per rendered period
+#define NB_PERIODS          (2)                     ///< Number of buffered periods per track
+#define MAX_CHANNELS        (2)                     ///< Maximal number of output channels
+#define QS823_MIN           (-8388608.0f)           ///< QS8.23 full scale (lowest value)
+#define QS823_MAX           (8388607.0f)            ///< QS8.23 full scale (highest value)
+
+/* Mix bus kernels prototypes: frames [start, nb_frames[ */
+typedef void (*multitrack_add_kernel)(const int32_t *in, float gain, int start, int nb_frames,
+                                      float *bus);
+typedef void (*multitrack_add_float_kernel)(const float *in, float gain, int start,
+                                            int nb_frames, float *bus);
+typedef void (*multitrack_out_kernel)(float *const *bus, int nb_channels, int start,
+                                      int nb_frames, int32_t *out);
+typedef void (*multitrack_out_float_kernel)(float *const *bus, int nb_channels, int start,
+                                            int nb_frames, float *out);
+
+
+struct multitrack;
+
+struct track {
+    struct multitrack *parent;                      ///< Multi-track handle
+    const struct seq *sequence;                     ///< Track sequence
+    struct sequencer *sequencer;                    ///< Track sequencer
+    float gain[MAX_CHANNELS];                       ///< Per channel mix bus gain (linear)
+    void *buffers[NB_PERIODS];                      ///< Rendered periods (int32_t or float)
+    int nb_frames[NB_PERIODS];                      ///< Number of rendered samples per period
+    int64_t period;                                 ///< Last rendered period (-1 if none)
+    int ret;                                        ///< Rendering status (0 > errno on failure)
+    struct stats stats;                             ///< Track processing statistics
+    pthread_t thread;                               ///< Worker thread
+};
+
+
+struct multitrack {
+    float fs;                                       ///< Sampling frequency
+    int float_path;                                 ///< Floating point signal path
+    int nb_channels;                                ///< Number of output channels
+    int nb_tracks;                                  ///< Number of tracks
+    struct track tracks[MULTITRACK_MAX_TRACKS];     ///< Tracks
+
+    /* Mix bus */
+    float *bus[MAX_CHANNELS];                       ///< Per channel mix bus
+    void *output;                                   ///< Interleaved output (int32_t or float)
+    multitrack_add_kernel add;                      ///< Track accumulation kernel (fixed point)
+    multitrack_add_float_kernel add_fl;             ///< Track accumulation kernel (floating point)
+    multitrack_out_kernel out;                      ///< Saturation kernel (fixed point)
+    multitrack_out_float_kernel out_fl;             ///< Saturation kernel (floating point)
+
+    /* Workers synchronization */
+    pthread_mutex_t lock;                           ///< Protects periods and stop flag
+    pthread_cond_t work;                            ///< Signaled on period request / stop
+    pthread_cond_t done;                            ///< Signaled on period completion
+    int64_t period;                                 ///< Last requested period
+    int stop;                                       ///< Workers stop request
+};
+
+
+/* Track accumulation kernel, portable version (fixed point tracks) */
+static void multitrack_add_scalar(const int32_t *in, float gain, int start, int nb_frames,
+                                  float *bus)
+{
+    int i;
+
+    for (i = start; i < nb_frames; i++)
+        bus[i] += gain * (float)in[i];
+}
+
+
+/* Track accumulation kernel, portable version (floating point tracks) */
+static void multitrack_add_float_scalar(const float *in, float gain, int start, int nb_frames,
+                                        float *bus)
+{
+    int i;
+
+    for (i = start; i < nb_frames; i++)
+        bus[i] += gain * in[i];
+}
+
+
+/* Saturation kernel, portable version (fixed point output): QS8.23 full scale saturation, QS.31
+ * conversion and channels interleaving
+ */
+static void multitrack_out_scalar(float *const *bus, int nb_channels, int start, int nb_frames,
+                                  int32_t *out)
+{
+    int i, c;
+    float v;
+
+    for (i = start; i < nb_frames; i++) {
+        for (c = 0; c < nb_channels; c++) {
+            v = bus[c][i];
+            v = (v < QS823_MIN) ? QS823_MIN : ((v > QS823_MAX) ? QS823_MAX : v);
+            out[i * nb_channels + c] = (int32_t)lrintf(v) << 8;
+        }
+    }
+}
+
+
+/* Saturation kernel, portable version (floating point output): [-1, 1] saturation and channels
+ * interleaving
+ */
+static void multitrack_out_float_scalar(float *const *bus, int nb_channels, int start,
+                                        int nb_frames, float *out)
+{
+    int i, c;
+    float v;
+
+    for (i = start; i < nb_frames; i++) {
+        for (c = 0; c < nb_channels; c++) {
+            v = bus[c][i];
+            out[i * nb_channels + c] = (v < -1.0f) ? -1.0f : ((v > 1.0f) ? 1.0f : v);
+        }
+    }
+}
+
+
+#if defined(MULTITRACK_SIMD)
+
+/* Track accumulation kernel, SSE2 version (4 frames per iteration, fixed point tracks) */
+static void multitrack_add_sse2(const int32_t *in, float gain, int start, int nb_frames,
+                                float *bus)
+{
+    int i;
+    __m128 x;
+    const __m128 g = _mm_set1_ps(gain);
+
+    for (i = start; i + 4 <= nb_frames; i += 4) {
+        x = _mm_cvtepi32_ps(_mm_loadu_si128((const __m128i *)&in[i]));
+        _mm_storeu_ps(&bus[i], _mm_add_ps(_mm_loadu_ps(&bus[i]), _mm_mul_ps(g, x)));
+    }
+
+    multitrack_add_scalar(in, gain, i, nb_frames, bus);
+}
+
+
+/* Track accumulation kernel, SSE2 version (4 frames per iteration, floating point tracks) */
+static void multitrack_add_float_sse2(const float *in, float gain, int start, int nb_frames,
+                                      float *bus)
+{
+    int i;
+    const __m128 g = _mm_set1_ps(gain);
+
+    for (i = start; i + 4 <= nb_frames; i += 4)
+        _mm_storeu_ps(&bus[i], _mm_add_ps(_mm_loadu_ps(&bus[i]),
+                                          _mm_mul_ps(g, _mm_loadu_ps(&in[i]))));
+
+    multitrack_add_float_scalar(in, gain, i, nb_frames, bus);
+}
+
+
+/* Saturation kernel, SSE2 version (4 frames per iteration, fixed point output)
+ *
+ *  Conversion rounds to nearest, as lrintf does under the default rounding mode.
+ */
+static void multitrack_out_sse2(float *const *bus, int nb_channels, int start, int nb_frames,
+                                int32_t *out)
+{
+    int i = start;
+    __m128i l, r;
+    const __m128 lo = _mm_set1_ps(QS823_MIN);
+    const __m128 hi = _mm_set1_ps(QS823_MAX);
+
+#define SAT_QS31(x) _mm_slli_epi32(_mm_cvtps_epi32(_mm_min_ps(_mm_max_ps((x), lo), hi)), 8)
+
+    if (nb_channels == 1) {
+        for (; i + 4 <= nb_frames; i += 4)
+            _mm_storeu_si128((__m128i *)&out[i], SAT_QS31(_mm_loadu_ps(&bus[0][i])));
+    } else if (nb_channels == 2) {
+        for (; i + 4 <= nb_frames; i += 4) {
+            l = SAT_QS31(_mm_loadu_ps(&bus[0][i]));
+            r = SAT_QS31(_mm_loadu_ps(&bus[1][i]));
+            _mm_storeu_si128((__m128i *)&out[2 * i], _mm_unpacklo_epi32(l, r));
+            _mm_storeu_si128((__m128i *)&out[2 * i + 4], _mm_unpackhi_epi32(l, r));
+        }
+    }
+
+#undef SAT_QS31
+
+    multitrack_out_scalar(bus, nb_channels, i, nb_frames, out);
+}
+
+
+/* Saturation kernel, SSE2 version (4 frames per iteration, floating point output) */
+static void multitrack_out_float_sse2(float *const *bus, int nb_channels, int start,
+                                      int nb_frames, float *out)
+{
+    int i = start;
+    __m128 l, r;
+    const __m128 lo = _mm_set1_ps(-1.0f);
+    const __m128 hi = _mm_set1_ps(1.0f);
+
+    if (nb_channels == 1) {
+        for (; i + 4 <= nb_frames; i += 4)
+            _mm_storeu_ps(&out[i], _mm_min_ps(_mm_max_ps(_mm_loadu_ps(&bus[0][i]), lo), hi));
+    } else if (nb_channels == 2) {
+        for (; i + 4 <= nb_frames; i += 4) {
+            l = _mm_min_ps(_mm_max_ps(_mm_loadu_ps(&bus[0][i]), lo), hi);
+            r = _mm_min_ps(_mm_max_ps(_mm_loadu_ps(&bus[1][i]), lo), hi);
+            _mm_storeu_ps(&out[2 * i], _mm_unpacklo_ps(l, r));
+            _mm_storeu_ps(&out[2 * i + 4], _mm_unpackhi_ps(l, r));
+        }
+    }
+
+    multitrack_out_float_scalar(bus, nb_channels, i, nb_frames, out);
+}
+
+
+/* Track accumulation kernel, AVX2 version (8 frames per iteration, fixed point tracks) */
+__attribute__((target("avx2")))
+static void multitrack_add_avx2(const int32_t *in, float gain, int start, int nb_frames,
+                                float *bus)
+{
+    int i;
+    __m256 x;
+    const __m256 g = _mm256_set1_ps(gain);
+
+    for (i = start; i + 8 <= nb_frames; i += 8) {
+        x = _mm256_cvtepi32_ps(_mm256_loadu_si256((const __m256i *)&in[i]));
+        _mm256_storeu_ps(&bus[i], _mm256_add_ps(_mm256_loadu_ps(&bus[i]), _mm256_mul_ps(g, x)));
+    }
+
+    multitrack_add_scalar(in, gain, i, nb_frames, bus);
+}
+
+
+/* Track accumulation kernel, AVX2 version (8 frames per iteration, floating point tracks) */
+__attribute__((target("avx2")))
+static void multitrack_add_float_avx2(const float *in, float gain, int start, int nb_frames,
+                                      float *bus)
+{
+    int i;
+    const __m256 g = _mm256_set1_ps(gain);
+
+    for (i = start; i + 8 <= nb_frames; i += 8)
+        _mm256_storeu_ps(&bus[i], _mm256_add_ps(_mm256_loadu_ps(&bus[i]),
+                                                _mm256_mul_ps(g, _mm256_loadu_ps(&in[i]))));
+
+    multitrack_add_float_scalar(in, gain, i, nb_frames, bus);
+}
+
+
+/* Saturation kernel, AVX2 version (8 frames per iteration, fixed point output)
+ *
+ *  Stereo unpacking works within 128 bits lanes: lanes are then swapped back in frames order.
+ */
+__attribute__((target("avx2")))
+static void multitrack_out_avx2(float *const *bus, int nb_channels, int start, int nb_frames,
+                                int32_t *out)
+{
+    int i = start;
+    __m256i l, r, lo_lr, hi_lr;
+    const __m256 lo = _mm256_set1_ps(QS823_MIN);
+    const __m256 hi = _mm256_set1_ps(QS823_MAX);
+
+#define SAT_QS31(x) _mm256_slli_epi32(_mm256_cvtps_epi32(_mm256_min_ps(_mm256_max_ps((x), lo), \
+                                                                       hi)), 8)
+
+    if (nb_channels == 1) {
+        for (; i + 8 <= nb_frames; i += 8)
+            _mm256_storeu_si256((__m256i *)&out[i], SAT_QS31(_mm256_loadu_ps(&bus[0][i])));
+    } else if (nb_channels == 2) {
+        for (; i + 8 <= nb_frames; i += 8) {
+            l     = SAT_QS31(_mm256_loadu_ps(&bus[0][i]));
+            r     = SAT_QS31(_mm256_loadu_ps(&bus[1][i]));
+            lo_lr = _mm256_unpacklo_epi32(l, r);
+            hi_lr = _mm256_unpackhi_epi32(l, r);
+            _mm256_storeu_si256((__m256i *)&out[2 * i],
+                                _mm256_permute2x128_si256(lo_lr, hi_lr, 0x20));
+            _mm256_storeu_si256((__m256i *)&out[2 * i + 8],
+                                _mm256_permute2x128_si256(lo_lr, hi_lr, 0x31));
+        }
+    }
+
+#undef SAT_QS31
+
+    multitrack_out_scalar(bus, nb_channels, i, nb_frames, out);
+}
+
+
+/* Saturation kernel, AVX2 version (8 frames per iteration, floating point output) */
+__attribute__((target("avx2")))
+static void multitrack_out_float_avx2(float *const *bus, int nb_channels, int start,
+                                      int nb_frames, float *out)
+{
+    int i = start;
+    __m256 l, r, lo_lr, hi_lr;
+    const __m256 lo = _mm256_set1_ps(-1.0f);
+    const __m256 hi = _mm256_set1_ps(1.0f);
+
+    if (nb_channels == 1) {
+        for (; i + 8 <= nb_frames; i += 8)
+            _mm256_storeu_ps(&out[i],
+                             _mm256_min_ps(_mm256_max_ps(_mm256_loadu_ps(&bus[0][i]), lo), hi));
+    } else if (nb_channels == 2) {
+        for (; i + 8 <= nb_frames; i += 8) {
+            l     = _mm256_min_ps(_mm256_max_ps(_mm256_loadu_ps(&bus[0][i]), lo), hi);
+            r     = _mm256_min_ps(_mm256_max_ps(_mm256_loadu_ps(&bus[1][i]), lo), hi);
+            lo_lr = _mm256_unpacklo_ps(l, r);
+            hi_lr = _mm256_unpackhi_ps(l, r);
+            _mm256_storeu_ps(&out[2 * i], _mm256_permute2f128_ps(lo_lr, hi_lr, 0x20));
+            _mm256_storeu_ps(&out[2 * i + 8], _mm256_permute2f128_ps(lo_lr, hi_lr, 0x31));
+        }
+    }
+
+    multitrack_out_float_scalar(bus, nb_channels, i, nb_frames, out);
+}
+
+#endif /* MULTITRACK_SIMD */
+
+
+/* Select best kernels supported by running CPU */
+static void multitrack_select_kernels(struct multitrack *handle)
+{
+    handle->add    = multitrack_add_scalar;
+    handle->add_fl = multitrack_add_float_scalar;
+    handle->out    = multitrack_out_scalar;
+    handle->out_fl = multitrack_out_float_scalar;
+
+#if defined(MULTITRACK_SIMD)
+    __builtin_cpu_init();
+    if (__builtin_cpu_supports("avx2")) {
+        handle->add    = multitrack_add_avx2;
+        handle->add_fl = multitrack_add_float_avx2;
+        handle->out    = multitrack_out_avx2;
+        handle->out_fl = multitrack_out_float_avx2;
+    } else {
+        handle->add    = multitrack_add_sse2;
+        handle->add_fl = multitrack_add_float_sse2;
+        handle->out    = multitrack_out_sse2;
+        handle->out_fl = multitrack_out_float_sse2;
+    }
+#endif
+}
+
+
+/* Per channel track gains: dB gain, and constant power pan law (-3 dB per channel once
+ * centered) on stereo output
+ */
+static void multitrack_set_gains(struct track *track, const struct cfg *config, int nb_channels)
+{
+    float gain  = powf(10.0f, config->track_gain / 20.0f);
+    float theta = (config->track_pan + 1.0f) * (float)M_PI / 4.0f;
+
+    if (nb_channels == 1) {
+        track->gain[0] = gain;
+    } else {
+        track->gain[0] = gain * cosf(theta);
+        track->gain[1] = gain * sinf(theta);
+    }
+}
+
+
+/* Worker thread: Renders the requested periods of a track, one at a time */
+static void *multitrack_worker(void *arg)
+{
+    int ret;
+    int64_t period;
+    struct track *track = (struct track *)arg;
+    struct multitrack *handle = track->parent;
+
+    pthread_mutex_lock(&handle->lock);
+
+    for (;;) {
+        while ((!handle->stop) && (track->period == handle->period))
+            pthread_cond_wait(&handle->work, &handle->lock);
+        if (handle->stop)
+            break;
+
+        period = track->period + 1;
+        pthread_mutex_unlock(&handle->lock);
+
+        ret = sequencer_render(track->sequencer, PERIOD_SIZE, track->buffers[period % NB_PERIODS]);
+
+        pthread_mutex_lock(&handle->lock);
+        track->nb_frames[period % NB_PERIODS] = (ret > 0) ? ret : 0;
+        if ((ret < 0) && (!track->ret))
+            track->ret = ret;
+        track->period = period;
+        pthread_cond_signal(&handle->done);
+    }
+
+    pthread_mutex_unlock(&handle->lock);
+
+    return NULL;
+}
+
+
+/* Request workers to render given period */
+static void multitrack_request(struct multitrack *handle, int64_t period)
+{
+    pthread_mutex_lock(&handle->lock);
+    handle->period = period;
+    pthread_cond_broadcast(&handle->work);
+    pthread_mutex_unlock(&handle->lock);
+}
+
+
+/* Wait for every worker to be done with given period, and return first rendering failure */
+static int multitrack_wait(struct multitrack *handle, int64_t period)
+{
+    int t, ret = 0;
+
+    pthread_mutex_lock(&handle->lock);
+    for (t = 0; t < handle->nb_tracks; t++) {
+        while (handle->tracks[t].period < period)
+            pthread_cond_wait(&handle->done, &handle->lock);
+        if ((!ret) && (handle->tracks[t].ret))
+            ret = handle->tracks[t].ret;
+    }
+    pthread_mutex_unlock(&handle->lock);
+
+    return ret;
+}
+
+
+/* Mix a rendered period of every track on the bus, saturate it and write it */
+static int multitrack_mix_period(struct multitrack *handle, int64_t period, int nb_frames,
+                                 struct wav_writer *wav, struct stats *stats)
+{
+    int t, c, n, ret;
+    struct track *track;
+    uint64_t timestamp = 0;
+
+    STATS_START(stats, timestamp);
+    for (c = 0; c < handle->nb_channels; c++)
+        memset(handle->bus[c], 0, nb_frames * sizeof(float));
+
+    for (t = 0; t < handle->nb_tracks; t++) {
+        track = &handle->tracks[t];
+        n     = track->nb_frames[period % NB_PERIODS];
+        for (c = 0; c < handle->nb_channels; c++) {
+            if (handle->float_path)
+                handle->add_fl((const float *)track->buffers[period % NB_PERIODS],
+                               track->gain[c], 0, n, handle->bus[c]);
+            else
+                handle->add((const int32_t *)track->buffers[period % NB_PERIODS],
+                            track->gain[c], 0, n, handle->bus[c]);
+        }
+    }
+
+    if (handle->float_path)
+        handle->out_fl(handle->bus, handle->nb_channels, 0, nb_frames, (float *)handle->output);
+    else
+        handle->out(handle->bus, handle->nb_channels, 0, nb_frames, (int32_t *)handle->output);
+    STATS_STOP(stats, STATS_MIX, timestamp);
+
+    STATS_START(stats, timestamp);
+    ret = wav_writer_write(wav, handle->output, nb_frames);
+    if (ret >= 0)
+        ret = 0;
+    STATS_STOP(stats, STATS_WRITE, timestamp);
+
+    if (stats)
+        stats->nb_samples += nb_frames;
+
+    return ret;
+}
+
+
+struct multitrack *multitrack_create(const struct multitrack_params *params)
+{
+    int i, t;
+    size_t sample_size;
+    struct track *track;
+    const struct cfg *config;
+    struct multitrack *handle = NULL;
+
+    if ((!params)
+    ||  (params->nb_tracks < 1)
+    ||  (params->nb_tracks > MULTITRACK_MAX_TRACKS))
+        goto failure;
+
+    handle = (struct multitrack *)calloc(1, sizeof(struct multitrack));
+    if (!handle)
+        goto failure;
+
+    pthread_mutex_init(&handle->lock, NULL);
+    pthread_cond_init(&handle->work, NULL);
+    pthread_cond_init(&handle->done, NULL);
+
+    config              = params->tracks[0].config;
+    handle->fs          = config->m_params.fs;
+    handle->float_path  = (config->m_params.sample_format == MOOG_SAMPLE_FORMAT_FLOAT);
+    handle->nb_channels = 1;
+    handle->nb_tracks   = params->nb_tracks;
+    sample_size         = handle->float_path ? sizeof(float) : sizeof(int32_t);
+
+    for (t = 0; t < params->nb_tracks; t++) {
+        config = params->tracks[t].config;
+        if ((!config) || (!params->tracks[t].sequence)) {
+            LOGE("Missing track %d configuration or sequence", t);
+            goto failure;
+        }
+        if ((config->m_params.fs != handle->fs)
+        ||  ((config->m_params.sample_format == MOOG_SAMPLE_FORMAT_FLOAT) != handle->float_path)) {
+            LOGE("Track %d sampling frequency or sample format differs from first track's", t);
+            goto failure;
+        }
+        if (config->track_pan != 0)
+            handle->nb_channels = MAX_CHANNELS;
+    }
+
+    for (t = 0; t < handle->nb_tracks; t++) {
+        track           = &handle->tracks[t];
+        track->parent   = handle;
+        track->sequence = params->tracks[t].sequence;
+        multitrack_set_gains(track, params->tracks[t].config, handle->nb_channels);
+
+        track->sequencer = sequencer_create(params->tracks[t].config);
+        if (!track->sequencer) {
+            LOGE("Failed to initialize track %d sequencer !", t);
+            goto failure;
+        }
+
+        for (i = 0; i < NB_PERIODS; i++) {
+            track->buffers[i] = calloc(PERIOD_SIZE, sample_size);
+            if (!track->buffers[i]) {
+                LOGE("Track buffer allocation failure");
+                goto failure;
+            }
+        }
+    }
+
+    /* Mix bus */
+    for (i = 0; i < handle->nb_channels; i++) {
+        handle->bus[i] = (float *)calloc(PERIOD_SIZE, sizeof(float));
+        if (!handle->bus[i]) {
+            LOGE("Mix bus allocation failure");
+            goto failure;
+        }
+    }
+
+    handle->output = calloc(PERIOD_SIZE * handle->nb_channels, sample_size);
+    if (!handle->output) {
+        LOGE("Output buffer allocation failure");
+        goto failure;
+    }
+
+    multitrack_select_kernels(handle);
+
+    return handle;
+
+failure:
+
+    multitrack_destroy(&handle);
+
+    return NULL;
+}
+
+
+void multitrack_destroy(struct multitrack **handle)
+{
+    int i, t;
+
+    if ((!handle) || (!(*handle)))
+        goto exit;
+
+    for (t = 0; t < MULTITRACK_MAX_TRACKS; t++) {
+        sequencer_destroy(&(*handle)->tracks[t].sequencer);
+        for (i = 0; i < NB_PERIODS; i++) {
+            if ((*handle)->tracks[t].buffers[i])
+                free((*handle)->tracks[t].buffers[i]);
+        }
+    }
+
+    for (i = 0; i < MAX_CHANNELS; i++) {
+        if ((*handle)->bus[i])
+            free((*handle)->bus[i]);
+    }
+
+    if ((*handle)->output)
+        free((*handle)->output);
+
+    pthread_cond_destroy(&(*handle)->done);
+    pthread_cond_destroy(&(*handle)->work);
+    pthread_mutex_destroy(&(*handle)->lock);
+
+    free(*handle);
+    *handle = NULL;
+
+exit:
+
+    return;
+}
+
+
+int multitrack_get_nb_channels(struct multitrack *handle, int *nb_channels)
+{
+    int ret = 0;
+
+    if ((!handle)
+    ||  (!nb_channels)) {
+        ret = -EINVAL;
+        goto exit;
+    }
+
+    *nb_channels = handle->nb_channels;
+
+exit:
+
+    return ret;
+}
+
+
+int multitrack_run(struct multitrack *handle, int nb_prefill, int nb_postfill,
+                   struct wav_writer *wav, struct stats *stats)
+{
+    int t, i, ret = 0;
+    int nb_started = 0;
+    int64_t period;
+    int nb_frames;
+    struct track *track;
+
+    if ((!handle)
+    ||  (!wav)) {
+        ret = -EINVAL;
+        goto exit;
+    }
+
+    if (stats)
+        stats->fs = handle->fs;
+
+    for (t = 0; t < handle->nb_tracks; t++) {
+        track = &handle->tracks[t];
+        memset(&track->stats, 0, sizeof(struct stats));
+        track->period = -1;
+        track->ret    = 0;
+
+        ret = sequencer_start(track->sequencer, track->sequence, nb_prefill, nb_postfill,
+                              stats ? &track->stats : NULL);
+        if (ret)
+            goto exit;
+    }
+
+    /* Workers start on first period straight away */
+    handle->period = 0;
+    handle->stop   = 0;
+    for (t = 0; t < handle->nb_tracks; t++) {
+        ret = -pthread_create(&handle->tracks[t].thread, NULL, multitrack_worker,
+                              &handle->tracks[t]);
+        if (ret) {
+            LOGE("Failed to start track %d worker thread", t);
+            goto exit;
+        }
+        nb_started++;
+    }
+
+    /* Main loop: While workers render next period, current one is mixed and written */
+    for (period = 0; ; period++) {
+
+        ret = multitrack_wait(handle, period);
+        if (ret) {
+            LOGE("Track rendering failure");
+            goto exit;
+        }
+
+        nb_frames = 0;
+        for (t = 0; t < handle->nb_tracks; t++) {
+            if (handle->tracks[t].nb_frames[period % NB_PERIODS] > nb_frames)
+                nb_frames = handle->tracks[t].nb_frames[period % NB_PERIODS];
+        }
+
+        /* Every track is over once none of them fills a whole period */
+        if (nb_frames == PERIOD_SIZE)
+            multitrack_request(handle, period + 1);
+
+        ret = multitrack_mix_period(handle, period, nb_frames, wav, stats);
+        if (ret)
+            goto exit;
+
+        if (nb_frames < PERIOD_SIZE)
+            break;
+    }
+
+exit:
+
+    if (handle) {
+        pthread_mutex_lock(&handle->lock);
+        handle->stop = 1;
+        pthread_cond_broadcast(&handle->work);
+        pthread_mutex_unlock(&handle->lock);
+
+        for (t = 0; t < nb_started; t++)
+            pthread_join(handle->tracks[t].thread, NULL);
+
+        /* Tracks stages (worker threads CPU time) are summed up apart from elapsed time: every
+         * mixed sample is rendered by worker threads
+         */
+        if (stats) {
+            stats->nb_workers        = handle->nb_tracks;
+            stats->nb_worker_samples = stats->nb_samples;
+            for (t = 0; t < handle->nb_tracks; t++) {
+                for (i = 0; i < STATS_NB_STAGES; i++)
+                    stats->workers[i] += handle->tracks[t].stats.elapsed[i];
+            }
+        }
+    }
+
+    return ret;
+}
@@ -0,0 +1,125 @@
+/***************************************************************************************************
+ * @file multitrack.h
+ *
+ * @brief Multi-track rendering module (headers)
+ *
+ * @licence MIT License
+ *
+ * Copyright (c) 2019 Jeremie Leclere
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy of this software and
+ * associated documentation files (the "Software"), to deal in the Software without restriction,
+ * including without limitation the rights to use, copy, modify, merge, publish, distribute,
+ * sublicense, and/or sell copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all copies or
+ * substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR IMPLIED, INCLUDING BUT
+ * NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND
+ * NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM,
+ * DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ **************************************************************************************************/
+
+#ifndef _MULTITRACK_H_
+#define _MULTITRACK_H_
+
+
+#include <errno.h>
+
+#include <stats.h>
+#include <cfg_parser.h>
+#include <seq_parser.h>
+#include <wav_writer.h>
+
+
+/**
+ * @brief Maximal number of tracks
+ */
+#define MULTITRACK_MAX_TRACKS   (16)
+
+
+/**
+ * @brief Opaque module handle
+ */
+struct multitrack;
+
+
+/**
+ * @brief Track description
+ */
+struct multitrack_track {
+    const struct cfg *config;                   ///< Track configuration (Moog parameters, tempo,
+                                                ///< mix bus gain and pan)
+    const struct seq *sequence;                 ///< Track sequence
+};
+
+
+/**
+ * @brief Initialization parameters
+ */
+struct multitrack_params {
+    int nb_tracks;                              ///< Number of tracks ([1, MULTITRACK_MAX_TRACKS])
+    struct multitrack_track tracks[MULTITRACK_MAX_TRACKS]; ///< Tracks
+};
+
+
+/**
+ * @brief Initialize multi-track module
+ *
+ *  Every track gets its own sequencer (and Moog voices). Tracks must share their sampling
+ * frequency and sample format, tempo and every other parameter being per track. Configurations
+ * and sequences must remain valid until the module is destroyed.
+ *
+ * @param[in] params        : Initialization parameters
+ *
+ * @return Module handle if successful, NULL else
+ */
+struct multitrack *multitrack_create(const struct multitrack_params *params);
+
+
+/**
+ * @brief Release module ressources
+ *
+ * @param[in] handle        : Module handle
+ *
+ * @return None
+ */
+void multitrack_destroy(struct multitrack **handle);
+
+
+/**
+ * @brief Get number of mix bus output channels
+ *  Output is stereo as soon as a track is panned, mono else.
+ *
+ * @param[in]  handle       : Module handle
+ * @param[out] nb_channels  : Number of output channels
+ *
+ * @return 0 if successful, 0 > errno else
+ */
+int multitrack_get_nb_channels(struct multitrack *handle, int *nb_channels);
+
+
+/**
+ * @brief Render every track, and write their mix to provided WAV writer
+ *
+ *  Tracks are rendered in parallel (one worker thread per track), while the previous period is
+ * mixed and written. The mix bus applies track gain and pan (constant power law), and saturates
+ * the sum to the output full scale. Mix lasts as long as the longest track.
+ *
+ * @param[in] handle        : Module handle
+ * @param[in] nb_prefill    : Number of silent sixteenth notes inserted before every sequence
+ * @param[in] nb_postfill   : Number of sixteenth notes rendered after every sequence (note OFF)
+ * @param[in] wav           : Output WAV writer (multitrack_get_nb_channels channels)
+ * @param[out] stats        : Processing statistics (can be NULL, not measured if so). Tracks
+ *                            stages are reported apart (CPU time summed over threads).
+ *
+ * @return 0 if successful, 0 > errno else
+ */
+int multitrack_run(struct multitrack *handle, int nb_prefill, int nb_postfill,
+                   struct wav_writer *wav, struct stats *stats);
+
+
+#endif /* _MULTITRACK_H_ */
@@ -37,9 +37,9 @@
  * overriden in provided user configuration.
  */
 #define DFT_BPM             (94)
-#define SIXTEENTH           (0.25)
-#define DFT_FRAME_SIZE      ((int)(60 * DFT_FS * SIXTEENTH / DFT_BPM))
 #define DFT_FS              (48000)
+#define DFT_BLOCK_SIZE      (MOOG_DFT_BLOCK_SIZE)
+#define DFT_SAMPLE_FORMAT   (MOOG_SAMPLE_FORMAT_FIXED)
 #define DFT_LP_Q            (1.5)
 #define DFT_LP_FC           (400.0)
 #define DFT_LP_GAIN         (1.0)
@@ -50,12 +50,18 @@
 #define DFT_OSC_MODE        (WAVE_MODE_SAW)
 #define DFT_OSC_COUPLING    (MOOG_OSC_COUPLING_FIFTH)
 #define DFT_INTENSITY       (0.6)
+#define DFT_NB_VOICES       (1)
+#define DFT_VOICE_STEAL     (VOICE_POOL_STEAL_OLDEST)
+#define DFT_TRACK_GAIN      (0.0)
+#define DFT_TRACK_PAN       (0.0)
 
 
-#define NB_FIELDS   (12)
+#define NB_FIELDS   (18)
 static char *config_fields[NB_FIELDS] = {
     "tempo",            ///< Sequence tempo (bpm, int in [1..])
     "fs",               ///< Sampling frequency (Hz, float in [1..)
+    "block_size",       ///< Internal processing block size (samples, int in [16..4096])
+    "sample_format",    ///< Signal path sample format (const char in ['fixed', 'float'])
     "lp_fc",            ///< Moog low pass cutoff frequency (Hz, float in [1..fs/2[)
     "lp_Q",             ///< Moog low pass Q factor (float in ]0..])
     "lp_gain",          ///< Moog low pass gain (dB, float)
@@ -63,9 +69,13 @@ static char *config_fields[NB_FIELDS] = {
     "decay_time",       ///< Moog ADSR decay time (ms, int in [1..])
     "sustain",          ///< Moog ADSR sustain factor (float in ]0..1])
     "release_time",     ///< Moog ADSR release time (ms, int in [1..])
-    "waveform",         ///< Moog generators waveform (const char in ['saw', 'sine', 'square'])
+    "waveform",         ///< Moog generators waveform (const char in ['saw', 'sine', 'square', 'saw_bl', 'square_bl'])
     "coupling",         ///< Moog generators coupling (const char in ['none', 'third_minor', 'third_major', 'fifth', 'otcave'])
-    "intensity"         ///< Moog output intensity (float in ]0, 1])
+    "intensity",        ///< Moog output intensity (float in ]0, 1])
+    "voices",           ///< Number of Moog voices (int in [1..256])
+    "voice_steal",      ///< Voice stealing policy (const char in ['oldest', 'quietest'])
+    "track_gain",       ///< Track gain on multi-track mix bus (dB, float)
+    "track_pan"         ///< Track pan on multi-track mix bus (float in [-1, 1], -1: left)
 };
 
 
@@ -110,6 +120,26 @@ static int fill_config_element(const char *key, const char *value, struct cfg *c
             goto exit;
         }
         configuration->m_params.fs = fvalue;
+    } else if (strcmp(key, "block_size") == 0) {
+        ivalue = atoi(value);
+        if ((ivalue < MOOG_MIN_BLOCK_SIZE) || (ivalue > MOOG_MAX_BLOCK_SIZE)) {
+            LOGE("%s: %s must be in [%d, %d] (%d provided)", __func__, key,
+                 MOOG_MIN_BLOCK_SIZE, MOOG_MAX_BLOCK_SIZE, ivalue);
+            ret = -EINVAL;
+            goto exit;
+        }
+        configuration->m_params.block_size = ivalue;
+    } else if (strcmp(key, "sample_format") == 0) {
+        if (strcmp(value, "fixed") == 0) {
+            configuration->m_params.sample_format = MOOG_SAMPLE_FORMAT_FIXED;
+        } else if (strcmp(value, "float") == 0) {
+            configuration->m_params.sample_format = MOOG_SAMPLE_FORMAT_FLOAT;
+        } else {
+            LOGE("%s: %s must be in [\"fixed\", \"float\"] (%s provided)",
+                 __func__, key, value);
+            ret = -EINVAL;
+            goto exit;
+        }
     } else if (strcmp(key, "lp_fc") == 0) {
         fvalue = atof(value);
         if ((fvalue <= 0) || (fvalue >= (configuration->m_params.fs)/2)){
@@ -167,9 +197,13 @@ static int fill_config_element(const char *key, const char *value, struct cfg *c
             configuration->m_params.osc_mode = WAVE_MODE_SINE;
         } else if (strcmp(value, "square") == 0) {
             configuration->m_params.osc_mode = WAVE_MODE_SQUARE;
+        } else if (strcmp(value, "saw_bl") == 0) {
+            configuration->m_params.osc_mode = WAVE_MODE_SAW_BL;
+        } else if (strcmp(value, "square_bl") == 0) {
+            configuration->m_params.osc_mode = WAVE_MODE_SQUARE_BL;
         } else {
-            LOGE("%s: %s must be in [\"saw\", \"sine\", \"square\"] (%s provided)",
-                 __func__, key, value);
+            LOGE("%s: %s must be in [\"saw\", \"sine\", \"square\", \"saw_bl\", \"square_bl\"] "
+                 "(%s provided)", __func__, key, value);
         }
     } else if (strcmp(key, "coupling") == 0) {
         if (strcmp(value, "none") == 0) {
@@ -194,6 +228,36 @@ static int fill_config_element(const char *key, const char *value, struct cfg *c
             goto exit;
         }
         configuration->intensity = fvalue;
+    } else if (strcmp(key, "voices") == 0) {
+        ivalue = atoi(value);
+        if ((ivalue < 1) || (ivalue > VOICE_POOL_MAX_VOICES)) {
+            LOGE("%s: %s must be in [1, %d] (%d provided)", __func__, key,
+                 VOICE_POOL_MAX_VOICES, ivalue);
+            ret = -EINVAL;
+            goto exit;
+        }
+        configuration->nb_voices = ivalue;
+    } else if (strcmp(key, "voice_steal") == 0) {
+        if (strcmp(value, "oldest") == 0) {
+            configuration->steal = VOICE_POOL_STEAL_OLDEST;
+        } else if (strcmp(value, "quietest") == 0) {
+            configuration->steal = VOICE_POOL_STEAL_QUIETEST;
+        } else {
+            LOGE("%s: %s must be in [\"oldest\", \"quietest\"] (%s provided)",
+                 __func__, key, value);
+            ret = -EINVAL;
+            goto exit;
+        }
+    } else if (strcmp(key, "track_gain") == 0) {
+        configuration->track_gain = atof(value);
+    } else if (strcmp(key, "track_pan") == 0) {
+        fvalue = atof(value);
+        if ((fvalue < -1) || (fvalue > 1)){
+            LOGE("%s: %s must be in [-1, 1] (%f provided)", __func__, key, fvalue);
+            ret = -EINVAL;
+            goto exit;
+        }
+        configuration->track_pan = fvalue;
     }
 
 exit:
@@ -212,8 +276,14 @@ int get_default_config(struct cfg *configuration)
     }
 
     configuration->tempo                    = DFT_BPM;
+    configuration->intensity                = DFT_INTENSITY;
+    configuration->nb_voices                = DFT_NB_VOICES;
+    configuration->steal                    = DFT_VOICE_STEAL;
+    configuration->track_gain               = DFT_TRACK_GAIN;
+    configuration->track_pan                = DFT_TRACK_PAN;
     configuration->m_params.fs              = DFT_FS;
-    configuration->m_params.frame_size      = DFT_FRAME_SIZE;
+    configuration->m_params.block_size      = DFT_BLOCK_SIZE;
+    configuration->m_params.sample_format   = DFT_SAMPLE_FORMAT;
     configuration->m_params.fc              = DFT_LP_FC;
     configuration->m_params.Q               = DFT_LP_Q;
     configuration->m_params.gain            = DFT_LP_GAIN;
@@ -289,9 +359,6 @@ int parse_cfg(const char *filename, struct cfg *configuration)
         }
     };
 
-    configuration->m_params.frame_size = (int)(60 * configuration->m_params.fs
-                                               * SIXTEENTH / configuration->tempo);
-
 exit:
 
     if (line)
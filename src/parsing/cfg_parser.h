@@ -28,6 +28,7 @@
 
 #include <moog.h>
 #include <errno.h>
+#include <voice_pool.h>
 
 
 /**
@@ -36,6 +37,10 @@
 struct cfg {
     float tempo;
     float intensity;
+    int nb_voices;
+    enum voice_pool_steal steal;
+    float track_gain;
+    float track_pan;
     struct moog_params m_params;
 };
 
@@ -32,6 +32,7 @@
 #include <seq_parser.h>
 
 #define NB_LENGTHS      (5)
+#define EVENT_DELIMITERS    (" \t\r\n")      ///< Events separators
 
 static int NOTES_LENGTH[NB_LENGTHS] = {1, 2, 4, 8, 16};
 
@@ -153,6 +154,117 @@ exit:
 }
 
 
+/*
+ * Parse a note, starting at given position, and move position to the following character:
+ *
+ *      [NOTE_NAME][RANK_UPDATE]
+ */
+static int parse_note(const char *token, int *position, char *note, int *rank_update)
+{
+    int ret = 0;
+    int name_len = 0;
+    const char *c = token + *position;
+
+    /* Get note name */
+    while (isalpha(c[name_len]))
+        name_len++;
+
+    if ((name_len == 0) || (name_len > 2)) {
+        LOGE("%s: Unexpected note name !", __func__);
+        ret = -EINVAL;
+        goto exit;
+    }
+
+    memset(note, 0, 3);
+    note[0] = toupper(c[0]);
+    if (name_len == 2)
+        note[1] = tolower(c[1]);
+
+    if (check_note_name(note) == -EINVAL) {
+        LOGE("%s: Unexpected note name !", __func__);
+        ret = -EINVAL;
+        goto exit;
+    }
+    c += name_len;
+
+    /* Check for a rank update */
+    *rank_update = 0;
+    while ((*c == '\'') || (*c == ',')) {
+        if (*c == '\'')
+            (*rank_update)++;
+        else
+            (*rank_update)--;
+        c++;
+    }
+
+    *position = c - token;
+
+exit:
+
+    return ret;
+}
+
+
+/*
+ * Parse a chord, starting at given position, and move position to the following character:
+ *
+ *      <[NOTE_NAME][RANK_UPDATE] [NOTE_NAME][RANK_UPDATE] ...>
+ *
+ *  Rests are not allowed in chords.
+ */
+static int parse_chord(const char *token, int *position, struct event *event)
+{
+    int ret = 0;
+    int pos = *position + 1;
+
+    event->nb_notes = 0;
+    while (token[pos] != '>') {
+
+        if (token[pos] == '\0') {
+            LOGE("%s: Unterminated <> chord !", __func__);
+            ret = -EINVAL;
+            goto exit;
+        }
+
+        if ((token[pos] == ' ') || (token[pos] == '\t')) {
+            pos++;
+            continue;
+        }
+
+        if (event->nb_notes == SEQ_MAX_NOTES) {
+            LOGE("%s: Too many chord notes (%d max) !", __func__, SEQ_MAX_NOTES);
+            ret = -EINVAL;
+            goto exit;
+        }
+
+        ret = parse_note(token, &pos, event->note[event->nb_notes],
+                         &event->rank_update[event->nb_notes]);
+        if (ret)
+            goto exit;
+
+        if (strcmp(event->note[event->nb_notes], "R") == 0) {
+            LOGE("%s: Unexpected rest in chord !", __func__);
+            ret = -EINVAL;
+            goto exit;
+        }
+
+        event->nb_notes++;
+    }
+
+    if (event->nb_notes == 0) {
+        LOGE("%s: Empty chord !", __func__);
+        ret = -EINVAL;
+        goto exit;
+    }
+
+    *position = pos + 1;
+
+exit:
+
+    return ret;
+}
+
+
 /*
  * Event is assumed to respect the following structure:
  *
@@ -164,6 +276,12 @@ exit:
  *                    NOTES_NAMES table. This field is mandatory.
  *  . RANK_UPDATE   : Must be a ' or a , character, indicating an octave update.
  *                    This field is optional.
+ *
+ *  or, for chords, to:
+ *
+ *      <[NOTE_NAME][RANK_UPDATE] ...>[LENGTH_UPDATE][MOOG_UPDATE]
+ *
+ *  and in both cases
  *  . LENGTH_UPDATE : Must be a number in 1, 2, 4, 8, 16
  *  . MOOG_UPDATE   : Moog parameters update, parsed with parse_moog_update
  */
@@ -173,7 +291,6 @@ static int parse_event(char *token, struct event *event)
     int len_pos = 0;
     char *c = token;
     int len_len = 0;
-    int name_len = 0;
     int position = 0;
     char len[3] = {0};
     char *sub_section = NULL;
@@ -186,37 +303,16 @@ static int parse_event(char *token, struct event *event)
     event->fc_update   = LP_NO_UPDATE_VALUE;
     event->gain_update = LP_NO_UPDATE_VALUE;
 
-    /* Get note name */
-    while ((isalpha(*c)) && (position < strlen(token))) {
-        c++;
-        name_len++;
-        position ++;
-    }
-
-    if (name_len > 2) {
-        LOGE("%s: Unexpected note name !", __func__);
-        ret = -EINVAL;
-        goto exit;
+    /* Get note (or chord notes) */
+    if (token[0] == '<') {
+        ret = parse_chord(token, &position, event);
+    } else {
+        event->nb_notes = 1;
+        ret = parse_note(token, &position, event->note[0], &event->rank_update[0]);
     }
-
-    event->note[0] = toupper(token[0]);
-    if (name_len == 2)
-        event->note[1] = tolower(token[1]);
-
-    if (check_note_name(event->note) == -EINVAL) {
-        LOGE("%s: Unexpected note name !", __func__);
+    if (ret)
         goto exit;
-    }
-
-    /* Check for a rank update */
-    while (((*c == '\'') || (*c == ',')) && (position < strlen(token))) {
-        if (*c == '\'')
-            event->rank_update++;
-        else
-            event->rank_update--;
-        c++;
-        position++;
-    }
+    c = token + position;
 
     /* Check for a length update */
     len_pos = position;
@@ -290,6 +386,34 @@ exit:
 }
 
 
+/*
+ * Split line in space separated events (strtok_r like), a chord being a single event even though
+ * its notes are space separated: <c e g>4
+ */
+static char *next_event(char *line, char **ctx)
+{
+    char *start = (line) ? line : *ctx;
+    char *end;
+
+    start += strspn(start, EVENT_DELIMITERS);
+    if (*start == '\0') {
+        *ctx = start;
+        return NULL;
+    }
+
+    end = start;
+    if (*end == '<')
+        end += strcspn(end, ">");
+    end += strcspn(end, EVENT_DELIMITERS);
+
+    if (*end != '\0')
+        *end++ = '\0';
+    *ctx = end;
+
+    return start;
+}
+
+
 int parse_sequence(const char *filename, struct seq *sequence)
 {
     char *c;
@@ -324,10 +448,10 @@ int parse_sequence(const char *filename, struct seq *sequence)
             continue;
 
         /* Split line in space separated elements */
-        token = strtok_r(line, " ", &ctx);
+        token = next_event(line, &ctx);
         while (token) {
             sequence->nb_events++;
-            token = strtok_r(NULL, " ", &ctx);
+            token = next_event(NULL, &ctx);
         }
     }
     sequence->events = (struct event *)calloc(sequence->nb_events,
@@ -355,7 +479,7 @@ int parse_sequence(const char *filename, struct seq *sequence)
             continue;
 
         /* Split line in space separated elements */
-        token = strtok(line, " ");
+        token = next_event(line, &ctx);
         while (token) {
             /* Try to interpret user command */
             ret = parse_event(token, &sequence->events[event_id]);
@@ -363,7 +487,7 @@ int parse_sequence(const char *filename, struct seq *sequence)
                 LOGE("%s: Line %d, event %d: '%s'", __func__,
                      line_index + 1, event_index + 1, token);
             }
-            token = strtok(NULL, " ");
+            token = next_event(NULL, &ctx);
             event_index++;
             event_id++;
         }
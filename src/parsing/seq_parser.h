@@ -38,13 +38,21 @@
 #define LP_NO_UPDATE_VALUE     (-987341.5)
 
 
+/**
+ * @brief Maximal number of notes per event (chords)
+ */
+#define SEQ_MAX_NOTES          (8)
+
+
 /**
  * @brief Note event structure
  */
 struct event {
-    char note[3];                           ///< Note name
+    int nb_notes;                           ///< Number of notes (1, more for chords)
+    char note[SEQ_MAX_NOTES][3];            ///< Notes names (chords: in script order)
+    int rank_update[SEQ_MAX_NOTES];         ///< Notes rank update values (chords: each one
+                                            ///< relative to the previous note)
     int len_update;                         ///< Note length update value (number of sixteenth notes)
-    int rank_update;                        ///< Note rank update value
     float q_update;                         ///< Low pass Q factor update
     float fc_update;                        ///< Low pass cutoff frequency update
     float gain_update;                      ///< Low pass gain update
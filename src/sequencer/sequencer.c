@@ -0,0 +1,736 @@
+/***************************************************************************************************
+ * @file sequencer.c
+ *
+ * @brief Sequence rendering module (sources)
+ *
+ * @licence MIT License
+ *
+ * Copyright (c) 2019 Jeremie Leclere
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy of this software and
+ * associated documentation files (the "Software"), to deal in the Software without restriction,
+ * including without limitation the rights to use, copy, modify, merge, publish, distribute,
+ * sublicense, and/or sell copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all copies or
+ * substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR IMPLIED, INCLUDING BUT
+ * NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND
+ * NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM,
+ * DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ **************************************************************************************************/
+
+#include <math.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include <log.h>
+#include <notes.h>
+#include <snapshot.h>
+#include <sequencer.h>
+#include <voice_pool.h>
+
+
+#define DFT_RANK            (2)
+#define DFT_LENGTH          (4)
+#define SIXTEENTH           (0.25)
+#define RENDER_SIZE         (8192)          ///< Maximal number of samples per rendered block
+#define MAX_EVENTS          (64)            ///< Maximal number of Moog events per rendered block
+#define EVENTS_PER_STEP     (2 * SEQ_MAX_NOTES + 2) ///< Maximal number of Moog events per
+                                                    ///< sequence event
+
+/* Snapshot: pending events and held notes (unused entries zeroed, so that snapshots of the same
+ * state are identical), position and rendering state, followed by the voice pool snapshot
+ */
+#define EVENT_SIZE          (8 * SNAPSHOT_32)
+#define CONTROL_SIZE        (SNAPSHOT_32 + MAX_EVENTS * EVENT_SIZE              \
+                             + SNAPSHOT_32 + SEQ_MAX_NOTES * SNAPSHOT_32        \
+                             + 4 * SNAPSHOT_32 + 3 * SNAPSHOT_64)
+
+
+struct sequencer {
+    float fs;                               ///< Sampling frequency
+    double step_size;                       ///< Number of samples per sixteenth note (fractional)
+    struct voice_pool *voices;              ///< Moog synthesizer voices
+    int32_t *output_block;                  ///< Output block (fixed point signal path)
+    float *output_block_fl;                 ///< Output block (floating point signal path)
+
+    /* Rendered block events */
+    int nb_events;                          ///< Number of pending Moog events
+    struct moog_event events[MAX_EVENTS];   ///< Pending Moog events
+
+    /* Held notes (notes of the last played sequence event) */
+    int nb_held;                            ///< Number of held notes
+    float held[SEQ_MAX_NOTES];              ///< Held notes frequencies
+
+    /* Sequence position */
+    int rank;                               ///< Current note rank
+    int length;                             ///< Current note length (number of sixteenth notes)
+    int64_t position;                       ///< Current position (number of sixteenth notes)
+
+    /* Rendering state */
+    const struct seq *sequence;             ///< Rendered sequence
+    int next_event;                         ///< Index of next sequence event to be pushed
+    int nb_postfill;                        ///< Number of post-fill sixteenth notes
+    int64_t rendered;                       ///< Number of rendered samples
+    int64_t end;                            ///< Last sample (-1 until every event is pushed)
+};
+
+
+/* Sample index of a position on the sixteenth notes grid
+ *
+ *  Positions are converted from their exact (fractional) time, so that rounding errors never
+ * accumulate along the sequence, however long it might be.
+ */
+static int64_t sequencer_get_sample(const struct sequencer *handle, int64_t position)
+{
+    return (int64_t)llround(position * handle->step_size);
+}
+
+
+/* Queue a Moog event */
+static struct moog_event *sequencer_push_event(struct sequencer *handle, enum moog_event_type type,
+                                               int offset)
+{
+    struct moog_event *event = &handle->events[handle->nb_events++];
+
+    memset(event, 0, sizeof(struct moog_event));
+    event->type   = type;
+    event->offset = offset;
+
+    return event;
+}
+
+
+/* Check whether a note is part of a notes set */
+static int sequencer_find_note(const float *notes, int nb_notes, float frequency)
+{
+    int i;
+
+    for (i = 0; i < nb_notes; i++) {
+        if (notes[i] == frequency)
+            return 1;
+    }
+
+    return 0;
+}
+
+
+/* Release every held note */
+static void sequencer_release_all(struct sequencer *handle, int offset)
+{
+    /* Null frequency: all voices */
+    sequencer_push_event(handle, MOOG_EVENT_NOTE_OFF, offset);
+    handle->nb_held = 0;
+}
+
+
+/* Play the notes of a sequence event (single note or chord)
+ *
+ *  Previously held notes which are not part of the new event are released first, so that new
+ * notes steal their voices rather than the ones of held notes which keep on playing. A single
+ * voice still plays legato, as the historical monophonic synthesizer (see voice_pool_process).
+ */
+static int sequencer_push_notes(struct sequencer *handle, const struct event *event, int offset)
+{
+    int i, rank, ret = 0;
+    float frequencies[SEQ_MAX_NOTES];
+    struct moog_event *m_event;
+
+    /* Chord notes ranks are relative to the previous chord note, and next event rank to the
+     * chord first note
+     */
+    rank = handle->rank;
+    for (i = 0; i < event->nb_notes; i++) {
+        rank += event->rank_update[i];
+        if (i == 0)
+            handle->rank = rank;
+
+        ret = get_note(rank, event->note[i], &frequencies[i]);
+        if (ret) {
+            LOGE("Failed to get note frequency !");
+            goto exit;
+        }
+    }
+
+    for (i = 0; i < handle->nb_held; i++) {
+        if (!sequencer_find_note(frequencies, event->nb_notes, handle->held[i])) {
+            m_event = sequencer_push_event(handle, MOOG_EVENT_NOTE_OFF, offset);
+            m_event->frequency = handle->held[i];
+        }
+    }
+
+    for (i = 0; i < event->nb_notes; i++) {
+        if (!sequencer_find_note(handle->held, handle->nb_held, frequencies[i])) {
+            m_event = sequencer_push_event(handle, MOOG_EVENT_NOTE_ON, offset);
+            m_event->frequency = frequencies[i];
+        }
+    }
+
+    memcpy(handle->held, frequencies, event->nb_notes * sizeof(float));
+    handle->nb_held = event->nb_notes;
+
+exit:
+
+    return ret;
+}
+
+
+/* Convert a sequence event to Moog events, and move sequence position to next event */
+static int sequencer_push_step(struct sequencer *handle, const struct event *event, int offset)
+{
+    int ret = 0;
+    int64_t start, end;
+    struct moog_event *m_event;
+
+    /* Silence / notes update */
+    if (strcmp(event->note[0], "R") == 0) {
+        sequencer_release_all(handle, offset);
+    } else {
+        ret = sequencer_push_notes(handle, event, offset);
+        if (ret)
+            goto exit;
+    }
+
+    /* Length update */
+    if (event->len_update != 0)
+        handle->length = event->len_update;
+
+    start = sequencer_get_sample(handle, handle->position);
+    end   = sequencer_get_sample(handle, handle->position + handle->length);
+    handle->position += handle->length;
+
+    /* Low pass cutoff frequency sweep (on the whole note duration) */
+    if (event->fc_sweep != 0) {
+        m_event = sequencer_push_event(handle, MOOG_EVENT_FILTER_SWEEP, offset);
+        m_event->fc         = event->fc_sweep;
+        m_event->nb_samples = (int)(end - start);
+    }
+
+    /* Low pass filter parameters update */
+    if ((event->q_update != LP_NO_UPDATE_VALUE)
+    ||  (event->fc_update != LP_NO_UPDATE_VALUE)
+    ||  (event->gain_update != LP_NO_UPDATE_VALUE)) {
+        m_event = sequencer_push_event(handle, MOOG_EVENT_FILTER_UPDATE, offset);
+        if (event->q_update != LP_NO_UPDATE_VALUE) {
+            m_event->Q     = event->q_update;
+            m_event->mask |= MOOG_FILTER_Q;
+        }
+        if (event->fc_update != LP_NO_UPDATE_VALUE) {
+            m_event->fc    = event->fc_update;
+            m_event->mask |= MOOG_FILTER_FC;
+        }
+        if (event->gain_update != LP_NO_UPDATE_VALUE) {
+            m_event->gain  = event->gain_update;
+            m_event->mask |= MOOG_FILTER_GAIN;
+        }
+    }
+
+exit:
+
+    return ret;
+}
+
+
+/* Render a block with its pending events (only move voices forward if output is NULL)
+ *
+ *  Idle fast path: with no event and silent voices, voices are only moved forward, output is left
+ * untouched and silent is set.
+ */
+static int sequencer_render_block(struct sequencer *handle, int nb_frames, void *output,
+                                  int *silent)
+{
+    int ret;
+
+    *silent = (handle->nb_events == 0) && (voice_pool_is_silent(handle->voices));
+    if (*silent) {
+        ret = voice_pool_skip(handle->voices, nb_frames);
+        goto exit;
+    }
+
+    if (!output)
+        ret = voice_pool_fast_forward(handle->voices, handle->events, handle->nb_events,
+                                      nb_frames);
+    else if (handle->output_block_fl)
+        ret = voice_pool_process_float(handle->voices, handle->events, handle->nb_events,
+                                       nb_frames, (float *)output);
+    else
+        ret = voice_pool_process(handle->voices, handle->events, handle->nb_events, nb_frames,
+                                 (int32_t *)output);
+    handle->nb_events = 0;
+    if (ret)
+        LOGE("Failed to apply sequence events ! Please consider reducing the attack and/or "
+             "release time, and avoid filter updates during fc sweeps");
+
+exit:
+
+    return ret;
+}
+
+
+/* Check whether the whole sequence (post-fill included) has been rendered */
+static int sequencer_is_over(const struct sequencer *handle)
+{
+    return (handle->end >= 0) && (handle->rendered >= handle->end);
+}
+
+
+/* Render next block: Up to max_frames samples, with the Moog events of every sequence event
+ * starting within the block, at their exact sample offset
+ *
+ *  Returns the number of rendered samples, 0 > errno else.
+ */
+static int sequencer_step(struct sequencer *handle, int max_frames, void *output, int *silent)
+{
+    int ret = 0;
+    int64_t start, block_end;
+    const struct seq *sequence = handle->sequence;
+
+    block_end = handle->rendered + max_frames;
+
+    while (handle->end < 0) {
+
+        start = sequencer_get_sample(handle, handle->position);
+        if (start >= block_end)
+            break;
+
+        /* Keep remaining events for next block if there is no more room for them */
+        if (handle->nb_events + EVENTS_PER_STEP > MAX_EVENTS) {
+            block_end = start;
+            break;
+        }
+
+        if (handle->next_event < sequence->nb_events) {
+            ret = sequencer_push_step(handle, &sequence->events[handle->next_event],
+                                      (int)(start - handle->rendered));
+            if (ret)
+                goto exit;
+            handle->next_event++;
+        } else {
+            /* Post-fill with silence */
+            sequencer_release_all(handle, (int)(start - handle->rendered));
+            handle->end = sequencer_get_sample(handle, handle->position + handle->nb_postfill);
+        }
+    }
+
+    if ((handle->end >= 0) && (handle->end < block_end))
+        block_end = handle->end;
+
+    ret = sequencer_render_block(handle, (int)(block_end - handle->rendered), output, silent);
+    if (ret)
+        goto exit;
+
+    ret = (int)(block_end - handle->rendered);
+    handle->rendered = block_end;
+
+exit:
+
+    return ret;
+}
+
+
+struct sequencer *sequencer_create(const struct cfg *config)
+{
+    struct sequencer *handle = NULL;
+    struct voice_pool_params v_params;
+
+    if (!config)
+        goto failure;
+
+    handle = (struct sequencer *)calloc(1, sizeof(struct sequencer));
+    if (!handle)
+        goto failure;
+
+    handle->fs        = config->m_params.fs;
+    handle->step_size = 60.0 * config->m_params.fs * SIXTEENTH / config->tempo;
+    if (handle->step_size < 1) {
+        LOGE("Sixteenth notes shorter than a sample, please check tempo and sampling frequency");
+        goto failure;
+    }
+
+    /* Output block */
+    if (config->m_params.sample_format == MOOG_SAMPLE_FORMAT_FLOAT) {
+        handle->output_block_fl = (float *)calloc(RENDER_SIZE, sizeof(float));
+        if (!handle->output_block_fl) {
+            LOGE("Output buffer allocation failure");
+            goto failure;
+        }
+    } else {
+        handle->output_block = (int32_t *)calloc(RENDER_SIZE, sizeof(int32_t));
+        if (!handle->output_block) {
+            LOGE("Output buffer allocation failure");
+            goto failure;
+        }
+    }
+
+    /* Moog voices init */
+    memcpy(&v_params.m_params, &config->m_params, sizeof(struct moog_params));
+    v_params.nb_voices = config->nb_voices;
+    v_params.steal     = config->steal;
+    v_params.intensity = config->intensity;
+    handle->voices = voice_pool_create(&v_params);
+    if (!handle->voices) {
+        LOGE("Failed to initialize Moog voices !");
+        goto failure;
+    }
+
+    return handle;
+
+failure:
+
+    sequencer_destroy(&handle);
+
+    return NULL;
+}
+
+
+void sequencer_destroy(struct sequencer **handle)
+{
+    if ((!handle) || (!(*handle)))
+        goto exit;
+
+    voice_pool_destroy(&(*handle)->voices);
+
+    if ((*handle)->output_block)
+        free((*handle)->output_block);
+    if ((*handle)->output_block_fl)
+        free((*handle)->output_block_fl);
+
+    free(*handle);
+    *handle = NULL;
+
+exit:
+
+    return;
+}
+
+
+int sequencer_start(struct sequencer *handle, const struct seq *sequence, int nb_prefill,
+                    int nb_postfill, struct stats *stats)
+{
+    int ret = 0;
+
+    if ((!handle)
+    ||  (!sequence)
+    ||  (nb_prefill < 0)
+    ||  (nb_postfill < 0)) {
+        ret = -EINVAL;
+        goto exit;
+    }
+
+    if (stats)
+        stats->fs = handle->fs;
+    voice_pool_set_stats(handle->voices, stats);
+
+    handle->sequence    = sequence;
+    handle->next_event  = 0;
+    handle->nb_postfill = nb_postfill;
+    handle->rendered    = 0;
+    handle->end         = -1;
+
+    /* Pre-fill with silence */
+    handle->nb_events = 0;
+    handle->rank      = DFT_RANK;
+    handle->length    = DFT_LENGTH;
+    handle->position  = nb_prefill;
+    sequencer_release_all(handle, 0);
+
+exit:
+
+    return ret;
+}
+
+
+int sequencer_set_stats(struct sequencer *handle, struct stats *stats)
+{
+    if (!handle)
+        return -EINVAL;
+
+    return voice_pool_set_stats(handle->voices, stats);
+}
+
+
+int sequencer_render(struct sequencer *handle, int nb_frames, void *output)
+{
+    int n, silent, ret = 0;
+    int done = 0;
+    size_t sample_size;
+
+    if ((!handle)
+    ||  (!handle->sequence)
+    ||  (nb_frames < 0)
+    ||  (!output)) {
+        ret = -EINVAL;
+        goto exit;
+    }
+
+    sample_size = handle->output_block_fl ? sizeof(float) : sizeof(int32_t);
+
+    while ((done < nb_frames) && (!sequencer_is_over(handle))) {
+        ret = sequencer_step(handle, nb_frames - done, (char *)output + done * sample_size,
+                             &silent);
+        if (ret < 0)
+            goto exit;
+        n = ret;
+
+        if (silent)
+            memset((char *)output + done * sample_size, 0, n * sample_size);
+        done += n;
+    }
+
+    ret = done;
+
+exit:
+
+    return ret;
+}
+
+
+int sequencer_fast_forward(struct sequencer *handle, int nb_frames)
+{
+    int silent, ret = 0;
+    int done = 0;
+
+    if ((!handle)
+    ||  (!handle->sequence)
+    ||  (nb_frames < 0)) {
+        ret = -EINVAL;
+        goto exit;
+    }
+
+    while ((done < nb_frames) && (!sequencer_is_over(handle))) {
+        ret = sequencer_step(handle, nb_frames - done, NULL, &silent);
+        if (ret < 0)
+            goto exit;
+        done += ret;
+    }
+
+    ret = done;
+
+exit:
+
+    return ret;
+}
+
+
+int sequencer_is_silent(struct sequencer *handle)
+{
+    if (!handle)
+        return 0;
+
+    return (handle->nb_events == 0) && (voice_pool_is_silent(handle->voices));
+}
+
+
+int sequencer_snapshot(struct sequencer *handle, void *blob, int size)
+{
+    int i, n, ret = 0;
+    uint8_t *ptr = (uint8_t *)blob;
+    const struct moog_event *event;
+
+    if (!handle) {
+        ret = -EINVAL;
+        goto exit;
+    }
+
+    ret = voice_pool_snapshot(handle->voices, NULL, 0);
+    if (ret < 0)
+        goto exit;
+    ret += CONTROL_SIZE;
+
+    if (!blob)
+        goto exit;
+
+    if (size < ret) {
+        ret = -ENOSPC;
+        goto exit;
+    }
+
+    memset(ptr, 0, CONTROL_SIZE);
+
+    snapshot_put_i32(&ptr, handle->nb_events);
+    for (i = 0; i < handle->nb_events; i++) {
+        event = &handle->events[i];
+        snapshot_put_i32(&ptr, event->offset);
+        snapshot_put_i32(&ptr, event->type);
+        snapshot_put_float(&ptr, event->frequency);
+        snapshot_put_float(&ptr, event->fc);
+        snapshot_put_float(&ptr, event->Q);
+        snapshot_put_float(&ptr, event->gain);
+        snapshot_put_i32(&ptr, event->mask);
+        snapshot_put_i32(&ptr, event->nb_samples);
+    }
+    ptr += (MAX_EVENTS - handle->nb_events) * EVENT_SIZE;
+
+    snapshot_put_i32(&ptr, handle->nb_held);
+    for (i = 0; i < handle->nb_held; i++)
+        snapshot_put_float(&ptr, handle->held[i]);
+    ptr += (SEQ_MAX_NOTES - handle->nb_held) * SNAPSHOT_32;
+
+    snapshot_put_i32(&ptr, handle->rank);
+    snapshot_put_i32(&ptr, handle->length);
+    snapshot_put_i64(&ptr, handle->position);
+    snapshot_put_i32(&ptr, handle->next_event);
+    snapshot_put_i32(&ptr, handle->nb_postfill);
+    snapshot_put_i64(&ptr, handle->rendered);
+    snapshot_put_i64(&ptr, handle->end);
+
+    n = voice_pool_snapshot(handle->voices, ptr, size - CONTROL_SIZE);
+    if (n < 0)
+        ret = n;
+
+exit:
+
+    return ret;
+}
+
+
+int sequencer_restore(struct sequencer *handle, const void *blob, int size)
+{
+    int i, n, ret = 0;
+    const uint8_t *ptr = (const uint8_t *)blob;
+    struct sequencer state;
+    struct moog_event *event;
+
+    if ((!handle)
+    ||  (!handle->sequence)
+    ||  (!blob)
+    ||  (size < CONTROL_SIZE)) {
+        ret = -EINVAL;
+        goto exit;
+    }
+
+    memcpy(&state, handle, sizeof(struct sequencer));
+
+    state.nb_events = snapshot_get_i32(&ptr);
+    if ((state.nb_events < 0)
+    ||  (state.nb_events > MAX_EVENTS)) {
+        ret = -EINVAL;
+        goto exit;
+    }
+
+    for (i = 0; i < state.nb_events; i++) {
+        event = &state.events[i];
+        event->offset     = snapshot_get_i32(&ptr);
+        event->type       = (enum moog_event_type)snapshot_get_i32(&ptr);
+        event->frequency  = snapshot_get_float(&ptr);
+        event->fc         = snapshot_get_float(&ptr);
+        event->Q          = snapshot_get_float(&ptr);
+        event->gain       = snapshot_get_float(&ptr);
+        event->mask       = snapshot_get_i32(&ptr);
+        event->nb_samples = snapshot_get_i32(&ptr);
+        if ((event->offset < 0)
+        ||  (event->type < MOOG_EVENT_NOTE_ON)
+        ||  (event->type > MOOG_EVENT_FILTER_SWEEP)) {
+            ret = -EINVAL;
+            goto exit;
+        }
+    }
+    ptr += (MAX_EVENTS - state.nb_events) * EVENT_SIZE;
+
+    state.nb_held = snapshot_get_i32(&ptr);
+    if ((state.nb_held < 0)
+    ||  (state.nb_held > SEQ_MAX_NOTES)) {
+        ret = -EINVAL;
+        goto exit;
+    }
+    for (i = 0; i < state.nb_held; i++)
+        state.held[i] = snapshot_get_float(&ptr);
+    ptr += (SEQ_MAX_NOTES - state.nb_held) * SNAPSHOT_32;
+
+    state.rank        = snapshot_get_i32(&ptr);
+    state.length      = snapshot_get_i32(&ptr);
+    state.position    = snapshot_get_i64(&ptr);
+    state.next_event  = snapshot_get_i32(&ptr);
+    state.nb_postfill = snapshot_get_i32(&ptr);
+    state.rendered    = snapshot_get_i64(&ptr);
+    state.end         = snapshot_get_i64(&ptr);
+    if ((state.length < 1)
+    ||  (state.position < 0)
+    ||  (state.next_event < 0)
+    ||  (state.next_event > state.sequence->nb_events)
+    ||  (state.nb_postfill < 0)
+    ||  (state.rendered < 0)
+    ||  (state.end < -1)) {
+        ret = -EINVAL;
+        goto exit;
+    }
+
+    /* Voices last: they are left untouched if their snapshot is rejected */
+    n = voice_pool_restore(handle->voices, ptr, size - CONTROL_SIZE);
+    if (n < 0) {
+        ret = n;
+        goto exit;
+    }
+
+    memcpy(handle, &state, sizeof(struct sequencer));
+    ret = CONTROL_SIZE + n;
+
+exit:
+
+    return ret;
+}
+
+
+int sequencer_run(struct sequencer *handle, const struct seq *sequence, int nb_prefill,
+                  int nb_postfill, struct wav_writer *wav, struct stats *stats)
+{
+    int i, n, silent, ret = 0;
+    void *output;
+    uint64_t timestamp = 0;
+
+    if (!wav) {
+        ret = -EINVAL;
+        goto exit;
+    }
+
+    ret = sequencer_start(handle, sequence, nb_prefill, nb_postfill, stats);
+    if (ret)
+        goto exit;
+
+    output = handle->output_block_fl ? (void *)handle->output_block_fl :
+                                       (void *)handle->output_block;
+
+    /* Main loop: Render blocks of RENDER_SIZE samples, silent ones going straight to the writer */
+    while (!sequencer_is_over(handle)) {
+
+        ret = sequencer_step(handle, RENDER_SIZE, output, &silent);
+        if (ret < 0)
+            goto exit;
+        n = ret;
+
+        if (silent) {
+            STATS_START(stats, timestamp);
+            ret = wav_writer_write_silence(wav, n);
+            STATS_STOP(stats, STATS_WRITE, timestamp);
+        } else {
+            /* QS8.23 to QS.31 (floating point samples are directly written) */
+            if (!handle->output_block_fl) {
+                STATS_START(stats, timestamp);
+                for (i = 0; i < n; i++)
+                    handle->output_block[i] = handle->output_block[i] << 8;
+                STATS_STOP(stats, STATS_SHIFT, timestamp);
+            }
+
+            STATS_START(stats, timestamp);
+            ret = wav_writer_write(wav, output, n);
+            STATS_STOP(stats, STATS_WRITE, timestamp);
+        }
+        if (ret < 0)
+            goto exit;
+        ret = 0;
+
+        if (stats)
+            stats->nb_samples += n;
+    }
+
+exit:
+
+    if (handle)
+        voice_pool_set_stats(handle->voices, NULL);
+
+    return ret;
+}
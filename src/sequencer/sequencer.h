@@ -0,0 +1,185 @@
+/***************************************************************************************************
+ * @file sequencer.h
+ *
+ * @brief Sequence rendering module (header)
+ *
+ * @licence MIT License
+ *
+ * Copyright (c) 2019 Jeremie Leclere
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy of this software and
+ * associated documentation files (the "Software"), to deal in the Software without restriction,
+ * including without limitation the rights to use, copy, modify, merge, publish, distribute,
+ * sublicense, and/or sell copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all copies or
+ * substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR IMPLIED, INCLUDING BUT
+ * NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND
+ * NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM,
+ * DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ **************************************************************************************************/
+
+#ifndef _SEQUENCER_H_
+#define _SEQUENCER_H_
+
+
+#include <errno.h>
+#include <stdint.h>
+
+#include <stats.h>
+#include <cfg_parser.h>
+#include <seq_parser.h>
+#include <wav_writer.h>
+
+
+/**
+ * @brief Opaque module handle
+ */
+struct sequencer;
+
+
+/**
+ * @brief Initialize sequencer module
+ *
+ * @param[in] config    : User configuration (Moog parameters, tempo, intensity)
+ *
+ * @return Module handle if successful, NULL else
+ */
+struct sequencer *sequencer_create(const struct cfg *config);
+
+
+/**
+ * @brief Release module ressources
+ *
+ * @param[in] handle    : Module handle
+ *
+ * @return None
+ */
+void sequencer_destroy(struct sequencer **handle);
+
+
+/**
+ * @brief Start rendering a sequence (incremental rendering, see sequencer_render)
+ *
+ * @param[in] handle        : Module handle
+ * @param[in] sequence      : Parsed user sequence (must remain valid until rendering is over)
+ * @param[in] nb_prefill    : Number of silent sixteenth notes inserted before the sequence
+ * @param[in] nb_postfill   : Number of sixteenth notes rendered after the sequence (note OFF)
+ * @param[out] stats        : Processing statistics (can be NULL, not measured if so). Must remain
+ *                            valid until rendering is over, and not be shared between threads.
+ *
+ * @return 0 if successful, 0 > errno else
+ */
+int sequencer_start(struct sequencer *handle, const struct seq *sequence, int nb_prefill,
+                    int nb_postfill, struct stats *stats);
+
+
+/**
+ * @brief Change the statistics updated by the started sequence rendering (see sequencer_start)
+ *
+ * @param[in] handle        : Module handle
+ * @param[out] stats        : Processing statistics (can be NULL, not measured if so). Same
+ *                            constraints as with sequencer_start.
+ *
+ * @return 0 if successful, 0 > errno else
+ */
+int sequencer_set_stats(struct sequencer *handle, struct stats *stats);
+
+
+/**
+ * @brief Render next samples of the started sequence
+ *
+ *  Samples are QS8.23 (int32_t) on the fixed point signal path, and floats on the floating point
+ * one: contrary to sequencer_run, no QS.31 conversion is applied.
+ *
+ * @param[in] handle        : Module handle
+ * @param[in] nb_frames     : Number of requested samples
+ * @param[out] output       : Output samples (int32_t or float, depending on sample format)
+ *
+ * @return Number of rendered samples (lower than nb_frames once the sequence is over), 0 > errno
+ *         else
+ */
+int sequencer_render(struct sequencer *handle, int nb_frames, void *output);
+
+
+/**
+ * @brief Move the started sequence forward, without running the voices signal path
+ *
+ *  Every control state (sequence position, voices allocation, enveloppes, oscillators, filter
+ * coefficients) moves exactly as with sequencer_render, filters being reset instead of ringing:
+ * the reached state is the one sequencer_render would reach as long as the voice allocations
+ * match, and output would be silent (see sequencer_is_silent and sequencer_snapshot).
+ *
+ * @param[in] handle        : Module handle
+ * @param[in] nb_frames     : Number of skipped samples
+ *
+ * @return Number of skipped samples (lower than nb_frames once the sequence is over), 0 > errno
+ *         else
+ */
+int sequencer_fast_forward(struct sequencer *handle, int nb_frames);
+
+
+/**
+ * @brief Check whether every voice is silent, with no pending event
+ *
+ * @param[in] handle        : Module handle
+ *
+ * @return 1 if silent, 0 else
+ */
+int sequencer_is_silent(struct sequencer *handle);
+
+
+/**
+ * @brief Save the whole state of the started sequence rendering (position, pending events, held
+ *        notes and voices, see voice_pool_snapshot)
+ *
+ *  Snapshot size only depends on the configuration, and snapshots of sequencers in the same state
+ * are byte identical: comparing them tells whether rendering would go on the same way.
+ *
+ * @param[in]  handle       : Module handle
+ * @param[out] blob         : State snapshot (NULL to only get its size)
+ * @param[in]  size         : Blob size (bytes)
+ *
+ * @return Snapshot size (bytes) if successful, -ENOSPC if blob is too small, 0 > errno else
+ */
+int sequencer_snapshot(struct sequencer *handle, void *blob, int size);
+
+
+/**
+ * @brief Restore a snapshot (see sequencer_snapshot) taken with the same configuration, on the
+ *        same sequence: rendering then goes on exactly as it would have from the snapshot point
+ *
+ *  The sequence must have been started (see sequencer_start). Restoration is all or nothing: the
+ * state is left untouched if the snapshot is rejected.
+ *
+ * @param[in] handle        : Module handle
+ * @param[in] blob          : State snapshot
+ * @param[in] size          : Blob size (bytes)
+ *
+ * @return Number of read bytes if successful, -EINVAL if the snapshot is not compatible with
+ *         this sequencer, 0 > errno else
+ */
+int sequencer_restore(struct sequencer *handle, const void *blob, int size);
+
+
+/**
+ * @brief Render a whole sequence to provided WAV writer
+ *
+ * @param[in] handle        : Module handle
+ * @param[in] sequence      : Parsed user sequence
+ * @param[in] nb_prefill    : Number of silent sixteenth notes inserted before the sequence
+ * @param[in] nb_postfill   : Number of sixteenth notes rendered after the sequence (note OFF)
+ * @param[in] wav           : Output WAV writer
+ * @param[out] stats        : Processing statistics (can be NULL, not measured if so)
+ *
+ * @return 0 if successful, 0 > errno else
+ */
+int sequencer_run(struct sequencer *handle, const struct seq *sequence, int nb_prefill,
+                  int nb_postfill, struct wav_writer *wav, struct stats *stats);
+
+
+#endif /* _SEQUENCER_H_ */
@@ -0,0 +1,786 @@
+/***************************************************************************************************
+ * @file splitter.c
+ *
+ * @brief Parallel sequence rendering module (sequence split in segments)
+ *
+ * @licence MIT License
+ *
+ * Copyright (c) 2019 Jeremie Leclere
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy of this software and
+ * associated documentation files (the "Software"), to deal in the Software without restriction,
+ * including without limitation the rights to use, copy, modify, merge, publish, distribute,
+ * sublicense, and/or sell copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all copies or
+ * substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR IMPLIED, INCLUDING BUT
+ * NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND
+ * NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM,
+ * DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ **************************************************************************************************/
+
+#include <stdlib.h>
+#include <string.h>
+#include <pthread.h>
+
+#include <log.h>
+#include <splitter.h>
+#include <sequencer.h>
+
+
+#define MIN(x, y)           (((x) < (y)) ? (x) : (y))
+#define SCAN_SIZE           (1024)                  ///< Scan granularity (samples)
+#define BLOCK_SIZE          (8192)                  ///< Main thread rendering block (samples)
+#define FORWARD_SIZE        (1 << 30)               ///< Largest single fast forward (samples)
+#define TAIL_LEN            (0.25)                  ///< Silence required before a split (s)
+#define MIN_SEGMENT_LEN     (1.0)                   ///< Minimal segment duration (s)
+#define MAX_SEGMENT_LEN     (10.0)                  ///< Longest segment rendered by workers (s)
+#define SOUNDING_SPLIT_LEN  (4.0)                   ///< Split period while voices sound (s)
+#define WARMUP_LEN          (1.0)                   ///< Rendering ahead of a sounding split (s)
+#define NB_SPARE_SLOTS      (2)                     ///< Number of slots on top of worker threads
+
+
+/* Slot states */
+enum slot_state {
+    SLOT_FREE,                                      ///< Available (or main thread sequencer)
+    SLOT_QUEUED,                                    ///< Waiting for / being rendered by a worker
+    SLOT_DONE                                       ///< Rendered, waiting for main thread
+};
+
+
+struct splitter;
+
+/* A sequencer with its rendering buffer: Segments are rendered in slots, either by a worker
+ * (speculatively, sequencer being moved forward to the segment start), or by the main thread
+ * (sequencer being known to be in the actual rendering state)
+ */
+struct slot {
+    struct sequencer *sequencer;                    ///< Slot sequencer
+    void *buffer;                                   ///< Rendered segment (int32_t or float)
+    uint8_t *start;                                 ///< Sequencer snapshot at segment start (or
+                                                    ///< rebase state to be restored first)
+    struct stats stats;                             ///< Slot processing statistics
+    enum slot_state state;                          ///< Slot state
+    int job;                                        ///< Segment to be rendered
+    int segment;                                    ///< Last rendered segment (-1: not started)
+    int seed;                                       ///< Split from which the state follows the
+                                                    ///< actual one
+    int restore;                                    ///< Start snapshot to be restored first
+    int ret;                                        ///< Rendering status (0 > errno on failure)
+};
+
+
+struct splitter {
+    float fs;                                       ///< Sampling frequency
+    int float_path;                                 ///< Floating point signal path
+    int max_segment;                                ///< Longest segment rendered by workers
+    int warmup;                                     ///< Rendering ahead of a sounding split
+    const struct seq *sequence;                     ///< Rendered sequence
+    struct sequencer *scanner;                      ///< Scan sequencer (never rendering)
+    void *block;                                    ///< Main thread rendering block
+
+    /* Scan results: nb_splits - 1 segments */
+    int nb_splits;                                  ///< Number of segments boundaries
+    int max_splits;                                 ///< Allocated number of boundaries
+    int64_t *splits;                                ///< Segments boundaries (samples)
+    uint8_t *sounding;                              ///< Boundaries within sounding passages
+    struct slot **owner;                            ///< Slot rendering every segment (or NULL)
+
+    /* Actual rendering states (main thread) */
+    int state_size;                                 ///< Sequencer snapshots size (bytes)
+    uint8_t *actual;                                ///< Actual state at current segment start
+    int base;                                       ///< Rebase split (main thread last rendering end)
+    uint8_t *base_state;                            ///< Actual state at rebase split
+
+    /* Rendering slots */
+    int nb_slots;                                   ///< Number of slots
+    struct slot *slots;                             ///< Slots
+    int nb_prefill;                                 ///< Number of pre-fill sixteenth notes
+    int nb_postfill;                                ///< Number of post-fill sixteenth notes
+    int measured;                                   ///< Statistics measurement enabled
+
+    /* Workers synchronization */
+    int nb_threads;                                 ///< Number of worker threads
+    pthread_t threads[SPLITTER_MAX_THREADS];        ///< Worker threads
+    pthread_mutex_t lock;                           ///< Protects queue, slots states and stop flag
+    pthread_cond_t work;                            ///< Signaled on queued slot / stop
+    pthread_cond_t done;                            ///< Signaled on slot completion
+    int *queue;                                     ///< Queued slots (FIFO)
+    int queue_head;                                 ///< First queued slot
+    int queue_len;                                  ///< Number of queued slots
+    int stop;                                       ///< Workers stop request
+};
+
+
+/* Append a segment boundary */
+static int splitter_add_split(struct splitter *handle, int64_t sample, int sounding)
+{
+    int64_t *splits;
+    uint8_t *flags;
+    int max_splits;
+
+    if (handle->nb_splits == handle->max_splits) {
+        max_splits = handle->max_splits ? 2 * handle->max_splits : 64;
+
+        splits = (int64_t *)realloc(handle->splits, max_splits * sizeof(int64_t));
+        if (!splits)
+            return -ENOMEM;
+        handle->splits = splits;
+
+        flags = (uint8_t *)realloc(handle->sounding, max_splits * sizeof(uint8_t));
+        if (!flags)
+            return -ENOMEM;
+        handle->sounding = flags;
+
+        handle->max_splits = max_splits;
+    }
+
+    handle->splits[handle->nb_splits]   = sample;
+    handle->sounding[handle->nb_splits] = (uint8_t)sounding;
+    handle->nb_splits++;
+
+    return 0;
+}
+
+
+/* Scan the sequence without rendering it, looking for split points: Every voice must have been
+ * silent for TAIL_LEN at least (so that filters of the actual rendering are likely to be back to
+ * rest as well), segments lasting MIN_SEGMENT_LEN at least
+ *
+ *  On the fixed point path, passages sounding for longer than SOUNDING_SPLIT_LEN are split
+ * anyway (see splitter_seek): floating point filters never settle back to the actual state.
+ */
+static int splitter_scan(struct splitter *handle)
+{
+    int n, ret;
+    int64_t position = 0, quiet_since = 0, last_split = 0;
+    int64_t tail        = (int64_t)(TAIL_LEN * handle->fs);
+    int64_t min_segment = (int64_t)(MIN_SEGMENT_LEN * handle->fs);
+    int64_t sounding    = (int64_t)(SOUNDING_SPLIT_LEN * handle->fs);
+
+    handle->nb_splits = 0;
+
+    ret = sequencer_start(handle->scanner, handle->sequence, handle->nb_prefill,
+                          handle->nb_postfill, NULL);
+    if (ret)
+        goto exit;
+
+    ret = splitter_add_split(handle, 0, 0);
+    if (ret)
+        goto exit;
+
+    for (;;) {
+
+        ret = sequencer_fast_forward(handle->scanner, SCAN_SIZE);
+        if (ret < 0)
+            goto exit;
+        n = ret;
+        position += n;
+
+        if (n < SCAN_SIZE)
+            break;
+
+        if (!sequencer_is_silent(handle->scanner)) {
+            quiet_since = -1;
+
+            if ((!handle->float_path)
+            &&  (position - last_split >= sounding)) {
+                ret = splitter_add_split(handle, position, 1);
+                if (ret)
+                    goto exit;
+                last_split = position;
+            }
+            continue;
+        }
+
+        if (quiet_since < 0)
+            quiet_since = position;
+
+        if ((position - quiet_since >= tail)
+        &&  (position - last_split >= min_segment)) {
+            ret = splitter_add_split(handle, position, 0);
+            if (ret)
+                goto exit;
+            last_split = position;
+        }
+    }
+
+    /* Sequence end closes last segment */
+    if ((handle->nb_splits == 1)
+    ||  (handle->splits[handle->nb_splits - 1] < position)) {
+        ret = splitter_add_split(handle, position, 0);
+        if (ret)
+            goto exit;
+    }
+    ret = 0;
+
+exit:
+
+    if (ret)
+        LOGE("Sequence scan failure");
+
+    return ret;
+}
+
+
+/* Render next samples of a slot: QS8.23 samples are converted to QS.31 */
+static int splitter_render(struct splitter *handle, struct slot *slot, int nb_frames, void *output,
+                           struct stats *stats)
+{
+    int i, ret;
+    int32_t *samples = (int32_t *)output;
+    uint64_t timestamp = 0;
+
+    ret = sequencer_render(slot->sequencer, nb_frames, output);
+    if (ret < 0)
+        goto exit;
+    if (ret != nb_frames) {
+        ret = -EINVAL;
+        goto exit;
+    }
+    ret = 0;
+
+    if (!handle->float_path) {
+        STATS_START(stats, timestamp);
+        for (i = 0; i < nb_frames; i++)
+            samples[i] = samples[i] << 8;
+        STATS_STOP(stats, STATS_SHIFT, timestamp);
+    }
+
+exit:
+
+    return ret;
+}
+
+
+/* Move a slot sequencer to given segment start, restoring the rebase state or starting the
+ * sequence first if need be
+ *
+ *  Filters are reset by the fast forward: ahead of a split within a sounding passage, the last
+ * WARMUP_LEN are rendered instead (output being dropped), so that filters ring again. Fixed point
+ * filters then most often settle back to the very same state as the actual rendering ones.
+ */
+static int splitter_seek(struct splitter *handle, struct slot *slot, int segment,
+                         struct stats *stats)
+{
+    int n, ret = 0;
+    int64_t nb_frames, warmup;
+
+    if ((slot->segment < 0) || (slot->restore)) {
+        ret = sequencer_start(slot->sequencer, handle->sequence, handle->nb_prefill,
+                              handle->nb_postfill, NULL);
+        if (ret)
+            goto exit;
+    }
+
+    if (slot->restore) {
+        ret = sequencer_restore(slot->sequencer, slot->start, handle->state_size);
+        if (ret < 0)
+            goto exit;
+        slot->restore = 0;
+    }
+
+    ret = sequencer_set_stats(slot->sequencer, stats);
+    if (ret)
+        goto exit;
+
+    nb_frames = handle->splits[segment] - handle->splits[slot->segment + 1];
+    warmup    = handle->sounding[segment] ? MIN(nb_frames, handle->warmup) : 0;
+    nb_frames -= warmup;
+
+    while (nb_frames > 0) {
+        n = (int)MIN(nb_frames, FORWARD_SIZE);
+        ret = sequencer_fast_forward(slot->sequencer, n);
+        if (ret < 0)
+            goto exit;
+        if (ret != n) {
+            ret = -EINVAL;
+            goto exit;
+        }
+        nb_frames -= n;
+    }
+
+    while (warmup > 0) {
+        n = (int)MIN(warmup, handle->max_segment);
+        ret = splitter_render(handle, slot, n, slot->buffer, stats);
+        if (ret)
+            goto exit;
+        warmup -= n;
+    }
+    ret = 0;
+
+exit:
+
+    return ret;
+}
+
+
+/* Render a whole segment in a slot buffer, keeping its start state (worker thread) */
+static int splitter_render_segment(struct splitter *handle, struct slot *slot)
+{
+    int ret;
+    int segment = slot->job;
+    struct stats *stats = handle->measured ? &slot->stats : NULL;
+
+    /* Worker threads time is measured apart (CPU time) */
+    ret = splitter_seek(handle, slot, segment, stats);
+    if (ret)
+        goto exit;
+
+    ret = sequencer_snapshot(slot->sequencer, slot->start, handle->state_size);
+    if (ret < 0)
+        goto exit;
+
+    ret = splitter_render(handle, slot,
+                          (int)(handle->splits[segment + 1] - handle->splits[segment]),
+                          slot->buffer, stats);
+    if (ret)
+        goto exit;
+
+    slot->segment = segment;
+
+exit:
+
+    /* Sequencer is left in an unknown state: start it again on next use */
+    if (ret) {
+        slot->segment = -1;
+        slot->seed    = 0;
+    }
+
+    return ret;
+}
+
+
+/* Render a segment with the actual rendering state sequencer, straight to the WAV writer (main
+ * thread)
+ */
+static int splitter_write_segment(struct splitter *handle, struct slot *slot, int segment,
+                                  struct wav_writer *wav, struct stats *stats)
+{
+    int n, ret = 0;
+    uint64_t timestamp = 0;
+    int64_t nb_frames = handle->splits[segment + 1] - handle->splits[segment];
+
+    ret = splitter_seek(handle, slot, segment, stats);
+    if (ret)
+        goto exit;
+
+    while (nb_frames > 0) {
+        n = (int)MIN(nb_frames, BLOCK_SIZE);
+
+        ret = splitter_render(handle, slot, n, handle->block, stats);
+        if (ret)
+            goto exit;
+
+        STATS_START(stats, timestamp);
+        ret = wav_writer_write(wav, handle->block, n);
+        STATS_STOP(stats, STATS_WRITE, timestamp);
+        if (ret < 0)
+            goto exit;
+        ret = 0;
+
+        if (stats)
+            stats->nb_samples += n;
+        nb_frames -= n;
+    }
+
+    slot->segment = segment;
+
+exit:
+
+    return ret;
+}
+
+
+/* Worker thread: Renders queued slots, one at a time */
+static void *splitter_worker(void *arg)
+{
+    int ret;
+    struct slot *slot;
+    struct splitter *handle = (struct splitter *)arg;
+
+    pthread_mutex_lock(&handle->lock);
+
+    for (;;) {
+        while ((!handle->stop) && (!handle->queue_len))
+            pthread_cond_wait(&handle->work, &handle->lock);
+        if (handle->stop)
+            break;
+
+        slot = &handle->slots[handle->queue[handle->queue_head]];
+        handle->queue_head = (handle->queue_head + 1) % handle->nb_slots;
+        handle->queue_len--;
+        pthread_mutex_unlock(&handle->lock);
+
+        ret = splitter_render_segment(handle, slot);
+
+        pthread_mutex_lock(&handle->lock);
+        slot->ret   = ret;
+        slot->state = SLOT_DONE;
+        pthread_cond_broadcast(&handle->done);
+    }
+
+    pthread_mutex_unlock(&handle->lock);
+
+    return NULL;
+}
+
+
+/* Queue next segments on free slots (the actual rendering state one excepted), and return the
+ * first segment left out
+ *
+ *  Slots move forward only: the closest slot behind a segment start gets it. Slots last known in
+ * the actual state before the rebase split start over from the rebase state: whatever made them
+ * diverge is behind. Long segments are left to the main thread.
+ */
+static int splitter_dispatch(struct splitter *handle, int next, const struct slot *current)
+{
+    int i, from, best_from = 0;
+    struct slot *slot, *best;
+
+    pthread_mutex_lock(&handle->lock);
+
+    while (next < handle->nb_splits - 1) {
+
+        if (handle->splits[next + 1] - handle->splits[next] > handle->max_segment) {
+            next++;
+            continue;
+        }
+
+        best = NULL;
+        for (i = 0; i < handle->nb_slots; i++) {
+            slot = &handle->slots[i];
+            if ((slot == current)
+            ||  (slot->state != SLOT_FREE))
+                continue;
+            from = (slot->seed < handle->base) ? handle->base : slot->segment + 1;
+            if (from > next)
+                continue;
+            if ((!best) || (from > best_from)) {
+                best      = slot;
+                best_from = from;
+            }
+        }
+        if (!best)
+            break;
+
+        if (best->seed < handle->base) {
+            memcpy(best->start, handle->base_state, handle->state_size);
+            best->restore = 1;
+            best->segment = handle->base - 1;
+            best->seed    = handle->base;
+        }
+
+        best->job   = next;
+        best->state = SLOT_QUEUED;
+        handle->owner[next] = best;
+        handle->queue[(handle->queue_head + handle->queue_len) % handle->nb_slots] =
+            (int)(best - handle->slots);
+        handle->queue_len++;
+        next++;
+    }
+
+    pthread_cond_broadcast(&handle->work);
+    pthread_mutex_unlock(&handle->lock);
+
+    return next;
+}
+
+
+/* Wait for a slot to be rendered */
+static void splitter_wait(struct splitter *handle, struct slot *slot)
+{
+    pthread_mutex_lock(&handle->lock);
+    while (slot->state != SLOT_DONE)
+        pthread_cond_wait(&handle->done, &handle->lock);
+    pthread_mutex_unlock(&handle->lock);
+}
+
+
+/* Release a slot */
+static void splitter_release(struct splitter *handle, struct slot *slot)
+{
+    pthread_mutex_lock(&handle->lock);
+    slot->state = SLOT_FREE;
+    pthread_mutex_unlock(&handle->lock);
+}
+
+
+struct splitter *splitter_create(const struct splitter_params *params)
+{
+    int i;
+    size_t sample_size;
+    struct splitter *handle = NULL;
+
+    if ((!params)
+    ||  (!params->config)
+    ||  (!params->sequence)
+    ||  (params->nb_threads < 1)
+    ||  (params->nb_threads > SPLITTER_MAX_THREADS))
+        goto failure;
+
+    handle = (struct splitter *)calloc(1, sizeof(struct splitter));
+    if (!handle)
+        goto failure;
+
+    pthread_mutex_init(&handle->lock, NULL);
+    pthread_cond_init(&handle->work, NULL);
+    pthread_cond_init(&handle->done, NULL);
+
+    handle->fs          = params->config->m_params.fs;
+    handle->float_path  = (params->config->m_params.sample_format == MOOG_SAMPLE_FORMAT_FLOAT);
+    handle->max_segment = (int)(MAX_SEGMENT_LEN * handle->fs);
+    handle->warmup      = (int)(WARMUP_LEN * handle->fs);
+    handle->sequence    = params->sequence;
+    handle->nb_threads  = params->nb_threads;
+    handle->nb_slots    = params->nb_threads + NB_SPARE_SLOTS;
+    sample_size         = handle->float_path ? sizeof(float) : sizeof(int32_t);
+
+    handle->scanner = sequencer_create(params->config);
+    if (!handle->scanner) {
+        LOGE("Failed to initialize scan sequencer !");
+        goto failure;
+    }
+
+    handle->state_size = sequencer_snapshot(handle->scanner, NULL, 0);
+    if (handle->state_size < 0) {
+        LOGE("Failed to get sequencer snapshot size !");
+        goto failure;
+    }
+
+    handle->block      = calloc(BLOCK_SIZE, sample_size);
+    handle->queue      = (int *)calloc(handle->nb_slots, sizeof(int));
+    handle->slots      = (struct slot *)calloc(handle->nb_slots, sizeof(struct slot));
+    handle->actual     = (uint8_t *)calloc(handle->state_size, sizeof(uint8_t));
+    handle->base_state = (uint8_t *)calloc(handle->state_size, sizeof(uint8_t));
+    if ((!handle->block)
+    ||  (!handle->queue)
+    ||  (!handle->slots)
+    ||  (!handle->actual)
+    ||  (!handle->base_state)) {
+        LOGE("Splitter allocation failure");
+        goto failure;
+    }
+
+    for (i = 0; i < handle->nb_slots; i++) {
+        handle->slots[i].sequencer = sequencer_create(params->config);
+        if (!handle->slots[i].sequencer) {
+            LOGE("Failed to initialize slot %d sequencer !", i);
+            goto failure;
+        }
+
+        handle->slots[i].buffer = calloc(handle->max_segment, sample_size);
+        handle->slots[i].start  = (uint8_t *)calloc(handle->state_size, sizeof(uint8_t));
+        if ((!handle->slots[i].buffer) || (!handle->slots[i].start)) {
+            LOGE("Slot buffer allocation failure");
+            goto failure;
+        }
+    }
+
+    return handle;
+
+failure:
+
+    splitter_destroy(&handle);
+
+    return NULL;
+}
+
+
+void splitter_destroy(struct splitter **handle)
+{
+    int i;
+
+    if ((!handle) || (!(*handle)))
+        goto exit;
+
+    if ((*handle)->slots) {
+        for (i = 0; i < (*handle)->nb_slots; i++) {
+            sequencer_destroy(&(*handle)->slots[i].sequencer);
+            if ((*handle)->slots[i].buffer)
+                free((*handle)->slots[i].buffer);
+            if ((*handle)->slots[i].start)
+                free((*handle)->slots[i].start);
+        }
+        free((*handle)->slots);
+    }
+
+    sequencer_destroy(&(*handle)->scanner);
+
+    if ((*handle)->block)
+        free((*handle)->block);
+    if ((*handle)->queue)
+        free((*handle)->queue);
+    if ((*handle)->splits)
+        free((*handle)->splits);
+    if ((*handle)->sounding)
+        free((*handle)->sounding);
+    if ((*handle)->actual)
+        free((*handle)->actual);
+    if ((*handle)->base_state)
+        free((*handle)->base_state);
+    if ((*handle)->owner)
+        free((*handle)->owner);
+
+    pthread_cond_destroy(&(*handle)->done);
+    pthread_cond_destroy(&(*handle)->work);
+    pthread_mutex_destroy(&(*handle)->lock);
+
+    free(*handle);
+    *handle = NULL;
+
+exit:
+
+    return;
+}
+
+
+int splitter_run(struct splitter *handle, int nb_prefill, int nb_postfill,
+                 struct wav_writer *wav, struct stats *stats)
+{
+    int i, k, ret = 0;
+    int next = 0, nb_started = 0;
+    uint64_t timestamp = 0;
+    struct slot *slot, *current;
+
+    if ((!handle)
+    ||  (!wav)
+    ||  (nb_prefill < 0)
+    ||  (nb_postfill < 0)) {
+        ret = -EINVAL;
+        goto exit;
+    }
+
+    if (stats)
+        stats->fs = handle->fs;
+
+    handle->nb_prefill  = nb_prefill;
+    handle->nb_postfill = nb_postfill;
+    handle->measured    = (stats != NULL);
+
+    ret = splitter_scan(handle);
+    if (ret)
+        goto exit;
+
+    if (handle->owner)
+        free(handle->owner);
+    handle->owner = (struct slot **)calloc(handle->nb_splits, sizeof(struct slot *));
+    if (!handle->owner) {
+        ret = -ENOMEM;
+        goto exit;
+    }
+
+    for (i = 0; i < handle->nb_slots; i++) {
+        slot = &handle->slots[i];
+        memset(&slot->stats, 0, sizeof(struct stats));
+        slot->state   = SLOT_FREE;
+        slot->segment = -1;
+        slot->seed    = 0;
+        slot->restore = 0;
+    }
+    handle->base = 0;
+
+    /* Main thread sequencer */
+    current = &handle->slots[0];
+    ret = splitter_seek(handle, current, 0, NULL);
+    if (ret)
+        goto exit;
+
+    handle->queue_head = 0;
+    handle->queue_len  = 0;
+    handle->stop       = 0;
+    for (i = 0; i < handle->nb_threads; i++) {
+        ret = -pthread_create(&handle->threads[i], NULL, splitter_worker, handle);
+        if (ret) {
+            LOGE("Failed to start worker thread %d", i);
+            goto exit;
+        }
+        nb_started++;
+    }
+
+    /* Main loop: Write segments in order, while workers render next ones. The current slot
+     * sequencer holds the actual rendering state at next segment start: A rendered segment is only
+     * kept if it started from the very same state. Segments rendered again from the actual state
+     * become the rebase split, slots left behind starting over from there.
+     */
+    for (k = 0; k < handle->nb_splits - 1; k++) {
+
+        next = splitter_dispatch(handle, next, current);
+        if (next <= k)
+            next = k + 1;
+
+        slot = handle->owner[k];
+        if (slot) {
+            splitter_wait(handle, slot);
+
+            ret = sequencer_snapshot(current->sequencer, handle->actual, handle->state_size);
+            if (ret < 0)
+                goto exit;
+            ret = 0;
+
+            if ((!slot->ret) && (!memcmp(slot->start, handle->actual, handle->state_size))) {
+                STATS_START(stats, timestamp);
+                ret = wav_writer_write(wav, slot->buffer,
+                                       (int)(handle->splits[k + 1] - handle->splits[k]));
+                STATS_STOP(stats, STATS_WRITE, timestamp);
+                if (ret < 0)
+                    goto exit;
+                ret = 0;
+
+                if (stats) {
+                    stats->nb_samples        += handle->splits[k + 1] - handle->splits[k];
+                    stats->nb_worker_samples += handle->splits[k + 1] - handle->splits[k];
+                }
+
+                current->seed = current->segment + 1;
+                splitter_release(handle, current);
+                current = slot;
+                slot    = NULL;
+            } else {
+                splitter_release(handle, slot);
+            }
+        }
+
+        /* Render again from the actual state (long or discarded segment) */
+        if (slot || (!handle->owner[k])) {
+            ret = splitter_write_segment(handle, current, k, wav, stats);
+            if (ret) {
+                LOGE("Segment rendering failure");
+                goto exit;
+            }
+
+            ret = sequencer_snapshot(current->sequencer, handle->base_state, handle->state_size);
+            if (ret < 0)
+                goto exit;
+            ret = 0;
+            handle->base = k + 1;
+        }
+    }
+
+exit:
+
+    if (handle) {
+        pthread_mutex_lock(&handle->lock);
+        handle->stop = 1;
+        pthread_cond_broadcast(&handle->work);
+        pthread_mutex_unlock(&handle->lock);
+
+        for (i = 0; i < nb_started; i++)
+            pthread_join(handle->threads[i], NULL);
+
+        /* Slots stages (worker threads CPU time) are summed up apart from elapsed time */
+        if (stats) {
+            stats->nb_workers = handle->nb_threads;
+            for (i = 0; i < handle->nb_slots; i++) {
+                for (k = 0; k < STATS_NB_STAGES; k++)
+                    stats->workers[k] += handle->slots[i].stats.elapsed[k];
+            }
+        }
+    }
+
+    return ret;
+}
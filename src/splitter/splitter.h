@@ -0,0 +1,108 @@
+/***************************************************************************************************
+ * @file splitter.h
+ *
+ * @brief Parallel sequence rendering module (sequence split in segments)
+ *
+ * @licence MIT License
+ *
+ * Copyright (c) 2019 Jeremie Leclere
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy of this software and
+ * associated documentation files (the "Software"), to deal in the Software without restriction,
+ * including without limitation the rights to use, copy, modify, merge, publish, distribute,
+ * sublicense, and/or sell copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all copies or
+ * substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR IMPLIED, INCLUDING BUT
+ * NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND
+ * NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM,
+ * DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ **************************************************************************************************/
+
+#ifndef _SPLITTER_H_
+#define _SPLITTER_H_
+
+
+#include <errno.h>
+
+#include <stats.h>
+#include <cfg_parser.h>
+#include <seq_parser.h>
+#include <wav_writer.h>
+
+
+/**
+ * @brief Maximal number of worker threads
+ */
+#define SPLITTER_MAX_THREADS    (64)
+
+
+/**
+ * @brief Opaque module handle
+ */
+struct splitter;
+
+
+/**
+ * @brief Initialization parameters
+ */
+struct splitter_params {
+    const struct cfg *config;                   ///< User configuration (Moog parameters, tempo)
+    const struct seq *sequence;                 ///< Rendered sequence
+    int nb_threads;                             ///< Number of worker threads
+                                                ///< ([1, SPLITTER_MAX_THREADS])
+};
+
+
+/**
+ * @brief Initialize parallel rendering module
+ *
+ *  Configuration and sequence must remain valid until the module is destroyed.
+ *
+ * @param[in] params        : Initialization parameters
+ *
+ * @return Module handle if successful, NULL else
+ */
+struct splitter *splitter_create(const struct splitter_params *params);
+
+
+/**
+ * @brief Release module ressources
+ *
+ * @param[in] handle        : Module handle
+ *
+ * @return None
+ */
+void splitter_destroy(struct splitter **handle);
+
+
+/**
+ * @brief Render the sequence to provided WAV writer, splitting it in segments rendered in parallel
+ *
+ *  The sequence is first scanned without running the signal path, looking for points where
+ * every voice has been silent for a while (and, on the fixed point signal path, regular points
+ * within long sounding passages): segments in between are rendered in parallel, every worker
+ * moving its own sequencer to the segment start the same way. Segments are then written in order,
+ * once their start state is checked against the actual rendering one (see sequencer_snapshot):
+ * any segment failing the check is rendered again from the previous one end, and workers start
+ * over from the reached state. Output is bit exact with sequencer_run, whatever the number of
+ * threads.
+ *
+ * @param[in] handle        : Module handle
+ * @param[in] nb_prefill    : Number of silent sixteenth notes inserted before the sequence
+ * @param[in] nb_postfill   : Number of sixteenth notes rendered after the sequence (note OFF)
+ * @param[in] wav           : Output WAV writer
+ * @param[out] stats        : Processing statistics (can be NULL, not measured if so). Worker
+ *                            threads stages are reported apart (CPU time summed over threads).
+ *
+ * @return 0 if successful, 0 > errno else
+ */
+int splitter_run(struct splitter *handle, int nb_prefill, int nb_postfill,
+                 struct wav_writer *wav, struct stats *stats);
+
+
+#endif /* _SPLITTER_H_ */
@@ -0,0 +1,116 @@
+/***************************************************************************************************
+ * @file stats.c
+ *
+ * @brief Processing statistics module (sources)
+ *
+ * @licence MIT License
+ *
+ * Copyright (c) 2019 Jeremie Leclere
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy of this software and
+ * associated documentation files (the "Software"), to deal in the Software without restriction,
+ * including without limitation the rights to use, copy, modify, merge, publish, distribute,
+ * sublicense, and/or sell copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all copies or
+ * substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR IMPLIED, INCLUDING BUT
+ * NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND
+ * NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM,
+ * DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ **************************************************************************************************/
+
+#include <string.h>
+#include <sys/resource.h>
+
+#include <log.h>
+#include <stats.h>
+
+
+static const char *stage_names[STATS_NB_STAGES] = {
+    "parse",
+    "adsr",
+    "osc1",
+    "osc2",
+    "enveloppe",
+    "low_pass",
+    "mix",
+    "shift",
+    "write"
+};
+
+
+int stats_init(struct stats *stats)
+{
+    int ret = 0;
+
+    if (!stats) {
+        ret = -EINVAL;
+        goto exit;
+    }
+
+    memset(stats, 0, sizeof(struct stats));
+    stats->start = stats_now();
+
+exit:
+
+    return ret;
+}
+
+
+long stats_peak_rss(void)
+{
+    struct rusage usage;
+
+    if (getrusage(RUSAGE_SELF, &usage))
+        return 0;
+
+    return usage.ru_maxrss;
+}
+
+
+int stats_report(const struct stats *stats)
+{
+    int i, ret = 0;
+    double total, audio, stage;
+
+    if (!stats) {
+        ret = -EINVAL;
+        goto exit;
+    }
+
+    total = (stats_now() - stats->start) * 1e-9;
+    audio = (stats->fs > 0) ? stats->nb_samples / stats->fs : 0;
+
+    LOGI("Processing statistics:");
+    for (i = 0; i < STATS_NB_STAGES; i++) {
+        stage = stats->elapsed[i] * 1e-9;
+        LOGI("    %-10s: %10.3f s (%5.1f %%, %8.2f ns/sample)",
+             stage_names[i],
+             stage,
+             (total > 0) ? 100 * stage / total : 0,
+             (stats->nb_samples) ? stats->elapsed[i] / (double)stats->nb_samples : 0);
+    }
+    LOGI("    total     : %10.3f s", total);
+
+    if (stats->nb_workers) {
+        LOGI("Worker threads (%d, CPU time summed over threads):", stats->nb_workers);
+        for (i = 0; i < STATS_NB_STAGES; i++) {
+            if (stats->workers[i])
+                LOGI("    %-10s: %10.3f s", stage_names[i], stats->workers[i] * 1e-9);
+        }
+    }
+    LOGI("Audio duration : %.3f s (%llu samples)", audio, (unsigned long long)stats->nb_samples);
+    LOGI("Realtime factor: %.1f", (total > 0) ? audio / total : 0);
+    if (stats->nb_workers)
+        LOGI("Parallel share : %.1f %% of samples rendered by worker threads",
+             (stats->nb_samples) ? 100.0 * stats->nb_worker_samples / stats->nb_samples : 0);
+    LOGI("Peak RSS       : %ld kB", stats_peak_rss());
+
+exit:
+
+    return ret;
+}
@@ -0,0 +1,140 @@
+/***************************************************************************************************
+ * @file stats.h
+ *
+ * @brief Processing statistics module (header)
+ *
+ * @licence MIT License
+ *
+ * Copyright (c) 2019 Jeremie Leclere
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy of this software and
+ * associated documentation files (the "Software"), to deal in the Software without restriction,
+ * including without limitation the rights to use, copy, modify, merge, publish, distribute,
+ * sublicense, and/or sell copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all copies or
+ * substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR IMPLIED, INCLUDING BUT
+ * NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND
+ * NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM,
+ * DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ **************************************************************************************************/
+
+#ifndef _STATS_H_
+#define _STATS_H_
+
+
+#include <time.h>
+#include <errno.h>
+#include <stdint.h>
+
+
+/**
+ * @brief Measured processing stages
+ */
+enum stats_stage {
+    STATS_PARSE,                            ///< Configuration & script parsing
+    STATS_ADSR,                             ///< ADSR enveloppe computation
+    STATS_OSC1,                             ///< First oscillator
+    STATS_OSC2,                             ///< Second oscillator
+    STATS_ENVELOPPE,                        ///< Oscillators saturating sum & enveloppe application
+    STATS_LOW_PASS,                         ///< Low pass filter
+    STATS_MIX,                              ///< Voices mix
+    STATS_SHIFT,                            ///< QS8.23 to QS.31 conversion
+    STATS_WRITE,                            ///< WAV file writing
+    STATS_NB_STAGES
+};
+
+
+/**
+ * @brief Statistics structure
+ *
+ *  Every instrumented module accepts a NULL statistics pointer, in which case
+ * nothing is measured: The instrumentation overhead is then limited to a
+ * pointer check per processed frame and stage.
+ */
+struct stats {
+    uint64_t start;                         ///< Statistics initialization timestamp (ns)
+    uint64_t elapsed[STATS_NB_STAGES];      ///< Time spent per stage (ns)
+    uint64_t nb_samples;                    ///< Number of generated samples
+    float fs;                               ///< Sampling frequency of generated samples (Hz)
+
+    /* Parallel rendering: worker threads run concurrently with the main thread, their time is
+     * CPU time (summed over threads) rather than part of the elapsed time
+     */
+    int nb_workers;                         ///< Number of worker threads (0 if none)
+    uint64_t workers[STATS_NB_STAGES];      ///< Worker threads CPU time spent per stage (ns)
+    uint64_t nb_worker_samples;             ///< Generated samples rendered by worker threads
+};
+
+
+/**
+ * @brief Monotonic timestamp, in ns
+ */
+static inline uint64_t stats_now(void)
+{
+    struct timespec ts;
+
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+
+    return (uint64_t)ts.tv_sec * 1000000000ull + ts.tv_nsec;
+}
+
+
+/**
+ * @brief Start measuring a stage (no-op if stats is NULL)
+ */
+#define STATS_START(stats, timestamp)                                           \
+do {                                                                            \
+    if (stats)                                                                  \
+        (timestamp) = stats_now();                                              \
+} while (0)
+
+
+/**
+ * @brief Stop measuring a stage, and account elapsed time (no-op if stats is NULL)
+ */
+#define STATS_STOP(stats, stage, timestamp)                                     \
+do {                                                                            \
+    if (stats)                                                                  \
+        (stats)->elapsed[(stage)] += stats_now() - (timestamp);                \
+} while (0)
+
+
+/**
+ * @brief Initialize statistics structure
+ *
+ * @param[out] stats    : Statistics structure
+ *
+ * @return 0 if successful, 0 > errno else
+ */
+int stats_init(struct stats *stats);
+
+
+/**
+ * @brief Get process peak resident set size
+ *
+ * @return Peak RSS (kB)
+ */
+long stats_peak_rss(void);
+
+
+/**
+ * @brief Print statistics report
+ *
+ *  Reports the time spent in each stage, the generated audio duration, the
+ * realtime factor (audio duration over time elapsed since stats_init) and the
+ * process peak RSS. With parallel rendering, worker threads CPU time is
+ * reported on its own, with the share of samples they rendered.
+ *
+ * @param[in] stats     : Statistics structure
+ *
+ * @return 0 if successful, 0 > errno else
+ */
+int stats_report(const struct stats *stats);
+
+
+#endif /* _STATS_H_ */
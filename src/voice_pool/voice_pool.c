@@ -0,0 +1,844 @@
+/***************************************************************************************************
+ * @file voice_pool.c
+ *
+ * @brief Polyphonic voice pool module (sources)
+ *
+ * @licence MIT License
+ *
+ * Copyright (c) 2019 Jeremie Leclere
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy of this software and
+ * associated documentation files (the "Software"), to deal in the Software without restriction,
+ * including without limitation the rights to use, copy, modify, merge, publish, distribute,
+ * sublicense, and/or sell copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all copies or
+ * substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR IMPLIED, INCLUDING BUT
+ * NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND
+ * NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM,
+ * DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ **************************************************************************************************/
+
+#include <string.h>
+#include <stdlib.h>
+
+#include <snapshot.h>
+#include <voice_pool.h>
+
+/* Runtime dispatched SIMD kernels (x86 only) */
+#if defined(__x86_64__) && defined(__GNUC__)
+#include <immintrin.h>
+#define VOICE_POOL_SIMD
+#endif
+
+
+#define MAX(x, y) ((x) > (y) ? (x) : (y))
+#define MIN(x, y) ((x) < (y) ? (x) : (y))
+
+#define QS823_MIN       (-(1 << 23))
+#define QS823_MAX       ((1 << 23) - 1)
+
+#define HEADER_SIZE     (SNAPSHOT_32 + SNAPSHOT_64)     ///< Snapshot header (voices, notes counter)
+#define VOICE_SIZE      (SNAPSHOT_32 + SNAPSHOT_64)     ///< Voice header (frequency, age)
+
+/* Mixing kernels prototypes: acc += in, frames [start, nb_frames[ */
+typedef void (*voice_pool_mix_kernel)(const int32_t *in, int start, int nb_frames, int64_t *acc);
+typedef void (*voice_pool_mix_kernel_float)(const float *in, int start, int nb_frames, float *acc);
+
+
+struct voice {
+    struct moog *moog;                              ///< Voice synthesizer
+    float frequency;                                ///< Held note frequency (0 if released)
+    uint64_t age;                                   ///< Note ON sequence number (0: never used)
+    int releasing;                                  ///< Note OFF pending (see voice_pool_release)
+};
+
+
+struct voice_pool {
+    int nb_voices;                                  ///< Number of voices
+    int block_size;                                 ///< Processing block size
+    enum voice_pool_steal steal;                    ///< Voice stealing policy
+    uint64_t nb_notes;                              ///< Note ON events counter
+    struct voice *voices;                           ///< Voices
+    struct moog *batch[MOOG_BANK_MAX_INSTANCES];    ///< Playing voices processed at once
+    int32_t *outputs[MOOG_BANK_MAX_INSTANCES];      ///< Batch outputs (fixed point path)
+    float *outputs_fl[MOOG_BANK_MAX_INSTANCES];     ///< Batch outputs (floating point path)
+    int32_t *voice_output;                          ///< Voices blocks (fixed point path)
+    int64_t *acc;                                   ///< Voices sum block (fixed point path)
+    float *voice_output_fl;                         ///< Voices blocks (floating point path)
+    voice_pool_mix_kernel mix;                      ///< Mixing kernel (fixed point path)
+    voice_pool_mix_kernel_float mix_fl;             ///< Mixing kernel (floating point path)
+    struct stats *stats;                            ///< Processing statistics (NULL if disabled)
+};
+
+
+/* Mixing kernel, portable version
+ *
+ *  QS8.23 voices are summed without saturation in 64 bits, and the sum is saturated once all voices
+ * are mixed. A 32 bits accumulator would overflow: resonant filters push voices beyond full scale,
+ * and 256 full scale voices already reach 2^31.
+ */
+static void voice_pool_mix_scalar(const int32_t *in, int start, int nb_frames, int64_t *acc)
+{
+    int i;
+
+    for (i = start; i < nb_frames; i++)
+        acc[i] += in[i];
+}
+
+
+/* Mixing kernel, portable version (floating point path) */
+static void voice_pool_mix_float_scalar(const float *in, int start, int nb_frames, float *acc)
+{
+    int i;
+
+    for (i = start; i < nb_frames; i++)
+        acc[i] += in[i];
+}
+
+
+#if defined(VOICE_POOL_SIMD)
+
+/* Mixing kernel, SSE2 version (4 frames per iteration, sign extended to 64 bits) */
+static void voice_pool_mix_sse2(const int32_t *in, int start, int nb_frames, int64_t *acc)
+{
+    int i;
+    __m128i v, sign;
+
+    for (i = start; i + 4 <= nb_frames; i += 4) {
+        v    = _mm_loadu_si128((const __m128i *)&in[i]);
+        sign = _mm_srai_epi32(v, 31);
+        _mm_storeu_si128((__m128i *)&acc[i],
+                         _mm_add_epi64(_mm_loadu_si128((const __m128i *)&acc[i]),
+                                       _mm_unpacklo_epi32(v, sign)));
+        _mm_storeu_si128((__m128i *)&acc[i + 2],
+                         _mm_add_epi64(_mm_loadu_si128((const __m128i *)&acc[i + 2]),
+                                       _mm_unpackhi_epi32(v, sign)));
+    }
+
+    voice_pool_mix_scalar(in, i, nb_frames, acc);
+}
+
+
+/* Mixing kernel, AVX2 version (8 frames per iteration, sign extended to 64 bits) */
+__attribute__((target("avx2")))
+static void voice_pool_mix_avx2(const int32_t *in, int start, int nb_frames, int64_t *acc)
+{
+    int i;
+
+    for (i = start; i + 8 <= nb_frames; i += 8) {
+        _mm256_storeu_si256((__m256i *)&acc[i],
+                            _mm256_add_epi64(_mm256_loadu_si256((const __m256i *)&acc[i]),
+                                             _mm256_cvtepi32_epi64(
+                                                 _mm_loadu_si128((const __m128i *)&in[i]))));
+        _mm256_storeu_si256((__m256i *)&acc[i + 4],
+                            _mm256_add_epi64(_mm256_loadu_si256((const __m256i *)&acc[i + 4]),
+                                             _mm256_cvtepi32_epi64(
+                                                 _mm_loadu_si128((const __m128i *)&in[i + 4]))));
+    }
+
+    voice_pool_mix_scalar(in, i, nb_frames, acc);
+}
+
+
+/* Mixing kernel, SSE version (floating point path, 4 frames per iteration) */
+static void voice_pool_mix_float_sse(const float *in, int start, int nb_frames, float *acc)
+{
+    int i;
+
+    for (i = start; i + 4 <= nb_frames; i += 4)
+        _mm_storeu_ps(&acc[i], _mm_add_ps(_mm_loadu_ps(&acc[i]), _mm_loadu_ps(&in[i])));
+
+    voice_pool_mix_float_scalar(in, i, nb_frames, acc);
+}
+
+
+/* Mixing kernel, AVX version (floating point path, 8 frames per iteration) */
+__attribute__((target("avx")))
+static void voice_pool_mix_float_avx(const float *in, int start, int nb_frames, float *acc)
+{
+    int i;
+
+    for (i = start; i + 8 <= nb_frames; i += 8)
+        _mm256_storeu_ps(&acc[i], _mm256_add_ps(_mm256_loadu_ps(&acc[i]),
+                                                _mm256_loadu_ps(&in[i])));
+
+    voice_pool_mix_float_scalar(in, i, nb_frames, acc);
+}
+
+#endif /* VOICE_POOL_SIMD */
+
+
+/* Select best kernels supported by running CPU */
+static void voice_pool_select_kernels(struct voice_pool *handle)
+{
+#if defined(VOICE_POOL_SIMD)
+    __builtin_cpu_init();
+    handle->mix    = __builtin_cpu_supports("avx2") ? voice_pool_mix_avx2 : voice_pool_mix_sse2;
+    handle->mix_fl = __builtin_cpu_supports("avx") ? voice_pool_mix_float_avx
+                                                   : voice_pool_mix_float_sse;
+#else
+    handle->mix    = voice_pool_mix_scalar;
+    handle->mix_fl = voice_pool_mix_float_scalar;
+#endif
+}
+
+
+/* Pick a voice for a new note: an idle one if any, else a stolen one
+ *
+ *  Voices in release are stolen before held ones, the stealing policy telling which one.
+ */
+static struct voice *voice_pool_allocate(struct voice_pool *handle)
+{
+    int i, held;
+    float level, best_level = 0;
+    struct voice *voice, *best = NULL;
+
+    for (i = 0; i < handle->nb_voices; i++) {
+        if (moog_is_silent(handle->voices[i].moog))
+            return &handle->voices[i];
+    }
+
+    for (held = 0; (held < 2) && (!best); held++) {
+        for (i = 0; i < handle->nb_voices; i++) {
+
+            voice = &handle->voices[i];
+            if ((voice->frequency != 0) != held)
+                continue;
+
+            if (handle->steal == VOICE_POOL_STEAL_QUIETEST) {
+                moog_get_level(voice->moog, &level);
+                if ((!best) || (level < best_level)) {
+                    best       = voice;
+                    best_level = level;
+                }
+            } else if ((!best) || (voice->age < best->age)) {
+                best = voice;
+            }
+        }
+    }
+
+    return best;
+}
+
+
+/* Route a timed event to voices */
+static int voice_pool_apply_event(struct voice_pool *handle, const struct moog_event *event)
+{
+    int i, ret = 0;
+    struct voice *voice;
+
+    switch (event->type) {
+    case MOOG_EVENT_NOTE_ON:
+        /* A stolen voice starts its new note over (a single voice plays legato) */
+        voice = voice_pool_allocate(handle);
+        if ((handle->nb_voices > 1) && (!moog_is_silent(voice->moog))) {
+            ret = moog_retrigger(voice->moog);
+            if (ret)
+                goto exit;
+        }
+        ret = moog_apply_event(voice->moog, event);
+        if (ret)
+            goto exit;
+        voice->frequency = event->frequency;
+        voice->age       = ++handle->nb_notes;
+        voice->releasing = 0;
+        break;
+    case MOOG_EVENT_NOTE_OFF:
+        /* Released voices are stolen first, their enveloppe is released later on */
+        for (i = 0; i < handle->nb_voices; i++) {
+            voice = &handle->voices[i];
+            if ((event->frequency != 0) && (voice->frequency != event->frequency))
+                continue;
+            voice->releasing = (voice->frequency != 0);
+            voice->frequency = 0;
+        }
+        break;
+    default:
+        /* Low pass filter events */
+        for (i = 0; i < handle->nb_voices; i++) {
+            ret = moog_apply_event(handle->voices[i].moog, event);
+            if (ret)
+                goto exit;
+        }
+        break;
+    }
+
+exit:
+
+    return ret;
+}
+
+
+/* Release the enveloppes of voices released by note OFF events
+ *
+ *  Releases are applied once every event of a sample offset is routed: a voice whose note is
+ * released and taken over by a new note at the same offset never goes through its release (a
+ * single voice plays legato whatever the events order).
+ */
+static int voice_pool_release(struct voice_pool *handle)
+{
+    int i, ret = 0;
+    struct voice *voice;
+
+    for (i = 0; i < handle->nb_voices; i++) {
+        voice = &handle->voices[i];
+        if (!voice->releasing)
+            continue;
+        ret = moog_toggle(voice->moog, 0);
+        if (ret)
+            goto exit;
+        voice->releasing = 0;
+    }
+
+exit:
+
+    return ret;
+}
+
+
+/* Render a batch of playing voices at once (moog_process_bank), on either signal path
+ *
+ *  The very first playing voice of a block is rendered in place, next ones are mixed in (on the
+ * fixed point path, into the 64 bits sum the first voice is widened to once a second one plays).
+ */
+static int voice_pool_render_batch(struct voice_pool *handle, int nb_batch, int nb_frames,
+                                   int nb_active, int32_t *output, float *output_fl)
+{
+    int i, k, ret = 0;
+    uint64_t timestamp = 0;
+
+    for (k = 0; k < nb_batch; k++) {
+        if (output)
+            handle->outputs[k] = (nb_active + k) ? handle->voice_output + k * handle->block_size
+                                                 : output;
+        else
+            handle->outputs_fl[k] = (nb_active + k) ? handle->voice_output_fl
+                                                      + k * handle->block_size
+                                                    : output_fl;
+    }
+
+    if (output)
+        ret = moog_process_bank(handle->batch, nb_batch, nb_frames, handle->outputs);
+    else
+        ret = moog_process_bank_float(handle->batch, nb_batch, nb_frames, handle->outputs_fl);
+    if (ret)
+        goto exit;
+
+    STATS_START(handle->stats, timestamp);
+    for (k = (nb_active) ? 0 : 1; k < nb_batch; k++) {
+        if (output) {
+            if (nb_active + k == 1) {
+                for (i = 0; i < nb_frames; i++)
+                    handle->acc[i] = output[i];
+            }
+            handle->mix(handle->outputs[k], 0, nb_frames, handle->acc);
+        } else {
+            handle->mix_fl(handle->outputs_fl[k], 0, nb_frames, output_fl);
+        }
+    }
+    STATS_STOP(handle->stats, STATS_MIX, timestamp);
+
+exit:
+
+    return ret;
+}
+
+
+/* Render samples without event, on either signal path (output or output_fl)
+ *
+ *  Voices are processed block after block, so that the mix working set stays in cache. Playing
+ * voices are rendered by batches (their low pass filters running in parallel SIMD lanes), and
+ * silent ones only move forward.
+ */
+static int voice_pool_render_span(struct voice_pool *handle, int nb_frames, int32_t *output,
+                                  float *output_fl)
+{
+    int i, n, nb_active, nb_batch, ret = 0;
+    uint64_t timestamp = 0;
+    struct moog *moog;
+
+    while (nb_frames > 0) {
+
+        n = MIN(nb_frames, handle->block_size);
+        nb_active = 0;
+        nb_batch  = 0;
+
+        for (i = 0; i < handle->nb_voices; i++) {
+
+            moog = handle->voices[i].moog;
+            if (moog_is_silent(moog)) {
+                ret = moog_skip(moog, n);
+                if (ret)
+                    goto exit;
+                continue;
+            }
+
+            handle->batch[nb_batch++] = moog;
+            if (nb_batch == MOOG_BANK_MAX_INSTANCES) {
+                ret = voice_pool_render_batch(handle, nb_batch, n, nb_active, output, output_fl);
+                if (ret)
+                    goto exit;
+                nb_active += nb_batch;
+                nb_batch   = 0;
+            }
+        }
+
+        if (nb_batch) {
+            ret = voice_pool_render_batch(handle, nb_batch, n, nb_active, output, output_fl);
+            if (ret)
+                goto exit;
+            nb_active += nb_batch;
+        }
+
+        if (!nb_active) {
+            if (output)
+                memset(output, 0, n * sizeof(int32_t));
+            else
+                memset(output_fl, 0, n * sizeof(float));
+        } else if ((nb_active > 1) && (output)) {
+            /* Saturate voices sum */
+            STATS_START(handle->stats, timestamp);
+            for (i = 0; i < n; i++)
+                output[i] = (int32_t)MAX(MIN(handle->acc[i], QS823_MAX), QS823_MIN);
+            STATS_STOP(handle->stats, STATS_MIX, timestamp);
+        } else if (output_fl) {
+            /* Signed zeros: a voice may render -0.0 where a skipped one (or a filter reset by
+             * moog_fast_forward) renders +0.0. Adding +0.0 only turns -0.0 into +0.0, so that
+             * output does not depend on how voices got there (bit exact -j rendering).
+             */
+            STATS_START(handle->stats, timestamp);
+            for (i = 0; i < n; i++)
+                output_fl[i] += 0.0f;
+            STATS_STOP(handle->stats, STATS_MIX, timestamp);
+        }
+
+        if (output)
+            output += n;
+        else
+            output_fl += n;
+        nb_frames -= n;
+    }
+
+exit:
+
+    return ret;
+}
+
+
+/* Move every voice forward without rendering (see moog_fast_forward) */
+static int voice_pool_fast_forward_span(struct voice_pool *handle, int nb_frames)
+{
+    int i, ret = 0;
+
+    for (i = 0; (i < handle->nb_voices) && (!ret); i++)
+        ret = moog_fast_forward(handle->voices[i].moog, nb_frames);
+
+    return ret;
+}
+
+
+/* Whole snapshot size: header, then every voice header followed by its moog snapshot */
+static int voice_pool_snapshot_size(struct voice_pool *handle)
+{
+    int n;
+
+    n = moog_snapshot(handle->voices[0].moog, NULL, 0);
+    if (n < 0)
+        return n;
+
+    return HEADER_SIZE + handle->nb_voices * (VOICE_SIZE + n);
+}
+
+
+/* Check a whole snapshot (size already checked), and restore it as well if restore is set
+ *
+ *  Returns the number of read bytes, 0 > errno else.
+ */
+static int voice_pool_read_snapshot(struct voice_pool *handle, const uint8_t *blob, int size,
+                                    int restore)
+{
+    int i, n, ret = 0;
+    float frequency;
+    uint64_t nb_notes, age;
+    const uint8_t *ptr = blob;
+    struct voice *voice;
+
+    if (snapshot_get_i32(&ptr) != handle->nb_voices) {
+        ret = -EINVAL;
+        goto exit;
+    }
+    nb_notes = snapshot_get_u64(&ptr);
+
+    for (i = 0; i < handle->nb_voices; i++) {
+        voice     = &handle->voices[i];
+        frequency = snapshot_get_float(&ptr);
+        age       = snapshot_get_u64(&ptr);
+        if ((!(frequency >= 0))
+        ||  (age > nb_notes)) {
+            ret = -EINVAL;
+            goto exit;
+        }
+
+        n = restore ? moog_restore(voice->moog, ptr, size - (int)(ptr - blob))
+                    : moog_check_snapshot(voice->moog, ptr, size - (int)(ptr - blob));
+        if (n < 0) {
+            ret = n;
+            goto exit;
+        }
+        ptr += n;
+
+        if (restore) {
+            voice->frequency = frequency;
+            voice->age       = age;
+        }
+    }
+
+    if (restore)
+        handle->nb_notes = nb_notes;
+
+    ret = (int)(ptr - blob);
+
+exit:
+
+    return ret;
+}
+
+
+/* Render samples with timed events, on either signal path (output or output_fl), or only move
+ * forward if both are NULL
+ */
+static int voice_pool_render(struct voice_pool *handle, const struct moog_event *events,
+                             int nb_events, int nb_frames, int32_t *output, float *output_fl)
+{
+    int i, next, done = 0, ret = 0;
+
+    if ((nb_frames < 0)
+    ||  (nb_events < 0)
+    ||  ((nb_events > 0) && (!events))) {
+        ret = -EINVAL;
+        goto exit;
+    }
+
+    for (i = 0; i <= nb_events; i++) {
+
+        /* Render samples up to next event */
+        next = (i < nb_events) ? events[i].offset : nb_frames;
+        if ((next < done) || (next > nb_frames)) {
+            ret = -EINVAL;
+            goto exit;
+        }
+
+        if ((next > done) || (i == nb_events)) {
+            ret = voice_pool_release(handle);
+            if (ret)
+                goto exit;
+        }
+
+        if ((!output) && (!output_fl))
+            ret = voice_pool_fast_forward_span(handle, next - done);
+        else
+            ret = voice_pool_render_span(handle, next - done, (output) ? output + done : NULL,
+                                         (output) ? NULL : output_fl + done);
+        if (ret)
+            goto exit;
+        done = next;
+
+        if (i < nb_events) {
+            ret = voice_pool_apply_event(handle, &events[i]);
+            if (ret)
+                goto exit;
+        }
+    }
+
+exit:
+
+    return ret;
+}
+
+
+struct voice_pool *voice_pool_create(const struct voice_pool_params *params)
+{
+    int i;
+    struct moog_params m_params;
+    struct voice_pool *handle = NULL;
+
+    if ((!params)
+    ||  (params->nb_voices < 1)
+    ||  (params->nb_voices > VOICE_POOL_MAX_VOICES)
+    ||  ((params->steal != VOICE_POOL_STEAL_OLDEST)
+    &&   (params->steal != VOICE_POOL_STEAL_QUIETEST)))
+        goto failure;
+
+    handle = (struct voice_pool *)calloc(1, sizeof(struct voice_pool));
+    if (!handle)
+        goto failure;
+
+    handle->steal      = params->steal;
+    handle->block_size = params->m_params.block_size;
+
+    /* Voices (low pass filter tables being shared, see moog_create) */
+    handle->voices = (struct voice *)calloc(params->nb_voices, sizeof(struct voice));
+    if (!handle->voices)
+        goto failure;
+    handle->nb_voices = params->nb_voices;
+
+    memcpy(&m_params, &params->m_params, sizeof(struct moog_params));
+    for (i = 0; i < handle->nb_voices; i++) {
+        handle->voices[i].moog = moog_create(&m_params);
+        if ((!handle->voices[i].moog)
+        ||  (moog_set_intensity(handle->voices[i].moog, params->intensity)))
+            goto failure;
+    }
+
+    /* Mixing buffers (one block per batch voice) */
+    handle->voice_output = (int32_t *)calloc(MOOG_BANK_MAX_INSTANCES * handle->block_size,
+                                             sizeof(int32_t));
+    handle->acc = (int64_t *)calloc(handle->block_size, sizeof(int64_t));
+    if ((!handle->voice_output) || (!handle->acc))
+        goto failure;
+
+    if (params->m_params.sample_format == MOOG_SAMPLE_FORMAT_FLOAT) {
+        handle->voice_output_fl = (float *)calloc(MOOG_BANK_MAX_INSTANCES * handle->block_size,
+                                                  sizeof(float));
+        if (!handle->voice_output_fl)
+            goto failure;
+    }
+
+    voice_pool_select_kernels(handle);
+
+    return handle;
+
+failure:
+
+    voice_pool_destroy(&handle);
+
+    return NULL;
+}
+
+
+void voice_pool_destroy(struct voice_pool **handle)
+{
+    int i;
+
+    if ((!handle) || (!(*handle)))
+        goto exit;
+
+    if ((*handle)->voices) {
+        for (i = 0; i < (*handle)->nb_voices; i++)
+            moog_destroy(&(*handle)->voices[i].moog);
+        free((*handle)->voices);
+    }
+
+    if ((*handle)->voice_output)
+        free((*handle)->voice_output);
+    if ((*handle)->acc)
+        free((*handle)->acc);
+    if ((*handle)->voice_output_fl)
+        free((*handle)->voice_output_fl);
+
+    free(*handle);
+    *handle = NULL;
+
+exit:
+
+    return;
+}
+
+
+int voice_pool_set_stats(struct voice_pool *handle, struct stats *stats)
+{
+    int i, ret = 0;
+
+    if (!handle) {
+        ret = -EINVAL;
+        goto exit;
+    }
+
+    handle->stats = stats;
+    for (i = 0; i < handle->nb_voices; i++)
+        ret |= moog_set_stats(handle->voices[i].moog, stats);
+
+exit:
+
+    return ret;
+}
+
+
+int voice_pool_process(struct voice_pool *handle, const struct moog_event *events, int nb_events,
+                       int nb_frames, int32_t *output)
+{
+    int ret = 0;
+
+    if ((!handle)
+    ||  (!output)) {
+        ret = -EINVAL;
+        goto exit;
+    }
+
+    ret = voice_pool_render(handle, events, nb_events, nb_frames, output, NULL);
+
+exit:
+
+    return ret;
+}
+
+
+int voice_pool_process_float(struct voice_pool *handle, const struct moog_event *events,
+                             int nb_events, int nb_frames, float *output)
+{
+    int ret = 0;
+
+    if ((!handle)
+    ||  (!output)
+    ||  (!handle->voice_output_fl)) {
+        ret = -EINVAL;
+        goto exit;
+    }
+
+    ret = voice_pool_render(handle, events, nb_events, nb_frames, NULL, output);
+
+exit:
+
+    return ret;
+}
+
+
+int voice_pool_fast_forward(struct voice_pool *handle, const struct moog_event *events,
+                            int nb_events, int nb_frames)
+{
+    int ret = 0;
+
+    if (!handle) {
+        ret = -EINVAL;
+        goto exit;
+    }
+
+    ret = voice_pool_render(handle, events, nb_events, nb_frames, NULL, NULL);
+
+exit:
+
+    return ret;
+}
+
+
+int voice_pool_snapshot(struct voice_pool *handle, void *blob, int size)
+{
+    int i, n, ret = 0;
+    uint8_t *ptr = (uint8_t *)blob;
+    struct voice *voice;
+
+    if (!handle) {
+        ret = -EINVAL;
+        goto exit;
+    }
+
+    ret = voice_pool_snapshot_size(handle);
+    if ((ret < 0) || (!blob))
+        goto exit;
+
+    if (size < ret) {
+        ret = -ENOSPC;
+        goto exit;
+    }
+
+    snapshot_put_i32(&ptr, handle->nb_voices);
+    snapshot_put_u64(&ptr, handle->nb_notes);
+    size -= HEADER_SIZE;
+
+    for (i = 0; i < handle->nb_voices; i++) {
+        voice = &handle->voices[i];
+        snapshot_put_float(&ptr, voice->frequency);
+        snapshot_put_u64(&ptr, voice->age);
+        size -= VOICE_SIZE;
+
+        n = moog_snapshot(voice->moog, ptr, size);
+        if (n < 0) {
+            ret = n;
+            goto exit;
+        }
+        ptr  += n;
+        size -= n;
+    }
+
+exit:
+
+    return ret;
+}
+
+
+int voice_pool_restore(struct voice_pool *handle, const void *blob, int size)
+{
+    int ret = 0;
+
+    if ((!handle)
+    ||  (!blob)) {
+        ret = -EINVAL;
+        goto exit;
+    }
+
+    ret = voice_pool_snapshot_size(handle);
+    if (ret < 0)
+        goto exit;
+    if (size < ret) {
+        ret = -EINVAL;
+        goto exit;
+    }
+
+    /* Every voice snapshot is checked before any is restored */
+    ret = voice_pool_read_snapshot(handle, (const uint8_t *)blob, size, 0);
+    if (ret < 0)
+        goto exit;
+
+    ret = voice_pool_read_snapshot(handle, (const uint8_t *)blob, size, 1);
+
+exit:
+
+    return ret;
+}
+
+
+int voice_pool_is_silent(struct voice_pool *handle)
+{
+    int i;
+
+    if (!handle)
+        return 0;
+
+    for (i = 0; i < handle->nb_voices; i++) {
+        if (!moog_is_silent(handle->voices[i].moog))
+            return 0;
+    }
+
+    return 1;
+}
+
+
+int voice_pool_skip(struct voice_pool *handle, int nb_frames)
+{
+    int i, ret = 0;
+
+    if ((!handle) || (nb_frames < 0)) {
+        ret = -EINVAL;
+        goto exit;
+    }
+
+    if (!voice_pool_is_silent(handle)) {
+        ret = -EAGAIN;
+        goto exit;
+    }
+
+    for (i = 0; i < handle->nb_voices; i++) {
+        ret = moog_skip(handle->voices[i].moog, nb_frames);
+        if (ret)
+            goto exit;
+    }
+
+exit:
+
+    return ret;
+}
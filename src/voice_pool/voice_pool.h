@@ -0,0 +1,223 @@
+/***************************************************************************************************
+ * @file voice_pool.h
+ *
+ * @brief Polyphonic voice pool module (headers)
+ *
+ * @licence MIT License
+ *
+ * Copyright (c) 2019 Jeremie Leclere
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy of this software and
+ * associated documentation files (the "Software"), to deal in the Software without restriction,
+ * including without limitation the rights to use, copy, modify, merge, publish, distribute,
+ * sublicense, and/or sell copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all copies or
+ * substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR IMPLIED, INCLUDING BUT
+ * NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND
+ * NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM,
+ * DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ **************************************************************************************************/
+
+#ifndef _VOICE_POOL_H_
+#define _VOICE_POOL_H_
+
+
+#include <errno.h>
+#include <stdint.h>
+
+#include <moog.h>
+#include <stats.h>
+
+
+/**
+ * @brief Maximal number of voices
+ *  Voices are mixed in 64 bits accumulators, which can't overflow whatever the voices level
+ * (resonant filters may push them beyond full scale).
+ */
+#define VOICE_POOL_MAX_VOICES   (256)
+
+
+/**
+ * @brief Opaque module handle
+ */
+struct voice_pool;
+
+
+/**
+ * @brief Voice stealing policy, applied to note ON events while no voice is idle
+ *  Voices in release are stolen first, held ones last.
+ */
+enum voice_pool_steal {
+    VOICE_POOL_STEAL_OLDEST,                    ///< Steal the voice whose note started first
+    VOICE_POOL_STEAL_QUIETEST                   ///< Steal the voice with the lowest enveloppe
+};
+
+
+/**
+ * @brief Initialization parameters
+ */
+struct voice_pool_params {
+    struct moog_params m_params;                ///< Voices parameters (shared by all voices)
+    int nb_voices;                              ///< Number of voices ([1, VOICE_POOL_MAX_VOICES])
+    enum voice_pool_steal steal;                ///< Voice stealing policy
+    float intensity;                            ///< Voices output intensity ([0,1])
+};
+
+
+/**
+ * @brief Initialize voice pool module
+ *
+ *  Every voice (Moog synthesizer and buffers) is allocated here: processing never allocates.
+ *
+ * @param[in] params        : Initialization parameters
+ *
+ * @return Module handle if successful, NULL else
+ */
+struct voice_pool *voice_pool_create(const struct voice_pool_params *params);
+
+
+/**
+ * @brief Release module ressources
+ *
+ * @param[in] handle        : Module handle
+ *
+ * @return None
+ */
+void voice_pool_destroy(struct voice_pool **handle);
+
+
+/**
+ * @brief Enable/disable per stage processing time measures (all voices and mix)
+ *
+ * @param[in] handle        : Module handle
+ * @param[in] stats         : Statistics structure to be updated (NULL to disable)
+ *
+ * @return 0 if successful, 0 > errno else
+ */
+int voice_pool_set_stats(struct voice_pool *handle, struct stats *stats);
+
+
+/**
+ * @brief Proceed to polyphonic generation
+ *
+ *  Moog events are routed to voices, at their exact sample offset:
+ *  . MOOG_EVENT_NOTE_ON starts the note on an idle voice, or on a stolen one if none is idle
+ *  . MOOG_EVENT_NOTE_OFF releases the voices playing the event frequency (all voices if 0).
+ *    Released voices are stolen before held ones, even by a note ON at the same offset
+ *  . Low pass filter events apply to every voice
+ *
+ *  With a single voice, a note ON always lands on the playing voice: this is the historical
+ * monophonic behaviour (legato if the previous note is still held, or released at the same
+ * offset).
+ *
+ * @param[in]  handle       : Module handle
+ * @param[in]  events       : Timed events, sorted by offset in [0, nb_frames] (can be NULL
+ *                            if nb_events is 0)
+ * @param[in]  nb_events    : Number of events
+ * @param[in]  nb_frames    : Number of samples to be generated
+ * @param[out] output       : Output QS8.23 signal (voices saturating sum)
+ *
+ * @return 0 if successful, 0 > errno
+ */
+int voice_pool_process(struct voice_pool *handle, const struct moog_event *events, int nb_events,
+                       int nb_frames, int32_t *output);
+
+
+/**
+ * @brief Proceed to polyphonic generation (floating point signal path)
+ *
+ *  Same as voice_pool_process, only available if voices use the MOOG_SAMPLE_FORMAT_FLOAT sample
+ * format.
+ *
+ * @param[in]  handle       : Module handle
+ * @param[in]  events       : Timed events, sorted by offset in [0, nb_frames] (can be NULL
+ *                            if nb_events is 0)
+ * @param[in]  nb_events    : Number of events
+ * @param[in]  nb_frames    : Number of samples to be generated
+ * @param[out] output       : Output signal (voices sum, full scale: [-1, 1[)
+ *
+ * @return 0 if successful, 0 > errno
+ */
+int voice_pool_process_float(struct voice_pool *handle, const struct moog_event *events,
+                             int nb_events, int nb_frames, float *output);
+
+
+/**
+ * @brief Move every voice forward as if samples were generated, without running their signal
+ *        path (see moog_fast_forward)
+ *
+ *  Events are routed exactly as by voice_pool_process, voices whose filter would still ring
+ * being considered silent though: the reached state is the very same as after voice_pool_process
+ * only if the voice allocations match, and output would be silent (see voice_pool_snapshot to
+ * compare states).
+ *
+ * @param[in]  handle       : Module handle
+ * @param[in]  events       : Timed events, sorted by offset in [0, nb_frames] (can be NULL
+ *                            if nb_events is 0)
+ * @param[in]  nb_events    : Number of events
+ * @param[in]  nb_frames    : Number of skipped samples
+ *
+ * @return 0 if successful, 0 > errno
+ */
+int voice_pool_fast_forward(struct voice_pool *handle, const struct moog_event *events,
+                            int nb_events, int nb_frames);
+
+
+/**
+ * @brief Save the whole pool state (voice allocations and every voice moog, see moog_snapshot)
+ *
+ *  Snapshots of pools in the same state are byte identical: comparing them tells whether
+ * rendering would go on the same way.
+ *
+ * @param[in]  handle       : Module handle
+ * @param[out] blob         : State snapshot (NULL to only get its size)
+ * @param[in]  size         : Blob size (bytes)
+ *
+ * @return Snapshot size (bytes) if successful, -ENOSPC if blob is too small, 0 > errno else
+ */
+int voice_pool_snapshot(struct voice_pool *handle, void *blob, int size);
+
+
+/**
+ * @brief Restore the whole pool state from a snapshot taken by a pool created with the same
+ *        parameters (see voice_pool_snapshot)
+ *
+ *  Restoration is all or nothing: every voice snapshot is checked before any is restored.
+ *
+ * @param[in] handle        : Module handle
+ * @param[in] blob          : State snapshot
+ * @param[in] size          : Blob size (bytes)
+ *
+ * @return Number of read bytes if successful, -EINVAL if the snapshot is not compatible with
+ *         this pool (state being left untouched), 0 > errno else
+ */
+int voice_pool_restore(struct voice_pool *handle, const void *blob, int size);
+
+
+/**
+ * @brief Check whether output is silent up to next event (every voice is silent)
+ *
+ * @param[in] handle        : Module handle
+ *
+ * @return 1 if silent, 0 else
+ */
+int voice_pool_is_silent(struct voice_pool *handle);
+
+
+/**
+ * @brief Skip silent samples (see moog_skip)
+ *
+ * @param[in] handle        : Module handle
+ * @param[in] nb_frames     : Number of skipped samples
+ *
+ * @return 0 if successful, -EAGAIN if output is not silent, 0 > errno else
+ */
+int voice_pool_skip(struct voice_pool *handle, int nb_frames);
+
+
+#endif /* _VOICE_POOL_H_ */
@@ -0,0 +1,286 @@
+/***************************************************************************************************
+ * @file wav_reader.c
+ *
+ * @brief WAV file reader module (sources)
+ *
+ * @licence MIT License
+ *
+ * Copyright (c) 2019 Jeremie Leclere
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy of this software and
+ * associated documentation files (the "Software"), to deal in the Software without restriction,
+ * including without limitation the rights to use, copy, modify, merge, publish, distribute,
+ * sublicense, and/or sell copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all copies or
+ * substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR IMPLIED, INCLUDING BUT
+ * NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND
+ * NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM,
+ * DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ **************************************************************************************************/
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include <wav_reader.h>
+
+
+#define HEADER_DATA        ("data")
+#define HEADER_FMT         ("fmt ")
+#define HEADER_RIFF        ("RIFF")
+#define HEADER_WAVE        ("WAVE")
+
+#define FORMAT_PCM         (1)
+#define FORMAT_FLOAT       (3)
+#define READ_CHUNK         (1024)                           ///< Number of samples per file read
+
+
+struct wav_reader {
+   FILE *fd;                                                ///< Input file descriptor
+   int  frame_size;                                         ///< Frame size (bytes)
+   int  nb_frames_read;                                     ///< Number of frames already read
+   uint8_t buffer[READ_CHUNK * 4];                          ///< Raw samples buffer
+   struct wav_reader_info info;                             ///< WAV file properties
+};
+
+
+/* Helper: Read 4 bytes value from file (little endian) */
+static int _read_32bits_value(FILE *fd, uint32_t *value)
+{
+   uint8_t tmp[4];
+
+   if (fread(tmp, sizeof(uint8_t), 4, fd) != 4)
+      return -EIO;
+
+   *value = tmp[0] | (tmp[1] << 8) | (tmp[2] << 16) | ((uint32_t)tmp[3] << 24);
+
+   return 0;
+}
+
+
+/* Helper: Read 2 bytes value from file (little endian) */
+static int _read_16bits_value(FILE *fd, uint16_t *value)
+{
+   uint8_t tmp[2];
+
+   if (fread(tmp, sizeof(uint8_t), 2, fd) != 2)
+      return -EIO;
+
+   *value = tmp[0] | (tmp[1] << 8);
+
+   return 0;
+}
+
+
+/*
+ * Parse RIFF header and chunks, until the data chunk is reached
+ *
+ *    http://soundfile.sapp.org/doc/WaveFormat/
+ */
+static int _read_header(struct wav_reader *handle)
+{
+   char id[4];
+   int fmt_found = 0;
+   uint16_t value16;
+   uint32_t value32, chunk_size;
+
+   if ((fread(id, sizeof(char), 4, handle->fd) != 4)
+   ||  (strncmp(id, HEADER_RIFF, 4) != 0)
+   ||  (_read_32bits_value(handle->fd, &value32))
+   ||  (fread(id, sizeof(char), 4, handle->fd) != 4)
+   ||  (strncmp(id, HEADER_WAVE, 4) != 0))
+      return -EINVAL;
+
+   while (1) {
+
+      if ((fread(id, sizeof(char), 4, handle->fd) != 4)
+      ||  (_read_32bits_value(handle->fd, &chunk_size)))
+         return -EINVAL;
+
+      if (strncmp(id, HEADER_FMT, 4) == 0) {
+
+         if (chunk_size < 16)
+            return -EINVAL;
+
+         /* AudioFormat, NumChannels, SampleRate, ByteRate, BlockAlign, BitsPerSample */
+         _read_16bits_value(handle->fd, &value16);
+         handle->info.format = value16;
+         _read_16bits_value(handle->fd, &value16);
+         handle->info.nb_channels = value16;
+         _read_32bits_value(handle->fd, &value32);
+         handle->info.fs = value32;
+         _read_32bits_value(handle->fd, &value32);
+         _read_16bits_value(handle->fd, &value16);
+         handle->frame_size = value16;
+         if (_read_16bits_value(handle->fd, &value16))
+            return -EINVAL;
+         handle->info.bit_depth = value16;
+
+         /* Skip format extension if any */
+         if (chunk_size > 16)
+            fseek(handle->fd, chunk_size - 16, SEEK_CUR);
+
+         fmt_found = 1;
+
+      } else if (strncmp(id, HEADER_DATA, 4) == 0) {
+
+         if ((!fmt_found) || (handle->frame_size <= 0))
+            return -EINVAL;
+
+         handle->info.nb_frames = chunk_size / handle->frame_size;
+         break;
+
+      } else {
+
+         /* Unknown chunk: Skip it (chunks are word aligned) */
+         fseek(handle->fd, chunk_size + (chunk_size & 1), SEEK_CUR);
+      }
+   }
+
+   /* Check format support */
+   if (((handle->info.format == FORMAT_PCM)
+   &&   (handle->info.bit_depth != 16)
+   &&   (handle->info.bit_depth != 24)
+   &&   (handle->info.bit_depth != 32))
+   ||  ((handle->info.format == FORMAT_FLOAT)
+   &&   (handle->info.bit_depth != 32))
+   ||  ((handle->info.format != FORMAT_PCM)
+   &&   (handle->info.format != FORMAT_FLOAT))
+   ||  (handle->info.nb_channels <= 0)
+   ||  (handle->frame_size != handle->info.nb_channels * (handle->info.bit_depth >> 3)))
+      return -EINVAL;
+
+   return 0;
+}
+
+
+struct wav_reader *wav_reader_create(const char *filename)
+{
+   struct wav_reader *handle = NULL;
+
+   if (!filename)
+      goto failure;
+
+   handle = calloc(1, sizeof(struct wav_reader));
+   if (!handle)
+      goto failure;
+
+   handle->fd = fopen(filename, "rb");
+   if (!(handle->fd))
+      goto failure;
+
+   if (_read_header(handle))
+      goto failure;
+
+   return handle;
+
+failure:
+
+   wav_reader_destroy(&handle);
+
+   return NULL;
+}
+
+
+void wav_reader_destroy(struct wav_reader **handle)
+{
+    if ((!handle) || (!(*handle)))
+        goto exit;
+
+    if ((*handle)->fd)
+        fclose((*handle)->fd);
+
+    free(*handle);
+    *handle = NULL;
+
+exit:
+
+    return;
+}
+
+
+int wav_reader_get_info(struct wav_reader *handle, struct wav_reader_info *info)
+{
+    int ret = 0;
+
+    if ((!handle) || (!info)) {
+        ret = -EINVAL;
+        goto exit;
+    }
+
+    memcpy(info, &handle->info, sizeof(struct wav_reader_info));
+
+exit:
+
+    return ret;
+}
+
+
+int wav_reader_read(struct wav_reader *handle, double *data, int nb_frames)
+{
+    float fvalue;
+    int32_t value;
+    uint8_t *sample;
+    int i, nb, nb_samples, sample_size, ret = 0;
+
+    if ((!handle) || (!data) || (nb_frames < 0)) {
+        ret = -EINVAL;
+        goto exit;
+    }
+
+    /* Don't read beyond data chunk */
+    if (nb_frames > handle->info.nb_frames - handle->nb_frames_read)
+        nb_frames = handle->info.nb_frames - handle->nb_frames_read;
+
+    sample_size = handle->info.bit_depth >> 3;
+    nb_samples  = nb_frames * handle->info.nb_channels;
+
+    while (nb_samples > 0) {
+
+        nb = (nb_samples > READ_CHUNK) ? READ_CHUNK : nb_samples;
+        if (fread(handle->buffer, sample_size, nb, handle->fd) != nb) {
+            ret = -EIO;
+            goto exit;
+        }
+
+        for (i = 0; i < nb; i++) {
+            sample = &handle->buffer[i * sample_size];
+            switch (sample_size) {
+            case 2:
+                value = (int16_t)(sample[0] | (sample[1] << 8));
+                *data++ = value / 32768.0;
+                break;
+            case 3:
+                value = (int32_t)(((uint32_t)sample[0] << 8) | ((uint32_t)sample[1] << 16)
+                                  | ((uint32_t)sample[2] << 24)) >> 8;
+                *data++ = value / 8388608.0;
+                break;
+            case 4:
+            default:
+                value = (int32_t)(sample[0] | (sample[1] << 8) | (sample[2] << 16)
+                                  | ((uint32_t)sample[3] << 24));
+                if (handle->info.format == FORMAT_FLOAT) {
+                    memcpy(&fvalue, &value, sizeof(float));
+                    *data++ = fvalue;
+                } else {
+                    *data++ = value / 2147483648.0;
+                }
+                break;
+            }
+        }
+
+        nb_samples -= nb;
+    }
+
+    handle->nb_frames_read += nb_frames;
+    ret = nb_frames;
+
+exit:
+
+    return ret;
+}
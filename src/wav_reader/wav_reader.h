@@ -0,0 +1,100 @@
+/***************************************************************************************************
+ * @file wav_reader.h
+ *
+ * @brief WAV file reader module (header)
+ *
+ * @licence MIT License
+ *
+ * Copyright (c) 2019 Jeremie Leclere
+ *
+ * Permission is hereby granted, free of charge, to any person obtaining a copy of this software and
+ * associated documentation files (the "Software"), to deal in the Software without restriction,
+ * including without limitation the rights to use, copy, modify, merge, publish, distribute,
+ * sublicense, and/or sell copies of the Software, and to permit persons to whom the Software is
+ * furnished to do so, subject to the following conditions:
+ *
+ * The above copyright notice and this permission notice shall be included in all copies or
+ * substantial portions of the Software.
+ *
+ * THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR IMPLIED, INCLUDING BUT
+ * NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY, FITNESS FOR A PARTICULAR PURPOSE AND
+ * NONINFRINGEMENT. IN NO EVENT SHALL THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM,
+ * DAMAGES OR OTHER LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING FROM,
+ * OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS IN THE SOFTWARE.
+ **************************************************************************************************/
+
+#ifndef _WAV_READER_H_
+#define _WAV_READER_H_
+
+
+#include <errno.h>
+#include <stdint.h>
+
+
+/**
+ * @brief Opaque module handle
+ */
+struct wav_reader;
+
+
+/**
+ * @brief WAV file properties
+ */
+struct wav_reader_info {
+    int fs;                                 ///< Sampling frequency (Hz)
+    int format;                             ///< Audio format (1: PCM, 3: IEEE float)
+    int bit_depth;                          ///< Sample size (bits)
+    int nb_channels;                        ///< Number of channels
+    int nb_frames;                          ///< Number of frames in file
+};
+
+
+/**
+ * @brief Module initialization
+ *
+ * @param[in] filename  : Input WAV filename
+ *
+ * @note Supported formats: 16, 24 and 32 bits PCM, 32 bits IEEE float
+ *
+ * @return Valid module handle if successful, NULL else
+ */
+struct wav_reader *wav_reader_create(const char *filename);
+
+
+/**
+ * @brief Release module resources
+ *
+ * @param[in] handle    : Module handle
+ *
+ * @return None
+ */
+void wav_reader_destroy(struct wav_reader **handle);
+
+
+/**
+ * @brief Get WAV file properties
+ *
+ * @param[in]  handle   : Module handle
+ * @param[out] info     : WAV file properties
+ *
+ * @return 0 if successful, 0 > errno else
+ */
+int wav_reader_get_info(struct wav_reader *handle, struct wav_reader_info *info);
+
+
+/**
+ * @brief Read WAV frames from input file
+ *
+ *  Samples are converted to double precision values, full scale being [-1,1[.
+ * Conversion is lossless for all supported formats.
+ *
+ * @param[in]  handle       : Module handle
+ * @param[out] data         : Interleaved output samples
+ * @param[in]  nb_frames    : Maximum number of frames to be read
+ *
+ * @return Number of frames read if successful (0 at end of file), errno (<0) else.
+ */
+int wav_reader_read(struct wav_reader *handle, double *data, int nb_frames);
+
+
+#endif /* _WAV_READER_H_ */
@@ -35,10 +35,12 @@
 #define HEADER_FMT         ("fmt ")
 #define HEADER_RIFF        ("RIFF")
 #define HEADER_WAVE        ("WAVE")
+#define SILENCE_SIZE       (4096)                           ///< Silence chunk size (bytes)
 
 
 struct wav_writer {
    int  fs;                                                 ///< Sampling frequency (Hz)
+   int  format;                                             ///< Samples format
    FILE *fd;                                                ///< Output file descriptor
    int  bit_depth;                                          ///< Sample size (bits)
    int  frame_size;                                         ///< Frame size (bytes)
@@ -99,7 +101,7 @@ static void _write_header(struct wav_writer *handle)
    _write_32bits_value(handle->fd, 16);
 
    /* AudioFormat */
-   _write_16bits_value(handle->fd, 1);
+   _write_16bits_value(handle->fd, handle->format);
 
    /* NumChannels */
    _write_16bits_value(handle->fd, handle->nb_channels);
@@ -129,7 +131,10 @@ struct wav_writer *wav_writer_create(struct wav_writer_params *params)
 {
    struct wav_writer *handle = NULL;
 
-    if (!params)
+    if ((!params)
+    ||  ((params->format != WAV_WRITER_FORMAT_PCM)
+    &&   (params->format != WAV_WRITER_FORMAT_FLOAT))
+    ||  ((params->format == WAV_WRITER_FORMAT_FLOAT) && (params->bit_depth != 32)))
         goto failure;
 
    handle = calloc(1, sizeof(struct wav_writer));
@@ -141,6 +146,7 @@ struct wav_writer *wav_writer_create(struct wav_writer_params *params)
       goto failure;
 
    handle->fs          = params->fs;
+   handle->format      = params->format;
    handle->bit_depth   = params->bit_depth;
    handle->nb_channels = params->nb_channels;
    handle->frame_size  = handle->nb_channels * (handle->bit_depth >> 3);
@@ -193,3 +199,34 @@ exit:
 
     return ret;
 }
+
+
+int wav_writer_write_silence(struct wav_writer *handle, int nb_frames)
+{
+    int n, written, ret = 0;
+    static const char silence[SILENCE_SIZE];
+
+    if ((!handle) || (nb_frames < 0)) {
+        ret = -EINVAL;
+        goto exit;
+    }
+
+    /* Null (PCM and IEEE float) samples, written by chunks of whole frames */
+    while (nb_frames > 0) {
+        n = SILENCE_SIZE / handle->frame_size;
+        if (n > nb_frames)
+            n = nb_frames;
+
+        written = fwrite(silence, handle->frame_size, n, handle->fd);
+        handle->nb_frames_written += written;
+        ret += written;
+        if (written < n)
+            break;
+
+        nb_frames -= n;
+    }
+
+exit:
+
+    return ret;
+}
@@ -37,12 +37,22 @@
 struct wav_writer;
 
 
+/**
+ * @brief WAV samples format
+ */
+enum wav_writer_format {
+   WAV_WRITER_FORMAT_PCM   = 1,             ///< Integer PCM samples
+   WAV_WRITER_FORMAT_FLOAT = 3              ///< IEEE floating point samples (32 bits)
+};
+
+
 /**
  * @brief WAV file parameters
  */
 struct wav_writer_params {
    int fs;                                  ///< Sampling frequency (Hz)
-   int bit_depth;                           ///< Sample size (bits)
+   enum wav_writer_format format;           ///< Samples format
+   int bit_depth;                           ///< Sample size (bits, 32 if WAV_WRITER_FORMAT_FLOAT)
    int nb_channels;                         ///< Number of channels
    const char *filename;                    ///< Output filename
 };
@@ -53,7 +63,7 @@ struct wav_writer_params {
  *
  * @param[in] params    : WAV file parameters
  *
- * @note Only PCM supported so far
+ * @note PCM and 32 bits IEEE float supported so far
  *
  * @return Valid module handle if successful, NULL else
  */
@@ -85,4 +95,15 @@ void wav_writer_destroy(struct wav_writer **handle);
 int wav_writer_write(struct wav_writer *handle, void *data, int nb_frames);
 
 
+/**
+ * @brief Write silent (null) WAV frames to output file
+ *
+ * @param[in] handle    : Module handle
+ * @param[in] nb_frames : Number of frames to be written
+ *
+ * @return nb_frames written if successful, errno (<0) else.
+ */
+int wav_writer_write_silence(struct wav_writer *handle, int nb_frames);
+
+
 #endif /* _WAV_WRITER_H_ */